@@ -10,8 +10,13 @@
 #define ADC_H_
 
 //#define ADC_OVERSAMPLE_RATE		4
-#define ADC_BUFFER_LENGTH 		32
-#define COEFF_SCALE				10000L
+#define ADC_DECIMATION			490		// Free-running conversions per CIC output, 9615 Hz / 490 ~ main loop rate
+#define ADC_FIR_LENGTH			8
+#define ADC_EXTRA_BITS			2		// adc_filtered is 2^ADC_EXTRA_BITS finer than calibration and PID counts
+#define COEFF_SCALE				(10000L << ADC_EXTRA_BITS)
+
+// adc_filtered or conv_Celsius_to_ADC() value in calibration and PID counts (4x adc_normalized), rounded
+#define ADC_TO_PID_COUNTS(x)	(((x) + (1 << (ADC_EXTRA_BITS - 1))) >> ADC_EXTRA_BITS)
 
 
 // adc_status bits:
@@ -22,6 +27,16 @@
 #define ADC_LOW_CORRECT		50
 #define ADC_HIGH_CORRECT	1000
 
+#ifdef FWSIM
+// Paths of conv_ADC_to_Celsius() / conv_Celsius_to_ADC(), counted for FwSim -convcheck
+#define CONV_PATH_FIXED		0		// Fixed point value
+#define CONV_PATH_CORRECTED	1		// Fixed point value corrected by one multiply-compare
+#define CONV_PATH_DIVISION	2		// Negative result or argument out of the fixed point range
+#define CONV_PATH_COUNT		3
+extern uint32_t conv_adc_paths[CONV_PATH_COUNT];
+extern uint32_t conv_celsius_paths[CONV_PATH_COUNT];
+#endif
+
 
 extern uint16_t adc_normalized;
 extern int16_t adc_celsius;
@@ -47,9 +47,15 @@
 #define __flash PROGMEM const
 #define read_byte_flash(x) pgm_read_byte(&(x)) 
 
+#ifndef FWSIM
 // http://radiokot.ru/forum/viewtopic.php?p=1381879
   #define PRELOAD(reg,var) \
   __asm__ __volatile (";PRELOAD " reg " with " #var : "=" reg (var) : "0" (var))
+#else
+// Host build with mock AVR headers, see simulation/FwSim
+#define PRELOAD(reg,var)
+#define __idle() mcu_idle()
+#endif
   
 #endif
 
@@ -78,6 +84,10 @@
 
 //____________________________________________
 
+// Main loop has nothing to do until next interrupt
+#ifndef __idle
+#define __idle()
+#endif
 
 
 #endif //COMPILERS_H
@@ -76,6 +76,9 @@ typedef struct
 
 #define USE_EEPROM_CRC						// CRC will be used for EEPROM parameter protection
 #define MAIN_LOOP_TIME_PROFILING			// If defined, maximum time of main loop will be sent over UART when device is switched off
+//#define STAGE_PROFILING					// If defined, execution time statistics of main loop stages and ISRs are sent over UART (profiler.h), takes about 300 bytes of SRAM
+//#define LOG_BINARY_TELEMETRY				// If defined, log is sent every main loop run as binary frames (telemetry.h) instead of text
+//#define SYNC_CALIBRATION_SAVE				// If defined, calibration is written at once and the main loop waits for EEPROM (former timing, see FwSim -calibcheck)
 
 //--------------------------------------------//
 // Global control and status variables bits
@@ -110,12 +113,12 @@ extern uint8_t max_work_time;
 
 void processRollControl(void);
 void processHeaterControl(void);
+void processHeaterPID(void);
 void processHeaterEvents(void);
 void processHeaterAlerts(void);
 uint8_t restoreGlobalParams(void);		// Returns zero if EEPROM data CRC is correct
 void exitPowerOff(void);
-void saveCalibrationToEEPROM(void);
-void saveGlobalParamsToEEPROM(void);
+void saveCalibrationToEEPROM(void (*done)(void));		// Background write, done() may be 0
 
 
 #endif /* CONTROL_H_ */
\ No newline at end of file
@@ -0,0 +1,34 @@
+/*
+ * eeprom_queue.h
+ *
+ * Background EEPROM writes: queue of blocks written by the main loop, see eeprom_queue.c
+ */
+
+
+#ifndef EEPROM_QUEUE_H_
+#define EEPROM_QUEUE_H_
+
+#define EEQ_LENGTH			4			// Queued blocks, saveCalibrationToEEPROM() takes two
+#define EEQ_DATA_MAX		6			// Bytes per block, sizeof(cParams_t)
+// Power fail path (flushEEPROMQueue()) writes the rest of the queue, 8.5 ms per changed byte:
+// up to EEQ_LENGTH * EEQ_DATA_MAX = 24 bytes, 204 ms. Calibration save queues 7 bytes - 60 ms
+// if power is lost right after it, the queue is empty in normal use.
+
+typedef void (*eeq_callback_t)(void);
+
+typedef struct
+{
+	uint8_t *address;					// EEPROM
+	uint8_t data[EEQ_DATA_MAX];			// Copy of the data taken when the block is queued
+	uint8_t length;
+	eeq_callback_t done;				// Called by processEEPROMQueue() when the block is written, may be 0
+} eeq_block_t;
+
+
+uint8_t queueEEPROMWrite(void *address, const void *data, uint8_t length, eeq_callback_t done);
+void processEEPROMQueue(void);
+void flushEEPROMQueue(void);
+
+
+
+#endif /* EEPROM_QUEUE_H_ */
@@ -27,24 +27,16 @@ bufStartPos defines start position for writing strings
 */
 
 
-//--------------------------------------------//
-// Typedefs
-
-typedef struct {
-	uint8_t code;
-	uint8_t segdata;
-} encode_7seg_pair;
-
-
 //--------------------------------------------//
 // Settings					
 
 #define NUM_DIGITS			6	// Number of digits of LED display
 #define LED_BUFFER_LENGTH	(NUM_DIGITS * 2 + 2)	
 
-#define SETUP_DELAY_US		5	// Serial data setup time, us
-#define SHIFT_DELAY_US		5	// Serial clock hold time, us
-#define PULLUP_DELAY_US		10	// Delay between disabling segment outputs and reading buttons
+// Shift register is clocked without delays - port writes are 2 CPU cycles (125ns) apart,
+// much longer than setup and pulse width times of HC logic.
+// Buttons are read one processLedIndicator() call after disabling segment outputs
+// and enabling pull-ups, so the ISR does not wait for pull-ups either.
 
 #define USE_EXTRA_LED_DIGIT		// Use this if you want to manage some separate LEDs dynamically
 #define USE_SIMPLE_PRINT		// Simplified string print (no comma processing)
@@ -92,6 +84,11 @@ typedef struct {
 #define LED_SHIFT_LEFT 	1
 #define LED_SHIFT_RIGHT	2
 
+// Button scan states
+#define BUTTON_SCAN_IDLE		0
+#define BUTTON_SCAN_REQUESTED	1	// Buttons will be read at the start of the next display cycle
+#define BUTTON_SCAN_ACTIVE		2	// Scan line is active, segment outputs are HI-Z with pull-ups
+
 
 //--------------------------------------------//
 // Externs		
@@ -119,6 +116,7 @@ extern volatile uint8_t raw_button_state;
 // User functions
 void initLedIndicator();
 void processLedIndicator();
+void requestButtonScan(void);
 
 void setWindowStartPos(int8_t pos);
 void shiftWindowPosition(int8_t increment);
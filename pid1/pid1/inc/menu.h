@@ -11,7 +11,6 @@
 typedef void (*FuncPtr)(void);
 
 typedef struct {
-	uint8_t		Item;				//
 	uint16_t	JumpCondition;      //
 	uint8_t		NextItem;			//
 	uint8_t		Flags;
@@ -19,13 +18,19 @@ typedef struct {
 
 
 typedef struct {
-	uint8_t				Item;				//
 	FuncPtr				SelectFunction;     //
 	FuncPtr				RunFunction;		//
 	FuncPtr				LeaveFunction;      //
 } MenuFunctionRecord;
 
 
+typedef struct {
+	MenuFunctionRecord		Functions;
+	const MenuJumpRecord	*Jumps;			// Jumps of the item in priority order, FLASH
+	uint8_t					JumpCount;
+} MenuItemRecord;
+
+
 typedef struct {
 	uint8_t ItemID;
 	uint8_t ItemTimeout;
@@ -52,6 +57,7 @@ typedef struct {
 #define		mi_ACTSNDEN		0x0B
 #define		mi_ACTAUTOPOFF	0x0C
 #define		mi_POFFACT		0x0E
+#define		MENU_ITEM_COUNT	0x0F	// Size of menuItemSet[], items are indexed by ID
 
 // MenuJumpRecord flags:
 #define 	SHIFT_LEFT		0x80
@@ -75,6 +81,7 @@ typedef struct {
 
 void InitMenu(void);
 void processMenu(void);
+NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCond);
 
 
 
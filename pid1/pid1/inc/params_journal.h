@@ -0,0 +1,48 @@
+/*
+ * params_journal.h
+ *
+ * Wear-levelled EEPROM store of global params (gParams_t): ring of records, see params_journal.c
+ */
+
+
+#ifndef PARAMS_JOURNAL_H_
+#define PARAMS_JOURNAL_H_
+
+#include "control.h"
+
+/*
+	Record, JOURNAL_RECORDS of them in a ring:
+
+	offset	type		value
+	0		gParams_t	params
+	4		uint8_t		sequence number, incremented by every record
+	5		uint8_t		commit byte: CRC-8 of bytes 0-4 with bit 7 cleared, JOURNAL_NO_COMMIT while written
+
+	Valid record with the highest sequence number (compared modulo 256) holds current params.
+	Record is written to the slot after the latest one: commit byte is cleared first, then changed
+	body bytes and the commit byte at last. Power loss at any byte leaves either the new record
+	valid or the latest one - see -eepromcheck of FwSim.
+*/
+
+#define JOURNAL_RECORDS			32			// Every slot is written once per JOURNAL_RECORDS commits
+#define JOURNAL_NO_COMMIT		0xFF		// Valid commit bytes have bit 7 cleared
+#define JOURNAL_CRC_SEED		0x5A		// Zero filled record is not valid
+
+typedef struct
+{
+	gParams_t params;
+	uint8_t seq;
+	uint8_t commit;
+} journal_record_t;
+
+
+extern journal_record_t ee_journal[JOURNAL_RECORDS];		// EEMEM
+
+uint8_t restoreJournalParams(void);		// Loads p, returns zero if a valid record is found
+void commitGlobalParams(void);
+void processParamsJournal(void);
+void finishParamsJournal(void);
+
+
+
+#endif /* PARAMS_JOURNAL_H_ */
@@ -52,6 +52,7 @@
 // Integrator limit function parameters
 #define INTEGRATOR_SOFT_LIMIT
 #define INTEGRATOR_SOFT_RANGE	(PROP_MAX / Kp)		// Start integrating when error becomes such that p_term is less than PROP_MAX
+#define INTEGRATOR_SOFT_SLOPE	12					// integ_soft_k per Celsius degree of set point, see setPIDIntegratorLimit()
 //#define INTEGRATOR_SOFT_MAX		(30 * 10000L)		// Intergator maximum when error = 0		
 //#define INTEGRATOR_SOFT_K	(INTEGRATOR_SOFT_MAX / INTEGRATOR_SOFT_RANGE)
 
@@ -69,12 +70,40 @@
 //------------------------------------------//
 
 
+//------------------------------------------//
+// Power-of-two scaled controller - processPIDShift()
+//------------------------------------------//
+// Same gains and limits as above, without 32-bit divisions. Terms are scaled by
+// 2^PID_SHIFT_OUTPUT / SCALING_FACTOR (1.6), so the output is the summ of terms shifted right.
+// Integrator is scaled by 2^16 instead of INTEGRATOR_SCALE, i_term is the high word of it.
+// Debug p_term, i_term and d_term are in the scaled units.
+//#define PID_SHIFT_SCALING					// If defined, control.c uses processPIDShift() instead of processPID()
+
+#define PID_SHIFT_OUTPUT		5
+#define PID_SHIFT_TERM(x)		(((x) * (1L << PID_SHIFT_OUTPUT) + SCALING_FACTOR / 2) / SCALING_FACTOR)
+#define PID_SHIFT_INTEGRATOR(x)	((((x) << 16) * (1L << PID_SHIFT_OUTPUT) + (SCALING_FACTOR * INTEGRATOR_SCALE) / 2) / (SCALING_FACTOR * INTEGRATOR_SCALE))
+
+#define PID_SHIFT_KP			PID_SHIFT_TERM(Kp)						// 68.8 -> 69
+#define PID_SHIFT_PROP_MAX		PID_SHIFT_TERM(PROP_MAX)
+#define PID_SHIFT_PROP_MIN		(-PID_SHIFT_TERM(-PROP_MIN))
+#define PID_SHIFT_KI			PID_SHIFT_INTEGRATOR((int32_t)Ki)		// 36700.16 -> 36700
+#define PID_SHIFT_INTEGRATOR_MAX	(PID_SHIFT_TERM(INTEGRATOR_MAX / INTEGRATOR_SCALE) << 16)
+#define PID_SHIFT_INTEGRATOR_MIN	(PID_SHIFT_TERM(INTEGRATOR_MIN / INTEGRATOR_SCALE) << 16)
+#define PID_SHIFT_SOFT_SLOPE	PID_SHIFT_INTEGRATOR((int32_t)INTEGRATOR_SOFT_SLOPE)	// 12582.9 -> 12583
+#define PID_SHIFT_KD			PID_SHIFT_TERM(Kd)
+#define PID_SHIFT_DIFF_MAX		PID_SHIFT_TERM(DIFF_MAX)
+#define PID_SHIFT_DIFF_MIN		(-PID_SHIFT_TERM(-DIFF_MIN))
+//------------------------------------------//
+
+
 
 
 extern dbg_PID_t dbg_PID_struct;
 
 void setPIDIntegratorLimit(uint8_t set_temp);
 uint16_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode);
+void setPIDShiftIntegratorLimit(uint8_t set_temp);
+uint16_t processPIDShift(uint16_t setPoint, uint16_t processValue, uint8_t mode);
 
 
 
@@ -0,0 +1,69 @@
+/*
+ * profiler.h
+ *
+ * Execution time profiler of the main loop stages and ISRs, enabled by STAGE_PROFILING (control.h)
+ */ 
+
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "scheduler.h"
+
+/*
+	Timestamp is a free running 16-bit counter of Timer2 clocks (4us @ 16MHz): systick
+	milliseconds * 250 + TCNT2. It wraps every 262ms, longer intervals are not measured correctly.
+	Main loop stage times include ISRs that have interrupted the stage. ISR times do not include
+	register save / restore code of the ISR prologue and epilogue.
+	
+	Statistics (count, min, average, max and histogram) are kept in SRAM and sent over UART
+	every 10 seconds or when 'p' is received, one line per run of the profiler task:
+	
+		prof   <id>   <count>   <min>   <avg>   <max>   <histogram bins 0-5>
+	
+	Times are in units of 4us. Histogram bins are < 16us, < 64us, < 256us, < 1ms, < 4ms, >= 4ms.
+	Statistics are cleared when sent. Counting stops at 65535 calls - ADC ISR (9615 calls per second)
+	statistics cover the first 6.8 seconds of a period.
+*/
+
+// Profiled stages. IDs 0 to TASK_COUNT - 1 are the main loop tasks (scheduler.h),
+// a task is counted at the ticks it runs.
+#define PROF_LOOP				(TASK_COUNT + 0)		// Whole main loop run
+#define PROF_ISR_TIMER2			(TASK_COUNT + 1)		// TIMER2_COMP_vect
+#define PROF_ISR_TIMER0			(TASK_COUNT + 2)		// TIMER0_OVF_vect
+#define PROF_ISR_ANA_COMP		(TASK_COUNT + 3)		// ANA_COMP_vect
+#define PROF_ISR_ADC			(TASK_COUNT + 4)		// ADC_vect
+#define PROF_ISR_UDRE			(TASK_COUNT + 5)		// USART_UDRE_vect
+#define PROF_COUNT				(TASK_COUNT + 6)
+
+#define PROF_TIMER_PERIOD		250		// Timer2 clocks per systick, OCR2 + 1
+#define PROF_HIST_BINS			6
+#define PROF_HIST_FIRST_LIMIT	4		// Timestamp units, upper limit of bin 0. Every next bin is 4 times wider.
+
+
+#ifdef STAGE_PROFILING
+
+extern volatile uint16_t profiler_ms;
+
+uint16_t getProfilerTimestamp(void);
+uint16_t profileStage(uint8_t id, uint16_t start);
+void processProfiler(void);
+
+#define PROFILE_SYSTICK()		profiler_ms++
+#define PROFILE_START(t)		(t) = getProfilerTimestamp()
+#define PROFILE_STAGE(id,t)		(t) = profileStage((id),(t))
+#define PROFILE_ISR_ENTER()		uint16_t prof_isr_start = getProfilerTimestamp()
+#define PROFILE_ISR_EXIT(id)	profileStage((id),prof_isr_start)
+
+#else
+
+#define PROFILE_SYSTICK()
+#define PROFILE_START(t)
+#define PROFILE_STAGE(id,t)
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT(id)
+
+#endif
+
+
+#endif /* PROFILER_H_ */
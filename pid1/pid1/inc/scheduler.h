@@ -0,0 +1,75 @@
+/*
+ * scheduler.h
+ *
+ * Main loop task table and cooperative scheduler, see scheduler.c
+ */
+
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "control.h"
+
+/*
+	Every main loop run is a tick (MENU_UPDATE_INTERVAL). Ticks are counted from 0 - the first
+	run after start. Task runs at ticks where tick % period == phase. requestTask() makes
+	a task run at the current tick if it comes later in the table than the caller, otherwise
+	at the next tick - periodic runs are not shifted.
+
+	Tasks due at the same tick run in table order: the table is sorted by priority, task ID
+	is the index. Phases of the heavy periodic tasks (Celsius update, PID, text log) differ,
+	so a tick runs at most one of them. Profiler output runs at the ticks without text log.
+
+	Task statistics, counting stops at 255:
+		overruns		- next tick became due while the task was running
+		deadline_misses	- task finished after the next tick became due
+	Overrun of a task gives deadline misses of the tasks after it in the same run.
+	Late tick is not skipped - the next run starts at once.
+*/
+
+// Task IDs, profiler stage IDs are the same (profiler.h)
+#define TASK_BUTTONS		0		// process_buttons(), sound feedback, Sound_Prefetch()
+#define TASK_TIMERS			1		// processSystemTimers(), every 10 seconds
+#define TASK_ADC			2		// update_normalized_adc()
+#define TASK_CELSIUS		3		// update_Celsius()
+#define TASK_MENU			4		// processMenu(), EEPROM writers
+#define TASK_ROLL			5		// processRollControl()
+#define TASK_HEATER			6		// processHeaterEvents(), processHeaterControl()
+#define TASK_PID			7		// processHeaterPID()
+#define TASK_ALERTS			8		// processHeaterAlerts()
+#define TASK_LOG			9		// UART log
+#ifdef STAGE_PROFILING
+#define TASK_PROFILER		10		// processProfiler()
+#define TASK_COUNT			11
+#else
+#define TASK_COUNT			10
+#endif
+
+#define TASK_STAT_MAX		0xFF
+
+typedef struct
+{
+	void (*run)(void);
+	uint8_t period;			// Ticks, 1 to 255
+	uint8_t phase;			// Ticks, 0 to period - 1
+} task_t;
+
+typedef struct
+{
+	uint8_t countdown;		// Ticks till the next periodic run
+	uint8_t pending;		// Task runs at this tick, set by countdown end or requestTask()
+	uint8_t overruns;
+	uint8_t deadline_misses;
+} task_state_t;
+
+
+extern const task_t main_tasks[TASK_COUNT];		// PROGMEM, pid1.c
+extern task_state_t task_states[TASK_COUNT];
+
+void initScheduler(const task_t *tasks, uint8_t count);
+void runScheduler(void);
+void requestTask(uint8_t id);
+
+
+
+#endif /* SCHEDULER_H_ */
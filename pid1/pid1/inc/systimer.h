@@ -12,32 +12,27 @@
 // System timers intervals
 #define MENU_UPDATE_INTERVAL 			50		// Reference value for all soft system timers, in units of main systimer ticks (1ms)
 
+// Task periods of the scheduler (scheduler.h), up to 255
 #define CELSIUS_UDPATE_INTERVAL			4		// in units of MENU_UPDATE_INTERVAL (50ms)			-> 200ms
 #define COUNTER_10SEC_INTERVAL			200		// in units of MENU_UPDATE_INTERVAL (50ms)			-> 10s
 //#define COUNTER_10SEC_INTERVAL		5		// in units of MENU_UPDATE_INTERVAL (50ms)			-> 0.25s (for debug)
-#define COUNTER_1MIN_INTERVAL			6		// in units of COUNTER_10SEC_INTERVAL (10s)			-> 1m
 #define LOG_INTERVAL					2		// in units of MENU_UPDATE_INTERVAL (50ms)			-> 100ms
-#define PID_UPDATE_INTERVAL			(5 * 4)		// in units of CELSIUS_UDPATE_INTERVAL (200ms)		-> 0.2 to 50 seconds
+#define PID_UPDATE_INTERVAL			(5 * 4 * CELSIUS_UDPATE_INTERVAL)	// in units of MENU_UPDATE_INTERVAL (50ms)	-> 4s
+
+#define COUNTER_1MIN_INTERVAL			6		// in units of COUNTER_10SEC_INTERVAL (10s)			-> 1m
 
 
-// System timers flags
-#define EXPIRED_CELSIUS		0x01
+// System timers flags, set for one tick of the scheduler
 #define EXPIRED_10SEC		0x02
 #define EXPIRED_1MIN		0x04
-#define AUTOPOFF_SOON		0x08
 #define AUTOPOFF_EXPIRED	0x10
-#define EXPIRED_LOG			0x20
-#define UPDATE_PID			0x40
 
 
 
 typedef struct {
-	uint8_t celsius_upd_counter;			// about 200ms
-	uint8_t counter_10sec;		
 	uint8_t counter_1min;		
 	uint8_t poff_counter;	
-	uint8_t log_counter;	
-	uint8_t pid_update_counter;
+	uint16_t loop_ticks;					// Scheduler ticks
 	//uint8_t flags;
 } sys_timers_t;
 
@@ -63,6 +58,7 @@ void processSystemTimers(void);
 #define SOUND_GET_NEXT_TONE 5
 
 #define TONE_DURATION_SCALE 10				// Single note duration may be up to 2.55 seconds
+#define SOUND_QUEUE_LENGTH	8				// Tones prefetched from EEPROM, power of 2. Holds SOUND_QUEUE_LENGTH - 1 tones.
 
 #define FREQ(x) (125000 / x)				// Macro for specifying timer period from Hz frequency
 #define LAST(y)	(y/TONE_DURATION_SCALE)		// Macro for specifying tone duration from ms time units
@@ -78,6 +74,7 @@ typedef struct
 void Sound_Play(const tone_t* p_melody);
 void Sound_Stop(void);
 void Sound_OverrideDisable(void);
+void Sound_Prefetch(void);
 
 extern const tone_t m_beep_1000Hz_100ms[];
 extern const tone_t m_beep_1000Hz_40ms[];
@@ -91,6 +88,8 @@ extern const tone_t m_siren4[];
 extern const tone_t m_beep_warn_poff[];
 
 // Every melody table must be terminated with tone pair where duration = 0
+// Sound_Prefetch() is called by every main loop run, so SOUND_QUEUE_LENGTH - 1 tones
+// must last longer than a main loop run with EEPROM write (e.g. 7 x 40ms).
 
 
 
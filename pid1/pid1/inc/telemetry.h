@@ -0,0 +1,39 @@
+/*
+ * telemetry.h
+ *
+ * Binary UART log, replaces the text log task of pid1.c if LOG_BINARY_TELEMETRY is defined (control.h)
+ */ 
+
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/*
+	Record, little endian, same columns as the text log:
+	
+	offset	type		value
+	0		uint8_t		sequence number, incremented by every record
+	1		uint16_t	main loop tick (MENU_UPDATE_INTERVAL units)
+	3		int16_t		adc_celsius
+	5		uint16_t	adc_normalized
+	7		uint16_t	adc_filtered
+	9		uint16_t	PID_SetPoint
+	11		uint16_t	PID_ProcessValue
+	13		int16_t		PID_p_term
+	15		int16_t		PID_d_term
+	17		int16_t		PID_i_term
+	19		uint16_t	PID_output
+	21		uint8_t		CRC-8 of bytes 0-20, _crc_ibutton_update()
+	
+	Frame: record encoded with COBS (no zero bytes inside) followed by 0x00 delimiter.
+	Record is shorter than 254 bytes, so the frame is 1 byte longer than the record plus delimiter.
+*/
+
+#define TELEMETRY_RECORD_LENGTH		22		// Including CRC
+
+
+void sendTelemetry(void);
+
+
+
+#endif /* TELEMETRY_H_ */
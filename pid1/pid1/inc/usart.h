@@ -9,6 +9,10 @@
 #ifndef USART_H_
 #define USART_H_
 
+#define USART_TX_BUFFER_LENGTH	128			// Transmit queue, must be a power of 2 and not greater than 256
+
+extern uint16_t usart_tx_dropped;			// Bytes dropped because transmit queue was full
+
 // Functions for log optimization
 void logU16p(uint16_t val);
 void logI32p(int32_t val);
@@ -16,6 +20,7 @@ void logI32p(int32_t val);
 void USART_send( uint8_t data );
 void USART_sendstr(char* str);
 void USART_sendstr_E(const char *estr);
+void USART_discard(void);
 
 
 
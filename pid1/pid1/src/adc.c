@@ -10,6 +10,7 @@
 #include "adc.h"
 #include "fir_filter.h"
 #include "control.h"
+#include "profiler.h"
 
 
 /*
@@ -28,45 +29,73 @@
 
 uint16_t adc_normalized;	// normalized ADC value (used for debug only)
 int16_t adc_celsius;		// Celsius degree value (used for indication / calibration)
-uint16_t adc_filtered;		// Oversampled and filtered ADC value, used for conversion to Celsius, calibration and PID
+uint16_t adc_filtered;		// Decimated and filtered ADC value, used for conversion to Celsius, calibration and PID
 uint8_t adc_status;			// Sensor and ADC status
 
 
+#define ADC_CIC_GAIN	((uint32_t)ADC_DECIMATION * ADC_DECIMATION)
+
+// Reciprocal of ADC_CIC_GAIN for the high word of the rounded CIC output, rounded down
+// (35776 for ADC_DECIMATION 490, must fit 16 bits), see update_normalized_adc()
+#define ADC_CIC_RECIP_SHIFT	17
+#define ADC_CIC_RECIP	((uint16_t)((1ULL << (16 + ADC_CIC_RECIP_SHIFT)) / ADC_CIC_GAIN))
+
 // Internal variables
-static uint16_t raw_adc_buffer[ADC_BUFFER_LENGTH];	// Buffer for raw ADC samples
-static int16_t filter_buffer[20];					// FIR filter buffer
+static volatile uint32_t adc_cic_output;			// Latest CIC output, ADC_CIC_GAIN times the mean (1024 - ADC), updated by ADC ISR
+static int16_t filter_buffer[ADC_FIR_LENGTH];		// FIR filter buffer
 
 static filter8bit_core_t fir_filter_rect = {
 	.coeffs = {
-		   11,
-           21,
-           33,
-           44,
-           55,
-           65,
-           73,
-           79,
-           83,
-           84,
-           83,
-           79,
-           73,
-           65,
-           55,
-           44,
-           33,
-           21,
-           11,
-            2
+            8,
+           27,
+           49,
+           64,
+           64,
+           49,
+           27,
+            8
 	},
-	.n = 20,
-	.dc_gain = 1014
+	.n = ADC_FIR_LENGTH,
+	.dc_gain = 296
 };
 
 
 static int32_t k_norm;				// integer, scaled by COEFF_SCALE
 static int32_t offset_norm;			// integer, scaled by COEFF_SCALE
 
+/*
+	Division-free conversion.
+	Both conversions are linear functions of the argument divided by a constant. calculateCoeffs()
+	turns them into fixed point functions with 2^CONV_xxx_BITS scale and slope and offset rounded down:
+		ADC to Celsius:		(adc * k_adc_conv + offset_adc_conv) >> CONV_ADC_BITS
+		Celsius to ADC:		(degree * k_celsius_conv + offset_celsius_conv) >> CONV_CELSIUS_BITS
+	Fixed point value is less than the exact quotient by less than (argument + 1) / 2^CONV_xxx_BITS,
+	so it has the same integer part when the fraction is not within that distance of the next integer.
+	Otherwise (below 1% of arguments at operating temperatures) the integer part q is one less than
+	the result or equal to it: one multiply-compare, dividend - q * divisor >= divisor, gives it.
+	Negative results and arguments out of the fast range use division and give the same result as before.
+*/
+#define CONV_ADC_BITS		20
+#define CONV_CELSIUS_BITS	16
+#define CONV_ADC_RANGE		(1L << (10 + 4))	// adc_filtered is 16x 10-bit sample
+#define CONV_CELSIUS_RANGE	256					// uint8_t setup temperature
+#define CONV_PRODUCT_MAX	(1L << 30)			// Fixed point products and offsets are below, sums fit int32_t
+
+static int32_t k_adc_conv;
+static int32_t offset_adc_conv;
+static int32_t k_celsius_conv;
+static int32_t offset_celsius_conv;
+static uint16_t adc_conv_range;			// Fast path is used for arguments below, 0 if conversion needs division
+static uint16_t celsius_conv_range;
+
+#ifdef FWSIM
+uint32_t conv_adc_paths[CONV_PATH_COUNT];
+uint32_t conv_celsius_paths[CONV_PATH_COUNT];
+#define CONV_PATH(counts, path)		counts[path]++
+#else
+#define CONV_PATH(counts, path)
+#endif
+
 
 //-------------------------------------------------------//
 // Converts ADC counts to Celsius degree
@@ -74,6 +103,26 @@ static int32_t offset_norm;			// integer, scaled by COEFF_SCALE
 //-------------------------------------------------------//
 int16_t conv_ADC_to_Celsius(uint16_t adc_value)
 {	
+	int32_t temp;
+	int16_t q;
+	if (adc_value < adc_conv_range)
+	{
+		temp = (int32_t)adc_value * k_adc_conv + offset_adc_conv;
+		if (temp >= 0)
+		{
+			q = (int16_t)(temp >> CONV_ADC_BITS);
+			if (((uint32_t)temp & ((1UL << CONV_ADC_BITS) - 1)) <= ((1UL << CONV_ADC_BITS) - 1) - adc_value)
+			{
+				CONV_PATH(conv_adc_paths, CONV_PATH_FIXED);
+				return q;
+			}
+			CONV_PATH(conv_adc_paths, CONV_PATH_CORRECTED);
+			if ((int32_t)adc_value * k_norm + offset_norm + (COEFF_SCALE>>1) - (int32_t)q * COEFF_SCALE >= COEFF_SCALE)
+				q++;
+			return q;
+		}
+	}
+	CONV_PATH(conv_adc_paths, CONV_PATH_DIVISION);
 	//return (int16_t)(((int32_t)adc_value * k_norm + offset_norm) / (COEFF_SCALE));					// Truncate
 	return (int16_t)(((int32_t)adc_value * k_norm + offset_norm + (COEFF_SCALE>>1)) / (COEFF_SCALE));	// Round
 }
@@ -84,34 +133,120 @@ int16_t conv_ADC_to_Celsius(uint16_t adc_value)
 //-------------------------------------------------------//
 uint16_t conv_Celsius_to_ADC(int16_t degree_value)
 {
+	int32_t temp;
+	uint16_t q;
+	if ((uint16_t)degree_value < celsius_conv_range)
+	{
+		temp = (int32_t)degree_value * k_celsius_conv + offset_celsius_conv;
+		if (temp >= 0)
+		{
+			q = (uint16_t)(temp >> CONV_CELSIUS_BITS);
+			if (((uint32_t)temp & ((1UL << CONV_CELSIUS_BITS) - 1)) <= ((1UL << CONV_CELSIUS_BITS) - 1) - (uint16_t)degree_value)
+			{
+				CONV_PATH(conv_celsius_paths, CONV_PATH_FIXED);
+				return q;
+			}
+			CONV_PATH(conv_celsius_paths, CONV_PATH_CORRECTED);
+			if ((int32_t)degree_value * COEFF_SCALE - offset_norm + (k_norm>>1) - (int32_t)q * k_norm >= k_norm)
+				q++;
+			return q;
+		}
+	}
+	CONV_PATH(conv_celsius_paths, CONV_PATH_DIVISION);
 	//degree_value += 1;
 	//return (uint16_t)(((int32_t)degree_value * COEFF_SCALE - offset_norm) / k_norm);				// Truncate
 	return (uint16_t)(((int32_t)degree_value * COEFF_SCALE - offset_norm + (k_norm>>1)) / k_norm);	// Round
 }
 
+//-------------------------------------------------------//
+// Calculates floor(value * 2^bits / divisor) for divisor > 0:
+//	one division and binary long division of the remainder.
+// Returns 0 if the result is not within +-CONV_PRODUCT_MAX
+//-------------------------------------------------------//
+static uint8_t divideScaled(int32_t value, int32_t divisor, uint8_t bits, int32_t *result)
+{
+	int32_t q = value / divisor;
+	int32_t r = value % divisor;
+	if (r < 0)
+	{
+		q--;
+		r += divisor;
+	}
+	if ((q >= (CONV_PRODUCT_MAX >> bits)) || (q < -(CONV_PRODUCT_MAX >> bits)))
+		return 0;
+	while (bits--)
+	{
+		q += q;
+		r += r;
+		if (r >= divisor)
+		{
+			r -= divisor;
+			q++;
+		}
+	}
+	*result = q;
+	return 1;
+}
+
+//-------------------------------------------------------//
+// Calculates fixed point constants of division-free conversion
+//	from k_norm and offset_norm. Fast range is limited to keep sums in int32_t.
+//-------------------------------------------------------//
+static void calculateConversion(void)
+{
+	int32_t range;
+	adc_conv_range = 0;
+	celsius_conv_range = 0;
+	if (k_norm <= 0)
+		return;
+	if (divideScaled(k_norm, COEFF_SCALE, CONV_ADC_BITS, &k_adc_conv) &&
+		divideScaled(offset_norm + (COEFF_SCALE>>1), COEFF_SCALE, CONV_ADC_BITS, &offset_adc_conv) && (k_adc_conv > 0))
+	{
+		range = CONV_PRODUCT_MAX / k_adc_conv;
+		adc_conv_range = (range < CONV_ADC_RANGE) ? range : CONV_ADC_RANGE;
+	}
+	if (divideScaled(COEFF_SCALE, k_norm, CONV_CELSIUS_BITS, &k_celsius_conv) &&
+		divideScaled((k_norm>>1) - offset_norm, k_norm, CONV_CELSIUS_BITS, &offset_celsius_conv) && (k_celsius_conv > 0))
+	{
+		range = CONV_PRODUCT_MAX / k_celsius_conv;
+		celsius_conv_range = (range < CONV_CELSIUS_RANGE) ? range : CONV_CELSIUS_RANGE;
+	}
+}
+
 //-------------------------------------------------------//
 // Calculates k_norm and offset_norm for ADC to Celsius conversion
 //  ADC(sensor) function is considered linear, so two points are required.
 //	Every point holds Celsius value and corresponding ADC value
 // 	k_norm and offset_norm are scaled by COEFF_SCALE to reduce error
+//	Calibration points are kept in PID counts, k_norm and offset_norm are for adc_filtered
 //-------------------------------------------------------//
 void calculateCoeffs(void)
 {
 	//k_norm = ((int32_t)(cp.cpoint2 - cp.cpoint1) * COEFF_SCALE) / ((int32_t)(cp.cpoint2_adc - cp.cpoint1_adc));	// Truncate
-	int16_t temp = cp.cpoint2_adc - cp.cpoint1_adc;
+	int16_t temp = (cp.cpoint2_adc - cp.cpoint1_adc) << ADC_EXTRA_BITS;
 	k_norm = ((int32_t)(cp.cpoint2 - cp.cpoint1) * COEFF_SCALE + (int32_t)(temp>>1)) / ((int32_t)temp);				// Round
-	offset_norm = (int32_t)cp.cpoint1 * COEFF_SCALE - (int32_t)cp.cpoint1_adc * k_norm;
+	offset_norm = (int32_t)cp.cpoint1 * COEFF_SCALE - ((int32_t)cp.cpoint1_adc << ADC_EXTRA_BITS) * k_norm;
+	calculateConversion();
 }
 
 /*
 	In order to increase ADC resolution oversampling is used.
 	To get result with n extra bits the summ of 4^n samples must be divided by 2^n.
-	If we want 12-bit result from 10-bit raw ADC, we should get 4^2 = 16 samples, summ them and
-	divide by 2^2 = 4 (equal to right-shift by 2)
+	Noise of the sensor and ADC (some tenths of ADC step) dithers the conversions.
+	
+	ADC runs free - prescaler 128, 13 ADC clocks per conversion, 9615 conversions per second.
+	ADC ISR feeds conversions to a CIC decimator of order 2: two integrators are updated
+	by every conversion, two combs - by every ADC_DECIMATION-th one. CIC output is the summ of
+	the last 2 * ADC_DECIMATION conversions with triangular weights, ADC_CIC_GAIN times their mean.
+	Integrators wrap around, combs still give the exact summ - 1024 * ADC_CIC_GAIN fits 32 bits.
+	ADC_DECIMATION is chosen to give one output per main loop run.
 	
-	adc_oversampled (adc_filtered) is about 8x celsius_degree - 
+	adc_oversampled (adc_filtered) is 16x adc_normalized (14 bits), about 32x celsius_degree - 
 		~2x - hardware ADC scale
-		4x - oversampling
+		16x - oversampling
+	Calibration points and PID input are kept in 4x counts (ADC_TO_PID_COUNTS()),
+	so EEPROM data and PID tuning are the same as with 4x oversampling.
+	RSim -adcmodel gives noise, delay and ISR load of averaging and FIR variants.
 */
 
 
@@ -125,26 +260,34 @@ void calculateCoeffs(void)
 // Gets average of raw ADC buffer, performs filtering
 // and updates global ADC variables:
 //	adc_normalized - average, but non-filtered (1024-ADCW) value
-//	adc_filtered - oversampled and filtered version, 4x adc_normalized
+//	adc_filtered - oversampled and filtered version, 16x adc_normalized
 //-------------------------------------------------------//
 void update_normalized_adc()
 {
-	uint8_t i;
-	uint16_t adc_raw_summ = 0;
+	uint32_t adc_cic;
+	uint32_t remainder;
 	uint16_t adc_oversampled;
 	
-	// Disable interrupts from ADC - to save data integrity
-	ADCSRA = (1<<ADEN | 1<<ADPS2 | 1<<ADPS1 | 1<<ADPS0);
-	
-	// Get normalized mean window summ
-	for (i=0;i<ADC_BUFFER_LENGTH;i++)
-		adc_raw_summ += raw_adc_buffer[i];
-	
-	// Enable interrupts from ADC
-	ADCSRA = (1<<ADEN | 1<<ADIE | 1<<ADPS2 | 1<<ADPS1 | 1<<ADPS0);
+	// Get the latest CIC output, kept by ADC ISR.
+	// 32-bit read is not atomic, but ISR updates the output once per ADC_DECIMATION conversions - 
+	// two equal reads in a row give a consistent value. ADC interrupt stays enabled.
+	do {
+		adc_cic = adc_cic_output;
+	} while (adc_cic != adc_cic_output);
 	
-	adc_normalized = adc_raw_summ >> 5;		// ADC_BUFFER_LENGTH = 32 !
-	adc_oversampled = adc_raw_summ >> 3;	// adc_oversampled is 4 times greater than adc_normalized
+	// adc_oversampled is 16 times greater than adc_normalized, (adc_cic << 4) fits 32 bits.
+	// Rounded quotient of ADC_CIC_GAIN without 32-bit division: the reciprocal estimate from
+	// the high word is never above the quotient and lower by at most 1 for ADC_DECIMATION 490
+	// (checked for every CIC output), the remainder corrects it.
+	adc_cic = (adc_cic << 4) + (ADC_CIC_GAIN >> 1);
+	adc_oversampled = (uint16_t)(((uint32_t)(uint16_t)(adc_cic >> 16) * ADC_CIC_RECIP) >> ADC_CIC_RECIP_SHIFT);
+	remainder = adc_cic - (uint32_t)adc_oversampled * ADC_CIC_GAIN;
+	while (remainder >= ADC_CIC_GAIN)
+	{
+		adc_oversampled++;
+		remainder -= ADC_CIC_GAIN;
+	}
+	adc_normalized = adc_oversampled >> 4;
 	// Filter
 	adc_filtered = fir_i16_i8(adc_oversampled, filter_buffer, &fir_filter_rect);	
 	// Check sensor
@@ -173,28 +316,39 @@ void update_CalibrationPoint(uint8_t point_number, uint8_t new_val_celsius)
 	if (point_number == 1)
 	{
 		cp.cpoint1 = new_val_celsius;
-		cp.cpoint1_adc = adc_filtered;
+		cp.cpoint1_adc = ADC_TO_PID_COUNTS(adc_filtered);
 	}
 	else if (point_number == 2)
 	{
 		cp.cpoint2 = new_val_celsius;
-		cp.cpoint2_adc = adc_filtered;
+		cp.cpoint2_adc = ADC_TO_PID_COUNTS(adc_filtered);
 	}
 }
 
 //-------------------------------------------------------//
 // Analog to digital converter ISR
-// ADC conversion is started by system timer (Timer2 ISR) every 1 ms
+// ADC runs in free-running mode, ISR is called by every conversion end
 //-------------------------------------------------------//
 ISR(ADC_vect)
 {
-	static uint8_t adc_buffer_pointer = ADC_BUFFER_LENGTH;
-	// Get new sample
-	uint16_t new_sample = 1024 - ADC;	
-	// Add new sample to the buffer
-	raw_adc_buffer[--adc_buffer_pointer] = new_sample;
-	if (adc_buffer_pointer == 0)
-		adc_buffer_pointer = ADC_BUFFER_LENGTH;
+	static uint32_t integrator1, integrator2;
+	static uint32_t comb1_delay, comb2_delay;
+	static uint16_t decimation_counter = ADC_DECIMATION;
+	uint32_t comb1;
+	PROFILE_ISR_ENTER();
+	// Integrate new sample
+	integrator1 += 1024 - ADC;
+	integrator2 += integrator1;
+	// Combs at the output rate
+	if (--decimation_counter == 0)
+	{
+		decimation_counter = ADC_DECIMATION;
+		comb1 = integrator2 - comb1_delay;
+		comb1_delay = integrator2;
+		adc_cic_output = comb1 - comb2_delay;
+		comb2_delay = comb1;
+	}
+	PROFILE_ISR_EXIT(PROF_ISR_ADC);
 }	
 
 
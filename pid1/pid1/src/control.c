@@ -18,14 +18,21 @@
 #include "pid_controller.h"
 #include "usart.h"
 #include "port_defs.h"
+#include "params_journal.h"
+#include "eeprom_queue.h"
+#include "scheduler.h"
 
 
 // Global variables - main system control
+// Global params are kept in the EEPROM journal (params_journal.c), records are protected by CRC.
 // #ifdef USE_EEPROM_CRC
 //   Default values must reside in the FLASH memory - for the case when EEPROM is not programmed at all
 //   At the very first start after programming MCU default values from FLASH memory are copied to EEPROM and
-//   both calibration and global params get protected by 8-bit CRC. EEPROM error message is displayed.
+//   calibration gets protected by 8-bit CRC. EEPROM error message is displayed.
 // #endif
+// eeGlobalParams and ee_gParamsCRC are the former global params layout: they are only read when
+// the journal is empty, so params of a device updated in use are kept. They also hold the addresses
+// of calibration data in EEPROM (declaration order is the EEPROM data map).
 EEMEM gParams_t eeGlobalParams = 
 {
 	.setup_temp_value 	= 50, 
@@ -42,10 +49,9 @@ EEMEM cParams_t eeCalibrationParams =
 	.cpoint2_adc 		= 1672
 };
 
-EEMEM uint8_t ee_gParamsCRC = 0xFF;		// Used only when USE_EEPROM_CRC is defined
+EEMEM uint8_t ee_gParamsCRC = 0xFF;		// Former layout, used only when USE_EEPROM_CRC is defined
 EEMEM uint8_t ee_cParamsCRC = 0xFF;		// Always declared to avoid changes in EEPROM data map
 
-#ifdef USE_EEPROM_CRC
 const PROGMEM gParams_t pmGlobalDefaults =
 {
 	.setup_temp_value 	= 50,
@@ -54,6 +60,7 @@ const PROGMEM gParams_t pmGlobalDefaults =
 	.power_off_timeout 	= 30
 };
 
+#ifdef USE_EEPROM_CRC
 const PROGMEM cParams_t pmCalibrationDefaults = 
 {
 	.cpoint1 			= 24,		// Default Celsius for the first point
@@ -64,7 +71,7 @@ const PROGMEM cParams_t pmCalibrationDefaults =
 #endif
 
 gParams_t p;		// Global params which are saved to and restored from EEPROM
-					// The global parameters are saved only when device is disconnected from the AC line 
+					// The global parameters are saved in the background when a menu item commits a change
 cParams_t cp;		// Calibration params are saved only after calibration of any of two calibration points
 
 
@@ -212,16 +219,12 @@ void processRollControl(void)
 //-------------------------------------------------------//
 void processHeaterControl(void)
 {
-	uint16_t setPoint;
-	uint16_t processValue;
-	uint16_t pid_output;
-	
 	// Process heater ON/OFF control by button
 	if (buttons.action_up_short & BD_HEATCTRL)
 	{
 		heaterState ^= HEATER_ENABLED;
 		// Force update heater power
-		sys_timers_flags |= UPDATE_PID;		// Not very good approach if UPDATE_PID flag is used outside this function
+		requestTask(TASK_PID);
 	}
 	
 	// Process PID controller reset
@@ -229,7 +232,7 @@ void processHeaterControl(void)
 	{
 		heaterState |= RESET_PID;
 		// Force update heater power
-		sys_timers_flags |= UPDATE_PID;
+		requestTask(TASK_PID);
 	}
 	else
 	{
@@ -245,32 +248,14 @@ void processHeaterControl(void)
 	// Update integrator limits if set point is changed
 	if (heaterState & SETPOINT_CHANGED)
 	{
+		#ifdef PID_SHIFT_SCALING
+		setPIDShiftIntegratorLimit(p.setup_temp_value);
+		#else
 		setPIDIntegratorLimit(p.setup_temp_value);
+		#endif
 		// Force update heater power
-		sys_timers_flags |= UPDATE_PID;
+		requestTask(TASK_PID);
 	}
-
-	
-	// Check if heater control should be updated
-	// PID call interval is a multiple of Celsius update interval. 
-	if (sys_timers_flags & UPDATE_PID)
-	{
-		// PID input: 1 count ~ 0.125 Celsius degree (see adc.c)
-		setPoint = conv_Celsius_to_ADC(p.setup_temp_value);
-		processValue = adc_filtered;
-		
-		// Process PID
-		// If heater is disabled, output will be 0
-		pid_output = processPID(setPoint, processValue, heaterState);		
-		
-		// If unregulated mode is selected, override PID output 
-		// This mode must be used with care for calibration only
-		if ((heaterState & HEATER_ENABLED) && (p.setup_temp_value >= MAX_SET_TEMP))
-			pid_output = HEATER_MAX_POWER;		
-			
-		// Apply new heater power value	
-		setHeaterPower(pid_output);			
-	}	
 		
 	
 	//----- LED indication ------//
@@ -282,6 +267,39 @@ void processHeaterControl(void)
 }
 
 
+//-------------------------------------------------------//
+// Function to update heater power
+// Scheduler task with period of PID_UPDATE_INTERVAL,
+// requested by processHeaterControl() to force the update
+//-------------------------------------------------------//
+void processHeaterPID(void)
+{
+	uint16_t setPoint;
+	uint16_t processValue;
+	uint16_t pid_output;
+	
+	// PID input: 1 count ~ 0.125 Celsius degree (see adc.c)
+	setPoint = ADC_TO_PID_COUNTS(conv_Celsius_to_ADC(p.setup_temp_value));
+	processValue = ADC_TO_PID_COUNTS(adc_filtered);
+	
+	// Process PID
+	// If heater is disabled, output will be 0
+	#ifdef PID_SHIFT_SCALING
+	pid_output = processPIDShift(setPoint, processValue, heaterState);
+	#else
+	pid_output = processPID(setPoint, processValue, heaterState);		
+	#endif
+	
+	// If unregulated mode is selected, override PID output 
+	// This mode must be used with care for calibration only
+	if ((heaterState & HEATER_ENABLED) && (p.setup_temp_value >= MAX_SET_TEMP))
+		pid_output = HEATER_MAX_POWER;		
+		
+	// Apply new heater power value	
+	setHeaterPower(pid_output);			
+}
+
+
 //-------------------------------------------------------//
 // Function to monitor heater events
 //-------------------------------------------------------//
@@ -405,6 +423,7 @@ static uint8_t getDataCRC(void *p,uint8_t byte_count)
 // Restores global parameters - control and calibration
 //	output:
 //	- if USE_EEPROM_CRC is not defined, always return 0
+//	  (global params are loaded from the former layout if the journal has no valid record)
 //	- if USE_EEPROM_CRC defined:
 //		0 if EEPROM parameters are correct
 //		1 if control parameters were corrupted and restored from defaults stored in FLASH
@@ -416,7 +435,21 @@ uint8_t restoreGlobalParams(void)
 	uint8_t defaults_used = 0;
 	
 	// Restore global parameters - temperature setting, sound enable, etc.
-	eeprom_read_block(&p,&eeGlobalParams,sizeof(gParams_t));
+	// If the journal has no valid record, take params of the former layout (first start after
+	// firmware update), restore global defaults if they are corrupted as well
+	if (restoreJournalParams())
+	{
+		eeprom_read_block(&p,&eeGlobalParams,sizeof(gParams_t));
+		#ifdef USE_EEPROM_CRC
+		if (eeprom_read_byte(&ee_gParamsCRC) != getDataCRC(&p,sizeof(gParams_t)))
+		{
+			memcpy_P(&p,&pmGlobalDefaults,sizeof(gParams_t));
+			defaults_used |= 0x01;
+		}
+		#endif
+		// Params are saved to the journal by the background writer
+		commitGlobalParams();
+	}
 	// Restore ADC calibration parameters
 	eeprom_read_block(&cp,&eeCalibrationParams,sizeof(cParams_t));
 	
@@ -424,19 +457,6 @@ uint8_t restoreGlobalParams(void)
 	uint8_t crc_byte;
 	uint8_t temp8u;
 	
-	//------- Check global params -------//
-	crc_byte = getDataCRC(&p,sizeof(gParams_t));
-	temp8u = eeprom_read_byte(&ee_gParamsCRC);
-	// Restore global defaults if corrupted
-	if (temp8u != crc_byte)
-	{
-		//PGM_read_block(&p,&pmGlobalDefaults,sizeof(gParams_t));
-		memcpy_P(&p,&pmGlobalDefaults,sizeof(gParams_t));
-		// Save restored default values with correct CRC
-		saveGlobalParamsToEEPROM();
-		defaults_used |= 0x01;
-	}
-	
 	//----- Check calibration params -----//
 	crc_byte = getDataCRC(&cp,sizeof(cParams_t));
 	temp8u = eeprom_read_byte(&ee_cParamsCRC);
@@ -446,7 +466,7 @@ uint8_t restoreGlobalParams(void)
 		//PGM_read_block(&cp,&pmCalibrationDefaults,sizeof(cParams_t));
 		memcpy_P(&cp,&pmCalibrationDefaults,sizeof(cParams_t));
 		// Save restored default values with correct CRC
-		saveCalibrationToEEPROM();
+		saveCalibrationToEEPROM(0);
 		defaults_used |= 0x02;	
 	}
 	#endif
@@ -458,29 +478,27 @@ uint8_t restoreGlobalParams(void)
 //-------------------------------------------------------//
 // Saves calibration to EEPROM
 //  if USE_EEPROM_CRC is defined, CRC is calculated and stored as well
+//  Data is written in the background (eeprom_queue.c), done() is called
+//	when it is written, may be 0
+//	With SYNC_CALIBRATION_SAVE data is written at once, before done() is called
 //-------------------------------------------------------//
-void saveCalibrationToEEPROM(void)
+void saveCalibrationToEEPROM(void (*done)(void))
 {
 	// Calibration parameters normally are only saved after calibrating 
+	#ifdef SYNC_CALIBRATION_SAVE
 	eeprom_update_block(&cp,&eeCalibrationParams,sizeof(cParams_t));	
 	#ifdef USE_EEPROM_CRC
 	uint8_t new_crc_byte = getDataCRC(&cp,sizeof(cParams_t));
 	eeprom_update_byte(&ee_cParamsCRC,new_crc_byte);
 	#endif
-}
-
-//-------------------------------------------------------//
-// Saves global control parameters to EEPROM
-//  if USE_EEPROM_CRC is defined, CRC is calculated and stored as well
-//-------------------------------------------------------//
-void saveGlobalParamsToEEPROM(void)
-{
-	// Save global parameters to EEPROM
-	// eeprom_update_block() updates only bytes that were changed
-	eeprom_update_block(&p,&eeGlobalParams,sizeof(gParams_t));
-	#ifdef USE_EEPROM_CRC
-	uint8_t new_crc_byte = getDataCRC(&p,sizeof(gParams_t));
-	eeprom_update_byte(&ee_gParamsCRC,new_crc_byte);
+	if (done)
+		done();
+	#elif defined(USE_EEPROM_CRC)
+	queueEEPROMWrite(&eeCalibrationParams,&cp,sizeof(cParams_t),0);
+	uint8_t new_crc_byte = getDataCRC(&cp,sizeof(cParams_t));
+	queueEEPROMWrite(&ee_cParamsCRC,&new_crc_byte,1,done);
+	#else
+	queueEEPROMWrite(&eeCalibrationParams,&cp,sizeof(cParams_t),done);
 	#endif
 }
 
@@ -488,10 +506,16 @@ void saveGlobalParamsToEEPROM(void)
 //-------------------------------------------------------//
 // This function is program exit when device has been disconnected from AC line
 //  When this function is called, all power-consuming devices like LED display
-//	are switched off, and global control parameters are saved to EEPROM
+//	are switched off, the global params record being written is committed
+//	if only its commit byte is left (global params are saved in the background)
+//	and queued EEPROM writes are finished (see EEQ_LENGTH for the time)
 //-------------------------------------------------------//
 void exitPowerOff(void)
 {
+	#ifdef MAIN_LOOP_TIME_PROFILING
+	uint8_t i;
+	#endif
+	
 	// Disable all interrupts
 	cli();
 	
@@ -504,21 +528,35 @@ void exitPowerOff(void)
 
 	PORTD = 0x00;			// Prevent pull-ups
 	DDRD = (1<<PD_TXD);
-	USART_sendstr("\r\nAC sync lost\r\n");
 	
-	saveGlobalParamsToEEPROM();
+	// Finish params record and EEPROM writes before any UART output.
+	// Queued log is discarded - sending 128 bytes would take about 22 ms.
+	finishParamsJournal();
+	flushEEPROMQueue();
+	USART_discard();
+	
+	// Interrupts are disabled, messages below are sent at once
+	USART_sendstr("\r\nAC sync lost\r\n");
 	
 	#ifdef MAIN_LOOP_TIME_PROFILING				
 	USART_sendstr("Max. main loop time:");
 	logU16p(max_work_time);
 	USART_sendstr(" ms\r\n");
+	USART_sendstr("UART bytes dropped:");
+	logU16p(usart_tx_dropped);
+	USART_sendstr("\r\n");
+	USART_sendstr("Task overruns:");
+	for (i = 0; i < TASK_COUNT; i++)
+		logU16p(task_states[i].overruns);
+	USART_sendstr("\r\n");
 	#endif
 	
 	USART_sendstr("Turn OFF");
 	
 	
 	// DIE!
-	while(1);
+	while(1)
+		__idle();
 }
 
 
@@ -0,0 +1,111 @@
+/*
+ * eeprom_queue.c
+ *
+ * Background EEPROM writes. Blocks are written in queue order, one byte per main loop run,
+ * so the main loop never waits for an EEPROM write (8.5 ms per byte) - the next
+ * byte is started when the previous one is finished. Bytes that already hold
+ * the value are skipped, like eeprom_update_block() does.
+ * Power fail path writes the rest of the queue at once.
+ */
+
+#include <string.h>
+#include "compilers.h"
+
+#include "eeprom_queue.h"
+
+
+static eeq_block_t eeq_blocks[EEQ_LENGTH];
+static uint8_t eeq_head;		// Block being written
+static uint8_t eeq_count;		// Queued blocks
+static uint8_t eeq_pos;			// Next byte of the head block
+
+
+//-------------------------------------------------------//
+// Queues a block write, data is copied.
+// If the queue is full, waits until the head block is written.
+//	output:
+//		0 if the block is queued
+//		1 if length exceeds EEQ_DATA_MAX - nothing is queued
+//-------------------------------------------------------//
+uint8_t queueEEPROMWrite(void *address, const void *data, uint8_t length, eeq_callback_t done)
+{
+	eeq_block_t *block;
+
+	if (length > EEQ_DATA_MAX)
+		return 1;
+	while (eeq_count == EEQ_LENGTH)
+	{
+		eeprom_busy_wait();
+		processEEPROMQueue();
+	}
+	block = &eeq_blocks[(eeq_head + eeq_count) % EEQ_LENGTH];
+	block->address = (uint8_t *)address;
+	memcpy(block->data, data, length);
+	block->length = length;
+	block->done = done;
+	// Block is visible for the power fail path when it is filled
+	eeq_count++;
+	return 0;
+}
+
+
+//-------------------------------------------------------//
+// Background writer, called by every main loop run.
+// Starts at most one byte write per call and does not wait for EEPROM.
+// Completion callback of a block is called when its last write is finished.
+//-------------------------------------------------------//
+void processEEPROMQueue(void)
+{
+	eeq_block_t *block;
+	uint8_t *ee_byte;
+	uint8_t value;
+
+	while (eeq_count)
+	{
+		if (!eeprom_is_ready())
+			return;
+		block = &eeq_blocks[eeq_head];
+		if (eeq_pos == block->length)
+		{
+			// Head and count are changed together for the power fail path
+			cli();
+			eeq_head = (eeq_head + 1) % EEQ_LENGTH;
+			eeq_count--;
+			eeq_pos = 0;
+			sei();
+			if (block->done)
+				block->done();
+			continue;
+		}
+		ee_byte = block->address + eeq_pos;
+		value = block->data[eeq_pos];
+		if (eeprom_read_byte(ee_byte) != value)
+		{
+			eeprom_write_byte(ee_byte, value);
+			eeq_pos++;
+			return;
+		}
+		eeq_pos++;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Power fail path, called with interrupts disabled.
+// Writes the rest of the queue at once, callbacks are not called.
+// Byte which write was started before is updated - skipped if it is written.
+//-------------------------------------------------------//
+void flushEEPROMQueue(void)
+{
+	eeq_block_t *block;
+
+	while (eeq_count)
+	{
+		block = &eeq_blocks[eeq_head];
+		for (; eeq_pos < block->length; eeq_pos++)
+			eeprom_update_byte(block->address + eeq_pos, block->data[eeq_pos]);
+		eeq_head = (eeq_head + 1) % EEQ_LENGTH;
+		eeq_count--;
+		eeq_pos = 0;
+	}
+}
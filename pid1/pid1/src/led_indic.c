@@ -27,39 +27,50 @@ static uint8_t bufActivePos;				// number of buffer item displayed to active LED
 static uint8_t wActivePos;					// number of active LED display digit
 uint8_t shifterState;	
 static SoftTimer8b_t shiftTimer;			// used for LED window shift
-
-
-// 7-seg encoding table
-const PROGMEM encode_7seg_pair led_encode_table[] = {
-	{ '0',	(SEGA | SEGB | SEGC | SEGD | SEGE | SEGF) },
-	{ 'O',	(SEGA | SEGB | SEGC | SEGD | SEGE | SEGF) },
-	{ '1',	(SEGB | SEGC ) },
-		
-	{ '2',	(SEGA | SEGB | SEGD | SEGE | SEGG) },
-	{ '3',	(SEGA | SEGB | SEGC | SEGD | SEGG) },
-	{ '4',	(SEGB | SEGC | SEGF | SEGG) },
-	{ 'S',	(SEGA | SEGC | SEGD | SEGF | SEGG) },
-	{ '5',	(SEGA | SEGC | SEGD | SEGF | SEGG) },
-	{ '6',	(SEGA | SEGC | SEGD | SEGE | SEGF | SEGG) },
-	{ '7',	(SEGA | SEGB | SEGC ) },
-	{ '8',	(SEGA | SEGB | SEGC | SEGD | SEGE | SEGF | SEGG) },
-	{ '9',	(SEGA | SEGB | SEGC | SEGD | SEGF | SEGG) },
-	{ '.',	(SEGH) },
-	{ ',',	(SEGH) },
-	{ '-',	(SEGG) },
-	{ '_',	(SEGD) },
-	{ ' ',	0 },
-	{ 0xB0,	(SEGA | SEGB | SEGF | SEGG) },		// Degree sign
-	{ 'A',	(SEGA | SEGB | SEGC | SEGE | SEGF | SEGG) },
-	{ 'C',	(SEGA | SEGD | SEGE | SEGF) },
-	{ 'F',	(SEGA | SEGE | SEGF | SEGG) },
-	{ 'N',	(SEGC | SEGE | SEGG) },
-	{ 'D',	(SEGB | SEGC | SEGD | SEGE | SEGG) },
-	{ 'P',	(SEGA | SEGB | SEGE | SEGF | SEGG) },
-	{ 'E',	(SEGA | SEGD | SEGE | SEGF | SEGG) },
-	{ 'U',	(SEGB | SEGC | SEGD | SEGE | SEGF) },
-	{ 'G',	(SEGA | SEGC | SEGD | SEGE | SEGF) },
-	{ 'R',	(SEGE | SEGG) }
+static uint8_t buttonScanState;
+
+
+// 7-seg encoding of a char. Chars that are not listed are passed as segment data.
+#define LED_GLYPH(c)	( \
+	((c) == '0') ? (SEGA | SEGB | SEGC | SEGD | SEGE | SEGF) : \
+	((c) == 'O') ? (SEGA | SEGB | SEGC | SEGD | SEGE | SEGF) : \
+	((c) == '1') ? (SEGB | SEGC ) : \
+	((c) == '2') ? (SEGA | SEGB | SEGD | SEGE | SEGG) : \
+	((c) == '3') ? (SEGA | SEGB | SEGC | SEGD | SEGG) : \
+	((c) == '4') ? (SEGB | SEGC | SEGF | SEGG) : \
+	((c) == 'S') ? (SEGA | SEGC | SEGD | SEGF | SEGG) : \
+	((c) == '5') ? (SEGA | SEGC | SEGD | SEGF | SEGG) : \
+	((c) == '6') ? (SEGA | SEGC | SEGD | SEGE | SEGF | SEGG) : \
+	((c) == '7') ? (SEGA | SEGB | SEGC ) : \
+	((c) == '8') ? (SEGA | SEGB | SEGC | SEGD | SEGE | SEGF | SEGG) : \
+	((c) == '9') ? (SEGA | SEGB | SEGC | SEGD | SEGF | SEGG) : \
+	((c) == '.') ? (SEGH) : \
+	((c) == ',') ? (SEGH) : \
+	((c) == '-') ? (SEGG) : \
+	((c) == '_') ? (SEGD) : \
+	((c) == ' ') ? 0 : \
+	((c) == 0xB0) ? (SEGA | SEGB | SEGF | SEGG) : 	/* Degree sign */ \
+	((c) == 'A') ? (SEGA | SEGB | SEGC | SEGE | SEGF | SEGG) : \
+	((c) == 'C') ? (SEGA | SEGD | SEGE | SEGF) : \
+	((c) == 'F') ? (SEGA | SEGE | SEGF | SEGG) : \
+	((c) == 'N') ? (SEGC | SEGE | SEGG) : \
+	((c) == 'D') ? (SEGB | SEGC | SEGD | SEGE | SEGG) : \
+	((c) == 'P') ? (SEGA | SEGB | SEGE | SEGF | SEGG) : \
+	((c) == 'E') ? (SEGA | SEGD | SEGE | SEGF | SEGG) : \
+	((c) == 'U') ? (SEGB | SEGC | SEGD | SEGE | SEGF) : \
+	((c) == 'G') ? (SEGA | SEGC | SEGD | SEGE | SEGF) : \
+	((c) == 'R') ? (SEGE | SEGG) : \
+	(c) )
+
+#define LED_GLYPH_FIRST		0x20		// ' ', table covers ' ' to '_'
+#define LED_GLYPH_COUNT		64
+#define LED_GLYPH_ROW(c)	LED_GLYPH(c), LED_GLYPH((c)+1), LED_GLYPH((c)+2), LED_GLYPH((c)+3), \
+							LED_GLYPH((c)+4), LED_GLYPH((c)+5), LED_GLYPH((c)+6), LED_GLYPH((c)+7)
+
+// 7-seg encoding table, indexed by char code - LED_GLYPH_FIRST
+const PROGMEM uint8_t led_glyph_table[LED_GLYPH_COUNT] = {
+	LED_GLYPH_ROW(0x20), LED_GLYPH_ROW(0x28), LED_GLYPH_ROW(0x30), LED_GLYPH_ROW(0x38),
+	LED_GLYPH_ROW(0x40), LED_GLYPH_ROW(0x48), LED_GLYPH_ROW(0x50), LED_GLYPH_ROW(0x58)
 };
 
 /**********************************************************
@@ -70,21 +81,13 @@ const PROGMEM encode_7seg_pair led_encode_table[] = {
 // Decodes normal string literal to the
 //	7-segment representation
 //---------------------------------------------//
-static uint8_t decode_led_char(char c)
+static inline uint8_t decode_led_char(char c)
 {
-	uint8_t i;
-	encode_7seg_pair encode_pair;
-	for (i = 0; i < sizeof(led_encode_table)/sizeof(encode_7seg_pair); i++  )
-	{
-		encode_pair.code = pgm_read_byte(&led_encode_table[i].code);
-		if (encode_pair.code == c)
-		{
-			i = pgm_read_byte(&led_encode_table[i].segdata);
-			return i;
-		}		
-	}			
-	// No item was found - return argument value
-	return  c;
+	uint8_t index = (uint8_t)c - LED_GLYPH_FIRST;
+	if (index < LED_GLYPH_COUNT)
+		return pgm_read_byte(&led_glyph_table[index]);
+	// Degree sign is the only listed char outside the table
+	return ((uint8_t)c == 0xB0) ? LED_GLYPH(0xB0) : (uint8_t)c;
 }
 
 //---------------------------------------------//
@@ -188,6 +191,7 @@ void initLedIndicator()
 	// Initialize shift timer - always enabled, but 
 	//	processed only when shifting is active
 	shifterState = LED_SHIFT_DONE;
+	buttonScanState = BUTTON_SCAN_IDLE;
 	shiftTimer.Enabled = 1;
 	shiftTimer.RunOnce = 0;
 	shiftTimer.Top = LED_SHIFT_INTERVAL-1;
@@ -199,6 +203,8 @@ void initLedIndicator()
 // Call this function N times per sec to get N/NUM_DIGITS_TOTAL display update rate, where
 // NUM_DIGITS_TOTAL is number_of_digits_of_LED_display if no extra LEDs are used or
 // (number_of_digits_of_LED_display + 1) otherwise.
+// Requested button scan takes one more call at the start of a cycle:
+// segments stay disabled with pull-ups until buttons are read by the next call.
 //---------------------------------------------//
 void processLedIndicator()
 {
@@ -209,24 +215,36 @@ void processLedIndicator()
 	disable_led_segments();
 	#endif
 	
-	
-	// Perform regular shift
-	led_clock_pulse(!LED_DIGIT_ACT_LVL);
-	
-	// Switch on active window item position
-	switch (wActivePos)
+	if (buttonScanState == BUTTON_SCAN_ACTIVE)
 	{
-	case 0:
-		// Get buttons
-		#ifndef CLEAN_OPERATION
-		disable_led_segments();
-		#endif
-		enable_led_segments_pullups();
-		_delay_us(PULLUP_DELAY_US);
+		// Pull-ups have settled since the last call
 		capture_button_state();
 		#ifndef CLEAN_OPERATION
 		enable_led_segments();
 		#endif
+		buttonScanState = BUTTON_SCAN_IDLE;
+	}
+	else
+	{
+		// Perform regular shift
+		led_clock_pulse(!LED_DIGIT_ACT_LVL);
+		
+		if ((wActivePos == 0) && (buttonScanState == BUTTON_SCAN_REQUESTED))
+		{
+			// Scan line is active - start button scan
+			#ifndef CLEAN_OPERATION
+			disable_led_segments();
+			#endif
+			enable_led_segments_pullups();
+			buttonScanState = BUTTON_SCAN_ACTIVE;
+			return;
+		}
+	}
+	
+	// Switch on active window item position
+	switch (wActivePos)
+	{
+	case 0:
 		// Start new cycle with active digit level
 		led_clock_pulse(LED_DIGIT_ACT_LVL);
 		// Always start new cycle from specified buffer start position
@@ -267,6 +285,17 @@ void processLedIndicator()
 }
 
 
+//---------------------------------------------//
+// Requests button scan at the start of the next display cycle.
+// Buttons are read within NUM_DIGITS_TOTAL + 1 processLedIndicator() calls.
+//---------------------------------------------//
+void requestButtonScan(void)
+{
+	if (buttonScanState == BUTTON_SCAN_IDLE)
+		buttonScanState = BUTTON_SCAN_REQUESTED;
+}
+
+
 //-------------------------------------------------------//
 //-------------------------------------------------------//
 
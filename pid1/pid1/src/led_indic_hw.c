@@ -19,9 +19,7 @@ void led_clock_pulse(uint8_t bit)
 		PORTB |= (1<<PB_LED_DOUT);
 	else
 		PORTB &= ~(1<<PB_LED_DOUT);
-	_delay_us(SETUP_DELAY_US);
 	PORTB |= (1<<PB_LED_CLK);
-	_delay_us(SHIFT_DELAY_US);
 	PORTB &= ~(1<<PB_LED_CLK);
 }
 
@@ -17,14 +17,15 @@
 #include "soft_timer.h"
 #include "led_indic.h"
 #include "power_control.h"
+#include "params_journal.h"
 
 //-------------------------------------------------------//
 // Internal definitions
 
-static inline NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCond);
 static void getMenuFunctionRecord(uint8_t menuItemID, MenuFunctionRecord* menuRecord );
 static inline void processItemFunction(FuncPtr funcAddr);
 static void restartMenuTimer(void);
+static uint8_t isRenderRequired(uint8_t state, uint16_t value);
 
 
 static void mf_realTempSelect(void);	// Real temperature indication
@@ -54,12 +55,17 @@ static void mf_calibDo(void);
 static void mf_calibDoExit(void);
 static void mf_cdoneSelect(void);		// Calibration done
 static void mf_cdoneDo(void);
+static void mf_cdoneSaved(void);
 
 static uint8_t selectedMenuItemID;
 static MenuFunctionRecord selectedMenuFunctionRecord;
 static uint8_t jumpFlags;
 static uint8_t setupValue_u8;
 static uint8_t cpointNum;
+static uint8_t calibSaved;				// Set when calibration is written to EEPROM
+static uint8_t renderValid;				// Display shows renderState and renderValue of the selected item
+static uint8_t renderState;
+static uint16_t renderValue;
 
 static SoftTimer8b_t menuTimer = {		// used for menu state jumps
 	.Timer = 0,	
@@ -77,78 +83,102 @@ static SoftTimer8b_t userTimer = {		// used for display blinking
 
 
 
-const PROGMEM MenuJumpRecord menuJumpSet[] = 
-{
-// sizeOf(MenuJumpRecord) = 5 bytes	
-//	|	Item		|		Jump condition		|	Next item	|	Flags/Timeout		|
-	// Real temperature indication
-	{ mi_REALTEMP, 	BD_UP | BD_DOWN,				mi_SETTEMP,		SHIFT_LEFT	|	10	},
-	{ mi_REALTEMP, 	BS_MENU,						mi_ROLL,		SHIFT_RIGHT	|	0	},
-	{ mi_REALTEMP, 	BL_MENU,						mi_SNDEN,						10	},	
-	// Rolling
-	{ mi_ROLL, 		BS_MENU,						mi_REALTEMP,	SHIFT_LEFT	|	0	},
-	{ mi_ROLL, 		BL_MENU,						mi_SNDEN,						10	},
-	// Temperature control
-	{ mi_SETTEMP, 	BS_MENU | TMR_EXP,				mi_REALTEMP,	SHIFT_RIGHT	| 	0	},
-	{ mi_SETTEMP, 	BL_MENU,						mi_REALTEMP,	SHIFT_RIGHT	| DISCARD_CHANGES	| 	0		},
-	// Sound enable/disable
-	{ mi_SNDEN, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
-	{ mi_SNDEN, 	BD_DOWN,						mi_AUTOPOFF,	SHIFT_RIGHT	|	10	},
-	{ mi_SNDEN, 	BD_UP,							mi_CALIB2,		SHIFT_LEFT	|	10	},
-	{ mi_SNDEN, 	BS_MENU,						mi_ACTSNDEN,					10	},
-	{ mi_ACTSNDEN, 	BS_MENU |  TMR_EXP,				mi_SNDEN,						10	},
-	{ mi_ACTSNDEN, 	BL_MENU,						mi_SNDEN,		DISCARD_CHANGES	|	10	},
-	// Auto power off timeout
-	{ mi_AUTOPOFF, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
-	{ mi_AUTOPOFF, 	BD_DOWN,						mi_CALIB1,		SHIFT_RIGHT	|	10	},
-	{ mi_AUTOPOFF, 	BD_UP,							mi_SNDEN,		SHIFT_LEFT	|	10	},
-	{ mi_AUTOPOFF,		BS_MENU,					mi_ACTAUTOPOFF,					10	},
-	{ mi_ACTAUTOPOFF,	BS_MENU | TMR_EXP,			mi_AUTOPOFF,					10	},
-	{ mi_ACTAUTOPOFF,	BL_MENU,					mi_AUTOPOFF,	DISCARD_CHANGES	|	10	},
-	// Calibration
-	{ mi_CALIB1, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
-	{ mi_CALIB1, 	BD_DOWN,						mi_CALIB2,		SHIFT_RIGHT	|	10	},
-	{ mi_CALIB1, 	BD_UP,							mi_AUTOPOFF,	SHIFT_LEFT	|	10	},
-	{ mi_CALIB1, 	BS_MENU,						mi_DOCALIB1,					0	},
-	{ mi_CALIB2, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
-	{ mi_CALIB2, 	BD_DOWN,						mi_SNDEN,		SHIFT_RIGHT	|	10	},
-	{ mi_CALIB2, 	BD_UP,							mi_CALIB1,		SHIFT_LEFT	|	10	},
-	{ mi_CALIB2, 	BS_MENU,						mi_DOCALIB2,					0	},
-	{ mi_DOCALIB1, 	BL_MENU,						mi_CALIB1,						10	},
-	{ mi_DOCALIB1, 	BS_MENU,						mi_CDONE1,						5	},
-	{ mi_CDONE1, 	BS_MENU | BL_MENU | TMR_EXP,	mi_REALTEMP,					0	},
-	{ mi_DOCALIB2, 	BL_MENU,						mi_CALIB2,						10	},
-	{ mi_DOCALIB2, 	BS_MENU,						mi_CDONE2,						5	},
-	{ mi_CDONE2, 	BS_MENU | BL_MENU | TMR_EXP,	mi_REALTEMP,					0	},
-	// Auto power off jumps - only from states without timeout, excluding calibration
-	{ mi_REALTEMP, 	GOTO_POFF,						mi_POFFACT,						0	},	
-	{ mi_ROLL, 		GOTO_POFF,						mi_POFFACT,						0	},	
-	// Auto power off mode cannot be exited by Cycle_roll button - there is no indication of valid roll points during power off mode
-	// Using BS_MENU and BL_MENU instead of BD_MENU to prevent false reaction
-	{ mi_POFFACT, 	BD_UP | BD_DOWN | BS_MENU | BL_MENU | BD_ROTFWD | BD_ROTREV | BD_HEATCTRL, mi_REALTEMP,	0	}
- };
- 
-
- const PROGMEM MenuFunctionRecord menuFunctionSet[]=
-{
-// sizeOf(MenuFunctionRecord) = 7 bytes
-//	|	Item		|	Select func			|	Do func			|		Leave func		|
-	{ mi_REALTEMP,		mf_realTempSelect, 		mf_realTempDo, 		mf_realTempLeave	},
-	{ mi_SETTEMP,  		mf_setTempSelect, 		mf_setTempDo, 		mf_setTempLeave		},
-	{ mi_ROLL, 			mf_rollSelect, 			mf_rollDo, 			mf_rollLeave		},
-	{ mi_SNDEN,			mf_sndenSelect, 		mf_sndenDo,				0				},
-	{ mi_ACTSNDEN,		mf_leafSelectAct, 		mf_sndenDo,			mf_sndenLeave		},
-	{ mi_AUTOPOFF,		mf_autopoffSelect, 		mf_autopoffDo,			0				},
-	{ mi_ACTAUTOPOFF,	mf_leafSelectAct,		mf_autopoffDo,		mf_autopoffLeave	},
+// Jumps of every menu item. First record with any of jump conditions matching is used.
+// sizeOf(MenuJumpRecord) = 4 bytes
+//	|		Jump condition		|	Next item	|	Flags/Timeout		|
+// Real temperature indication
+const PROGMEM MenuJumpRecord mj_realTemp[] = {
+	{ BD_UP | BD_DOWN,				mi_SETTEMP,		SHIFT_LEFT	|	10	},
+	{ BS_MENU,						mi_ROLL,		SHIFT_RIGHT	|	0	},
+	{ BL_MENU,						mi_SNDEN,						10	},	
+	{ GOTO_POFF,					mi_POFFACT,						0	}	// Auto power off jumps - only from states without timeout, excluding calibration
+};
+// Rolling
+const PROGMEM MenuJumpRecord mj_roll[] = {
+	{ BS_MENU,						mi_REALTEMP,	SHIFT_LEFT	|	0	},
+	{ BL_MENU,						mi_SNDEN,						10	},
+	{ GOTO_POFF,					mi_POFFACT,						0	}
+};
+// Temperature control
+const PROGMEM MenuJumpRecord mj_setTemp[] = {
+	{ BS_MENU | TMR_EXP,			mi_REALTEMP,	SHIFT_RIGHT	| 	0	},
+	{ BL_MENU,						mi_REALTEMP,	SHIFT_RIGHT	| DISCARD_CHANGES	| 	0		}
+};
+// Sound enable/disable
+const PROGMEM MenuJumpRecord mj_snden[] = {
+	{ BL_MENU | TMR_EXP,			mi_REALTEMP,					0	},
+	{ BD_DOWN,						mi_AUTOPOFF,	SHIFT_RIGHT	|	10	},
+	{ BD_UP,						mi_CALIB2,		SHIFT_LEFT	|	10	},
+	{ BS_MENU,						mi_ACTSNDEN,					10	}
+};
+const PROGMEM MenuJumpRecord mj_actSnden[] = {
+	{ BS_MENU |  TMR_EXP,			mi_SNDEN,						10	},
+	{ BL_MENU,						mi_SNDEN,		DISCARD_CHANGES	|	10	}
+};
+// Auto power off timeout
+const PROGMEM MenuJumpRecord mj_autopoff[] = {
+	{ BL_MENU | TMR_EXP,			mi_REALTEMP,					0	},
+	{ BD_DOWN,						mi_CALIB1,		SHIFT_RIGHT	|	10	},
+	{ BD_UP,						mi_SNDEN,		SHIFT_LEFT	|	10	},
+	{ BS_MENU,						mi_ACTAUTOPOFF,					10	}
+};
+const PROGMEM MenuJumpRecord mj_actAutopoff[] = {
+	{ BS_MENU | TMR_EXP,			mi_AUTOPOFF,					10	},
+	{ BL_MENU,						mi_AUTOPOFF,	DISCARD_CHANGES	|	10	}
+};
+// Calibration
+const PROGMEM MenuJumpRecord mj_calib1[] = {
+	{ BL_MENU | TMR_EXP,			mi_REALTEMP,					0	},
+	{ BD_DOWN,						mi_CALIB2,		SHIFT_RIGHT	|	10	},
+	{ BD_UP,						mi_AUTOPOFF,	SHIFT_LEFT	|	10	},
+	{ BS_MENU,						mi_DOCALIB1,					0	}
+};
+const PROGMEM MenuJumpRecord mj_calib2[] = {
+	{ BL_MENU | TMR_EXP,			mi_REALTEMP,					0	},
+	{ BD_DOWN,						mi_SNDEN,		SHIFT_RIGHT	|	10	},
+	{ BD_UP,						mi_CALIB1,		SHIFT_LEFT	|	10	},
+	{ BS_MENU,						mi_DOCALIB2,					0	}
+};
+const PROGMEM MenuJumpRecord mj_doCalib1[] = {
+	{ BL_MENU,						mi_CALIB1,						10	},
+	{ BS_MENU,						mi_CDONE1,						5	}
+};
+const PROGMEM MenuJumpRecord mj_doCalib2[] = {
+	{ BL_MENU,						mi_CALIB2,						10	},
+	{ BS_MENU,						mi_CDONE2,						5	}
+};
+const PROGMEM MenuJumpRecord mj_cdone[] = {
+	{ BS_MENU | BL_MENU | TMR_EXP,	mi_REALTEMP,					0	}
+};
+// Auto power off mode cannot be exited by Cycle_roll button - there is no indication of valid roll points during power off mode
+// Using BS_MENU and BL_MENU instead of BD_MENU to prevent false reaction
+const PROGMEM MenuJumpRecord mj_poffact[] = {
+	{ BD_UP | BD_DOWN | BS_MENU | BL_MENU | BD_ROTFWD | BD_ROTREV | BD_HEATCTRL, mi_REALTEMP,	0	}
+};
+
+#define JUMPS(list)		list, sizeof(list)/sizeof(MenuJumpRecord)
+
+// Menu items indexed by ID. Unused IDs have no functions and no jumps.
+// sizeOf(MenuItemRecord) = 9 bytes
+const PROGMEM MenuItemRecord menuItemSet[MENU_ITEM_COUNT] =
+{
+//	|	Item		|	Select func			|	Do func			|		Leave func		|	Jumps		|
+	[mi_REALTEMP] =		{{ mf_realTempSelect, 	mf_realTempDo, 		mf_realTempLeave	},	JUMPS(mj_realTemp)		},
+	[mi_SETTEMP] =		{{ mf_setTempSelect, 	mf_setTempDo, 		mf_setTempLeave		},	JUMPS(mj_setTemp)		},
+	[mi_ROLL] =			{{ mf_rollSelect, 		mf_rollDo, 			mf_rollLeave		},	JUMPS(mj_roll)			},
+	[mi_SNDEN] =		{{ mf_sndenSelect, 		mf_sndenDo,				0				},	JUMPS(mj_snden)			},
+	[mi_ACTSNDEN] =		{{ mf_leafSelectAct, 	mf_sndenDo,			mf_sndenLeave		},	JUMPS(mj_actSnden)		},
+	[mi_AUTOPOFF] =		{{ mf_autopoffSelect, 	mf_autopoffDo,			0				},	JUMPS(mj_autopoff)		},
+	[mi_ACTAUTOPOFF] =	{{ mf_leafSelectAct,	mf_autopoffDo,		mf_autopoffLeave	},	JUMPS(mj_actAutopoff)	},
 	
-	{ mi_CALIB1,		mf_calibP1Select,		mf_calibDo,				0				},
-	{ mi_DOCALIB1,		mf_leafSelectAct, 		mf_calibDo,			mf_calibDoExit		},
-	{ mi_CALIB2,		mf_calibP2Select,		mf_calibDo,				0				},
-	{ mi_DOCALIB2,		mf_leafSelectAct, 		mf_calibDo,			mf_calibDoExit		},
-	{ mi_CDONE1,		mf_cdoneSelect, 		mf_cdoneDo,				0				},
-	{ mi_CDONE2,		mf_cdoneSelect, 		mf_cdoneDo,				0				},
+	[mi_CALIB1] =		{{ mf_calibP1Select,	mf_calibDo,				0				},	JUMPS(mj_calib1)		},
+	[mi_DOCALIB1] =		{{ mf_leafSelectAct, 	mf_calibDo,			mf_calibDoExit		},	JUMPS(mj_doCalib1)		},
+	[mi_CALIB2] =		{{ mf_calibP2Select,	mf_calibDo,				0				},	JUMPS(mj_calib2)		},
+	[mi_DOCALIB2] =		{{ mf_leafSelectAct, 	mf_calibDo,			mf_calibDoExit		},	JUMPS(mj_doCalib2)		},
+	[mi_CDONE1] =		{{ mf_cdoneSelect, 		mf_cdoneDo,				0				},	JUMPS(mj_cdone)			},
+	[mi_CDONE2] =		{{ mf_cdoneSelect, 		mf_cdoneDo,				0				},	JUMPS(mj_cdone)			},
 	
-	{ mi_POFFACT,		mf_actpoffSelect,		mf_actpoffDo,		mf_actpoffLeave		}
+	[mi_POFFACT] =		{{ mf_actpoffSelect,	mf_actpoffDo,		mf_actpoffLeave		},	JUMPS(mj_poffact)		}
 }; 
 
 const PROGMEM char ms_realTempDo[] =	{' ',' ',' ',' ',0xB0,'C',0};
@@ -223,6 +253,7 @@ void processMenu(void)
 		
 		// Select new item
 		selectedMenuItemID = nextItem.ItemID;
+		renderValid = 0;
 		
 		// Load from FLASH and save function pointers
 		getMenuFunctionRecord(selectedMenuItemID, &selectedMenuFunctionRecord);
@@ -250,9 +281,10 @@ void processMenu(void)
 
 //-----------------------------------------------------------------//
 //	Returns ID of next menu item. 
-// If current item ID and jump condition match any of the
-// records in the "menuJumpSet" table new ID is returned.
+// If jump condition matches any of the jump records of the
+// current item in the "menuItemSet" table new ID is returned.
 // If there is no record match, selectedItemId is returned.
+// Only the records of the current item are read.
 //	Arguments:
 //		selectedItemId	- ID of currently active item
 //		jmpCond			- all information for jumps between states (buttons, timer flags, etc.)
@@ -260,25 +292,27 @@ void processMenu(void)
 //		NextItemID		- ID of item to jump to.
 //		NextItemTimeout	- allowed timeout for next item. Do not care if next item is the current.
 //-----------------------------------------------------------------//
-static inline NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCond)
+NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCond)
 {
 	NextItem_t nextItem;
 	nextItem.ItemID = selectedItemId;
-	MenuJumpRecord	jRecord;
-	uint8_t i;
+	const MenuJumpRecord *jRecord;
+	uint8_t count;
+	uint8_t flags;
 	
-	for (i = 0; i < sizeof(menuJumpSet)/sizeof(MenuJumpRecord); i++  )
+	if (selectedItemId >= MENU_ITEM_COUNT)
+		return nextItem;
+	memcpy_P(&jRecord,&menuItemSet[selectedItemId].Jumps,sizeof(jRecord));
+	count = pgm_read_byte(&menuItemSet[selectedItemId].JumpCount);
+	for (; count != 0; count--, jRecord++)
 	{
-		memcpy_P(&jRecord,&menuJumpSet[i],sizeof(MenuJumpRecord));
-		if (jRecord.Item == selectedItemId)				// If ID match,
+		if ((pgm_read_word(&jRecord->JumpCondition) & jmpCond) != 0)		// If any of jump conditions match,
 		{
-			if ((jRecord.JumpCondition & jmpCond) != 0)		// if any of jump conditions match too,
-			{
-				nextItem.ItemID = jRecord.NextItem;			// switch to next menu item
-				nextItem.ItemTimeout = jRecord.Flags & TIMEOUT_MASK;
-				nextItem.Flags = jRecord.Flags & ~TIMEOUT_MASK;
-				break;
-			}
+			nextItem.ItemID = pgm_read_byte(&jRecord->NextItem);			// switch to next menu item
+			flags = pgm_read_byte(&jRecord->Flags);
+			nextItem.ItemTimeout = flags & TIMEOUT_MASK;
+			nextItem.Flags = flags & ~TIMEOUT_MASK;
+			break;
 		}
 	}
 	return nextItem;
@@ -286,9 +320,8 @@ static inline NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCon
 
 
 //-----------------------------------------------------------------//
-//	Finds function pointers record for menuItemID
-//	If menuItemID is not found, last record in the 
-//	menuFunctionSet table is returned.
+//	Reads function pointers record for menuItemID
+//	menuItemID must be one of mi_xxx items.
 //	Arguments:
 //		menuItemID - ID of an item
 //		menuRecord - pointer to function structure to fill
@@ -296,13 +329,7 @@ static inline NextItem_t getNextMenuItem(uint8_t selectedItemId, uint16_t jmpCon
 //-----------------------------------------------------------------//
 static void getMenuFunctionRecord(uint8_t menuItemID, MenuFunctionRecord* menuRecord )
 {
-	uint8_t i;
-	for (i = 0; i < sizeof(menuFunctionSet)/sizeof(MenuFunctionRecord); i++  )
-	{
-		memcpy_P(menuRecord,&menuFunctionSet[i],sizeof(MenuFunctionRecord));
-		if (menuRecord->Item == menuItemID)
-			break;
-	}
+	memcpy_P(menuRecord,&menuItemSet[menuItemID].Functions,sizeof(MenuFunctionRecord));
 }
 
 
@@ -318,6 +345,26 @@ static inline void processItemFunction(FuncPtr funcAddr)
 }
 
 
+//-----------------------------------------------------------------//
+//	Checks if RUN function must print to LED buffer.
+//	Arguments:
+//		state, value - everything the item displays: status, blink phase, values
+//	Output:
+//		0 if the same state and value are displayed already.
+//	Cache is reset on menu item change - select functions print
+//	and window shift moves the buffer start position.
+//-----------------------------------------------------------------//
+static uint8_t isRenderRequired(uint8_t state, uint16_t value)
+{
+	if (renderValid && (state == renderState) && (value == renderValue))
+		return 0;
+	renderValid = 1;
+	renderState = state;
+	renderValue = value;
+	return 1;
+}
+
+
 //-----------------------------------------------------------------//
 //	 Restarts menu state timeout
 //	Should be used in RUN function when control buttons are pressed.
@@ -348,6 +395,9 @@ void mf_realTempSelect(void)
 void mf_realTempDo(void)
 {
 	char *str = (char *)&temp_str;
+	
+	if (!isRenderRequired(adc_status & (SENSOR_ERROR_NO_PRESENT | SENSOR_ERROR_SHORTED), (uint16_t)adc_celsius))
+		return;
 	memcpy_P(str,&ms_realTempDo,7);
 	
 	if (adc_status & (SENSOR_ERROR_NO_PRESENT))
@@ -386,7 +436,6 @@ void mf_setTempSelect(void)
 void mf_setTempDo(void)
 {
 	char *str = (char *)&temp_str;
-	memcpy_P(str,&ms_realTempDo,7);
 	
 	if (buttons.action_rep & BD_UP)
 	{
@@ -402,14 +451,18 @@ void mf_setTempDo(void)
 	}					
 		
 	// Output setting to LED
-	if (setupValue_u8 < MAX_SET_TEMP)
+	if (isRenderRequired(0, setupValue_u8))
 	{
-		u16toa_align_right(setupValue_u8,str,NO_TERMINATING_ZERO | 4);
-		printLedBuffer(0,str);
-	}		
-	else
-	{
-		printLedBuffer(0," UNREG");
+		memcpy_P(str,&ms_realTempDo,7);
+		if (setupValue_u8 < MAX_SET_TEMP)
+		{
+			u16toa_align_right(setupValue_u8,str,NO_TERMINATING_ZERO | 4);
+			printLedBuffer(0,str);
+		}		
+		else
+		{
+			printLedBuffer(0," UNREG");
+		}
 	}
 	
 	if (userTimer.FA_GE)
@@ -424,6 +477,7 @@ void mf_setTempLeave(void)
 	if (!(jumpFlags & DISCARD_CHANGES))
 	{
 		p.setup_temp_value = setupValue_u8;		// Apply changes		
+		commitGlobalParams();
 	}	
 }
 
@@ -441,33 +495,44 @@ void mf_rollSelect(void)
 void mf_rollDo(void)
 {
 	char *str = (char *)&temp_str;
-	memcpy_P(str,&ms_rollDo,7);
+	uint8_t points = 0;
+	uint8_t show_active;
 		
+	// Roll cycles are changed in place and saved at once - device stays in this item while in use
 	if (buttons.action_rep & BD_UP)
 	{
 		if (p.rollCycleSet < MAX_ROLL_CYCLES)
+		{
 			p.rollCycleSet += ROLL_CYCLES_STEP;
+			commitGlobalParams();
+		}
 	}
 	else if (buttons.action_rep & BD_DOWN)
 	{
 		if (p.rollCycleSet > MIN_ROLL_CYCLES)
+		{
 			p.rollCycleSet -= ROLL_CYCLES_STEP;
+			commitGlobalParams();
+		}
 	}	
+	
+	show_active = (!(rollState & ROLL_CYCLE)) || (userTimer.FA_GE);
+	if (isTopPointValid())
+		points |= SEGA;
+	if (isBottomPointValid())
+		points |= SEGD;
+	if (!isRenderRequired(points | (show_active ? 0x80 : 0), ((uint16_t)activeRollCycle << 8) | p.rollCycleSet))
+		return;
+	memcpy_P(str,&ms_rollDo,7);
 		
 	u16toa_align_right(p.rollCycleSet,str + 4,NO_TERMINATING_ZERO | 2);
 	
-	if ((!(rollState & ROLL_CYCLE)) || (userTimer.FA_GE))
+	if (show_active)
 	{
 		u16toa_align_right(activeRollCycle,str + 1,NO_TERMINATING_ZERO | 2);
 	}
 	
-	str[0] = 0;
-	if (isTopPointValid())
-		str[0] |= SEGA;
-	if (isBottomPointValid())
-		str[0] |= SEGD;
-	if (str[0] == 0)
-		str[0] = ' ';
+	str[0] = (points != 0) ? points : ' ';
 		
 	printLedBuffer(0,str);
 }
@@ -517,13 +582,16 @@ void mf_sndenSelect(void)
 void mf_sndenDo(void)
 {
 	char *str = (char *)&temp_str;
-	memcpy_P(str,&ms_soundEnDo,7);	
 		
 	if (buttons.action_rep & (BD_DOWN | BD_UP))
 	{
 		setupValue_u8 = !setupValue_u8;
 		restartMenuTimer();
 	}			
+	
+	if (!isRenderRequired(userTimer.FA_GE, setupValue_u8))
+		return;
+	memcpy_P(str,&ms_soundEnDo,7);	
 		
 	if (userTimer.FA_GE)
 	{
@@ -550,6 +618,7 @@ void mf_sndenLeave(void)
 	if (!(jumpFlags & DISCARD_CHANGES))
 	{
 		p.sound_enable = setupValue_u8;		// Apply changes
+		commitGlobalParams();
 	}
 }
 
@@ -566,7 +635,6 @@ void mf_autopoffSelect(void)
 void mf_autopoffDo(void)
 {
 	char *str = (char *)&temp_str;
-	memcpy_P(str,&ms_autoPoffDo,7);	
 		
 	if (buttons.action_rep & BD_UP)
 	{
@@ -580,6 +648,10 @@ void mf_autopoffDo(void)
 			setupValue_u8 -= POWEROFF_SET_STEP;
 		restartMenuTimer();
 	}	
+	
+	if (!isRenderRequired(userTimer.FA_GE, setupValue_u8))
+		return;
+	memcpy_P(str,&ms_autoPoffDo,7);	
 		
 	if (userTimer.FA_GE)
 	{
@@ -603,6 +675,7 @@ void mf_autopoffLeave(void)
 	if (!(jumpFlags & DISCARD_CHANGES))
 	{
 		p.power_off_timeout = setupValue_u8;		// Apply changes
+		commitGlobalParams();
 	}
 }
 
@@ -620,7 +693,8 @@ void mf_actpoffSelect(void)
 void mf_actpoffDo(void)
 {
 	autoPowerOffState = AUTO_POFF_ACTIVE;		// Set global flag
-	printLedBuffer(0,"   OFF");
+	if (isRenderRequired(0, 0))
+		printLedBuffer(0,"   OFF");
 }
 
 void mf_actpoffLeave(void)
@@ -655,7 +729,6 @@ void mf_calibP2Select(void)
 void mf_calibDo(void)
 {
 	char *str = (char *)&temp_str;
-	memcpy_P(str,&ms_calibDo,4);
 	
 	if (buttons.action_rep & BD_UP)
 	{
@@ -668,18 +741,22 @@ void mf_calibDo(void)
 		setupValue_u8 -= CALIB_TEMP_STEP;
 	}
 	
-	if (userTimer.FA_GE)
-	{	
-		// Blinking setup value
-		u16toa_align_right(setupValue_u8,str,3);	
-	}
-	else
+	if (!userTimer.FA_GE)
 	{
 		// This is executed only when calibration is active and setup value is blinking
 		resetAutoPowerOffCounter();
 		heaterState |= CALIBRATION_ACTIVE; 
 	}
 	
+	if (!isRenderRequired(userTimer.FA_GE, setupValue_u8))
+		return;
+	memcpy_P(str,&ms_calibDo,4);
+	if (userTimer.FA_GE)
+	{	
+		// Blinking setup value
+		u16toa_align_right(setupValue_u8,str,3);	
+	}
+	
 	printLedBuffer(3,str);
 }
 
@@ -697,17 +774,25 @@ void mf_calibDoExit(void)
 // There are two calibration points - the menu item is
 // same for both.
 //------------------------------------------------//
+void mf_cdoneSaved(void)
+{
+	calibSaved = 1;
+}
+
 void mf_cdoneSelect(void)
 {
 	update_CalibrationPoint(cpointNum,setupValue_u8);
 	calculateCoeffs();
-	saveCalibrationToEEPROM();
+	calibSaved = 0;
+	saveCalibrationToEEPROM(mf_cdoneSaved);
 }
 
 
 void mf_cdoneDo(void)
 {
-	printLedBuffer(0," DONE ");
+	// Calibration is written to EEPROM in the background
+	if (isRenderRequired(calibSaved, 0))
+		printLedBuffer(0, calibSaved ? " DONE " : " ---- ");
 }
 
 
@@ -0,0 +1,165 @@
+/*
+ * params_journal.c
+ *
+ * Wear-levelled EEPROM store of global params, record layout is in params_journal.h
+ *
+ * Changed params are written in the background, one EEPROM byte per main loop run,
+ * as soon as a menu item commits them - the main loop does not wait for EEPROM.
+ * Power fail path writes nothing or only the commit byte of the record being written.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+#include "compilers.h"
+
+#include "params_journal.h"
+
+
+// Write steps of a record. Step n of 1 to JOURNAL_STEP_COMMIT writes byte n - 1 of the record.
+#define JOURNAL_STEP_INVALIDATE		0
+#define JOURNAL_STEP_COMMIT			sizeof(journal_record_t)
+#define JOURNAL_IDLE				0xFF
+
+// Empty ring - bytes of the unprogrammed EEPROM. The first record is written to slot 0.
+EEMEM journal_record_t ee_journal[JOURNAL_RECORDS] =
+{
+	[0 ... JOURNAL_RECORDS - 1] = {.commit = JOURNAL_NO_COMMIT}
+};
+
+static journal_record_t journal_record;		// The latest record, or the record being written
+static uint8_t journal_slot;				// Slot of journal_record
+static uint8_t journal_pending;				// Set by commitGlobalParams()
+static volatile uint8_t journal_step = JOURNAL_IDLE;	// Read by the power fail path
+
+
+//-------------------------------------------------------//
+// Returns commit byte of the record - CRC-8 of params and
+// sequence number, bit 7 is cleared
+//-------------------------------------------------------//
+static uint8_t getRecordCommit(const journal_record_t *record)
+{
+	const uint8_t *data = (const uint8_t *)record;
+	uint8_t crc_byte = JOURNAL_CRC_SEED;
+	uint8_t i;
+	for (i = 0; i < offsetof(journal_record_t, commit); i++)
+		crc_byte = _crc_ibutton_update(crc_byte, data[i]);
+	return crc_byte & 0x7F;
+}
+
+
+//-------------------------------------------------------//
+// Finds the latest valid record and loads its params to p
+//	output:
+//		0 if a valid record is found
+//		1 if there is no valid record, p is not changed
+// Records of the ring differ less than 128 in sequence number,
+// so they are compared modulo 256
+//-------------------------------------------------------//
+uint8_t restoreJournalParams(void)
+{
+	journal_record_t record;
+	uint8_t slot;
+	uint8_t found = 0;
+
+	journal_step = JOURNAL_IDLE;
+	journal_pending = 0;
+	// No record: the first one gets slot 0 and sequence number 0.
+	// Params of 0xFF bytes are out of menu ranges, so any params differ from them.
+	memset(&journal_record, 0xFF, sizeof(journal_record_t));
+	journal_slot = JOURNAL_RECORDS - 1;
+
+	for (slot = 0; slot < JOURNAL_RECORDS; slot++)
+	{
+		eeprom_read_block(&record, &ee_journal[slot], sizeof(journal_record_t));
+		if (record.commit != getRecordCommit(&record))
+			continue;
+		if (found && ((int8_t)(record.seq - journal_record.seq) <= 0))
+			continue;
+		journal_record = record;
+		journal_slot = slot;
+		found = 1;
+	}
+
+	if (!found)
+		return 1;
+	p = journal_record.params;
+	return 0;
+}
+
+
+//-------------------------------------------------------//
+// Requests saving of p - called when a menu item commits a change
+//-------------------------------------------------------//
+void commitGlobalParams(void)
+{
+	journal_pending = 1;
+}
+
+
+//-------------------------------------------------------//
+// Background writer, called by every main loop run.
+// Starts a new record if saving is requested and p differs from the latest record,
+// writes at most one byte per call and does not wait for EEPROM.
+// Bytes that already hold the value are skipped.
+//-------------------------------------------------------//
+void processParamsJournal(void)
+{
+	uint8_t *ee_byte;
+	uint8_t index;
+	uint8_t value;
+	uint8_t written;
+
+	if (journal_step == JOURNAL_IDLE)
+	{
+		if (!journal_pending)
+			return;
+		journal_pending = 0;
+		if (memcmp(&p, &journal_record.params, sizeof(gParams_t)) == 0)
+			return;
+		journal_record.params = p;
+		journal_record.seq++;
+		journal_record.commit = getRecordCommit(&journal_record);
+		if (++journal_slot >= JOURNAL_RECORDS)
+			journal_slot = 0;
+		journal_step = JOURNAL_STEP_INVALIDATE;
+	}
+
+	while (journal_step != JOURNAL_IDLE)
+	{
+		if (!eeprom_is_ready())
+			return;
+		if (journal_step == JOURNAL_STEP_INVALIDATE)
+		{
+			index = offsetof(journal_record_t, commit);
+			value = JOURNAL_NO_COMMIT;
+		}
+		else
+		{
+			index = journal_step - 1;
+			value = ((uint8_t *)&journal_record)[index];
+		}
+		ee_byte = (uint8_t *)&ee_journal[journal_slot] + index;
+		written = (eeprom_read_byte(ee_byte) != value);
+		if (written)
+			eeprom_write_byte(ee_byte, value);
+		// Step is advanced after the write is started - power fail path
+		// writes the commit byte only when all body bytes are written
+		journal_step = (journal_step == JOURNAL_STEP_COMMIT) ? JOURNAL_IDLE : journal_step + 1;
+		if (written)
+			return;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Power fail path, called with interrupts disabled.
+// If body of the record is written, writes its commit byte - single EEPROM byte.
+// Otherwise the latest record stays in effect and nothing is written.
+// RAM state is not changed.
+//-------------------------------------------------------//
+void finishParamsJournal(void)
+{
+	if (journal_step == JOURNAL_STEP_COMMIT)
+		eeprom_update_byte(&ee_journal[journal_slot].commit, journal_record.commit);
+}
@@ -19,9 +19,56 @@
 #include "control.h"
 #include "menu.h"
 #include "pid_controller.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "params_journal.h"
+#include "eeprom_queue.h"
+#include "scheduler.h"
 
 extern volatile SoftTimer8b_t menuUpdateTimer;	// Must be declared volatile here
 
+static void processButtonsAndSound(void);
+static void processMenuAndEEPROM(void);
+static void processHeater(void);
+#ifndef LOG_BINARY_TELEMETRY
+static void processLog(void);
+#endif
+
+
+//-------------------------------------------------------//
+// Main loop tasks, sorted by priority - see scheduler.h
+// Celsius update, PID and text log never run at the same tick.
+// 10 seconds events come at even ticks where the profiler runs.
+// Some processing order rules:
+//	- system timers flags are used by menu, alerts and profiler
+//	- heater events must be processed before heater control
+//	- heater control requests PID update to force it
+//-------------------------------------------------------//
+const PROGMEM task_t main_tasks[TASK_COUNT] = {
+	//					function					period						phase
+	[TASK_BUTTONS]	= { processButtonsAndSound,		1,							0 },
+	[TASK_TIMERS]	= { processSystemTimers,		COUNTER_10SEC_INTERVAL,		COUNTER_10SEC_INTERVAL - 2 },
+	[TASK_ADC]		= { update_normalized_adc,		1,							0 },
+	[TASK_CELSIUS]	= { update_Celsius,				CELSIUS_UDPATE_INTERVAL,	0 },
+	[TASK_MENU]		= { processMenuAndEEPROM,		1,							0 },
+	[TASK_ROLL]		= { processRollControl,			1,							0 },
+	[TASK_HEATER]	= { processHeater,				1,							0 },
+	[TASK_PID]		= { processHeaterPID,			PID_UPDATE_INTERVAL,		2 },
+	[TASK_ALERTS]	= { processHeaterAlerts,		1,							0 },
+	#ifdef LOG_BINARY_TELEMETRY
+	[TASK_LOG]		= { sendTelemetry,				1,							0 },
+	#else
+	[TASK_LOG]		= { processLog,					LOG_INTERVAL,				1 },
+	#endif
+	#ifdef STAGE_PROFILING
+	#ifdef LOG_BINARY_TELEMETRY
+	[TASK_PROFILER]	= { processProfiler,			1,							0 },
+	#else
+	[TASK_PROFILER]	= { processProfiler,			LOG_INTERVAL,				0 },
+	#endif
+	#endif
+};
+
 
 
 //-------------------------------------------------------//
@@ -68,8 +115,8 @@ static void init_system_io()
 	// Setup ADC
 	// Internal Vref + cap, input ADC5, 
 	ADMUX = (1<<REFS1 | 1<<REFS0 | 0<<MUX3 | 1<<MUX2 | 0<<MUX1 | 1<<MUX0 );
-	// Prescaler = 128
-	ADCSRA = (1<<ADEN | 1<<ADIE | 1<<ADPS2 | 1<<ADPS1 | 1<<ADPS0);
+	// Prescaler = 128, free-running mode, start the first conversion
+	ADCSRA = (1<<ADEN | 1<<ADSC | 1<<ADFR | 1<<ADIE | 1<<ADPS2 | 1<<ADPS1 | 1<<ADPS0);
 	
 	// Setup USART
 	// Double speed
@@ -89,18 +136,115 @@ static void init_system_io()
 
 
 
+//-------------------------------------------------------//
+// Buttons task: new button state, sound feedback
+// and melody tones for the sound driver
+//-------------------------------------------------------//
+static void processButtonsAndSound(void)
+{
+	// Get new button state
+	process_buttons();
+	
+	// Give sound feedback
+	if (buttons.action_long & (BD_MENU | BD_HEATCTRL))
+	{
+		Sound_Play(m_beep_800Hz_40ms);
+	}
+	else if (buttons.action_down & (BD_MENU | BD_UP | BD_DOWN | BD_HEATCTRL))
+	{
+		Sound_Play(m_beep_1000Hz_40ms);
+	}	
+	// Direction control buttons sounds get special processing at processRollControl()
+	
+	// If any button is pressed, restart power off interval
+	if (buttons.action_down)
+	{
+		resetAutoPowerOffCounter();
+	}
+	
+	// Read next melody tones for the sound driver
+	Sound_Prefetch();
+}
+
+
+//-------------------------------------------------------//
+// Menu task: user menu states, settings and indication
+//-------------------------------------------------------//
+static void processMenuAndEEPROM(void)
+{
+	// Process user menu states, settings and indication
+	processMenu();
+	
+	// Save calibration and params committed by menu to EEPROM, one byte per run
+	processEEPROMQueue();
+	processParamsJournal();
+}
+
+
+//-------------------------------------------------------//
+// Heater task: heater events monitoring and heater control
+//-------------------------------------------------------//
+static void processHeater(void)
+{
+	// Process heater events monitoring
+	// Must be called before processHeaterControl()
+	processHeaterEvents();
+	
+	// Process heater regulation
+	processHeaterControl();
+	//setHeaterPower(0);		// bug test
+}
+
+
+#ifndef LOG_BINARY_TELEMETRY
+//-------------------------------------------------------//
+// Log task: text log line to UART
+//-------------------------------------------------------//
+static void processLog(void)
+{
+	dbg_PID_t* dbg_p = &dbg_PID_struct;
+	
+	PRELOAD("y",dbg_p);
+	
+	logU16p(adc_celsius);					// Actual temp Celsius
+	logU16p(adc_normalized);				// ADC, normalized (adc_normalized = 1024 - adc_raw)
+	logU16p(adc_filtered);					// ADC, oversampled and filtered
+	USART_sendstr("    ");
+
+	logU16p(dbg_p->PID_SetPoint);
+	logU16p(dbg_p->PID_ProcessValue);
+
+	logI32p(dbg_p->PID_p_term);
+	logI32p(dbg_p->PID_d_term);
+	logI32p(dbg_p->PID_i_term);
+	
+	USART_sendstr("    ");
+	
+	logU16p(dbg_p->PID_output);
+	
+	//USART_sendstr("    ");
+	//logU16p(menuUpdateTimer.Timer);			// Main loop time (ms)
+	
+	USART_sendstr("\r\n");
+}
+#endif
+
+
+
 //-------------------------------------------------------//
 // 							Main  
 // Asynchronous operations:
 //	ISR:	Analog comparator (AC line sync)
 //	ISR:	Timer0 (used for power control)
 //	ISR:	Timer2 (system timer)
-//	ISR:	ADC (ADC conversion is started by Timer2 ISR)
+//	ISR:	ADC (free-running, CIC decimator)
 //-------------------------------------------------------//
 int main(void)
 {
 	uint8_t temp8u = 0x00;
-	dbg_PID_t* dbg_p = &dbg_PID_struct;
+	#ifdef STAGE_PROFILING
+	uint16_t prof_loop_start;
+	#endif
 	
 	// Initialize MCU IO
 	init_system_io();
@@ -127,8 +271,8 @@ int main(void)
 		_delay_ms(1000);
 	} 
 	#endif
-	// Safety delay for power part and ADC buffer
-	_delay_ms(100);
+	// Safety delay for power part and ADC CIC decimator (two outputs)
+	_delay_ms(150);
 	// Check AC line
 	if(isACSyncPresent()) 	
 	{
@@ -141,15 +285,16 @@ int main(void)
 	// Beep
 	Sound_Play(m_beep_1000Hz_100ms);
 	
-	// When we get here, full ADC buffer have been sampled
+	// When we get here, CIC decimator gives outputs of the full window
 	// Initialize ADC filter
-	temp8u = 20;				// depth of ADC filter sample buffer
+	temp8u = ADC_FIR_LENGTH;	// depth of ADC filter sample buffer
 	while(--temp8u)
 		update_normalized_adc();	
 	
 	// Start rotating
 	setMotorDirection(ROLL_FWD);
-	// Clear timer
+	// Start tasks, clear timer
+	initScheduler(main_tasks, TASK_COUNT);
 	cli();
 	menuUpdateTimer.FOvfl = 0;
 	sei();
@@ -170,115 +315,20 @@ int main(void)
 		{
 			// Reset watchdog timer
 			wdt_reset();
+			PROFILE_START(prof_loop_start);
 			
-			//--------- BUTTONS ----------//
-			
-			// Get new button state
-			process_buttons();
-			
-			// Give sound feedback
-			if (buttons.action_long & (BD_MENU | BD_HEATCTRL))
-			{
-				Sound_Play(m_beep_800Hz_40ms);
-			}
-			else if (buttons.action_down & (BD_MENU | BD_UP | BD_DOWN | BD_HEATCTRL))
-			{
-				Sound_Play(m_beep_1000Hz_40ms);
-			}	
-			// Direction control buttons sounds get special processing at processRollControl()
-			
-			// If any button is pressed, restart power off interval
-			if (buttons.action_down)
-			{
-				resetAutoPowerOffCounter();
-			}
-			
-			//---------- TIMERS ----------//
-			
-			// Process timers and time counters - it is important to call
-			// this function before menu and power controls processing
-			processSystemTimers();
-
-			// Warn user about soon auto powering off
-			if (sys_timers_flags & AUTOPOFF_SOON)
-			{
-				Sound_Play(m_beep_warn_poff);
-			}		
-			
-			//----------- ADC ------------//
-			
-			// Get new temperature measurement
-			update_normalized_adc();			
-		
-			// Update indicated Celsius degree
-			if (sys_timers_flags & EXPIRED_CELSIUS)
-			{
-				update_Celsius();		
-			}
-			
-			//----------- MENU -----------//		
-				
-			// Process user menu states, settings and indication
-			processMenu();
-			
-			//--------- CONTROLS ---------//		
-			
-			// Process cyclic rolling, direction control
-			processRollControl();	
-			
-			// Process heater events monitoring
-			// Must be called before processHeaterControl()
-			processHeaterEvents();
-			
-			// Process heater regulation
-			processHeaterControl();
-			//setHeaterPower(0);		// bug test
-		
-			// Process heater warnings
-			processHeaterAlerts();
-			
-			
-			
-			//------- LOG to UART --------//	
-			if (sys_timers_flags & EXPIRED_LOG)
-			{
-				PRELOAD("y",dbg_p);
-				
-				logU16p(adc_celsius);					// Actual temp Celsius
-				logU16p(adc_normalized);				// ADC, normalized (adc_normalized = 1024 - adc_raw)
-				logU16p(adc_filtered);					// ADC, oversampled and filtered
-				USART_sendstr("    ");
-
-				logU16p(dbg_p->PID_SetPoint);
-				logU16p(dbg_p->PID_ProcessValue);
-
-				logI32p(dbg_p->PID_p_term);
-				logI32p(dbg_p->PID_d_term);
-				logI32p(dbg_p->PID_i_term);
-				
-				USART_sendstr("    ");
-				
-				logU16p(dbg_p->PID_output);
-				
-				//USART_sendstr("    ");
-				//logU16p(menuUpdateTimer.Timer);			// Main loop time (ms)
-				
-				USART_sendstr("\r\n");
-
-				//---------------------------------//
-			}
+			// Run the tasks due at this tick, see main_tasks
+			runScheduler();
+			PROFILE_STAGE(PROF_LOOP, prof_loop_start);
 			
 			#ifdef MAIN_LOOP_TIME_PROFILING
 			temp8u = menuUpdateTimer.Timer;
 			if (temp8u > max_work_time)
 				max_work_time = temp8u;
 			#endif
-			
-			cli();
-			menuUpdateTimer.FOvfl = 0;	
-			sei();
 		}
 		
+		__idle();
     }
 }
 
@@ -13,6 +13,7 @@ dbg_PID_t dbg_PID_struct;		// Moved here from contol.c - recheck
 // Nice new model
 
 static uint16_t integ_soft_k;
+static uint32_t integ_soft_k_shift;		// processPIDShift() integrator units
 
 // Sets maximum integrator value for particular temperature setting point in order to reduce wind-up
 // Argument is Celsius degree
@@ -28,7 +29,16 @@ void setPIDIntegratorLimit(uint8_t set_temp)
 	if (set_temp < 50)
 		set_temp = 50;
 	set_temp -= 15;
-	integ_soft_k = (uint16_t)set_temp * 12;
+	integ_soft_k = (uint16_t)set_temp * INTEGRATOR_SOFT_SLOPE;
+}
+
+// Same as setPIDIntegratorLimit(), for processPIDShift()
+void setPIDShiftIntegratorLimit(uint8_t set_temp)
+{
+	if (set_temp < 50)
+		set_temp = 50;
+	set_temp -= 15;
+	integ_soft_k_shift = (uint32_t)set_temp * PID_SHIFT_SOFT_SLOPE;
 }
 
 
@@ -154,6 +164,103 @@ uint16_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode)
 
 
 
+// Power-of-two scaled version of processPID() - see pid_controller.h
+// Integrator and output scaling are shifts instead of 32-bit divisions.
+// Output differs from processPID() by rounding of the scaled gains and terms
+// (FwSim -pidcheck compares them over experiment logs)
+uint16_t processPIDShift(uint16_t setPoint, uint16_t processValue, uint8_t mode)
+{
+	static uint16_t lastProcessValue;
+	static int32_t integAcc;			// Scaled by 2^16
+	int16_t error, p_term, i_term, d_term, temp;
+	int32_t integ_max, summ;
+	dbg_PID_t* dbg_p = &dbg_PID_struct;
+	
+	// Get the error
+	error = setPoint - processValue;
+	
+	//------ Calculate P term --------//
+	if (error > (int16_t)(PID_SHIFT_PROP_MAX / PID_SHIFT_KP))
+	{
+		p_term = PID_SHIFT_PROP_MAX;
+	}
+	else if (error < (int16_t)(PID_SHIFT_PROP_MIN / PID_SHIFT_KP))
+	{
+		p_term = PID_SHIFT_PROP_MIN;
+	}
+	else
+	{
+		p_term = error * (int16_t)PID_SHIFT_KP;
+	}
+	
+	//------ Calculate I term --------//
+	if (!(mode & PID_RESET_INTEGRATOR))
+		integAcc += (int32_t)error * PID_SHIFT_KI;
+	else
+		integAcc = 0;
 
+	#ifdef INTEGRATOR_SOFT_LIMIT
+	if (error > INTEGRATOR_SOFT_RANGE)
+		integ_max = 0;
+	else if (error < 0)
+		integ_max = PID_SHIFT_INTEGRATOR_MAX;
+	else
+		integ_max = (int32_t)(INTEGRATOR_SOFT_RANGE - error) * integ_soft_k_shift;
+	#else
+	integ_max = PID_SHIFT_INTEGRATOR_MAX;
+	#endif
+	if (integAcc > integ_max)
+	{
+		integAcc = integ_max;
+	}
+	else if (integAcc < PID_SHIFT_INTEGRATOR_MIN)
+	{
+		integAcc = PID_SHIFT_INTEGRATOR_MIN;
+	}
+	
+	i_term = (int16_t)(integAcc >> 16);
 
+	//------ Calculate D term --------//
+	d_term = lastProcessValue - processValue;
+	if (d_term > (int16_t)(PID_SHIFT_DIFF_MAX / PID_SHIFT_KD))
+	{
+		d_term = PID_SHIFT_DIFF_MAX;
+	}
+	else if (d_term < (int16_t)(PID_SHIFT_DIFF_MIN / PID_SHIFT_KD))
+	{
+		d_term = PID_SHIFT_DIFF_MIN;
+	}
+	else
+	{
+		d_term = (int16_t)PID_SHIFT_KD * d_term;
+	}
+	lastProcessValue = processValue;
+	
+	//--------- Summ terms -----------//
+	// Limits are checked before the shift, so it is done in 16 bits
+	summ = (int32_t)p_term + (int32_t)i_term + (int32_t)d_term;
+	if (!(mode & PID_ENABLED) || (summ < ((int32_t)PID_OUTPUT_MIN << PID_SHIFT_OUTPUT)))
+	{
+		temp = PID_OUTPUT_MIN;
+	}
+	else if (summ >= ((int32_t)(PID_OUTPUT_MAX + 1) << PID_SHIFT_OUTPUT))
+	{
+		temp = PID_OUTPUT_MAX;
+	}
+	else
+	{
+		temp = (uint16_t)summ >> PID_SHIFT_OUTPUT;
+	}
+	
+	//------- Debug --------//
+	PRELOAD("z",dbg_p);
+	dbg_p->PID_SetPoint = setPoint;
+	dbg_p->PID_ProcessValue = processValue;
+	dbg_p->PID_p_term = p_term;
+	dbg_p->PID_i_term = i_term;
+	dbg_p->PID_d_term = d_term;
+	dbg_p->PID_output = (uint16_t)temp;
+	
+	return (uint16_t)temp;
+}
 
@@ -11,6 +11,7 @@
 #include "port_defs.h"
 #include "power_control.h"
 #include "control.h"
+#include "profiler.h"
 
 
 // Heater controls
@@ -296,6 +297,7 @@ ISR(ANA_COMP_vect)
 {
 	static uint16_t sigma = 0;
 	uint16_t delta;
+	PROFILE_ISR_ENTER();
 	
 	// Once triggered, disable further comparator interrupt
 	ACSR &= ~(1<<ACIE);		// safe - ACI flag will be cleared anyway before reenabling comparator interrupt
@@ -320,6 +322,7 @@ ISR(ANA_COMP_vect)
 	p_state &= ~STATE_MASK;					// Start new state machine cycle
 	p_state ^= HALF_PERIOD_FLAG;			// Toggle flag
 	
+	PROFILE_ISR_EXIT(PROF_ISR_ANA_COMP);
 }
 
 
@@ -331,6 +334,7 @@ ISR(ANA_COMP_vect)
 ISR(TIMER0_OVF_vect)
 {
 	uint8_t temp;
+	PROFILE_ISR_ENTER();
 	
 	switch(p_state & STATE_MASK)
 	{
@@ -391,6 +395,8 @@ ISR(TIMER0_OVF_vect)
 	
 	if ((p_state & STATE_MASK)  != 0x0F)
 		p_state++;
+	
+	PROFILE_ISR_EXIT(PROF_ISR_TIMER0);
 }	
 
 
@@ -0,0 +1,157 @@
+/*
+ * profiler.c
+ *
+ * Execution time profiler of the main loop stages and ISRs, see profiler.h
+ */ 
+
+#include "compilers.h"
+#include "control.h"
+#include "systimer.h"
+#include "usart.h"
+#include "profiler.h"
+
+#ifdef STAGE_PROFILING
+
+typedef struct {
+	uint16_t count;
+	uint16_t min;
+	uint16_t max;
+	uint32_t summ;
+	uint16_t hist[PROF_HIST_BINS];
+} prof_stat_t;
+
+
+volatile uint16_t profiler_ms = 0;					// Incremented by systick ISR
+static prof_stat_t prof_stats[PROF_COUNT];
+static uint8_t prof_dump_id = PROF_COUNT + 1;		// Next line to send, PROF_COUNT - header, PROF_COUNT + 1 - idle
+
+
+//-------------------------------------------------------//
+// Returns time in Timer2 clocks (4us)
+// Safe to call from ISRs
+//-------------------------------------------------------//
+uint16_t getProfilerTimestamp(void)
+{
+	uint8_t saved_state = __save_interrupt();
+	uint16_t ms;
+	uint8_t timer;
+	
+	__disable_interrupt();
+	ms = profiler_ms;
+	timer = TCNT2;
+	// Compare match is pending if systick ISR has not been called yet
+	if ((TIFR & (1<<OCF2)) && (timer < (PROF_TIMER_PERIOD / 2)))
+		ms++;
+	__restore_interrupt(saved_state);
+	
+	// Wraps correctly since 65536 * 250 is a multiple of 65536
+	return ms * PROF_TIMER_PERIOD + timer;
+}
+
+//-------------------------------------------------------//
+// Adds time from start till now to statistics of a stage
+// Returns current timestamp - start of the next stage
+// Statistics of the main loop stages are updated by main loop only,
+// statistics of ISRs - by the ISRs only
+//-------------------------------------------------------//
+uint16_t profileStage(uint8_t id, uint16_t start)
+{
+	prof_stat_t *s = &prof_stats[id];
+	uint16_t now = getProfilerTimestamp();
+	uint16_t time = now - start;
+	uint16_t limit = PROF_HIST_FIRST_LIMIT;
+	uint8_t bin = 0;
+	
+	// Stop counting until statistics are sent
+	if (s->count == 0xFFFF)
+		return now;
+	if (s->count == 0)
+	{
+		s->min = 0xFFFF;
+		s->max = 0;
+		s->summ = 0;
+	}
+	s->count++;
+	s->summ += time;
+	if (time < s->min)
+		s->min = time;
+	if (time > s->max)
+		s->max = time;
+	while ((bin < PROF_HIST_BINS - 1) && (time >= limit))
+	{
+		bin++;
+		limit <<= 2;
+	}
+	s->hist[bin]++;
+	return now;
+}
+
+//-------------------------------------------------------//
+// Sends statistics of a single stage and clears them
+//-------------------------------------------------------//
+static void sendProfilerLine(uint8_t id)
+{
+	prof_stat_t s;
+	uint8_t i;
+	
+	// ISR statistics may be updated meanwhile
+	__disable_interrupt();
+	s = prof_stats[id];
+	prof_stats[id].count = 0;
+	for (i = 0; i < PROF_HIST_BINS; i++)
+		prof_stats[id].hist[i] = 0;
+	__enable_interrupt();
+	
+	if (s.count == 0)
+		s.min = 0;
+	USART_sendstr("prof");
+	logU16p(id);
+	logU16p(s.count);
+	logU16p(s.min);
+	logU16p(s.count ? (uint16_t)(s.summ / s.count) : 0);
+	logU16p(s.max);
+	for (i = 0; i < PROF_HIST_BINS; i++)
+		logU16p(s.hist[i]);
+	USART_sendstr("\r\n");
+}
+
+//-------------------------------------------------------//
+// Starts sending statistics every 10 seconds or by request
+// and sends one line per call. Scheduler task, runs at the ticks
+// without text log line - a line takes 72 bytes of the UART transmit queue.
+//-------------------------------------------------------//
+void processProfiler(void)
+{
+	uint8_t temp8u;
+	
+	if (UCSRA & (1<<RXC))
+	{
+		temp8u = UDR;
+		if ((temp8u == 'p') && (prof_dump_id > PROF_COUNT))
+			prof_dump_id = PROF_COUNT;
+	}
+	if ((sys_timers_flags & EXPIRED_10SEC) && (prof_dump_id > PROF_COUNT))
+		prof_dump_id = PROF_COUNT;
+	
+	if (prof_dump_id == PROF_COUNT)
+	{
+		USART_sendstr("prof    id count min avg max hist, 4us\r\n");
+		prof_dump_id = 0;
+	}
+	else if (prof_dump_id < PROF_COUNT)
+	{
+		sendProfilerLine(prof_dump_id++);
+		if (prof_dump_id == PROF_COUNT)
+			prof_dump_id = PROF_COUNT + 1;
+	}
+	else
+	{
+		return;
+	}
+	#ifdef LOG_BINARY_TELEMETRY
+	// Text line is a separate frame for telemetry decoder
+	USART_send(0);
+	#endif
+}
+
+#endif
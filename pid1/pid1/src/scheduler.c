@@ -0,0 +1,102 @@
+/*
+ * scheduler.c
+ *
+ * Cooperative scheduler of the main loop tasks, task table rules are in scheduler.h
+ *
+ * Periodic tasks have countdown counters instead of the former nested system timers
+ * counters - a task with period 1 runs by every tick. Task table is in program memory,
+ * a task costs a countdown decrement when it is not due.
+ */
+
+#include "compilers.h"
+#include "soft_timer.h"
+#include "systimer.h"
+#include "profiler.h"
+
+#include "scheduler.h"
+
+extern volatile SoftTimer8b_t menuUpdateTimer;	// Must be declared volatile here
+
+task_state_t task_states[TASK_COUNT];
+static const task_t *sched_tasks;
+static uint8_t sched_task_count;
+
+
+//-------------------------------------------------------//
+// Starts the table of count tasks, tick 0 is the next
+// runScheduler() call. Statistics are cleared.
+// Tasks may be a table other than main_tasks - see FwSim -schedcheck
+//-------------------------------------------------------//
+void initScheduler(const task_t *tasks, uint8_t count)
+{
+	uint8_t id;
+
+	sched_tasks = tasks;
+	sched_task_count = count;
+	for (id = 0; id < count; id++)
+	{
+		task_states[id].countdown = pgm_read_byte(&tasks[id].phase) + 1;
+		task_states[id].pending = 0;
+		task_states[id].overruns = 0;
+		task_states[id].deadline_misses = 0;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Main loop run - a tick. Called when menuUpdateTimer overflows.
+// Clears system timers flags and runs the due tasks in table order.
+//-------------------------------------------------------//
+void runScheduler(void)
+{
+	const task_t *task = sched_tasks;
+	task_state_t *state = task_states;
+	void (*run)(void);
+	uint8_t id;
+	uint8_t late;
+	#ifdef STAGE_PROFILING
+	uint16_t prof_stage_start;
+	#endif
+
+	// Tick is taken at start, overflow during the run is the next tick
+	cli();
+	menuUpdateTimer.FOvfl = 0;
+	sei();
+	sys_timers_flags = 0x00;
+	sys_timers.loop_ticks++;
+	PROFILE_START(prof_stage_start);
+
+	for (id = 0; id < sched_task_count; id++, task++, state++)
+	{
+		if (--state->countdown == 0)
+		{
+			state->countdown = pgm_read_byte(&task->period);
+			state->pending = 1;
+		}
+		if (!state->pending)
+			continue;
+		state->pending = 0;
+		memcpy_P(&run, &task->run, sizeof(run));
+
+		late = menuUpdateTimer.FOvfl;
+		run();
+		if (menuUpdateTimer.FOvfl)
+		{
+			if ((!late) && (state->overruns != TASK_STAT_MAX))
+				state->overruns++;
+			if (state->deadline_misses != TASK_STAT_MAX)
+				state->deadline_misses++;
+		}
+		PROFILE_STAGE(id, prof_stage_start);
+	}
+}
+
+
+//-------------------------------------------------------//
+// Runs a task out of its period, e.g. PID update when heater
+// is switched. Does not change the periodic runs.
+//-------------------------------------------------------//
+void requestTask(uint8_t id)
+{
+	task_states[id].pending = 1;
+}
@@ -11,6 +11,12 @@
 #include "led_indic.h"
 #include "adc.h"
 #include "control.h"
+#include "profiler.h"
+
+// menuUpdateTimer value when button scan is requested. Scan waits for the start of LED display
+// cycle and takes one more systick, so buttons are read within the last NUM_DIGITS_TOTAL + 1 ms
+// before the main loop run.
+#define BUTTON_SCAN_TIME	(MENU_UPDATE_INTERVAL - NUM_DIGITS_TOTAL)
 
 // Main timer, updated in Timer2 ISR and used for main super loop run
 SoftTimer8b_t menuUpdateTimer = {
@@ -25,12 +31,9 @@ SoftTimer8b_t menuUpdateTimer = {
 
 // Collection of counters and flags used to control various system events
 sys_timers_t sys_timers = {
-	.celsius_upd_counter = 1,					// To force Celsius update  - timer is decremental
-	.log_counter = 1,							// To force log message		- timer is decremental
-	.counter_10sec = COUNTER_10SEC_INTERVAL, 	//							- timer is decremental
 	.counter_1min = COUNTER_1MIN_INTERVAL,		//							- timer is decremental
 	.poff_counter = 0,							//							- timer is incremental
-	.pid_update_counter = PID_UPDATE_INTERVAL	//							- timer is decremental
+	.loop_ticks = 0								// Main loop runs, telemetry timestamp	- timer is incremental
 };
 
 //uint8_t sys_timers_flags = 0;		// declared as IO register
@@ -43,55 +46,28 @@ static inline void Sound_Process(void);
 
 
 //-------------------------------------------------------//
-// Main function for system time processing
-// Updates global system timers flags
+// System time processing, scheduler task with period of 10 seconds
+// Updates global system timers flags (cleared by the scheduler
+// every tick) and warns user about soon auto powering off
 //-------------------------------------------------------//
 void processSystemTimers(void)
 {
-	sys_timers_flags = 0x00;
+	sys_timers_flags |= EXPIRED_10SEC;
 	
-	// Process Celsius counter
-	if (--sys_timers.celsius_upd_counter == 0)
+	// Process 1 minute counter
+	if (--sys_timers.counter_1min == 0)
 	{
-		sys_timers.celsius_upd_counter = CELSIUS_UDPATE_INTERVAL;
-		sys_timers_flags |= EXPIRED_CELSIUS;
+		sys_timers.counter_1min = COUNTER_1MIN_INTERVAL;
+		sys_timers_flags |= EXPIRED_1MIN;
 		
-		// Process PID update counter
-		if (--sys_timers.pid_update_counter == 0)
-		{
-			sys_timers.pid_update_counter = PID_UPDATE_INTERVAL;
-			sys_timers_flags |= UPDATE_PID;
-		}
+		// Process auto power off counter
+		if (sys_timers.poff_counter != MAX_POWEROFF_TIMEOUT - 1)
+			sys_timers.poff_counter++;
+		if (sys_timers.poff_counter == p.power_off_timeout - 1)
+			Sound_Play(m_beep_warn_poff);
+		if (sys_timers.poff_counter == p.power_off_timeout)
+			sys_timers_flags |= AUTOPOFF_EXPIRED;			
 	}
-	
-	// Process log counter
-	if (--sys_timers.log_counter == 0)
-	{
-		sys_timers.log_counter = LOG_INTERVAL;
-		sys_timers_flags |= EXPIRED_LOG;
-	}
-	
-	// Process 10 seconds counter
-	if (--sys_timers.counter_10sec == 0)
-	{
-		sys_timers.counter_10sec = COUNTER_10SEC_INTERVAL;
-		sys_timers_flags |= EXPIRED_10SEC;
-		
-		// Process 1 minute counter
-		if (--sys_timers.counter_1min == 0)
-		{
-			sys_timers.counter_1min = COUNTER_1MIN_INTERVAL;
-			sys_timers_flags |= EXPIRED_1MIN;
-			
-			// Process auto power off counter
-			if (sys_timers.poff_counter != MAX_POWEROFF_TIMEOUT - 1)
-				sys_timers.poff_counter++;
-			if (sys_timers.poff_counter == p.power_off_timeout - 1)
-				sys_timers_flags |= AUTOPOFF_SOON;
-			if (sys_timers.poff_counter == p.power_off_timeout)
-				sys_timers_flags |= AUTOPOFF_EXPIRED;			
-		}
-	}	
 }
 
 //-------------------------------------------------------//
@@ -110,6 +86,13 @@ void resetAutoPowerOffCounter(void)
 //-------------------------------------------------------//
 ISR(TIMER2_COMP_vect)
 {	
+	PROFILE_SYSTICK();
+	PROFILE_ISR_ENTER();
+	
+	// Buttons are read once per main loop run, shortly before it
+	if (menuUpdateTimer.Timer == BUTTON_SCAN_TIME)
+		requestButtonScan();
+	
 	// Manage LED indicator
 	processLedIndicator();
 	
@@ -119,9 +102,7 @@ ISR(TIMER2_COMP_vect)
 	// Process menu update timer
 	processSoftTimer8b(&menuUpdateTimer);	
 	
-	// Start ADC conversion 
-	// Safe to use read-modify-write - this ISR is the only source of ADC conversion start
-	ADCSRA |= (1<<ADSC);
+	PROFILE_ISR_EXIT(PROF_ISR_TIMER2);
 }
 
 
@@ -131,8 +112,15 @@ ISR(TIMER2_COMP_vect)
 
 
 static uint8_t sound_state = SOUND_OFF;
-static const tone_t* new_melody;
 static uint8_t SoundEnable_override = 0;
+
+// Tone queue. Main code reads melody from EEPROM and writes sound_queue_head,
+// systimer ISR writes sound_queue_tail, so the ISR never waits for EEPROM.
+static tone_t sound_queue[SOUND_QUEUE_LENGTH];
+static volatile uint8_t sound_queue_head;
+static volatile uint8_t sound_queue_tail;
+static volatile uint8_t sound_queue_end;		// Last tone is queued
+static const tone_t* sound_melody;				// Next tone to prefetch
 #ifdef USE_BEEP_FUNCTION
 static uint8_t beep_duration;
 static uint8_t beep_tone_period;
@@ -149,6 +137,9 @@ void Sound_Beep(uint16_t freq_hz, uint16_t time_ms)
 	{
 		beep_duration = LAST(time_ms);		// Maximum is 2550ms
 		beep_tone_period = FREQ(freq_hz);	// Lowest is 500Hz
+		sound_state = SOUND_OFF;			// ISR does not use the queue when sound is off
+		sound_queue_tail = sound_queue_head;
+		sound_queue_end = 1;				// Nothing to play after the beep
 		sound_state = SOUND_DO_BEEP;		// No need to disable interrupts - atomic operation
 		SoundEnable_override = 0;
 	}
@@ -157,17 +148,47 @@ void Sound_Beep(uint16_t freq_hz, uint16_t time_ms)
 
 //-------------------------------------------------------//
 // Starts playing a melody from EEPROM
+// First tones are read into the queue at once, may wait for EEPROM write end.
 //-------------------------------------------------------//
 void Sound_Play(const tone_t* p_melody)
 {
 	if ((p.sound_enable) || (SoundEnable_override))
 	{
-		new_melody =  p_melody;
+		sound_state = SOUND_OFF;			// ISR does not use the queue when sound is off
+		sound_queue_tail = sound_queue_head;
+		sound_queue_end = 0;
+		sound_melody = p_melody;
+		Sound_Prefetch();
 		sound_state = SOUND_START_NEW;		// No need to disable interrupts - atomic operation
 		SoundEnable_override = 0;
 	}
 }
 
+//-------------------------------------------------------//
+// Reads melody tones from EEPROM into the queue until it is full
+// or melody end is read. Called from main loop.
+//-------------------------------------------------------//
+void Sound_Prefetch(void)
+{
+	uint8_t head = sound_queue_head;
+	uint8_t next;
+	uint8_t is_end;
+	
+	while (!sound_queue_end)
+	{
+		next = (head + 1) & (SOUND_QUEUE_LENGTH - 1);
+		if (next == sound_queue_tail)
+			break;
+		eeprom_read_block(&sound_queue[head],sound_melody++,sizeof(tone_t));
+		is_end = (sound_queue[head].duration == 0);
+		head = next;
+		// Tone must be in the queue before the end flag is set
+		sound_queue_head = head;
+		if (is_end)
+			sound_queue_end = 1;
+	}
+}
+
 //-------------------------------------------------------//
 // Stops all sound
 //-------------------------------------------------------//
@@ -193,13 +214,12 @@ static inline void Sound_Process(void)
 {
 	static uint16_t note_time_counter;
 	static tone_t tone;
-	static const tone_t* p_melody;
 	uint8_t new_state = sound_state;
+	uint8_t tail;
 	
 	switch (sound_state)
 	{
 		case SOUND_START_NEW:
-			p_melody = new_melody;
 			new_state = SOUND_GET_NEXT_TONE;
 		break;
 		#ifdef USE_BEEP_FUNCTION
@@ -207,7 +227,6 @@ static inline void Sound_Process(void)
 			tone.duration = beep_duration;
 			tone.tone_period = beep_tone_period;
 			new_state = SOUND_APPLY_TONE;
-			p_melody = NULL;				// Beeper mode
 			break;
 		#endif
 		case SOUND_PLAY:
@@ -215,21 +234,19 @@ static inline void Sound_Process(void)
 				new_state = SOUND_GET_NEXT_TONE;
 			break;
 		case SOUND_GET_NEXT_TONE:
-			#ifdef USE_BEEP_FUNCTION
-			if (p_melody != NULL)			// If driver is playing melody, not beeping
+			tail = sound_queue_tail;
+			if (tail != sound_queue_head)
 			{
-				#endif
-				if (!eeprom_is_ready())		// If EEPROM is busy and Sound_Process() is called from an ISR, deadly block may appear
-					return;
-				eeprom_read_block(&tone,p_melody++,sizeof(tone_t));
+				tone = sound_queue[tail];
+				sound_queue_tail = (tail + 1) & (SOUND_QUEUE_LENGTH - 1);
 				new_state = SOUND_APPLY_TONE;
-				#ifdef USE_BEEP_FUNCTION
 			}
-			else
+			else if (sound_queue_end)
 			{
+				// Beep is finished
 				new_state = SOUND_OFF;
 			}
-			#endif
+			// else wait for Sound_Prefetch()
 			break;
 		case SOUND_APPLY_TONE:
 			if (tone.duration == 0)
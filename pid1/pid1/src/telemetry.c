@@ -0,0 +1,67 @@
+/*
+ * telemetry.c
+ *
+ * Binary UART log: fixed layout record, CRC-8 and COBS framing, see telemetry.h
+ */ 
+
+#include <util/crc16.h>
+#include "compilers.h"
+
+#include "telemetry.h"
+#include "systimer.h"
+#include "adc.h"
+#include "pid_controller.h"
+#include "usart.h"
+
+
+static uint8_t telemetry_seq = 0;
+
+
+static inline uint8_t *put16(uint8_t *p, uint16_t val)
+{
+	*p++ = (uint8_t)val;
+	*p++ = (uint8_t)(val >> 8);
+	return p;
+}
+
+//-------------------------------------------------------//
+// Sends the log record as a COBS frame
+// Record size is about one third of the text log line
+//-------------------------------------------------------//
+void sendTelemetry(void)
+{
+	uint8_t record[TELEMETRY_RECORD_LENGTH];
+	uint8_t *p = record;
+	uint8_t crc = 0;
+	uint8_t i, start;
+	
+	*p++ = telemetry_seq++;
+	p = put16(p, sys_timers.loop_ticks);
+	p = put16(p, (uint16_t)adc_celsius);
+	p = put16(p, adc_normalized);
+	p = put16(p, adc_filtered);
+	p = put16(p, dbg_PID_struct.PID_SetPoint);
+	p = put16(p, dbg_PID_struct.PID_ProcessValue);
+	p = put16(p, (uint16_t)dbg_PID_struct.PID_p_term);
+	p = put16(p, (uint16_t)dbg_PID_struct.PID_d_term);
+	p = put16(p, (uint16_t)dbg_PID_struct.PID_i_term);
+	p = put16(p, dbg_PID_struct.PID_output);
+	for (i = 0; i < TELEMETRY_RECORD_LENGTH - 1; i++)
+		crc = _crc_ibutton_update(crc, record[i]);
+	*p = crc;
+	
+	// COBS: every zero byte is replaced by the distance to the next one,
+	// the first distance is sent in front of the record
+	start = 0;
+	for (i = 0; i <= TELEMETRY_RECORD_LENGTH; i++)
+	{
+		if ((i == TELEMETRY_RECORD_LENGTH) || (record[i] == 0))
+		{
+			USART_send(i - start + 1);
+			while (start < i)
+				USART_send(record[start++]);
+			start = i + 1;
+		}
+	}
+	USART_send(0);
+}
@@ -11,27 +11,53 @@
 #include "port_defs.h"
 #include "usart.h"
 #include "my_string.h"
+#include "profiler.h"
 
 
 static char str[20];
 
+// Transmit queue. Main code writes tx_head, UDRE ISR writes tx_tail.
+static uint8_t tx_buffer[USART_TX_BUFFER_LENGTH];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+
+uint16_t usart_tx_dropped = 0;
+
 
 //-------------------------------------------------------//
 // Sends a char over UART
-// Blocks until transmit is complete
+// Byte is put into transmit queue and sent by UDRE ISR.
+// If the queue is full, byte is dropped and counted - main loop never waits for UART.
+// With interrupts disabled (e.g. power off) the queue is discarded and
+// the byte is sent at once.
 //-------------------------------------------------------//
 void USART_send( uint8_t data )
 {
-	//  Wait for empty transmit buffer 
-	while ( !( UCSRA & (1<<UDRE)) );
-	//  Put data into buffer, sends the data
-	UDR = data;
+	uint8_t next = (tx_head + 1) & (USART_TX_BUFFER_LENGTH - 1);
+	
+	if (!(SREG & (1<<SREG_I)))
+	{
+		USART_discard();
+		//  Wait for empty transmit buffer 
+		while ( !( UCSRA & (1<<UDRE)) );
+		UDR = data;
+		return;
+	}
+	if (next == tx_tail)
+	{
+		if (usart_tx_dropped != 0xFFFF)
+			usart_tx_dropped++;
+		return;
+	}
+	tx_buffer[tx_head] = data;
+	tx_head = next;
+	// Start transmission. Safe to use read-modify-write - UCSRB is accessed by sbi/cbi
+	UCSRB |= (1<<UDRIE);
 }
 
 //-------------------------------------------------------//
 // Sends a null-terminated char string over UART
 // null-terminating symbol is not transmitted
-// Blocks until transmit is complete
 //-------------------------------------------------------//
 void USART_sendstr(char* str)
 {
@@ -41,6 +67,44 @@ void USART_sendstr(char* str)
 	}
 }
 
+//-------------------------------------------------------//
+// Drops all queued bytes, they are counted as dropped.
+// Does not wait - power off path has no time to send the log
+//-------------------------------------------------------//
+void USART_discard(void)
+{
+	uint8_t saved_sreg = __save_interrupt();
+	uint8_t count;
+	
+	__disable_interrupt();
+	UCSRB &= ~(1<<UDRIE);
+	count = (tx_head - tx_tail) & (USART_TX_BUFFER_LENGTH - 1);
+	tx_tail = tx_head;
+	usart_tx_dropped = (usart_tx_dropped > 0xFFFF - count) ? 0xFFFF : usart_tx_dropped + count;
+	__restore_interrupt(saved_sreg);
+}
+
+//-------------------------------------------------------//
+// UART data register empty ISR
+// Sends next byte of the transmit queue,
+// disables itself when the queue is empty
+//-------------------------------------------------------//
+ISR(USART_UDRE_vect)
+{
+	uint8_t tail = tx_tail;
+	PROFILE_ISR_ENTER();
+	
+	if (tail != tx_head)
+	{
+		UDR = tx_buffer[tail];
+		tail = (tail + 1) & (USART_TX_BUFFER_LENGTH - 1);
+		tx_tail = tail;
+	}
+	if (tail == tx_head)
+		UCSRB &= ~(1<<UDRIE);
+	PROFILE_ISR_EXIT(PROF_ISR_UDRE);
+}
+
 //-------------------------------------------------------//
 // Function to log uint16_t type data
 //-------------------------------------------------------//
@@ -0,0 +1,1433 @@
+// FwSim.cpp : Firmware-in-the-loop simulation.
+// Runs the laminator controller firmware (pid1/pid1/src) on the host against the RSim plant model.
+//
+//		FwSim [-seconds <S>] [-setpoint <C>] [-ambient <C>] [-noheat] [-fresh]
+//			[-press <time>:<button>[:<hold>],...] [-uart <file>] [-out <file>]
+//
+//		-seconds <S>		simulated time (default 3600)
+//		-setpoint <C>		set point programmed into EEPROM (default 150)
+//		-ambient <C>		ambient and initial plant temperature (default 25)
+//		-noheat				do not press the heater button after start
+//		-fresh				start with unprogrammed EEPROM (firmware loads defaults, ERR E3)
+//		-press <list>		button presses, time and hold in seconds, e.g. 10:up,12:menu:1.5
+//							buttons: menu, up, down, fwd, rev, heat, cycle
+//		-uart <file>		firmware UART log
+//		-out <file>			plant temperature and heater effect every second
+//
+// Check of the firmware ADC CIC decimator against the weighted summ of conversions:
+//		FwSim -adccheck <conversions>
+// Check of the menu jump lookup against the flat jump table, all items and jump conditions:
+//		FwSim -menucheck
+// Check of melody timing with EEPROM writes by every main loop run:
+//		FwSim -soundcheck
+// Check of division-free ADC / Celsius conversion against the division formulas, calibration grid:
+//		FwSim -convcheck
+// Comparison of the power-of-two scaled PID with processPID() over experiment logs:
+//		FwSim -pidcheck <log file or directory>
+// Power loss at every EEPROM byte write of the params journal, recovery check, update from the former layout:
+//		FwSim -eepromcheck
+// Main loop period jitter during calibration and its save to EEPROM, EEPROM queue block length:
+//		FwSim -calibcheck
+// Estimated worst-case main loop time of the task table and the former timing, task statistics:
+//		FwSim -schedcheck
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ArgParser.h"
+#include "plant.h"
+#include "simulation.h"
+#include "mcu_model.h"
+#include "board.h"
+#include "adc_filter.h"
+#include "adc_chain.h"
+#include "sim_random.h"
+
+extern "C" {
+	#include "buttons.h"
+	#include "control.h"
+	#include "menu.h"
+	#include "systimer.h"
+	#include "params_journal.h"
+	#include "eeprom_queue.h"
+	#include "soft_timer.h"
+	#include "scheduler.h"
+}
+
+
+#define HEATER_PRESS_TIME		2.0			// Default heater button press after start, seconds
+#define BUTTON_HOLD_TIME		0.2			// Default button hold time, seconds
+#define HALF_PERIODS_PER_STEP	((uint32_t)(TIMESTEP * 100))	// 50Hz AC line
+
+extern "C" {
+	int firmware_main(void);
+	// adc.c
+	extern uint16_t adc_normalized;
+	extern uint16_t adc_filtered;
+	extern uint8_t adc_status;
+	void update_normalized_adc(void);
+	void ADC_vect(void);
+	void calculateCoeffs(void);
+	int16_t conv_ADC_to_Celsius(uint16_t adc_value);
+	uint16_t conv_Celsius_to_ADC(int16_t degree_value);
+	extern uint32_t conv_adc_paths[3];			// Index is CONV_PATH_FIXED, _CORRECTED, _DIVISION of adc.h
+	extern uint32_t conv_celsius_paths[3];
+	// pid_controller.c, pid_controller.h of RSim has the same name
+	void setPIDIntegratorLimit(uint8_t set_temp);
+	uint16_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode);
+	void setPIDShiftIntegratorLimit(uint8_t set_temp);
+	uint16_t processPIDShift(uint16_t setPoint, uint16_t processValue, uint8_t mode);
+	// control.c, usart.c
+	extern const gParams_t pmGlobalDefaults;
+	extern cParams_t eeCalibrationParams;
+	extern uint8_t max_work_time;
+	extern uint16_t usart_tx_dropped;
+	// systimer.c
+	extern volatile SoftTimer8b_t menuUpdateTimer;
+}
+
+
+typedef struct {
+	double Time;
+	double Hold;
+	uint8_t Buttons;
+} ButtonPress_t;
+
+typedef struct {
+	plant_t Plant;
+	uint16_t SensorADC;
+	std::vector<ButtonPress_t> Presses;
+	FILE *UartFile;
+	FILE *OutFile;
+	unsigned long UartLines;
+	unsigned long Steps;
+	double EffectSumm;				// For the whole run
+	double SecondEffectSumm;		// For -out
+	double MaxTemperature;
+	uint64_t LoopRuns;				// Firmware main loop runs
+	uint16_t LoopTicks;				// Last sys_timers.loop_ticks
+} FwSimContext_t;
+
+
+//-------------------------------------------------------//
+// Counts main loop runs. 16-bit loop_ticks does not wrap
+// within a step.
+//-------------------------------------------------------//
+static void updateLoopRuns(FwSimContext_t *sim)
+{
+	uint16_t ticks = board_get_loop_ticks();
+	sim->LoopRuns += (uint16_t)(ticks - sim->LoopTicks);
+	sim->LoopTicks = ticks;
+}
+
+//-------------------------------------------------------//
+// Board step: plant update with the heater effect of the last step,
+// sensor and buttons
+//-------------------------------------------------------//
+static void boardStep(void *ctx)
+{
+	FwSimContext_t *sim = (FwSimContext_t *)ctx;
+	double effect = board_take_heater_count() * 100.0 / HALF_PERIODS_PER_STEP;
+	double seconds;
+	uint8_t buttons = 0;
+	size_t i;
+
+	updateLoopRuns(sim);
+	processPlant(&sim->Plant, effect);
+	sim->SensorADC = board_get_sensor_adc(getPlantState(&sim->Plant));
+	sim->Steps++;
+	sim->EffectSumm += effect;
+	sim->SecondEffectSumm += effect;
+	if (getPlantState(&sim->Plant) > sim->MaxTemperature)
+		sim->MaxTemperature = getPlantState(&sim->Plant);
+
+	seconds = sim->Steps * TIMESTEP;
+	for (i = 0; i < sim->Presses.size(); i++)
+	{
+		if ((seconds >= sim->Presses[i].Time) && (seconds < sim->Presses[i].Time + sim->Presses[i].Hold))
+			buttons |= sim->Presses[i].Buttons;
+	}
+	board_set_buttons(buttons);
+
+	if ((sim->OutFile) && (sim->Steps % STEPS_PER_SECOND == 0))
+	{
+		fprintf(sim->OutFile, "%lu\t%.3f\t%.1f\n", sim->Steps / STEPS_PER_SECOND, getPlantState(&sim->Plant),
+			sim->SecondEffectSumm / STEPS_PER_SECOND);
+		sim->SecondEffectSumm = 0;
+	}
+}
+
+static uint16_t boardReadADC(void *ctx)
+{
+	return ((FwSimContext_t *)ctx)->SensorADC;
+}
+
+static void boardACZero(void *ctx)
+{
+	board_ac_zero();
+}
+
+static void boardUartTx(uint8_t data, void *ctx)
+{
+	FwSimContext_t *sim = (FwSimContext_t *)ctx;
+	if (data == '\n')
+		sim->UartLines++;
+	if (sim->UartFile)
+		fputc(data, sim->UartFile);
+}
+
+
+//-------------------------------------------------------//
+// Parses -press list: <time>:<button>[:<hold>],...
+//-------------------------------------------------------//
+static bool parsePresses(const char *arg_str, std::vector<ButtonPress_t> *presses)
+{
+	std::string list(arg_str);
+	size_t start = 0;
+
+	while (start < list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		std::string item = list.substr(start, end - start);
+		size_t colon1 = item.find(':');
+		size_t colon2 = (colon1 == std::string::npos) ? colon1 : item.find(':', colon1 + 1);
+		ButtonPress_t press;
+
+		if (colon1 == std::string::npos)
+			return false;
+		press.Time = atof(item.substr(0, colon1).c_str());
+		press.Buttons = board_get_button(item.substr(colon1 + 1, colon2 - colon1 - 1).c_str());
+		press.Hold = (colon2 == std::string::npos) ? BUTTON_HOLD_TIME : atof(item.substr(colon2 + 1).c_str());
+		if ((press.Buttons == 0) || (press.Hold <= 0))
+			return false;
+		presses->push_back(press);
+		start = end + 1;
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------//
+// Feeds a random stream of conversions to the firmware ADC ISR and calls
+// update_normalized_adc() after a random number of conversions.
+// Reference computes the CIC output of the last complete decimation period
+// as the summ of conversions with triangular weights and filters it with the same FIR.
+// Returns number of updates with different results
+//-------------------------------------------------------//
+static unsigned long runAdcCheck(unsigned long conversions)
+{
+	std::vector<uint16_t> history(conversions);
+	AdcFilter_t filter;
+	SimRandom rng(2013);
+	unsigned long i, n, end, updates = 0, mismatches = 0;
+	unsigned next_update = 0;
+	uint32_t summ, gain = (uint32_t)ADC_DECIMATION * ADC_DECIMATION;
+	uint16_t oversampled, normalized;
+	uint8_t status;
+
+	filter.Init(0);
+	for (i = 0; i < conversions; i++)
+	{
+		// Random levels with noise, ADC limits and sensor faults
+		switch ((i / 50000) % 4)
+		{
+			case 0:		mcu_regs.adc = (uint16_t)(rng.Next() % 1024);						break;
+			case 1:		mcu_regs.adc = (uint16_t)(300 + (i / 50000) % 400 + rng.Next() % 8);	break;
+			case 2:		mcu_regs.adc = (rng.Next() & 1) ? 0 : 1023;							break;
+			default:	mcu_regs.adc = (uint16_t)(1000 + rng.Next() % 24);					break;
+		}
+		history[i] = 1024 - mcu_regs.adc;
+		ADC_vect();
+
+		if (next_update-- != 0)
+			continue;
+		next_update = (unsigned)(rng.Next() % (2 * ADC_DECIMATION));
+		update_normalized_adc();
+
+		// Newest block of the CIC window has weights ADC_DECIMATION to 1, the block before - ADC_DECIMATION - 1 to 0
+		end = (i + 1) / ADC_DECIMATION * ADC_DECIMATION;
+		summ = 0;
+		for (n = (end > 2 * ADC_DECIMATION) ? end - 2 * ADC_DECIMATION : 0; n < end; n++)
+			summ += history[n] * ((n + ADC_DECIMATION >= end) ? end - n : n + 2 * ADC_DECIMATION - end);
+		oversampled = (uint16_t)(((summ << 4) + (gain >> 1)) / gain);
+		normalized = oversampled >> 4;
+		status = 0;
+		if (normalized < ADC_LOW_CORRECT)
+			status |= ADC_SENSOR_NO_PRESENT;
+		else if (normalized > ADC_HIGH_CORRECT)
+			status |= ADC_SENSOR_SHORTED;
+		if ((adc_normalized != normalized) || (adc_filtered != (uint16_t)filter.Process(oversampled)) || (adc_status != status))
+			mismatches++;
+		updates++;
+	}
+	printf("ADC check: %lu conversions, %lu updates, %lu mismatches\n", conversions, updates, mismatches);
+	return mismatches;
+}
+
+
+//-------------------------------------------------------//
+// Checks getNextMenuItem() of menu.c against a scan of the flat jump table
+// menu.c had before the per-item index, for every item ID and jump condition.
+// Returns number of mismatches
+//-------------------------------------------------------//
+typedef struct {
+	uint8_t Item;
+	uint16_t JumpCondition;
+	uint8_t NextItem;
+	uint8_t Flags;
+} MenuFlatJump_t;
+
+static const MenuFlatJump_t menuFlatJumps[] = {
+	{ mi_REALTEMP, 	BD_UP | BD_DOWN,				mi_SETTEMP,		SHIFT_LEFT	|	10	},
+	{ mi_REALTEMP, 	BS_MENU,						mi_ROLL,		SHIFT_RIGHT	|	0	},
+	{ mi_REALTEMP, 	BL_MENU,						mi_SNDEN,						10	},
+	{ mi_ROLL, 		BS_MENU,						mi_REALTEMP,	SHIFT_LEFT	|	0	},
+	{ mi_ROLL, 		BL_MENU,						mi_SNDEN,						10	},
+	{ mi_SETTEMP, 	BS_MENU | TMR_EXP,				mi_REALTEMP,	SHIFT_RIGHT	| 	0	},
+	{ mi_SETTEMP, 	BL_MENU,						mi_REALTEMP,	SHIFT_RIGHT	| DISCARD_CHANGES	| 	0	},
+	{ mi_SNDEN, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
+	{ mi_SNDEN, 	BD_DOWN,						mi_AUTOPOFF,	SHIFT_RIGHT	|	10	},
+	{ mi_SNDEN, 	BD_UP,							mi_CALIB2,		SHIFT_LEFT	|	10	},
+	{ mi_SNDEN, 	BS_MENU,						mi_ACTSNDEN,					10	},
+	{ mi_ACTSNDEN, 	BS_MENU | TMR_EXP,				mi_SNDEN,						10	},
+	{ mi_ACTSNDEN, 	BL_MENU,						mi_SNDEN,		DISCARD_CHANGES	|	10	},
+	{ mi_AUTOPOFF, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
+	{ mi_AUTOPOFF, 	BD_DOWN,						mi_CALIB1,		SHIFT_RIGHT	|	10	},
+	{ mi_AUTOPOFF, 	BD_UP,							mi_SNDEN,		SHIFT_LEFT	|	10	},
+	{ mi_AUTOPOFF,		BS_MENU,					mi_ACTAUTOPOFF,					10	},
+	{ mi_ACTAUTOPOFF,	BS_MENU | TMR_EXP,			mi_AUTOPOFF,					10	},
+	{ mi_ACTAUTOPOFF,	BL_MENU,					mi_AUTOPOFF,	DISCARD_CHANGES	|	10	},
+	{ mi_CALIB1, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
+	{ mi_CALIB1, 	BD_DOWN,						mi_CALIB2,		SHIFT_RIGHT	|	10	},
+	{ mi_CALIB1, 	BD_UP,							mi_AUTOPOFF,	SHIFT_LEFT	|	10	},
+	{ mi_CALIB1, 	BS_MENU,						mi_DOCALIB1,					0	},
+	{ mi_CALIB2, 	BL_MENU | TMR_EXP,				mi_REALTEMP,					0	},
+	{ mi_CALIB2, 	BD_DOWN,						mi_SNDEN,		SHIFT_RIGHT	|	10	},
+	{ mi_CALIB2, 	BD_UP,							mi_CALIB1,		SHIFT_LEFT	|	10	},
+	{ mi_CALIB2, 	BS_MENU,						mi_DOCALIB2,					0	},
+	{ mi_DOCALIB1, 	BL_MENU,						mi_CALIB1,						10	},
+	{ mi_DOCALIB1, 	BS_MENU,						mi_CDONE1,						5	},
+	{ mi_CDONE1, 	BS_MENU | BL_MENU | TMR_EXP,	mi_REALTEMP,					0	},
+	{ mi_DOCALIB2, 	BL_MENU,						mi_CALIB2,						10	},
+	{ mi_DOCALIB2, 	BS_MENU,						mi_CDONE2,						5	},
+	{ mi_CDONE2, 	BS_MENU | BL_MENU | TMR_EXP,	mi_REALTEMP,					0	},
+	{ mi_REALTEMP, 	GOTO_POFF,						mi_POFFACT,						0	},
+	{ mi_ROLL, 		GOTO_POFF,						mi_POFFACT,						0	},
+	{ mi_POFFACT, 	BD_UP | BD_DOWN | BS_MENU | BL_MENU | BD_ROTFWD | BD_ROTREV | BD_HEATCTRL, mi_REALTEMP,	0	}
+};
+
+static unsigned long runMenuCheck(void)
+{
+	unsigned long pairs = 0, mismatches = 0;
+	unsigned item, cond, i;
+	NextItem_t next;
+	const MenuFlatJump_t *jump;
+
+	for (item = 0; item < 256; item++)
+	{
+		for (cond = 0; cond < 0x10000; cond++)
+		{
+			jump = NULL;
+			for (i = 0; (i < sizeof(menuFlatJumps) / sizeof(menuFlatJumps[0])) && !jump; i++)
+			{
+				if ((menuFlatJumps[i].Item == item) && (menuFlatJumps[i].JumpCondition & cond))
+					jump = &menuFlatJumps[i];
+			}
+			next = getNextMenuItem((uint8_t)item, (uint16_t)cond);
+			if (jump ? ((next.ItemID != jump->NextItem) || (next.ItemTimeout != (jump->Flags & TIMEOUT_MASK)) ||
+				(next.Flags != (jump->Flags & ~TIMEOUT_MASK))) : (next.ItemID != item))
+				mismatches++;
+			pairs++;
+		}
+	}
+	printf("Menu check: %lu item and jump condition pairs, %lu mismatches\n", pairs, mismatches);
+	return mismatches;
+}
+
+
+//-------------------------------------------------------//
+// Checks conv_ADC_to_Celsius() and conv_Celsius_to_ADC() of adc.c against
+// the division formulas adc.c had before the division-free conversion.
+// For every calibration of the grid all 16-bit ADC values and Celsius values
+// of -1024 to 1023 (setup temperature is 0 to 255) are converted.
+// Calibrations with the same ADC values or k_norm of 0 are skipped - former code divides by zero.
+// Prints how many values took the fixed point path, the fixed point with correction
+// and the division.
+// Returns number of mismatches
+//-------------------------------------------------------//
+static unsigned long runConvCheck(void)
+{
+	static const uint8_t celsius[] = {0, 20, 24, 50, 100, 130, 200, 255};
+	static const uint16_t adc[] = {0, 100, 500, 796, 1000, 1672, 2500, 4095};
+	unsigned long calibrations = 0, values = 0, mismatches = 0;
+	unsigned c1, c2, a1, a2;
+	int32_t k_norm, offset_norm;
+	int16_t temp;
+	int value;
+
+	memset(conv_adc_paths, 0, sizeof(conv_adc_paths));
+	memset(conv_celsius_paths, 0, sizeof(conv_celsius_paths));
+	for (c1 = 0; c1 < sizeof(celsius); c1++)
+	for (c2 = 0; c2 < sizeof(celsius); c2++)
+	for (a1 = 0; a1 < sizeof(adc) / sizeof(adc[0]); a1++)
+	for (a2 = 0; a2 < sizeof(adc) / sizeof(adc[0]); a2++)
+	{
+		if (a1 == a2)
+			continue;
+		cp.cpoint1 = celsius[c1];
+		cp.cpoint2 = celsius[c2];
+		cp.cpoint1_adc = adc[a1];
+		cp.cpoint2_adc = adc[a2];
+		temp = (int16_t)((cp.cpoint2_adc - cp.cpoint1_adc) << ADC_EXTRA_BITS);
+		k_norm = ((int32_t)(cp.cpoint2 - cp.cpoint1) * ADC_COEFF_SCALE + (int32_t)(temp >> 1)) / ((int32_t)temp);
+		offset_norm = (int32_t)cp.cpoint1 * ADC_COEFF_SCALE - ((int32_t)cp.cpoint1_adc << ADC_EXTRA_BITS) * k_norm;
+		if (k_norm == 0)
+			continue;
+		calculateCoeffs();
+		for (value = 0; value < 0x10000; value++)
+		{
+			if (conv_ADC_to_Celsius((uint16_t)value) !=
+				(int16_t)(((int32_t)value * k_norm + offset_norm + (ADC_COEFF_SCALE >> 1)) / ADC_COEFF_SCALE))
+				mismatches++;
+		}
+		for (value = -1024; value < 1024; value++)
+		{
+			if (conv_Celsius_to_ADC((int16_t)value) !=
+				(uint16_t)(((int32_t)value * ADC_COEFF_SCALE - offset_norm + (k_norm >> 1)) / k_norm))
+				mismatches++;
+		}
+		values += 0x10000 + 2048;
+		calibrations++;
+	}
+	printf("ADC to Celsius: fixed point %lu, corrected %lu, division %lu\n", (unsigned long)conv_adc_paths[0],
+		(unsigned long)conv_adc_paths[1], (unsigned long)conv_adc_paths[2]);
+	printf("Celsius to ADC: fixed point %lu, corrected %lu, division %lu\n", (unsigned long)conv_celsius_paths[0],
+		(unsigned long)conv_celsius_paths[1], (unsigned long)conv_celsius_paths[2]);
+	printf("Conversion check: %lu calibrations, %lu values, %lu mismatches\n", calibrations, values, mismatches);
+	return mismatches;
+}
+
+
+//-------------------------------------------------------//
+// Compares processPIDShift() with processPID() over PID_SetPoint / PID_ProcessValue
+// streams of experiment logs - text logs of pid1.c with 9 columns: Celsius, adc_normalized,
+// adc_filtered, set point, process value, p, d and i terms, output. Debug values change
+// when the PID runs, so every change of columns 3 to 7 is taken as a PID call.
+// Logs of different firmware versions have different scales - the streams are only
+// inputs here. Both controllers run enabled, integrator limit is set from the set point
+// converted to Celsius with the default calibration.
+// Returns number of calls with output difference above PID_CHECK_MAX_DIFF
+//-------------------------------------------------------//
+#define PID_CHECK_MAX_DIFF		3			// Output counts of PID_OUTPUT_MAX
+
+static void findLogFiles(const std::string &path, std::vector<std::string> *files)
+{
+	struct stat st;
+	struct dirent *entry;
+	DIR *dir;
+	std::string name;
+
+	if (stat(path.c_str(), &st) != 0)
+		return;
+	if (!S_ISDIR(st.st_mode))
+	{
+		files->push_back(path);
+		return;
+	}
+	if (!(dir = opendir(path.c_str())))
+		return;
+	while ((entry = readdir(dir)))
+	{
+		name = entry->d_name;
+		if ((name == ".") || (name == ".."))
+			continue;
+		if (stat((path + "/" + name).c_str(), &st) != 0)
+			continue;
+		if (S_ISDIR(st.st_mode) || ((name.size() > 4) && (name.compare(name.size() - 4, 4, ".log") == 0)))
+			findLogFiles(path + "/" + name, files);
+	}
+	closedir(dir);
+}
+
+static unsigned long runPidCheck(const char *path)
+{
+	std::vector<std::string> files;
+	unsigned long calls, differ, total_calls = 0, total_differ = 0, failed = 0;
+	int max_diff, total_max_diff = 0, diff;
+	long col[9], last[9];
+	char line[256], *p, *end;
+	unsigned i, n;
+	int set_temp;
+	bool first;
+	FILE *f;
+
+	findLogFiles(path, &files);
+	std::sort(files.begin(), files.end());
+	if (files.empty())
+	{
+		printf("No log files found in %s\n", path);
+		return 1;
+	}
+
+	cp.cpoint1 = 24;
+	cp.cpoint1_adc = 796;
+	cp.cpoint2 = 130;
+	cp.cpoint2_adc = 1672;
+	calculateCoeffs();
+
+	printf("%-60s %8s %8s %8s\n", "log", "calls", "max diff", "differ");
+	for (i = 0; i < files.size(); i++)
+	{
+		if (!(f = fopen(files[i].c_str(), "r")))
+			continue;
+		calls = differ = 0;
+		max_diff = 0;
+		first = true;
+		memset(last, 0, sizeof(last));
+		while (fgets(line, sizeof(line), f))
+		{
+			for (n = 0, p = line; n < 9; n++, p = end)
+			{
+				col[n] = strtol(p, &end, 10);
+				if (end == p)
+					break;
+			}
+			while ((*end == ' ') || (*end == '\t') || (*end == '\r') || (*end == '\n'))
+				end++;
+			if ((n != 9) || (*end != '\0') || (col[3] <= 0) || (col[3] > 0xFFFF) || (col[4] < 0) || (col[4] > 0xFFFF))
+				continue;
+			if (!first && (memcmp(&col[3], &last[3], 5 * sizeof(long)) == 0))
+				continue;
+			if (first || (col[3] != last[3]))
+			{
+				set_temp = conv_ADC_to_Celsius((uint16_t)(col[3] << ADC_EXTRA_BITS));
+				set_temp = (set_temp < 0) ? 0 : (set_temp > 255) ? 255 : set_temp;
+				setPIDIntegratorLimit((uint8_t)set_temp);
+				setPIDShiftIntegratorLimit((uint8_t)set_temp);
+			}
+			diff = (int)processPID((uint16_t)col[3], (uint16_t)col[4], first ? RESET_PID : HEATER_ENABLED) -
+				(int)processPIDShift((uint16_t)col[3], (uint16_t)col[4], first ? RESET_PID : HEATER_ENABLED);
+			diff = abs(diff);
+			max_diff = std::max(max_diff, diff);
+			if (diff != 0)
+				differ++;
+			if (diff > PID_CHECK_MAX_DIFF)
+				failed++;
+			memcpy(last, col, sizeof(last));
+			first = false;
+			calls++;
+		}
+		fclose(f);
+		if (calls == 0)
+			continue;
+		printf("%-60s %8lu %8d %8lu\n", files[i].c_str() + ((files[i].size() > 60) ? files[i].size() - 60 : 0),
+			calls, max_diff, differ);
+		total_calls += calls;
+		total_differ += differ;
+		total_max_diff = std::max(total_max_diff, max_diff);
+	}
+	printf("PID check: %lu calls, max output difference %d (limit %d), %lu calls differ, %lu above limit\n",
+		total_calls, total_max_diff, PID_CHECK_MAX_DIFF, total_differ, failed);
+	return failed;
+}
+
+
+//-------------------------------------------------------//
+// Power loss check of the params journal (params_journal.c).
+// A run of EEPROM_CHECK_RECORDS commits starts with the empty journal (defaults are
+// saved first), every next commit changes one param like a menu item. The run passes
+// 256 sequence numbers and wraps the ring several times.
+// Every byte written by processParamsJournal() is cut, and so is the byte that
+// finishParamsJournal() (power fail path) writes at every point of the run. A cut byte
+// gets any value of an erase or programming that is not finished: old or new value with
+// some bits still set. restoreJournalParams() must then give the params of the record being
+// written if its commit byte is fully written, the latest committed params otherwise,
+// defaults before the first commit. After every recovery one more commit is written
+// and must be restored.
+// Then restoreGlobalParams() starts from the EEPROM of a device updated in use: empty journal
+// and params in the former layout (eeGlobalParams). Params with valid CRC must be kept
+// without EEPROM error, corrupted ones replaced by defaults (E1), and both saved to the journal.
+// Returns number of failed recoveries
+//-------------------------------------------------------//
+#define EEPROM_CHECK_RECORDS	600
+#define EEPROM_CHECK_FORMER_SETPOINT	120		// Not the default set point
+#define EEPROM_CHECK_NONE		(-1)		// No committed record, firmware loads defaults
+#define EEPROM_CHECK_MAX_CALLS	16			// processParamsJournal() calls per record, a record takes up to 7
+
+typedef struct {
+	std::vector<uint8_t> Image;		// ee_journal before the write
+	unsigned Offset;
+	uint8_t Value;
+	bool Commit;					// Commit byte of the record being written
+	int Latest;						// Params of the latest committed record, EEPROM_CHECK_NONE before the first
+	int Record;						// Params of the record being written
+} EepromCheckWrite_t;
+
+static void getJournalImage(std::vector<uint8_t> *image)
+{
+	image->assign((const uint8_t *)ee_journal, (const uint8_t *)ee_journal + sizeof(ee_journal));
+}
+
+static void setJournalImage(const std::vector<uint8_t> &image)
+{
+	memcpy(ee_journal, image.data(), sizeof(ee_journal));
+}
+
+// Returns offset of the byte that differs from the image, -1 if none
+static int findJournalWrite(const std::vector<uint8_t> &image)
+{
+	unsigned i;
+	for (i = 0; i < sizeof(ee_journal); i++)
+	{
+		if (((const uint8_t *)ee_journal)[i] != image[i])
+			return (int)i;
+	}
+	return -1;
+}
+
+// Writes the record of committed params, returns byte writes
+static unsigned writeJournalRecord(void)
+{
+	std::vector<uint8_t> image;
+	unsigned calls, writes = 0;
+
+	commitGlobalParams();
+	for (calls = 0; calls < EEPROM_CHECK_MAX_CALLS; calls++)
+	{
+		getJournalImage(&image);
+		mcu_eeprom_complete();
+		processParamsJournal();
+		if (findJournalWrite(image) < 0)
+			break;
+		writes++;
+	}
+	return writes;
+}
+
+// Changes one param within its menu range
+static void changeParams(gParams_t *params, SimRandom *rng)
+{
+	gParams_t old = *params;
+	while (!memcmp(&old, params, sizeof(gParams_t)))
+	{
+		switch (rng->Next() % 4)
+		{
+			case 0: params->setup_temp_value = (uint8_t)(MIN_SET_TEMP + rng->Next() % ((MAX_SET_TEMP - MIN_SET_TEMP) / TEMP_SET_STEP + 1) * TEMP_SET_STEP); break;
+			case 1: params->rollCycleSet = (uint8_t)(MIN_ROLL_CYCLES + rng->Next() % (MAX_ROLL_CYCLES - MIN_ROLL_CYCLES + 1)); break;
+			case 2: params->sound_enable ^= 1; break;
+			default: params->power_off_timeout = (uint8_t)(MIN_POWEROFF_TIMEOUT + rng->Next() % ((MAX_POWEROFF_TIMEOUT - MIN_POWEROFF_TIMEOUT) / POWEROFF_SET_STEP + 1) * POWEROFF_SET_STEP); break;
+		}
+	}
+}
+
+// Restores params from the image, returns true if p is the expected params
+static bool checkJournalRecovery(const std::vector<uint8_t> &image, const std::vector<gParams_t> &params, int expected)
+{
+	setJournalImage(image);
+	memset(&p, 0, sizeof(gParams_t));
+	mcu_eeprom_complete();
+	if (restoreJournalParams())
+		return expected == EEPROM_CHECK_NONE;
+	return (expected != EEPROM_CHECK_NONE) && !memcmp(&p, &params[expected], sizeof(gParams_t));
+}
+
+static unsigned long runEepromCheck(void)
+{
+	std::vector<EepromCheckWrite_t> writes;
+	std::vector<gParams_t> params;
+	std::vector<uint8_t> initial, image;
+	std::vector<unsigned> byte_writes(sizeof(ee_journal), 0);
+	EepromCheckWrite_t write;
+	SimRandom rng(1);
+	gParams_t next;
+	unsigned long cuts = 0, failed = 0, fail_writes = 0;
+	unsigned i, calls, m;
+	int latest = EEPROM_CHECK_NONE;
+	int offset;
+	bool values[256];
+
+	getJournalImage(&initial);
+	// Zero filled ring holds no valid record
+	image.assign(sizeof(ee_journal), 0);
+	if (!checkJournalRecovery(image, params, EEPROM_CHECK_NONE))
+		failed++;
+
+	// Run of commits, every write is recorded with the image before it
+	setJournalImage(initial);
+	mcu_eeprom_complete();
+	if (!restoreJournalParams())
+		failed++;
+	p = pmGlobalDefaults;
+	for (i = 0; i < EEPROM_CHECK_RECORDS; i++)
+	{
+		if (i > 0)
+			changeParams(&p, &rng);
+		params.push_back(p);
+		commitGlobalParams();
+		for (calls = 0; calls < EEPROM_CHECK_MAX_CALLS; calls++)
+		{
+			write.Latest = latest;
+			write.Record = (int)i;
+			// AC line is lost here: power fail path, its write is undone for the run
+			getJournalImage(&write.Image);
+			mcu_eeprom_complete();
+			finishParamsJournal();
+			if ((offset = findJournalWrite(write.Image)) >= 0)
+			{
+				write.Offset = (unsigned)offset;
+				write.Value = ((uint8_t *)ee_journal)[offset];
+				write.Commit = true;
+				writes.push_back(write);
+				setJournalImage(write.Image);
+				fail_writes++;
+			}
+			// Background writer
+			mcu_eeprom_complete();
+			processParamsJournal();
+			if ((offset = findJournalWrite(write.Image)) < 0)
+				break;
+			write.Offset = (unsigned)offset;
+			write.Value = ((uint8_t *)ee_journal)[offset];
+			write.Commit = (offset % sizeof(journal_record_t) == offsetof(journal_record_t, commit)) &&
+				(write.Value != JOURNAL_NO_COMMIT);
+			writes.push_back(write);
+			byte_writes[offset]++;
+			if (write.Commit)
+				latest = (int)i;
+		}
+		if (latest != (int)i)
+		{
+			printf("Record %u is not written\n", i);
+			failed++;
+		}
+	}
+
+	// Power loss at every write
+	for (i = 0; i < writes.size(); i++)
+	{
+		const EepromCheckWrite_t *w = &writes[i];
+		memset(values, 0, sizeof(values));
+		for (m = 0; m < 256; m++)
+		{
+			values[w->Image[w->Offset] | m] = true;
+			values[w->Value | m] = true;
+		}
+		image = w->Image;
+		for (m = 0; m < 256; m++)
+		{
+			if (!values[m])
+				continue;
+			image[w->Offset] = (uint8_t)m;
+			cuts++;
+			if (!checkJournalRecovery(image, params, (w->Commit && (m == w->Value)) ? w->Record : w->Latest))
+			{
+				failed++;
+				continue;
+			}
+			// Next commit after the recovery
+			if (restoreJournalParams())
+				p = pmGlobalDefaults;
+			next = p;
+			changeParams(&next, &rng);
+			p = next;
+			writeJournalRecord();
+			memset(&p, 0, sizeof(gParams_t));
+			mcu_eeprom_complete();
+			if (restoreJournalParams() || memcmp(&p, &next, sizeof(gParams_t)))
+				failed++;
+		}
+	}
+
+	printf("EEPROM journal check: %u records, %lu byte writes, %lu by power fail path, %.2f writes per record\n",
+		(unsigned)EEPROM_CHECK_RECORDS, (unsigned long)writes.size() - fail_writes, fail_writes,
+		(double)(writes.size() - fail_writes) / EEPROM_CHECK_RECORDS);
+	printf("Max writes of one EEPROM byte %u (fixed layout: %u)\n",
+		*std::max_element(byte_writes.begin(), byte_writes.end()), (unsigned)EEPROM_CHECK_RECORDS);
+	printf("%lu power loss cuts, %lu failed recoveries\n", cuts, failed);
+
+	// Former layout, valid and corrupted CRC
+	for (m = 0; m < 2; m++)
+	{
+		board_program_former_eeprom(EEPROM_CHECK_FORMER_SETPOINT, (uint8_t)(m == 0));
+		next = pmGlobalDefaults;
+		if (m == 0)
+			next.setup_temp_value = EEPROM_CHECK_FORMER_SETPOINT;
+		memset(&p, 0, sizeof(gParams_t));
+		mcu_eeprom_complete();
+		if ((restoreGlobalParams() != ((m == 0) ? 0 : 0x01)) || memcmp(&p, &next, sizeof(gParams_t)))
+		{
+			printf("Former layout with %s CRC: params or EEPROM error are wrong\n", (m == 0) ? "valid" : "corrupted");
+			failed++;
+		}
+		for (calls = 0; calls < EEPROM_CHECK_MAX_CALLS; calls++)
+		{
+			mcu_eeprom_complete();
+			processParamsJournal();
+		}
+		memset(&p, 0, sizeof(gParams_t));
+		mcu_eeprom_complete();
+		if (restoreJournalParams() || memcmp(&p, &next, sizeof(gParams_t)))
+		{
+			printf("Former layout with %s CRC: params are not saved to the journal\n", (m == 0) ? "valid" : "corrupted");
+			failed++;
+		}
+	}
+	printf("Former layout update: 2 starts (valid and corrupted CRC), %lu failures in total\n", failed);
+	return failed;
+}
+
+
+//-------------------------------------------------------//
+// Main loop period during calibration: the firmware runs with unheated plant,
+// menu goes to calibration of point 1, sets CALIB_CHECK_CELSIUS and saves it
+// (point Celsius and ADC value change).
+// Main loop period is the interval of watchdog resets, main loop time is max_work_time
+// of the firmware - EEPROM waits delay the stages after the menu (heater control, log).
+// Fails if the longest period exceeds the shortest one by more than CALIB_CHECK_MAX_JITTER,
+// main loop time exceeds CALIB_CHECK_MAX_LOOP_TIME or the calibration is not saved
+// to EEPROM with valid CRC. Firmware built with SYNC_CALIBRATION_SAVE (make SYNCSAVE=1)
+// has the former synchronous save for comparison - its main loop time fails the check.
+// After the run, a block longer than EEQ_DATA_MAX must be rejected by the EEPROM queue
+// and nothing must be written.
+// Returns number of failures
+//-------------------------------------------------------//
+#define CALIB_CHECK_SECONDS		30
+#define CALIB_CHECK_PRESSES		"5:menu:2,8:down,9:down,10:menu,11:up:1,14:menu"	// Sound setup, auto power off, calibration 1, hold up
+#define CALIB_CHECK_AMBIENT		39			// Celsius, plant temperature
+#define CALIB_CHECK_CELSIUS		39			// Point 1 after CALIB_CHECK_PRESSES
+#define CALIB_CHECK_MAX_JITTER	1.0			// ms
+#define CALIB_CHECK_MAX_LOOP_TIME	1		// ms, firmware code runs in zero time
+
+static unsigned long runCalibCheck(void)
+{
+	FwSimContext_t sim;
+	mcu_config_t config;
+	const mcu_wdt_stats_t *stats;
+	unsigned long failed = 0;
+	double min_ms, max_ms, mean_ms;
+	uint8_t probe[EEQ_DATA_MAX + 1];
+	unsigned i;
+
+	parsePresses(CALIB_CHECK_PRESSES, &sim.Presses);
+	sim.UartFile = NULL;
+	sim.OutFile = NULL;
+	initPlant(&sim.Plant, CALIB_CHECK_AMBIENT, CALIB_CHECK_AMBIENT);
+	sim.SensorADC = board_get_sensor_adc(CALIB_CHECK_AMBIENT);
+	sim.UartLines = 0;
+	sim.Steps = 0;
+	sim.EffectSumm = 0;
+	sim.SecondEffectSumm = 0;
+	sim.MaxTemperature = CALIB_CHECK_AMBIENT;
+	sim.LoopRuns = 0;
+	sim.LoopTicks = 0;
+	board_program_eeprom(150);
+
+	config.end_time = (uint64_t)CALIB_CHECK_SECONDS * MCU_F_CPU;
+	config.step_period = (uint32_t)(TIMESTEP * MCU_F_CPU);
+	config.step = boardStep;
+	config.adc_read = boardReadADC;
+	config.ac_zero = boardACZero;
+	config.uart_tx = boardUartTx;
+	config.ctx = &sim;
+	mcu_init(&config);
+	if (mcu_run(firmware_main) != MCU_STOP_TIME)
+		failed++;
+
+	stats = mcu_get_wdt_stats();
+	min_ms = stats->min_interval * 1000.0 / MCU_F_CPU;
+	max_ms = stats->max_interval * 1000.0 / MCU_F_CPU;
+	mean_ms = (stats->resets > 1) ? stats->total_interval * 1000.0 / MCU_F_CPU / (stats->resets - 1) : 0;
+#ifdef SYNC_CALIBRATION_SAVE
+	printf("Calibration save: synchronous (SYNC_CALIBRATION_SAVE)\n");
+#else
+	printf("Calibration save: EEPROM queue\n");
+#endif
+	printf("Main loop period: %llu runs, mean %.3f ms, min %.3f ms, max %.3f ms, jitter %.3f ms (limit %.3f ms)\n",
+		(unsigned long long)stats->resets, mean_ms, min_ms, max_ms, max_ms - min_ms, CALIB_CHECK_MAX_JITTER);
+	printf("Max. main loop time %u ms (limit %u ms)\n", max_work_time, CALIB_CHECK_MAX_LOOP_TIME);
+	if ((max_ms - min_ms > CALIB_CHECK_MAX_JITTER) || (max_work_time > CALIB_CHECK_MAX_LOOP_TIME))
+		failed++;
+	if ((cp.cpoint1 != CALIB_CHECK_CELSIUS) || !board_is_calibration_saved())
+	{
+		printf("Calibration point 1 is not saved\n");
+		failed++;
+	}
+
+	// Rejected block: every byte differs from EEPROM, the writer would start the first one
+	for (i = 0; i < sizeof(probe); i++)
+		probe[i] = ~((uint8_t *)&eeCalibrationParams)[i % sizeof(cParams_t)];
+	if (!queueEEPROMWrite(&eeCalibrationParams, probe, sizeof(probe), 0))
+	{
+		printf("EEPROM queue takes a block of %u bytes (max %u)\n", (unsigned)sizeof(probe), (unsigned)EEQ_DATA_MAX);
+		failed++;
+	}
+	mcu_eeprom_complete();
+	processEEPROMQueue();
+	if (!board_is_calibration_saved())
+	{
+		printf("Rejected EEPROM queue block is written\n");
+		failed++;
+	}
+	printf("Calibration check: %lu failures\n", failed);
+	return failed;
+}
+
+
+//-------------------------------------------------------//
+// Prints busy waits inside ISRs, e.g. _delay_us() of the LED driver
+//-------------------------------------------------------//
+static void printIsrWaits(void)
+{
+	static const char *names[MCU_ISR_COUNT] = {"TIMER2_COMP", "TIMER0_OVF", "USART_UDRE", "ADC", "ANA_COMP"};
+	const mcu_isr_stats_t *stats = mcu_get_isr_stats();
+	bool waits = false;
+	unsigned i;
+
+	for (i = 0; i < MCU_ISR_COUNT; i++)
+	{
+		if (stats[i].wait_cycles == 0)
+			continue;
+		printf("%s ISR busy wait: %.2f us average, %.2f us max, %llu calls\n", names[i],
+			(double)stats[i].wait_cycles / stats[i].calls / MCU_CYCLES_PER_US,
+			(double)stats[i].max_wait_cycles / MCU_CYCLES_PER_US, (unsigned long long)stats[i].calls);
+		waits = true;
+	}
+	if (!waits)
+		printf("No busy waits in ISRs\n");
+}
+
+
+//-------------------------------------------------------//
+// Prints program memory reads per main loop run - tables, strings
+// and defaults copied by pgm_read_xx() and xxx_P() functions
+//-------------------------------------------------------//
+static void printFlashReads(FwSimContext_t *sim)
+{
+	uint64_t bytes = mcu_get_flash_reads();
+	double per_loop;
+
+	updateLoopRuns(sim);
+	per_loop = sim->LoopRuns ? (double)bytes / sim->LoopRuns : 0;
+	printf("Flash reads: %llu bytes, %.1f bytes (%.0f LPM cycles) per main loop run, %llu runs\n",
+		(unsigned long long)bytes, per_loop, per_loop * 3, (unsigned long long)sim->LoopRuns);
+}
+
+
+//-------------------------------------------------------//
+// Plays every melody from a main loop model (Sound_Play(), Sound_Prefetch()
+// by every run) and samples the beeper output at every systick.
+// With -soundcheck the run is repeated with SOUND_CHECK_WRITE_BYTES EEPROM
+// byte writes by every main loop run, which keeps EEPROM busy all the time.
+// Beeper output must be the same.
+//-------------------------------------------------------//
+#define SOUND_CHECK_LOOP			(51 * 1000 * MCU_CYCLES_PER_US)		// Main loop period
+#define SOUND_CHECK_SYSTICK			(1000 * MCU_CYCLES_PER_US)
+#define SOUND_CHECK_GAP				10			// Main loop runs between melodies
+#define SOUND_CHECK_WRITE_BYTES		6
+
+typedef struct {
+	const char *Name;
+	const tone_t *Melody;
+} SoundCheckMelody_t;
+
+static const SoundCheckMelody_t soundCheckMelodies[] = {
+	{"m_beep_1000Hz_100ms", m_beep_1000Hz_100ms},
+	{"m_beep_1000Hz_40ms", m_beep_1000Hz_40ms},
+	{"m_beep_800Hz_40ms", m_beep_800Hz_40ms},
+	{"m_beep_500Hz_40ms", m_beep_500Hz_40ms},
+	{"m_beep_err1", m_beep_err1},
+	{"m_siren1", m_siren1},
+	{"m_siren2", m_siren2},
+	{"m_siren3", m_siren3},
+	{"m_siren4", m_siren4},
+	{"m_beep_warn_poff", m_beep_warn_poff}
+};
+#define SOUND_CHECK_MELODIES	(sizeof(soundCheckMelodies) / sizeof(soundCheckMelodies[0]))
+
+typedef struct {
+	bool EepromWrites;
+	std::vector<uint8_t> Beeper;			// Sampled every systick
+	size_t Start[SOUND_CHECK_MELODIES + 1];	// Beeper index of every Sound_Play() and the end
+} SoundCheckRun_t;
+
+static SoundCheckRun_t *soundCheckRun;
+
+static void soundCheckStep(void *ctx)
+{
+	soundCheckRun->Beeper.push_back(board_get_beeper());
+}
+
+static uint16_t soundCheckReadADC(void *ctx)
+{
+	return 0;
+}
+
+static void soundCheckUartTx(uint8_t data, void *ctx)
+{
+}
+
+static unsigned getMelodyTime(const tone_t *melody)
+{
+	unsigned ms = 0;
+	for (; melody->duration != 0; melody++)
+		ms += melody->duration * TONE_DURATION_SCALE;
+	return ms;
+}
+
+static int soundCheckMain(void)
+{
+	uint64_t next_loop = SOUND_CHECK_LOOP;
+	unsigned i, loops;
+
+	board_start_systick();
+	for (i = 0; i < SOUND_CHECK_MELODIES; i++)
+	{
+		loops = getMelodyTime(soundCheckMelodies[i].Melody) * 1000 * MCU_CYCLES_PER_US / SOUND_CHECK_LOOP + SOUND_CHECK_GAP;
+		mcu_delay((uint32_t)(next_loop - mcu_get_time()));
+		next_loop += SOUND_CHECK_LOOP;
+		soundCheckRun->Start[i] = soundCheckRun->Beeper.size();
+		Sound_OverrideDisable();
+		Sound_Play(soundCheckMelodies[i].Melody);
+		while (loops--)
+		{
+			Sound_Prefetch();
+			if (soundCheckRun->EepromWrites)
+				board_write_eeprom(SOUND_CHECK_WRITE_BYTES, (uint8_t)loops);
+			if (mcu_get_time() < next_loop)
+				mcu_delay((uint32_t)(next_loop - mcu_get_time()));
+			next_loop += SOUND_CHECK_LOOP;
+		}
+	}
+	soundCheckRun->Start[SOUND_CHECK_MELODIES] = soundCheckRun->Beeper.size();
+	return 0;
+}
+
+static void runSoundCheckMelodies(SoundCheckRun_t *run)
+{
+	mcu_config_t config;
+
+	memset(&config, 0, sizeof(config));
+	config.end_time = ~0ULL;
+	config.step_period = SOUND_CHECK_SYSTICK;
+	config.step = soundCheckStep;
+	config.adc_read = soundCheckReadADC;
+	config.ac_zero = boardACZero;
+	config.uart_tx = soundCheckUartTx;
+	soundCheckRun = run;
+	mcu_init(&config);
+	mcu_run(soundCheckMain);
+}
+
+static unsigned long runSoundCheck(void)
+{
+	SoundCheckRun_t idle, writes;
+	unsigned long mismatches = 0;
+	size_t i, k, differ, played;
+
+	idle.EepromWrites = false;
+	writes.EepromWrites = true;
+	runSoundCheckMelodies(&idle);
+	runSoundCheckMelodies(&writes);
+
+	for (i = 0; i < SOUND_CHECK_MELODIES; i++)
+	{
+		played = 0;
+		differ = 0;
+		for (k = idle.Start[i]; k < idle.Start[i + 1]; k++)
+		{
+			if (idle.Beeper[k] != 0)
+				played++;
+			if ((k >= writes.Beeper.size()) || (writes.Beeper[k] != idle.Beeper[k]))
+				differ++;
+		}
+		printf("%-20s %5u ms melody, %5lu ms sound, %5lu ms differ with EEPROM writes\n", soundCheckMelodies[i].Name,
+			getMelodyTime(soundCheckMelodies[i].Melody), (unsigned long)played, (unsigned long)differ);
+		if (differ)
+			mismatches++;
+	}
+	printf("Sound check: %u melodies, %lu mismatches\n", (unsigned)SOUND_CHECK_MELODIES, mismatches);
+	return mismatches;
+}
+
+
+//-------------------------------------------------------//
+// Estimated worst-case main loop time of the task table. The firmware scheduler runs tables
+// with the periods and phases of main_tasks, task runs take estimated ATmega8 cycles
+// of virtual time (mcu_delay()), systick of Timer2 is the tick source. The former
+// table has the timing of the processSystemTimers() counters: Celsius update at
+// every log line and PID at every 20th Celsius update.
+// Third run is the new table with a stall of the menu task longer than a tick (like an
+// EEPROM wait) and two PID requests, one of them at a periodic PID tick.
+// Fails if:
+//	- a task run count differs from its period and phase (and requests)
+//	- the new table runs more than one heavy task at a tick, or its worst-case is not lower
+//	- runs without stall have overruns or deadline misses
+//	- the stall is not counted as a single overrun of the menu task and deadline misses
+//	  of the tasks that finish after it, or the late tick is lost (the last run starts later)
+// Returns number of failures
+//-------------------------------------------------------//
+#define SCHED_CHECK_TICKS			400			// Multiple of task periods
+#define SCHED_CHECK_STALL_TICK		101			// Odd, log line tick
+#define SCHED_CHECK_STALL_CYCLES	(60 * 1000 * MCU_CYCLES_PER_US)
+#define SCHED_CHECK_REQUEST_TICK	150			// Not a periodic PID tick
+
+// ATmega8 cycles per task run, index is task ID. Only the PID count is measured, the rest are
+// estimates - main loop times of the check are sums of them. 32-bit division takes about 600
+// cycles. Text log line is about 36 digits of logU16p() / logI32p() with a 32-bit division per
+// digit and 80 bytes queued for UART, profiler line - about 30 digits. Telemetry frame is
+// 24 bytes, COBS and CRC.
+// PID: worst case of processPID() counted on pid1/Debug/pid1.lss (see ReadMe.txt), without
+// the call from control.c. processPIDShift() is not measured - it has no loops, so the
+// processPID() count with two division loops is used as its bound.
+#define SCHED_CHECK_PID_CYCLES			1568
+
+typedef struct {
+	const char *Name;
+	uint32_t Cycles;
+	bool Heavy;								// Celsius update, PID, text log
+} SchedCheckTask_t;
+
+static const SchedCheckTask_t schedCheckTasks[TASK_COUNT] = {
+	{"buttons",		300,			false},
+	{"timers",		200,			false},
+	{"adc",			700,			false},
+	{"celsius",		200,			true},
+	{"menu",		1200,			false},
+	{"roll",		150,			false},
+	{"heater",		250,			false},
+	{"pid",			SCHED_CHECK_PID_CYCLES,	true},
+	{"alerts",		200,			false},
+#ifdef LOG_BINARY_TELEMETRY
+	{"telemetry",	2000,			false},
+#else
+	{"log",			26000,			true},
+#endif
+#ifdef STAGE_PROFILING
+	{"profiler",	22000,			false},
+#endif
+};
+
+typedef struct {
+	const char *Name;
+	task_t Tasks[TASK_COUNT];
+	bool Stall;
+	unsigned Tick;							// Current tick
+	unsigned Runs[TASK_COUNT];
+	unsigned ExpectedRuns[TASK_COUNT];
+	unsigned ExpectedMisses[TASK_COUNT];
+	unsigned MaxHeavy;						// Heavy tasks at a tick
+	uint64_t MaxLoop;						// CPU cycles, without the stall tick
+	unsigned MaxLoopTick;
+	uint64_t TotalLoop;
+	uint64_t LastTickStart;
+	task_state_t States[TASK_COUNT];		// Scheduler statistics at the end
+} SchedCheckRun_t;
+
+static SchedCheckRun_t *schedCheckRun;
+static unsigned schedCheckHeavy;			// Heavy tasks at the current tick
+
+static void schedCheckStep(void *ctx)
+{
+}
+
+static void schedCheckTask(uint8_t id)
+{
+	SchedCheckRun_t *run = schedCheckRun;
+	uint32_t cycles = schedCheckTasks[id].Cycles;
+
+	run->Runs[id]++;
+	if (schedCheckTasks[id].Heavy)
+		schedCheckHeavy++;
+	if (run->Stall)
+	{
+		if ((id == TASK_MENU) && (run->Tick == SCHED_CHECK_STALL_TICK))
+			cycles += SCHED_CHECK_STALL_CYCLES;
+		if ((id >= TASK_MENU) && (run->Tick == SCHED_CHECK_STALL_TICK))
+			run->ExpectedMisses[id]++;
+		// The second request is at a periodic PID tick
+		if ((id == TASK_HEATER) && ((run->Tick == SCHED_CHECK_REQUEST_TICK) ||
+			(run->Tick == run->Tasks[TASK_PID].phase + run->Tasks[TASK_PID].period)))
+			requestTask(TASK_PID);
+	}
+	mcu_delay(cycles);
+}
+
+template <uint8_t ID> static void schedCheckTaskRun(void)
+{
+	schedCheckTask(ID);
+}
+
+static void (* const schedCheckFunctions[TASK_COUNT])(void) = {
+	schedCheckTaskRun<TASK_BUTTONS>, schedCheckTaskRun<TASK_TIMERS>, schedCheckTaskRun<TASK_ADC>,
+	schedCheckTaskRun<TASK_CELSIUS>, schedCheckTaskRun<TASK_MENU>, schedCheckTaskRun<TASK_ROLL>,
+	schedCheckTaskRun<TASK_HEATER>, schedCheckTaskRun<TASK_PID>, schedCheckTaskRun<TASK_ALERTS>,
+	schedCheckTaskRun<TASK_LOG>,
+#ifdef STAGE_PROFILING
+	schedCheckTaskRun<TASK_PROFILER>,
+#endif
+};
+
+static int schedCheckMain(void)
+{
+	SchedCheckRun_t *run = schedCheckRun;
+	uint64_t start, loop;
+
+	board_start_systick();
+	initScheduler(run->Tasks, TASK_COUNT);
+	menuUpdateTimer.Timer = 0;
+	menuUpdateTimer.FOvfl = 0;
+	while (run->Tick < SCHED_CHECK_TICKS)
+	{
+		if (menuUpdateTimer.FOvfl)
+		{
+			start = mcu_get_time();
+			schedCheckHeavy = 0;
+			runScheduler();
+			loop = mcu_get_time() - start;
+			run->LastTickStart = start;
+			run->TotalLoop += loop;
+			if ((loop > run->MaxLoop) && !(run->Stall && (run->Tick == SCHED_CHECK_STALL_TICK)))
+			{
+				run->MaxLoop = loop;
+				run->MaxLoopTick = run->Tick;
+			}
+			run->MaxHeavy = std::max(run->MaxHeavy, schedCheckHeavy);
+			run->Tick++;
+		}
+		mcu_idle();
+	}
+	memcpy(run->States, task_states, sizeof(run->States));
+	return 0;
+}
+
+static void runSchedCheckTable(SchedCheckRun_t *run)
+{
+	mcu_config_t config;
+	unsigned id, tick;
+
+	run->Tick = 0;
+	run->MaxHeavy = 0;
+	run->MaxLoop = 0;
+	run->MaxLoopTick = 0;
+	run->TotalLoop = 0;
+	for (id = 0; id < TASK_COUNT; id++)
+	{
+		run->Tasks[id].run = schedCheckFunctions[id];
+		run->Runs[id] = 0;
+		run->ExpectedRuns[id] = 0;
+		run->ExpectedMisses[id] = 0;
+		for (tick = 0; tick < SCHED_CHECK_TICKS; tick++)
+			if (tick % run->Tasks[id].period == run->Tasks[id].phase)
+				run->ExpectedRuns[id]++;
+	}
+	if (run->Stall)
+		run->ExpectedRuns[TASK_PID]++;
+
+	memset(&config, 0, sizeof(config));
+	config.end_time = ~0ULL;
+	config.step_period = SOUND_CHECK_SYSTICK;
+	config.step = schedCheckStep;
+	config.adc_read = soundCheckReadADC;
+	config.ac_zero = boardACZero;
+	config.uart_tx = soundCheckUartTx;
+	schedCheckRun = run;
+	mcu_init(&config);
+	mcu_run(schedCheckMain);
+
+	printf("%s table: estimated worst-case main loop time %.3f ms at tick %u, mean %.3f ms, heavy tasks per tick %u\n",
+		run->Name, run->MaxLoop * 1000.0 / MCU_F_CPU, run->MaxLoopTick,
+		run->TotalLoop * 1000.0 / MCU_F_CPU / SCHED_CHECK_TICKS, run->MaxHeavy);
+}
+
+static unsigned long runSchedCheck(void)
+{
+	SchedCheckRun_t before, after, stall;
+	unsigned long failed = 0;
+	unsigned id;
+
+	before.Name = "Former";
+	after.Name = "Task";
+	stall.Name = "Stall";
+	before.Stall = false;
+	after.Stall = false;
+	stall.Stall = true;
+	memcpy(after.Tasks, main_tasks, sizeof(after.Tasks));
+	memcpy(before.Tasks, main_tasks, sizeof(before.Tasks));
+	memcpy(stall.Tasks, main_tasks, sizeof(stall.Tasks));
+	before.Tasks[TASK_TIMERS].phase = COUNTER_10SEC_INTERVAL - 1;
+	before.Tasks[TASK_CELSIUS].phase = 0;
+	before.Tasks[TASK_PID].phase = PID_UPDATE_INTERVAL - CELSIUS_UDPATE_INTERVAL;
+	before.Tasks[TASK_LOG].phase = 0;
+#if defined(STAGE_PROFILING) && !defined(LOG_BINARY_TELEMETRY)
+	before.Tasks[TASK_PROFILER].phase = 1;		// Former profiler skipped log line ticks
+#endif
+
+	printf("Estimated task times (pid - processPID() worst case), us:");
+	for (id = 0; id < TASK_COUNT; id++)
+		printf(" %s %.1f", schedCheckTasks[id].Name, (double)schedCheckTasks[id].Cycles / MCU_CYCLES_PER_US);
+	printf("\n");
+	runSchedCheckTable(&before);
+	runSchedCheckTable(&after);
+	runSchedCheckTable(&stall);
+
+	for (id = 0; id < TASK_COUNT; id++)
+	{
+		if ((before.Runs[id] != before.ExpectedRuns[id]) || (after.Runs[id] != after.ExpectedRuns[id]) ||
+			(stall.Runs[id] != stall.ExpectedRuns[id]))
+		{
+			printf("Task %s: %u, %u, %u runs, expected %u, %u, %u\n", schedCheckTasks[id].Name,
+				before.Runs[id], after.Runs[id], stall.Runs[id],
+				before.ExpectedRuns[id], after.ExpectedRuns[id], stall.ExpectedRuns[id]);
+			failed++;
+		}
+		if (before.States[id].overruns || before.States[id].deadline_misses ||
+			after.States[id].overruns || after.States[id].deadline_misses)
+		{
+			printf("Task %s: overruns or deadline misses without stall\n", schedCheckTasks[id].Name);
+			failed++;
+		}
+		if ((stall.States[id].overruns != ((id == TASK_MENU) ? 1 : 0)) ||
+			(stall.States[id].deadline_misses != stall.ExpectedMisses[id]))
+		{
+			printf("Task %s: stall gives %u overruns, %u deadline misses, expected %u, %u\n",
+				schedCheckTasks[id].Name, stall.States[id].overruns, stall.States[id].deadline_misses,
+				(id == TASK_MENU) ? 1 : 0, stall.ExpectedMisses[id]);
+			failed++;
+		}
+	}
+	if ((after.MaxHeavy > 1) || (after.MaxLoop >= before.MaxLoop))
+	{
+		printf("Task table does not lower the estimated worst-case main loop time\n");
+		failed++;
+	}
+	if (stall.LastTickStart != after.LastTickStart)
+	{
+		printf("Stall: last tick starts %.3f ms late\n",
+			((double)stall.LastTickStart - after.LastTickStart) * 1000.0 / MCU_F_CPU);
+		failed++;
+	}
+	printf("Scheduler check: %lu failures\n", failed);
+	return failed;
+}
+
+
+int main(int argc, char* argv[])
+{
+	ArgParser myArgParser;
+	FwSimContext_t sim;
+	mcu_config_t config;
+	double seconds = 3600;
+	double ambient = 25;
+	int setpoint = 150;
+	char *arg_str;
+	int result;
+
+	myArgParser.Parse(argc, argv);
+
+	if ((arg_str = myArgParser.GetOptionValue("-adccheck")))
+		return (runAdcCheck(strtoul(arg_str, NULL, 10)) == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-menucheck"))
+		return (runMenuCheck() == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-soundcheck"))
+		return (runSoundCheck() == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-convcheck"))
+		return (runConvCheck() == 0) ? 0 : 1;
+	if ((arg_str = myArgParser.GetOptionValue("-pidcheck")))
+		return (runPidCheck(arg_str) == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-eepromcheck"))
+		return (runEepromCheck() == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-calibcheck"))
+		return (runCalibCheck() == 0) ? 0 : 1;
+	if (myArgParser.GetOption("-schedcheck"))
+		return (runSchedCheck() == 0) ? 0 : 1;
+
+	if ((arg_str = myArgParser.GetOptionValue("-seconds")))
+		seconds = atof(arg_str);
+	if ((arg_str = myArgParser.GetOptionValue("-ambient")))
+		ambient = atof(arg_str);
+	if ((arg_str = myArgParser.GetOptionValue("-setpoint")))
+		setpoint = atoi(arg_str);
+	if ((seconds <= 0) || (setpoint < 0) || (setpoint > 255))
+	{
+		printf("Wrong -seconds or -setpoint\n");
+		return 1;
+	}
+
+	if (!myArgParser.GetOption("-noheat"))
+	{
+		ButtonPress_t press = {HEATER_PRESS_TIME, BUTTON_HOLD_TIME, (uint8_t)board_get_button("heat")};
+		sim.Presses.push_back(press);
+	}
+	if ((arg_str = myArgParser.GetOptionValue("-press")) && !parsePresses(arg_str, &sim.Presses))
+	{
+		printf("Wrong -press list, expected <time>:<button>[:<hold>],...\n");
+		return 1;
+	}
+
+	sim.UartFile = NULL;
+	sim.OutFile = NULL;
+	if ((arg_str = myArgParser.GetOptionValue("-uart")) && !(sim.UartFile = fopen(arg_str, "wb")))
+	{
+		printf("Cannot create file %s\n", arg_str);
+		return 1;
+	}
+	if ((arg_str = myArgParser.GetOptionValue("-out")) && !(sim.OutFile = fopen(arg_str, "w")))
+	{
+		printf("Cannot create file %s\n", arg_str);
+		return 1;
+	}
+
+	initPlant(&sim.Plant, ambient, ambient);
+	sim.SensorADC = board_get_sensor_adc(ambient);
+	sim.UartLines = 0;
+	sim.Steps = 0;
+	sim.EffectSumm = 0;
+	sim.SecondEffectSumm = 0;
+	sim.MaxTemperature = ambient;
+	sim.LoopRuns = 0;
+	sim.LoopTicks = 0;
+	if (!myArgParser.GetOption("-fresh"))
+		board_program_eeprom((uint8_t)setpoint);
+
+	config.end_time = (uint64_t)(seconds * MCU_F_CPU);
+	config.step_period = (uint32_t)(TIMESTEP * MCU_F_CPU);
+	config.step = boardStep;
+	config.adc_read = boardReadADC;
+	config.ac_zero = boardACZero;
+	config.uart_tx = boardUartTx;
+	config.ctx = &sim;
+	mcu_init(&config);
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	result = mcu_run(firmware_main);
+	double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	double sim_time = (double)mcu_get_time() / MCU_F_CPU;
+
+	if (sim.UartFile)
+		fclose(sim.UartFile);
+	if (sim.OutFile)
+		fclose(sim.OutFile);
+
+	printf("Simulated %.1f s in %.2f s (%.0fx real time)\n", sim_time, wall_time, sim_time / wall_time);
+	printf("Final temperature %.2f C, max %.2f C, mean heater effect %.1f%%, %lu UART lines\n",
+		getPlantState(&sim.Plant), sim.MaxTemperature, sim.Steps ? sim.EffectSumm / sim.Steps : 0, sim.UartLines);
+	printf("Max. main loop time %u ms, %u UART bytes dropped\n", max_work_time, usart_tx_dropped);
+	printIsrWaits();
+	printFlashReads(&sim);
+	if (result == MCU_STOP_WATCHDOG)
+		printf("Stopped by watchdog reset\n");
+	else if (result == MCU_STOP_MAIN_EXIT)
+		printf("Firmware main() returned\n");
+	return (result == MCU_STOP_TIME) ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+
+#include <math.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+#include "compilers.h"
+#include "port_defs.h"
+#include "buttons.h"
+#include "control.h"
+#include "systimer.h"
+#include "params_journal.h"
+#include "board.h"
+
+
+// EEMEM variables and defaults of control.c
+extern gParams_t eeGlobalParams;
+extern cParams_t eeCalibrationParams;
+extern uint8_t ee_gParamsCRC;
+extern uint8_t ee_cParamsCRC;
+extern const gParams_t pmGlobalDefaults;
+
+static uint16_t heater_count;		// TRIAC firings since last board_take_heater_count()
+static uint8_t ee_scratch[16] EEMEM;	// Written by board_write_eeprom()
+
+
+typedef struct {
+	const char *name;
+	uint8_t mask;
+} button_name_t;
+
+static const button_name_t button_names[] = {
+	{"menu",	BD_MENU},
+	{"up",		BD_UP},
+	{"down",	BD_DOWN},
+	{"fwd",		BD_ROTFWD},
+	{"rev",		BD_ROTREV},
+	{"heat",	BD_HEATCTRL},
+	{"cycle",	BD_CYCLE}
+};
+
+
+//-------------------------------------------------------//
+// Same as getDataCRC() of control.c
+//-------------------------------------------------------//
+static uint8_t getDataCRC(const void *data, uint8_t byte_count)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint8_t crc_byte = 0;
+	while (byte_count--)
+		crc_byte = _crc_ibutton_update(crc_byte, *p++);
+	return crc_byte;
+}
+
+//-------------------------------------------------------//
+// Same as getRecordCommit() of params_journal.c
+//-------------------------------------------------------//
+static uint8_t getRecordCommit(const journal_record_t *record)
+{
+	const uint8_t *p = (const uint8_t *)record;
+	uint8_t crc_byte = JOURNAL_CRC_SEED;
+	uint8_t i;
+	for (i = 0; i < offsetof(journal_record_t, commit); i++)
+		crc_byte = _crc_ibutton_update(crc_byte, *p++);
+	return crc_byte & 0x7F;
+}
+
+//-------------------------------------------------------//
+// Programs EEPROM of a device in use: journal record of default params
+// with given set point in slot 0 and valid calibration CRC,
+// so the firmware starts without EEPROM error
+//-------------------------------------------------------//
+void board_program_eeprom(uint8_t setpoint)
+{
+	ee_journal[0].params = pmGlobalDefaults;
+	ee_journal[0].params.setup_temp_value = setpoint;
+	ee_journal[0].seq = 0;
+	ee_journal[0].commit = getRecordCommit(&ee_journal[0]);
+	ee_cParamsCRC = getDataCRC(&eeCalibrationParams, sizeof(cParams_t));
+}
+
+//-------------------------------------------------------//
+// Programs EEPROM of a device in use with the firmware before the params journal:
+// default params with given set point in the former layout (eeGlobalParams),
+// with valid or corrupted CRC, unprogrammed journal and valid calibration CRC
+//-------------------------------------------------------//
+void board_program_former_eeprom(uint8_t setpoint, uint8_t crc_valid)
+{
+	memset(ee_journal, 0xFF, sizeof(ee_journal));
+	eeGlobalParams = pmGlobalDefaults;
+	eeGlobalParams.setup_temp_value = setpoint;
+	ee_gParamsCRC = getDataCRC(&eeGlobalParams, sizeof(gParams_t));
+	if (!crc_valid)
+		ee_gParamsCRC ^= 0x01;
+	ee_cParamsCRC = getDataCRC(&eeCalibrationParams, sizeof(cParams_t));
+}
+
+//-------------------------------------------------------//
+// Called at every AC line zero crossing after the comparator ISR.
+// Heater TRIAC is fired for the whole half-period when the ISR sets PD_HEATER.
+//-------------------------------------------------------//
+void board_ac_zero(void)
+{
+	if (PORTD & (1<<PD_HEATER))
+		heater_count++;
+}
+
+//-------------------------------------------------------//
+// Returns number of heated AC half-periods since the last call
+//-------------------------------------------------------//
+uint16_t board_take_heater_count(void)
+{
+	uint16_t count = heater_count;
+	heater_count = 0;
+	return count;
+}
+
+//-------------------------------------------------------//
+// Returns raw ADC value for the sensor temperature
+//-------------------------------------------------------//
+uint16_t board_get_sensor_adc(double celsius)
+{
+	double counts = BOARD_SENSOR_COUNTS1 + (celsius - BOARD_SENSOR_T1) *
+		(BOARD_SENSOR_COUNTS2 - BOARD_SENSOR_COUNTS1) / (BOARD_SENSOR_T2 - BOARD_SENSOR_T1);
+	double adc = 1024.0 - counts / 4;
+	if (adc < 0)
+		adc = 0;
+	if (adc > 1023)
+		adc = 1023;
+	return (uint16_t)floor(adc + 0.5);
+}
+
+//-------------------------------------------------------//
+// Sets pressed buttons (BD_xxx bits)
+// Buttons pull segment lines low, see capture_button_state()
+//-------------------------------------------------------//
+void board_set_buttons(uint8_t buttons)
+{
+	PINC = ~(buttons & 0x1F);
+	PINB = ~((buttons >> 2) & ((1<<PB_SEGF) | (1<<PB_SEGG) | (1<<PB_SEGH)));
+}
+
+//-------------------------------------------------------//
+// Returns BD_xxx bit for button name, 0 if unknown
+//-------------------------------------------------------//
+uint8_t board_get_button(const char *name)
+{
+	uint8_t i;
+	for (i = 0; i < sizeof(button_names) / sizeof(button_names[0]); i++)
+	{
+		if (strcmp(name, button_names[i].name) == 0)
+			return button_names[i].mask;
+	}
+	return 0;
+}
+
+//-------------------------------------------------------//
+// Returns firmware main loop run counter
+//-------------------------------------------------------//
+uint16_t board_get_loop_ticks(void)
+{
+	return sys_timers.loop_ticks;
+}
+
+//-------------------------------------------------------//
+// Starts timer 2 systick the same way as firmware main() and enables interrupts
+//-------------------------------------------------------//
+void board_start_systick(void)
+{
+	TCCR2 = (1<<CS22 | 1<<WGM21);
+	OCR2 = 249;
+	TIMSK = (1<<OCIE2);
+	sei();
+}
+
+//-------------------------------------------------------//
+// Returns beeper tone period (tone_t units), 0 when beeper output is off
+//-------------------------------------------------------//
+uint8_t board_get_beeper(void)
+{
+	return (TCCR1A & (1<<COM1A0)) ? (uint8_t)(OCR1A + 1) : 0;
+}
+
+//-------------------------------------------------------//
+// Writes bytes to EEPROM like saveCalibrationToEEPROM() does,
+// waits for every byte write except the last one
+//-------------------------------------------------------//
+void board_write_eeprom(uint8_t bytes, uint8_t value)
+{
+	uint8_t i;
+	for (i = 0; (i < bytes) && (i < sizeof(ee_scratch)); i++)
+		eeprom_write_byte(&ee_scratch[i], value);
+}
+
+//-------------------------------------------------------//
+// Returns 1 if EEPROM holds calibration params cp with valid CRC
+//-------------------------------------------------------//
+uint8_t board_is_calibration_saved(void)
+{
+	return !memcmp(&eeCalibrationParams, &cp, sizeof(cParams_t)) &&
+		(ee_cParamsCRC == getDataCRC(&eeCalibrationParams, sizeof(cParams_t)));
+}
@@ -0,0 +1,41 @@
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Laminator board around the MCU: heater TRIAC, temperature sensor, buttons, EEPROM contents.
+// Firmware specific parts of the host build live here, MCU model is in mcu_model.c
+
+// Temperature sensor, same points as the default calibration of control.c
+// ADC is sampled as (1024 - ADC), calibration points are in 4x counts (adc_filtered >> ADC_EXTRA_BITS)
+#define BOARD_SENSOR_T1			24.0		// Celsius
+#define BOARD_SENSOR_COUNTS1	796.0		// Calibration counts
+#define BOARD_SENSOR_T2			130.0
+#define BOARD_SENSOR_COUNTS2	1672.0
+
+
+void board_program_eeprom(uint8_t setpoint);
+void board_program_former_eeprom(uint8_t setpoint, uint8_t crc_valid);
+void board_ac_zero(void);
+uint16_t board_take_heater_count(void);
+uint16_t board_get_sensor_adc(double celsius);
+void board_set_buttons(uint8_t buttons);
+uint8_t board_get_button(const char *name);
+uint16_t board_get_loop_ticks(void);
+void board_start_systick(void);
+uint8_t board_get_beeper(void);
+void board_write_eeprom(uint8_t bytes, uint8_t value);
+uint8_t board_is_calibration_saved(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOARD_H_ */
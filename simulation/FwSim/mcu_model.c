@@ -0,0 +1,426 @@
+
+#include <setjmp.h>
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "mcu_model.h"
+
+
+#define NEVER			UINT64_MAX
+
+mcu_regs_t mcu_regs;
+
+static mcu_config_t cfg;
+static uint64_t now;				// Virtual time, CPU cycles
+static jmp_buf stop_point;
+static uint8_t in_isr;
+static uint32_t isr_wait;			// Busy wait cycles of the running ISR
+static mcu_isr_stats_t isr_stats[MCU_ISR_COUNT];
+static uint64_t flash_reads;
+
+// Next event times
+static uint64_t next_timer2;
+static uint64_t next_timer0;
+static uint64_t next_uart;			// Shift register empty, NEVER when idle
+static uint64_t next_adc;
+static uint64_t next_ac;
+static uint64_t next_step;
+static uint8_t adc_pending;			// Conversion done, ADC interrupt disabled
+
+static uint64_t eeprom_ready;		// End of EEPROM write
+static uint8_t wdt_enabled;
+static uint64_t wdt_timeout;
+static uint64_t wdt_last_reset;
+static mcu_wdt_stats_t wdt_stats;
+
+
+static const uint16_t timer0_prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16_t timer2_prescalers[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+
+//-------------------------------------------------------//
+// Passes byte written to UDR to the board at once
+//-------------------------------------------------------//
+static void flushUart(void)
+{
+	if (mcu_regs.udr != MCU_REG_UNTOUCHED)
+	{
+		cfg.uart_tx((uint8_t)mcu_regs.udr, cfg.ctx);
+		mcu_regs.udr = MCU_REG_UNTOUCHED;
+	}
+}
+
+//-------------------------------------------------------//
+// Stops firmware and returns from mcu_run()
+//-------------------------------------------------------//
+static void stop(int reason)
+{
+	flushUart();			// Pass last UART byte
+	longjmp(stop_point, reason + 1);
+}
+
+//-------------------------------------------------------//
+// Reschedules timer 0 overflow if firmware has written TCNT0
+// Firmware only writes TCNT0, so the register keeps MCU_REG_UNTOUCHED otherwise
+//-------------------------------------------------------//
+static void updateTimer0(void)
+{
+	uint16_t prescaler;
+	if (mcu_regs.tcnt0 == MCU_REG_UNTOUCHED)
+		return;
+	prescaler = timer0_prescalers[mcu_regs.tccr0 & 0x07];
+	if (prescaler)
+		next_timer0 = now + (uint64_t)(256 - (mcu_regs.tcnt0 & 0xFF)) * prescaler;
+	else
+		next_timer0 = NEVER;
+	mcu_regs.tcnt0 = MCU_REG_UNTOUCHED;
+}
+
+//-------------------------------------------------------//
+// Picks up timer setup done by firmware code
+//-------------------------------------------------------//
+static void updateTimers(void)
+{
+	uint16_t prescaler = timer2_prescalers[mcu_regs.tccr2 & 0x07];
+	updateTimer0();
+	// Timer 2 runs since the firmware has configured it
+	if ((next_timer2 == NEVER) && prescaler)
+		next_timer2 = now + (uint64_t)(mcu_regs.ocr2 + 1) * prescaler;
+}
+
+static inline uint8_t interruptsEnabled(void)
+{
+	return (mcu_regs.sreg & (1<<SREG_I)) && !in_isr;
+}
+
+static inline void callISR(void (*isr)(void), uint8_t index)
+{
+	mcu_isr_stats_t *stats = &isr_stats[index];
+	in_isr = 1;
+	isr_wait = 0;
+	isr();
+	in_isr = 0;
+	stats->calls++;
+	stats->wait_cycles += isr_wait;
+	if (isr_wait > stats->max_wait_cycles)
+		stats->max_wait_cycles = isr_wait;
+	updateTimer0();
+}
+
+//-------------------------------------------------------//
+// Moves byte from UDR to the idle shift register and updates UDRE
+//-------------------------------------------------------//
+static void updateUart(void)
+{
+	uint32_t ubrr = ((uint32_t)(mcu_regs.ubrrh & 0x0F) << 8) | mcu_regs.ubrrl;
+	if ((mcu_regs.udr != MCU_REG_UNTOUCHED) && (next_uart == NEVER))
+	{
+		next_uart = now + 10 * ((mcu_regs.ucsra & (1<<U2X)) ? 8 : 16) * (ubrr + 1);
+		flushUart();
+	}
+	if (mcu_regs.udr == MCU_REG_UNTOUCHED)
+		mcu_regs.ucsra |= (1<<UDRE);
+	else
+		mcu_regs.ucsra &= ~(1<<UDRE);
+}
+
+//-------------------------------------------------------//
+// Serves UART data register empty interrupt - it is pending
+// as long as UDRE and UDRIE are set
+//-------------------------------------------------------//
+static void serveUart(void)
+{
+	updateUart();
+	while ((mcu_regs.ucsrb & (1<<UDRIE)) && (mcu_regs.ucsra & (1<<UDRE)) && interruptsEnabled())
+	{
+		callISR(USART_UDRE_vect, MCU_ISR_USART_UDRE);
+		if (mcu_regs.udr == MCU_REG_UNTOUCHED)
+			break;
+		updateUart();
+	}
+}
+
+
+//-------------------------------------------------------//
+// Serves the earliest pending event if it is not later than time_limit
+// Returns 0 if there is no such event
+//-------------------------------------------------------//
+static uint8_t processNextEvent(uint64_t time_limit)
+{
+	uint64_t t = next_step;
+	uint16_t prescaler;
+
+	// Firmware may have queued UART data or started ADC since the last event
+	serveUart();
+	if ((mcu_regs.adcsra & (1<<ADSC)) && (next_adc == NEVER))
+		next_adc = now + MCU_ADC_CONVERSION;
+
+	if (next_timer2 < t) t = next_timer2;
+	if (next_timer0 < t) t = next_timer0;
+	if (next_uart < t) t = next_uart;
+	if (next_adc < t) t = next_adc;
+	if (next_ac < t) t = next_ac;
+	if (t > time_limit)
+		return 0;
+	now = t;
+
+	if (wdt_enabled && (now - wdt_last_reset > wdt_timeout))
+		stop(MCU_STOP_WATCHDOG);
+
+	// Board first, so that ISRs see new inputs
+	if (next_step == now)
+	{
+		next_step += cfg.step_period;
+		cfg.step(cfg.ctx);
+	}
+	// Vector 3
+	else if (next_timer2 == now)
+	{
+		prescaler = timer2_prescalers[mcu_regs.tccr2 & 0x07];
+		next_timer2 = prescaler ? (now + (uint64_t)(mcu_regs.ocr2 + 1) * prescaler) : NEVER;
+		if ((mcu_regs.timsk & (1<<OCIE2)) && interruptsEnabled())
+			callISR(TIMER2_COMP_vect, MCU_ISR_TIMER2_COMP);
+	}
+	// Vector 9
+	else if (next_timer0 == now)
+	{
+		prescaler = timer0_prescalers[mcu_regs.tccr0 & 0x07];
+		next_timer0 = prescaler ? (now + 256UL * prescaler) : NEVER;
+		if ((mcu_regs.timsk & (1<<TOIE0)) && interruptsEnabled())
+			callISR(TIMER0_OVF_vect, MCU_ISR_TIMER0_OVF);
+	}
+	// Vector 12
+	else if (next_uart == now)
+	{
+		next_uart = NEVER;
+		serveUart();
+	}
+	// Vector 14
+	else if (next_adc == now)
+	{
+		next_adc = NEVER;
+		if (!(mcu_regs.adcsra & (1<<ADFR)))
+			mcu_regs.adcsra &= ~(1<<ADSC);
+		mcu_regs.adc = cfg.adc_read(cfg.ctx);
+		adc_pending = 1;
+	}
+	// Vector 16
+	else
+	{
+		next_ac += MCU_AC_HALF_PERIOD;
+		if ((mcu_regs.acsr & (1<<ACIE)) && interruptsEnabled())
+			callISR(ANA_COMP_vect, MCU_ISR_ANA_COMP);
+		cfg.ac_zero(cfg.ctx);
+	}
+
+	if (adc_pending && (mcu_regs.adcsra & (1<<ADIE)) && interruptsEnabled())
+	{
+		adc_pending = 0;
+		callISR(ADC_vect, MCU_ISR_ADC);
+	}
+	return 1;
+}
+
+
+//-------------------------------------------------------//
+// Resets MCU model
+//-------------------------------------------------------//
+void mcu_init(const mcu_config_t *config)
+{
+	cfg = *config;
+	now = 0;
+	in_isr = 0;
+	memset(&mcu_regs, 0, sizeof(mcu_regs));
+	memset(isr_stats, 0, sizeof(isr_stats));
+	flash_reads = 0;
+	mcu_regs.pinb = 0xFF;
+	mcu_regs.pinc = 0xFF;
+	mcu_regs.pind = 0xFF;
+	mcu_regs.tcnt0 = MCU_REG_UNTOUCHED;
+	mcu_regs.udr = MCU_REG_UNTOUCHED;
+	mcu_regs.ucsra = (1<<UDRE);
+
+	next_timer2 = NEVER;
+	next_timer0 = NEVER;
+	next_uart = NEVER;
+	next_adc = NEVER;
+	next_ac = MCU_AC_HALF_PERIOD;
+	next_step = cfg.step_period;
+	adc_pending = 0;
+	eeprom_ready = 0;
+	wdt_enabled = 0;
+	memset(&wdt_stats, 0, sizeof(wdt_stats));
+}
+
+//-------------------------------------------------------//
+// Runs firmware entry point until end time, watchdog timeout
+// or return from entry
+// Returns MCU_STOP_xxx
+//-------------------------------------------------------//
+int mcu_run(int (*entry)(void))
+{
+	int reason = setjmp(stop_point);
+	if (reason)
+		return reason - 1;
+	entry();
+	flushUart();
+	return MCU_STOP_MAIN_EXIT;
+}
+
+uint64_t mcu_get_time(void)
+{
+	return now;
+}
+
+const mcu_isr_stats_t *mcu_get_isr_stats(void)
+{
+	return isr_stats;
+}
+
+uint64_t mcu_get_flash_reads(void)
+{
+	return flash_reads;
+}
+
+const mcu_wdt_stats_t *mcu_get_wdt_stats(void)
+{
+	return &wdt_stats;
+}
+
+
+//-------------------------------------------------------//
+// Main loop idle hook - waits for the next event
+//-------------------------------------------------------//
+void mcu_idle(void)
+{
+	if (in_isr)
+		return;
+	updateTimers();
+	if (!processNextEvent(cfg.end_time))
+		stop(MCU_STOP_TIME);
+}
+
+//-------------------------------------------------------//
+// Busy wait, events are served meanwhile
+// Delays inside ISRs take no time, they are counted in ISR statistics
+//-------------------------------------------------------//
+void mcu_delay(uint32_t cycles)
+{
+	uint64_t target = now + cycles;
+	if (in_isr)
+	{
+		isr_wait += cycles;
+		return;
+	}
+	updateTimers();
+	if (target > cfg.end_time)
+	{
+		while (processNextEvent(cfg.end_time));
+		stop(MCU_STOP_TIME);
+	}
+	while (processNextEvent(target));
+	now = target;
+}
+
+
+//-------------------------------------------------------//
+// EEPROM. Write of one byte is started after the previous one
+// is finished. Waits inside ISRs take no time, like other delays.
+//-------------------------------------------------------//
+uint8_t mcu_eeprom_ready(void)
+{
+	return now >= eeprom_ready;
+}
+
+void mcu_eeprom_wait(void)
+{
+	if (now < eeprom_ready)
+		mcu_delay((uint32_t)(eeprom_ready - now));
+}
+
+void mcu_eeprom_write(void)
+{
+	mcu_eeprom_wait();
+	eeprom_ready = now + MCU_EEPROM_WRITE;
+}
+
+void mcu_eeprom_complete(void)
+{
+	eeprom_ready = now;
+}
+
+
+//-------------------------------------------------------//
+// Watchdog
+//-------------------------------------------------------//
+void mcu_wdt_enable(uint8_t timeout)
+{
+	wdt_enabled = 1;
+	wdt_timeout = (16384ULL << timeout) * MCU_CYCLES_PER_US;
+	wdt_last_reset = now;
+}
+
+void mcu_wdt_reset(void)
+{
+	uint32_t interval = (uint32_t)(now - wdt_last_reset);
+	if (wdt_stats.resets)
+	{
+		wdt_stats.total_interval += interval;
+		if ((wdt_stats.resets == 1) || (interval < wdt_stats.min_interval))
+			wdt_stats.min_interval = interval;
+		if (interval > wdt_stats.max_interval)
+			wdt_stats.max_interval = interval;
+	}
+	wdt_stats.resets++;
+	wdt_last_reset = now;
+}
+
+//-------------------------------------------------------//
+// UCSRA access. Firmware polls UDRE in a busy loop, so
+// a read with UDR full waits for the shift register (events are served meanwhile).
+// Inside ISRs the byte is passed at once. No wait while UDRE interrupt
+// sends the transmit queue - UCSRA is read for other bits then.
+//-------------------------------------------------------//
+uint8_t *mcu_ucsra(void)
+{
+	updateUart();
+	if (in_isr)
+		flushUart();
+	if ((mcu_regs.ucsrb & (1<<UDRIE)) && interruptsEnabled())
+		return &mcu_regs.ucsra;
+	while (mcu_regs.udr != MCU_REG_UNTOUCHED)
+	{
+		updateTimers();
+		if (!processNextEvent(cfg.end_time))
+			stop(MCU_STOP_TIME);
+		updateUart();
+	}
+	mcu_regs.ucsra |= (1<<UDRE);
+	return &mcu_regs.ucsra;
+}
+
+//-------------------------------------------------------//
+// TCNT2 read. Timer 2 runs in CTC mode, the counter is
+// calculated from the time left to the next compare match.
+//-------------------------------------------------------//
+uint8_t *mcu_tcnt2(void)
+{
+	uint16_t prescaler = timer2_prescalers[mcu_regs.tccr2 & 0x07];
+	uint64_t left;
+	if (prescaler && (next_timer2 != NEVER))
+	{
+		left = (next_timer2 - now + prescaler - 1) / prescaler;
+		mcu_regs.tcnt2 = (uint8_t)(mcu_regs.ocr2 + 1 - left);
+	}
+	return &mcu_regs.tcnt2;
+}
+
+//-------------------------------------------------------//
+// Program memory read of pgm_read_xx() and xxx_P() functions,
+// returns the address
+//-------------------------------------------------------//
+const void *mcu_flash_read(const void *address, uint32_t bytes)
+{
+	flash_reads += bytes;
+	return address;
+}
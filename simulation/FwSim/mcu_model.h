@@ -0,0 +1,125 @@
+
+#ifndef MCU_MODEL_H_
+#define MCU_MODEL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// ATmega8 model for the host build of the firmware.
+// Firmware code runs in zero time. Virtual time (CPU cycles) advances only while
+// the firmware waits - in _delay_xx() and in the main loop idle hook (__idle()).
+// Peripherals are event driven: timer 2 compare, timer 0 overflow, UART frame end,
+// ADC conversion end, AC line zero crossing (analog comparator) and the board step callback.
+// ADC conversion starts at the first event after ADSC is set, in free-running mode (ADFR)
+// the next one starts at conversion end.
+// UART transmitter sends a byte in 10 bit times of UBRR / U2X baud rate, UDR is
+// a one byte buffer in front of the shift register. EEPROM byte write runs
+// MCU_EEPROM_WRITE cycles after it is started, EEPROM access waits for its end.
+// Events with the same time are served in ATmega8 interrupt vector order.
+
+#define MCU_F_CPU				16000000UL	// Must be the same as F_CPU of compilers.h
+#define MCU_CYCLES_PER_US		(MCU_F_CPU / 1000000UL)
+#define MCU_ADC_CONVERSION		(13 * 128)	// 13 ADC clocks, ADC prescaler 128
+#define MCU_AC_HALF_PERIOD		(MCU_F_CPU / 100)	// 50Hz AC line, zero crossing every 10ms
+#define MCU_EEPROM_WRITE		(8448ULL * MCU_CYCLES_PER_US)	// EEPROM byte write, 8448 cycles of 1MHz oscillator
+
+#define MCU_REG_UNTOUCHED		0xFFFF		// TCNT0 / UDR value when not written by firmware
+
+// mcu_run() results
+#define MCU_STOP_TIME			0			// End time reached
+#define MCU_STOP_WATCHDOG		1			// Watchdog was not reset in time
+#define MCU_STOP_MAIN_EXIT		2			// Firmware main() returned
+
+
+// Register file. Names are mapped to fields by mock avr/io.h
+typedef struct {
+	uint8_t portb, ddrb, pinb;
+	uint8_t portc, ddrc, pinc;
+	uint8_t portd, ddrd, pind;
+	uint8_t sreg;
+	uint8_t tccr0;
+	uint16_t tcnt0;						// MCU_REG_UNTOUCHED when not written since last timer update
+	uint8_t tccr2, ocr2, tcnt2;
+	uint8_t timsk, tifr;
+	uint8_t tccr1a, tccr1b;
+	uint16_t ocr1a, tcnt1;
+	uint8_t acsr;
+	uint8_t admux, adcsra;
+	uint16_t adc;
+	uint8_t ucsra, ucsrb, ucsrc, ubrrh, ubrrl;
+	uint16_t udr;						// MCU_REG_UNTOUCHED when UDR is empty
+	uint8_t twbr, twar;					// Used by firmware as global variables
+} mcu_regs_t;
+
+
+// ISRs, index of mcu_get_isr_stats() results
+#define MCU_ISR_TIMER2_COMP		0
+#define MCU_ISR_TIMER0_OVF		1
+#define MCU_ISR_USART_UDRE		2
+#define MCU_ISR_ADC				3
+#define MCU_ISR_ANA_COMP		4
+#define MCU_ISR_COUNT			5
+
+// Busy waits (_delay_xx) inside an ISR. They take no virtual time, but they are
+// the part of ISR duration that grows with delays, not with code.
+typedef struct {
+	uint64_t calls;
+	uint64_t wait_cycles;				// Total of all calls
+	uint32_t max_wait_cycles;			// Longest single call
+} mcu_isr_stats_t;
+
+// Watchdog resets. Firmware resets the watchdog at the start of every main loop run,
+// so intervals between resets are main loop periods.
+typedef struct {
+	uint64_t resets;
+	uint64_t total_interval;			// CPU cycles, from the first reset to the last one
+	uint32_t min_interval;
+	uint32_t max_interval;
+} mcu_wdt_stats_t;
+
+
+// Board connections
+typedef struct {
+	uint64_t end_time;					// CPU cycles
+	uint32_t step_period;				// CPU cycles, period of step() calls
+	void (*step)(void *ctx);			// Board step, e.g. plant model update
+	uint16_t (*adc_read)(void *ctx);	// Returns raw ADC value at conversion end
+	void (*ac_zero)(void *ctx);			// Called after analog comparator ISR at AC line zero crossing
+	void (*uart_tx)(uint8_t data, void *ctx);	// Byte moved to UART shift register
+	void *ctx;
+} mcu_config_t;
+
+
+extern mcu_regs_t mcu_regs;
+
+
+void mcu_init(const mcu_config_t *config);
+int mcu_run(int (*entry)(void));
+uint64_t mcu_get_time(void);
+const mcu_isr_stats_t *mcu_get_isr_stats(void);		// MCU_ISR_COUNT items
+uint64_t mcu_get_flash_reads(void);					// Program memory bytes read by avr/pgmspace.h functions
+const mcu_wdt_stats_t *mcu_get_wdt_stats(void);
+void mcu_eeprom_complete(void);						// Ends EEPROM write at once, for checks that call the firmware outside mcu_run()
+
+// Used by mock AVR headers
+void mcu_idle(void);
+void mcu_delay(uint32_t cycles);
+void mcu_wdt_enable(uint8_t timeout);
+void mcu_wdt_reset(void);
+uint8_t *mcu_ucsra(void);
+uint8_t *mcu_tcnt2(void);
+const void *mcu_flash_read(const void *address, uint32_t bytes);
+uint8_t mcu_eeprom_ready(void);
+void mcu_eeprom_wait(void);
+void mcu_eeprom_write(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MCU_MODEL_H_ */
@@ -0,0 +1,58 @@
+
+#ifndef FWSIM_AVR_EEPROM_H_
+#define FWSIM_AVR_EEPROM_H_
+
+// Host build (FwSim) replacement of avr-libc <avr/eeprom.h>
+// EEPROM variables are ordinary variables, initializers are the programmed EEPROM image.
+// Data is written at once, byte write time is kept by the MCU model:
+// every access waits for the end of the previous write, as avr-libc functions do.
+
+#include <stdint.h>
+#include <string.h>
+#include "mcu_model.h"
+
+#define EEMEM
+
+#define eeprom_is_ready()						mcu_eeprom_ready()
+#define eeprom_busy_wait()						mcu_eeprom_wait()
+
+static inline uint8_t eeprom_read_byte(const uint8_t *address)
+{
+	mcu_eeprom_wait();
+	return *address;
+}
+
+static inline void eeprom_write_byte(uint8_t *address, uint8_t value)
+{
+	mcu_eeprom_write();
+	*address = value;
+}
+
+static inline void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+	if (eeprom_read_byte(address) != value)
+		eeprom_write_byte(address, value);
+}
+
+static inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	mcu_eeprom_wait();
+	memcpy(dst, src, n);
+}
+
+static inline void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; i++)
+		eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+}
+
+static inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	size_t i;
+	for (i = 0; i < n; i++)
+		eeprom_update_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+}
+
+
+#endif /* FWSIM_AVR_EEPROM_H_ */
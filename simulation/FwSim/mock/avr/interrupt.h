@@ -0,0 +1,23 @@
+
+#ifndef FWSIM_AVR_INTERRUPT_H_
+#define FWSIM_AVR_INTERRUPT_H_
+
+// Host build (FwSim) replacement of avr-libc <avr/interrupt.h>
+// ISRs are plain functions named after the vector, called by mcu_model.c
+
+#include "avr/io.h"
+
+#define ISR(vector)		void vector(void); void vector(void)
+
+#define sei()			(SREG |= (1<<SREG_I))
+#define cli()			(SREG &= ~(1<<SREG_I))
+
+// Vectors used by the firmware
+void TIMER2_COMP_vect(void);
+void TIMER0_OVF_vect(void);
+void USART_UDRE_vect(void);
+void ADC_vect(void);
+void ANA_COMP_vect(void);
+
+
+#endif /* FWSIM_AVR_INTERRUPT_H_ */
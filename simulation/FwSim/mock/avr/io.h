@@ -0,0 +1,199 @@
+
+#ifndef FWSIM_AVR_IO_H_
+#define FWSIM_AVR_IO_H_
+
+// Host build (FwSim) replacement of avr-libc <avr/io.h> for ATmega8.
+// Registers are fields of mcu_regs, see mcu_model.h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "mcu_model.h"
+
+
+//--------------------------------------------//
+// Ports
+
+#define PORTB		mcu_regs.portb
+#define DDRB		mcu_regs.ddrb
+#define PINB		mcu_regs.pinb
+#define PORTC		mcu_regs.portc
+#define DDRC		mcu_regs.ddrc
+#define PINC		mcu_regs.pinc
+#define PORTD		mcu_regs.portd
+#define DDRD		mcu_regs.ddrd
+#define PIND		mcu_regs.pind
+
+#define PB0	0
+#define PB1	1
+#define PB2	2
+#define PB3	3
+#define PB4	4
+#define PB5	5
+#define PB6	6
+#define PB7	7
+#define PC0	0
+#define PC1	1
+#define PC2	2
+#define PC3	3
+#define PC4	4
+#define PC5	5
+#define PC6	6
+#define PD0	0
+#define PD1	1
+#define PD2	2
+#define PD3	3
+#define PD4	4
+#define PD5	5
+#define PD6	6
+#define PD7	7
+
+#define SREG		mcu_regs.sreg
+#define SREG_I		7
+
+
+//--------------------------------------------//
+// Timers
+
+#define TCCR0		mcu_regs.tccr0
+#define TCNT0		mcu_regs.tcnt0
+#define TCCR2		mcu_regs.tccr2
+#define OCR2		mcu_regs.ocr2
+#define TCNT2		(*mcu_tcnt2())		// Counted from virtual time, read only
+#define TIMSK		mcu_regs.timsk
+#define TIFR		mcu_regs.tifr
+#define TCCR1A		mcu_regs.tccr1a
+#define TCCR1B		mcu_regs.tccr1b
+#define OCR1A		mcu_regs.ocr1a
+#define TCNT1		mcu_regs.tcnt1
+
+// TCCR0
+#define CS02	2
+#define CS01	1
+#define CS00	0
+// TCCR2
+#define FOC2	7
+#define WGM20	6
+#define COM21	5
+#define COM20	4
+#define WGM21	3
+#define CS22	2
+#define CS21	1
+#define CS20	0
+// TCCR1A
+#define COM1A1	7
+#define COM1A0	6
+#define COM1B1	5
+#define COM1B0	4
+#define WGM11	1
+#define WGM10	0
+// TCCR1B
+#define WGM13	4
+#define WGM12	3
+#define CS12	2
+#define CS11	1
+#define CS10	0
+// TIMSK
+#define OCIE2	7
+#define TOIE2	6
+#define TICIE1	5
+#define OCIE1A	4
+#define OCIE1B	3
+#define TOIE1	2
+#define TOIE0	0
+// TIFR
+#define OCF2	7
+#define TOV2	6
+#define ICF1	5
+#define OCF1A	4
+#define OCF1B	3
+#define TOV1	2
+#define TOV0	0
+
+
+//--------------------------------------------//
+// Analog comparator and ADC
+
+#define ACSR		mcu_regs.acsr
+#define ADMUX		mcu_regs.admux
+#define ADCSRA		mcu_regs.adcsra
+#define ADC			mcu_regs.adc
+#define ADCW		mcu_regs.adc
+
+// ACSR
+#define ACD		7
+#define ACBG	6
+#define ACO		5
+#define ACI		4
+#define ACIE	3
+#define ACIC	2
+#define ACIS1	1
+#define ACIS0	0
+// ADMUX
+#define REFS1	7
+#define REFS0	6
+#define ADLAR	5
+#define MUX3	3
+#define MUX2	2
+#define MUX1	1
+#define MUX0	0
+// ADCSRA
+#define ADEN	7
+#define ADSC	6
+#define ADFR	5
+#define ADIF	4
+#define ADIE	3
+#define ADPS2	2
+#define ADPS1	1
+#define ADPS0	0
+
+
+//--------------------------------------------//
+// USART
+// UCSRA is read through a function - polling UDRE while the transmitter
+// is busy waits until the byte in UDR goes to the shift register
+
+#define UCSRA		(*mcu_ucsra())
+#define UCSRB		mcu_regs.ucsrb
+#define UCSRC		mcu_regs.ucsrc
+#define UBRRH		mcu_regs.ubrrh
+#define UBRRL		mcu_regs.ubrrl
+#define UDR			mcu_regs.udr
+
+// UCSRA
+#define RXC		7
+#define TXC		6
+#define UDRE	5
+#define FE		4
+#define DOR		3
+#define PE		2
+#define U2X		1
+#define MPCM	0
+// UCSRB
+#define RXCIE	7
+#define TXCIE	6
+#define UDRIE	5
+#define RXEN	4
+#define TXEN	3
+#define UCSZ2	2
+#define RXB8	1
+#define TXB8	0
+// UCSRC
+#define URSEL	7
+#define UMSEL	6
+#define UPM1	5
+#define UPM0	4
+#define USBS	3
+#define UCSZ1	2
+#define UCSZ0	1
+#define UCPOL	0
+
+
+//--------------------------------------------//
+// TWI registers, used by firmware as fast globals
+
+#define TWBR		mcu_regs.twbr
+#define TWAR		mcu_regs.twar
+
+
+#endif /* FWSIM_AVR_IO_H_ */
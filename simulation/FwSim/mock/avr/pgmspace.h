@@ -0,0 +1,20 @@
+
+#ifndef FWSIM_AVR_PGMSPACE_H_
+#define FWSIM_AVR_PGMSPACE_H_
+
+// Host build (FwSim) replacement of avr-libc <avr/pgmspace.h>
+// Flash data is ordinary const data, bytes read are counted by the MCU model
+
+#include <stdint.h>
+#include <string.h>
+#include "mcu_model.h"
+
+#define PROGMEM
+
+#define pgm_read_byte(address)		(*(const uint8_t *)mcu_flash_read((address), 1))
+#define pgm_read_word(address)		(*(const uint16_t *)mcu_flash_read((address), 2))
+#define memcpy_P(dst, src, n)		memcpy((dst), mcu_flash_read((src), (n)), (n))
+#define strcpy_P(dst, src)			strcpy((dst), (const char *)mcu_flash_read((src), strlen(src) + 1))
+
+
+#endif /* FWSIM_AVR_PGMSPACE_H_ */
@@ -0,0 +1,23 @@
+
+#ifndef FWSIM_AVR_WDT_H_
+#define FWSIM_AVR_WDT_H_
+
+// Host build (FwSim) replacement of avr-libc <avr/wdt.h>
+// Timeout is (16K << value) cycles of the 1MHz watchdog oscillator
+
+#include "mcu_model.h"
+
+#define WDTO_15MS	0
+#define WDTO_30MS	1
+#define WDTO_60MS	2
+#define WDTO_120MS	3
+#define WDTO_250MS	4
+#define WDTO_500MS	5
+#define WDTO_1S		6
+#define WDTO_2S		7
+
+#define wdt_enable(value)	mcu_wdt_enable(value)
+#define wdt_reset()			mcu_wdt_reset()
+
+
+#endif /* FWSIM_AVR_WDT_H_ */
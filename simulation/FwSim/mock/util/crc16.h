@@ -0,0 +1,26 @@
+
+#ifndef FWSIM_UTIL_CRC16_H_
+#define FWSIM_UTIL_CRC16_H_
+
+// Host build (FwSim) replacement of avr-libc <util/crc16.h>
+// Same results as the avr-libc versions
+
+#include <stdint.h>
+
+// Dallas (Maxim) iButton 8-bit CRC, polynomial x^8 + x^5 + x^4 + 1
+static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
+{
+	uint8_t i;
+	crc = crc ^ data;
+	for (i = 0; i < 8; i++)
+	{
+		if (crc & 0x01)
+			crc = (crc >> 1) ^ 0x8C;
+		else
+			crc >>= 1;
+	}
+	return crc;
+}
+
+
+#endif /* FWSIM_UTIL_CRC16_H_ */
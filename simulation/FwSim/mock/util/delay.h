@@ -0,0 +1,14 @@
+
+#ifndef FWSIM_UTIL_DELAY_H_
+#define FWSIM_UTIL_DELAY_H_
+
+// Host build (FwSim) replacement of avr-libc <util/delay.h>
+// Delays advance virtual time, interrupts are served meanwhile
+
+#include "mcu_model.h"
+
+#define _delay_us(us)		mcu_delay((uint32_t)((us) * MCU_CYCLES_PER_US))
+#define _delay_ms(ms)		mcu_delay((uint32_t)((ms) * 1000UL * MCU_CYCLES_PER_US))
+
+
+#endif /* FWSIM_UTIL_DELAY_H_ */
@@ -0,0 +1,295 @@
+// LogSplit.cpp : Splits firmware UART logs into columns. Replaces TextColumnSplitter.exe.
+//
+//		LogSplit -file <log> [-outdir <directory>] [-pref <prefix>] [-ext <extension>]
+//			[-bin <trace file>] [-raw] [-text] [-timestep <S>] [-scalar] [-telemetry [-ticks]]
+//
+//		-file <log>				firmware log, see log_parser.h
+//		-outdir <directory>		directory of column files (default current)
+//		-pref <prefix>			column file name prefix (default col_)
+//		-ext <extension>		column file name extension (default .txt)
+//		-bin <trace file>		write RSim binary trace instead of column files
+//		-raw					do not compress binary trace
+//		-text					write column files together with -bin
+//		-timestep <S>			binary trace timestep, seconds (default 0.1, firmware log interval;
+//								0.05 with -telemetry)
+//		-scalar					do not use SIMD parser
+//		-telemetry				log is binary telemetry of LOG_BINARY_TELEMETRY firmware, see log_telemetry.h
+//		-ticks					add main loop tick column to telemetry columns
+//		-split <separator>		ignored, columns are separated by any whitespace
+//
+// Parser throughput over all logs of a directory and its subdirectories, nothing is written:
+//		LogSplit -scan <directory> [-scalar]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "ArgParser.h"
+#include "log_parser.h"
+#include "log_output.h"
+#include "log_telemetry.h"
+
+
+#define LOG_FILE_EXTENSION		".log"
+#define DEFAULT_TIMESTEP		0.1			// LOG_INTERVAL of pid1.c
+#define TELEMETRY_TIMESTEP		0.05		// Telemetry is sent every main loop run
+
+
+static bool makeDirectory(const std::string &path)
+{
+	int result;
+#ifdef _WIN32
+	result = _mkdir(path.c_str());
+#else
+	result = mkdir(path.c_str(), 0777);
+#endif
+	return (result == 0) || (errno == EEXIST);
+}
+
+static bool hasLogExtension(const std::string &name)
+{
+	size_t n = strlen(LOG_FILE_EXTENSION);
+	return (name.size() > n) && (name.compare(name.size() - n, n, LOG_FILE_EXTENSION) == 0);
+}
+
+
+//-------------------------------------------------------//
+// Adds all logs of a directory and its subdirectories to the list
+//-------------------------------------------------------//
+static void findLogs(const std::string &dir, std::vector<std::string> &files)
+{
+#ifdef _WIN32
+	struct _finddata_t entry;
+	intptr_t handle = _findfirst((dir + "\\*").c_str(), &entry);
+	if (handle == -1)
+		return;
+	do
+	{
+		std::string name = entry.name;
+		if ((name == ".") || (name == ".."))
+			continue;
+		if (entry.attrib & _A_SUBDIR)
+			findLogs(dir + "\\" + name, files);
+		else if (hasLogExtension(name))
+			files.push_back(dir + "\\" + name);
+	} while (_findnext(handle, &entry) == 0);
+	_findclose(handle);
+#else
+	DIR *d = opendir(dir.c_str());
+	struct dirent *entry;
+	struct stat st;
+	if (!d)
+		return;
+	while ((entry = readdir(d)))
+	{
+		std::string name = entry->d_name;
+		std::string path = dir + "/" + name;
+		if ((name == ".") || (name == "..") || (stat(path.c_str(), &st) != 0))
+			continue;
+		if (S_ISDIR(st.st_mode))
+			findLogs(path, files);
+		else if (hasLogExtension(name))
+			files.push_back(path);
+	}
+	closedir(d);
+#endif
+}
+
+
+//-------------------------------------------------------//
+// Parses logs without output, prints statistics and throughput
+//-------------------------------------------------------//
+static int scanLogs(const char *dir, bool scalar)
+{
+	std::vector<std::string> files;
+	LogStats_t stats;
+	LogTable table;
+	uint64_t total_bytes = 0;
+	uint64_t total_rows = 0;
+	double seconds = 0;
+	size_t i;
+
+	findLogs(dir, files);
+	std::sort(files.begin(), files.end());
+	if (files.empty())
+	{
+		printf("No %s files found in %s\n", LOG_FILE_EXTENSION, dir);
+		return -1;
+	}
+
+	printf("  columns        rows   skipped  bad rows     bytes  log\n");
+	for (i = 0; i < files.size(); i++)
+	{
+		table.Columns.clear();
+		auto start = std::chrono::steady_clock::now();
+		if (!parseLogFile(files[i].c_str(), &table, &stats, scalar))
+		{
+			printf("Cannot read %s\n", files[i].c_str());
+			continue;
+		}
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%9u %11llu %9llu %9llu %9llu  %s\n", stats.Columns, (unsigned long long)stats.Rows,
+			(unsigned long long)stats.SkippedLines, (unsigned long long)stats.BadRows,
+			(unsigned long long)stats.Bytes, files[i].c_str());
+		total_bytes += stats.Bytes;
+		total_rows += stats.Rows;
+	}
+	printf("%u logs, %llu rows, %.1f MB in %.3f s, %.0f MB/s (%s parser)\n", (unsigned)files.size(),
+		(unsigned long long)total_rows, total_bytes / 1e6, seconds,
+		(seconds > 0) ? total_bytes / 1e6 / seconds : 0.0, scalar ? "scalar" : "SIMD");
+	return 0;
+}
+
+
+//-------------------------------------------------------//
+// Splits a log into column files and / or binary trace
+//-------------------------------------------------------//
+static int splitLog(ArgParser *parser, bool scalar)
+{
+	const char *file_name = parser->GetOptionValue("-file");
+	const char *arg_str;
+	std::string prefix = "col_";
+	std::string ext = ".txt";
+	std::string outdir;
+	bool telemetry = (parser->GetOption("-telemetry") != NULL);
+	double timestep = telemetry ? TELEMETRY_TIMESTEP : DEFAULT_TIMESTEP;
+	bool text = true;
+	bool compressed = true;
+	LogStats_t stats;
+	TelemetryStats_t telemetry_stats;
+	LogSink *sink;
+	LogTextWriter *text_writer = NULL;
+	LogTraceWriter *trace_writer = NULL;
+
+	if ((arg_str = parser->GetOptionValue("-pref")))
+		prefix = arg_str;
+	if ((arg_str = parser->GetOptionValue("-ext")))
+		ext = arg_str;
+	if ((arg_str = parser->GetOptionValue("-outdir")))
+	{
+		outdir = arg_str;
+		if (!makeDirectory(outdir))
+		{
+			printf("Cannot create output directory %s\n", arg_str);
+			return -1;
+		}
+		if ((outdir.back() != '/') && (outdir.back() != '\\'))
+			outdir += "/";
+	}
+	if ((arg_str = parser->GetOptionValue("-timestep")))
+	{
+		timestep = atof(arg_str);
+		if (timestep <= 0)
+		{
+			printf("Wrong timestep %s\n", arg_str);
+			return -1;
+		}
+	}
+	if (parser->GetOption("-raw"))
+		compressed = false;
+	if ((arg_str = parser->GetOptionValue("-bin")))
+	{
+		trace_writer = new LogTraceWriter(arg_str, timestep, compressed);
+		text = (parser->GetOption("-text") != NULL);
+	}
+	if (text)
+		text_writer = new LogTextWriter(outdir + prefix, ext);
+
+	// Both outputs get the same blocks
+	class TeeSink : public LogSink
+	{
+	public:
+		LogSink *First;
+		LogSink *Second;
+		bool Write(const int32_t *const *columns, unsigned column_count, unsigned rows)
+		{
+			return First->Write(columns, column_count, rows) && Second->Write(columns, column_count, rows);
+		}
+	} tee;
+	if (text_writer && trace_writer)
+	{
+		tee.First = text_writer;
+		tee.Second = trace_writer;
+		sink = &tee;
+	}
+	else
+	{
+		sink = text_writer ? (LogSink *)text_writer : (LogSink *)trace_writer;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	bool ok;
+	if (telemetry)
+		ok = parseTelemetryFile(file_name, sink, &telemetry_stats, parser->GetOption("-ticks") != NULL);
+	else
+		ok = parseLogFile(file_name, sink, &stats, scalar);
+	if (text_writer && !text_writer->Close())
+		ok = false;
+	if (trace_writer && !trace_writer->Close())
+		ok = false;
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	delete text_writer;
+	delete trace_writer;
+
+	if (!ok)
+	{
+		printf("Cannot split %s\n", file_name);
+		return -1;
+	}
+	if (telemetry)
+	{
+		printf("%s: %llu frames, %llu bad frames, %llu lost frames, %.3f s\n",
+			file_name, (unsigned long long)telemetry_stats.Frames, (unsigned long long)telemetry_stats.BadFrames,
+			(unsigned long long)telemetry_stats.LostFrames, seconds);
+		return 0;
+	}
+	printf("%s: %u columns, %llu rows, %llu lines skipped, %llu rows with wrong number of columns, %.3f s\n",
+		file_name, stats.Columns, (unsigned long long)stats.Rows, (unsigned long long)stats.SkippedLines,
+		(unsigned long long)stats.BadRows, seconds);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	ArgParser *parser = new ArgParser();
+	const char *arg_str;
+	bool scalar;
+	int result;
+
+	parser->Parse(argc, argv);
+	scalar = (parser->GetOption("-scalar") != NULL);
+
+	if ((arg_str = parser->GetOptionValue("-scan")))
+	{
+		result = scanLogs(arg_str, scalar);
+	}
+	else if (parser->GetOptionValue("-file"))
+	{
+		result = splitLog(parser, scalar);
+	}
+	else
+	{
+		printf("Usage: LogSplit -file <log> [-outdir <directory>] [-pref <prefix>] [-ext <extension>]\n");
+		printf("                [-bin <trace file>] [-raw] [-text] [-timestep <S>] [-scalar]\n");
+		printf("                [-telemetry [-ticks]]\n");
+		printf("       LogSplit -scan <directory> [-scalar]\n");
+		result = -1;
+	}
+	delete parser;
+	return result;
+}
@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "log_output.h"
+#include "trace_file.h"
+
+
+#define TEXT_BUFFER_SIZE		(1 << 16)		// Per column file
+
+static_assert(LOG_BLOCK_ROWS <= TRACE_CHUNK_SAMPLES, "Parser block must fit into a trace chunk");
+
+
+static const char traceMagic[8] = {'R','S','I','M','T','R','C','\0'};
+
+
+static void putLE(std::vector<uint8_t> &dst, uint64_t value, unsigned size)
+{
+	while (size--)
+	{
+		dst.push_back((uint8_t)value);
+		value >>= 8;
+	}
+}
+
+static void putVarint(std::vector<uint8_t> &dst, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		dst.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	dst.push_back((uint8_t)value);
+}
+
+static uint64_t zigzagEncode(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+
+//-------------------------------------------------------//
+// Writes value and CR LF to dst, returns end of the text
+//-------------------------------------------------------//
+static char *formatValue(char *dst, int32_t value)
+{
+	char digits[10];
+	unsigned n = 0;
+	uint32_t u = (uint32_t)value;
+
+	if (value < 0)
+	{
+		*dst++ = '-';
+		u = 0U - u;
+	}
+	do
+	{
+		digits[n++] = (char)('0' + u % 10);
+		u /= 10;
+	} while (u);
+	while (n)
+		*dst++ = digits[--n];
+	*dst++ = '\r';
+	*dst++ = '\n';
+	return dst;
+}
+
+
+//-------------------------------------------------------//
+// LogTextWriter
+//-------------------------------------------------------//
+LogTextWriter::LogTextWriter(const std::string &prefix, const std::string &ext)
+{
+	Prefix = prefix;
+	Ext = ext;
+}
+
+LogTextWriter::~LogTextWriter()
+{
+	Close();
+}
+
+bool LogTextWriter::Write(const int32_t *const *columns, unsigned column_count, unsigned rows)
+{
+	unsigned c, r;
+	char *p;
+
+	if (Files.empty())
+	{
+		for (c = 0; c < column_count; c++)
+		{
+			std::string path = Prefix + std::to_string(c) + Ext;
+			FILE *f = fopen(path.c_str(), "wb");
+			if (!f)
+			{
+				printf("Cannot create file %s\n", path.c_str());
+				return false;
+			}
+			setvbuf(f, NULL, _IOFBF, TEXT_BUFFER_SIZE);
+			Files.push_back(f);
+		}
+	}
+	// Max 11 characters and CR LF per value
+	Text.resize((size_t)rows * 13);
+	for (c = 0; c < column_count; c++)
+	{
+		p = &Text[0];
+		for (r = 0; r < rows; r++)
+			p = formatValue(p, columns[c][r]);
+		if (fwrite(&Text[0], 1, p - &Text[0], Files[c]) != (size_t)(p - &Text[0]))
+			return false;
+	}
+	return true;
+}
+
+bool LogTextWriter::Close(void)
+{
+	bool result = true;
+	size_t i;
+	for (i = 0; i < Files.size(); i++)
+	{
+		if (fclose(Files[i]) != 0)
+			result = false;
+	}
+	Files.clear();
+	return result;
+}
+
+
+//-------------------------------------------------------//
+// LogTraceWriter
+//-------------------------------------------------------//
+LogTraceWriter::LogTraceWriter(const std::string &fileName, double timestep, bool compressed)
+{
+	FileName = fileName;
+	Timestep = timestep;
+	Compressed = compressed;
+	ColumnCount = 0;
+	File = NULL;
+}
+
+LogTraceWriter::~LogTraceWriter()
+{
+	Close();
+}
+
+bool LogTraceWriter::Write(const int32_t *const *columns, unsigned column_count, unsigned rows)
+{
+	unsigned c, r;
+	unsigned size_pos;
+	int32_t prev;
+
+	if (!File)
+	{
+		std::vector<uint8_t> header;
+		uint64_t timestep_bits;
+
+		if (!(File = fopen(FileName.c_str(), "wb")))
+		{
+			printf("Cannot create file %s\n", FileName.c_str());
+			return false;
+		}
+		ColumnCount = column_count;
+		memcpy(&timestep_bits, &Timestep, sizeof(timestep_bits));
+		header.insert(header.end(), traceMagic, traceMagic + sizeof(traceMagic));
+		putLE(header, TRACE_FILE_VERSION, 2);
+		putLE(header, Compressed ? TRACE_FLAG_COMPRESSED : 0, 2);
+		putLE(header, column_count, 2);
+		putLE(header, 0, 2);
+		putLE(header, timestep_bits, 8);
+		for (c = 0; c < column_count; c++)
+		{
+			char name[TRACE_NAME_LENGTH] = {0};
+			snprintf(name, TRACE_NAME_LENGTH, "col_%u", c);
+			header.insert(header.end(), name, name + TRACE_NAME_LENGTH);
+			putLE(header, TRACE_TYPE_I32, 1);
+			putLE(header, 0, 3);
+		}
+		if (fwrite(&header[0], 1, header.size(), File) != header.size())
+			return false;
+	}
+
+	// Parser blocks are not longer than TRACE_CHUNK_SAMPLES, one chunk per block
+	ChunkData.clear();
+	putLE(ChunkData, rows, 4);
+	for (c = 0; c < column_count; c++)
+	{
+		size_pos = (unsigned)ChunkData.size();
+		putLE(ChunkData, 0, 4);
+		if (Compressed)
+		{
+			prev = 0;
+			for (r = 0; r < rows; r++)
+			{
+				putVarint(ChunkData, zigzagEncode((int64_t)columns[c][r] - prev));
+				prev = columns[c][r];
+			}
+		}
+		else
+		{
+			for (r = 0; r < rows; r++)
+				putLE(ChunkData, (uint32_t)columns[c][r], 4);
+		}
+		r = (unsigned)ChunkData.size() - size_pos - 4;
+		ChunkData[size_pos] = (uint8_t)r;
+		ChunkData[size_pos + 1] = (uint8_t)(r >> 8);
+		ChunkData[size_pos + 2] = (uint8_t)(r >> 16);
+		ChunkData[size_pos + 3] = (uint8_t)(r >> 24);
+	}
+	return fwrite(&ChunkData[0], 1, ChunkData.size(), File) == ChunkData.size();
+}
+
+bool LogTraceWriter::Close(void)
+{
+	bool result = true;
+	if (File)
+		result = (fclose(File) == 0);
+	File = NULL;
+	return result;
+}
@@ -0,0 +1,47 @@
+
+#ifndef LOG_OUTPUT_H_
+#define LOG_OUTPUT_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "log_parser.h"
+
+
+// Legacy output of TextColumnSplitter.exe: one file per column, <prefix><N><ext>,
+// a value and CR LF per row. Values are written as integers without leading zeros.
+class LogTextWriter : public LogSink
+{
+public:
+	LogTextWriter(const std::string &prefix, const std::string &ext);
+	~LogTextWriter();
+	bool Write(const int32_t *const *columns, unsigned column_count, unsigned rows);
+	bool Close(void);
+private:
+	std::string Prefix;
+	std::string Ext;
+	std::vector<FILE *> Files;
+	std::vector<char> Text;
+};
+
+
+// Binary trace of RSim (trace_file.h), channels col_0, col_1 ... of TRACE_TYPE_I32.
+// Readable with RSim -convert. File is created on the first block.
+class LogTraceWriter : public LogSink
+{
+public:
+	LogTraceWriter(const std::string &fileName, double timestep, bool compressed);
+	~LogTraceWriter();
+	bool Write(const int32_t *const *columns, unsigned column_count, unsigned rows);
+	bool Close(void);
+private:
+	std::string FileName;
+	double Timestep;
+	bool Compressed;
+	unsigned ColumnCount;
+	FILE *File;
+	std::vector<uint8_t> ChunkData;
+};
+
+
+#endif /* LOG_OUTPUT_H_ */
@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define LOG_MMAP
+#endif
+
+// SSE2 is a part of every x86-64 CPU
+#if defined(__SSE2__) || defined(_M_X64)
+#define LOG_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "log_parser.h"
+
+
+#if defined(__GNUC__)
+#define ctz(x)		__builtin_ctz(x)
+#else
+#include <intrin.h>
+static inline unsigned ctz(unsigned x)
+{
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return index;
+}
+#endif
+
+
+typedef struct
+{
+	LogSink *Sink;
+	LogStats_t *Stats;
+	std::vector<int32_t> Block;			// Column c of row r is Block[c * LOG_BLOCK_ROWS + r]
+	unsigned BlockRows;
+	bool Scalar;
+	bool ColumnsConfirmed;				// LOG_CONFIRM_ROWS rows with the same number of columns found
+	bool SkipLine;						// Rest of a line longer than LOG_MAP_WINDOW
+	bool SinkError;
+} ParserState_t;
+
+
+//-------------------------------------------------------//
+// Number being parsed, may span several SIMD chunks
+//-------------------------------------------------------//
+typedef struct
+{
+	int64_t Value;
+	bool Negative;
+	bool HasDigits;
+	unsigned Count;						// Values of the line done
+} ParsedNumber_t;
+
+static inline void beginNumber(ParsedNumber_t *n)
+{
+	n->Value = 0;
+	n->Negative = false;
+	n->HasDigits = false;
+}
+
+// Returns false if the number is not valid or there are too many columns
+static inline bool endNumber(ParsedNumber_t *n, int32_t *row, unsigned stride)
+{
+	if (!n->HasDigits || (n->Count == LOG_MAX_COLUMNS) || (!n->Negative && (n->Value > 2147483647LL)))
+		return false;
+	row[n->Count * stride] = (int32_t)(n->Negative ? -n->Value : n->Value);
+	n->Count++;
+	return true;
+}
+
+// Adds a character of a number. Returns false if it cannot be there
+static inline bool addNumberChar(ParsedNumber_t *n, char c)
+{
+	if (c == '-')
+	{
+		if (n->HasDigits || n->Negative)
+			return false;
+		n->Negative = true;
+		return true;
+	}
+	n->Value = n->Value * 10 + (c - '0');
+	n->HasDigits = true;
+	return n->Value <= 2147483648LL;
+}
+
+
+//-------------------------------------------------------//
+// Parses line [p : end) into row[0], row[stride], ...
+// Returns number of values, -1 if the line is not a data line
+//-------------------------------------------------------//
+static int parseLineScalar(const char *p, const char *end, int32_t *row, unsigned stride)
+{
+	ParsedNumber_t n;
+	bool in_number = false;
+	char c;
+
+	beginNumber(&n);
+	n.Count = 0;
+	for (; p < end; p++)
+	{
+		c = *p;
+		if ((c == ' ') || (c == '\r') || (c == '\t'))
+		{
+			if (in_number && !endNumber(&n, row, stride))
+				return -1;
+			in_number = false;
+			continue;
+		}
+		if (((c < '0') || (c > '9')) && (c != '-'))
+			return -1;
+		if (!in_number)
+			beginNumber(&n);
+		in_number = true;
+		if (!addNumberChar(&n, c))
+			return -1;
+	}
+	if (in_number && !endNumber(&n, row, stride))
+		return -1;
+	return (int)n.Count;
+}
+
+
+#ifdef LOG_SSE2
+//-------------------------------------------------------//
+// Same as parseLineScalar(), 16 characters at once:
+// classification of characters and search for numbers are done with SSE2,
+// only characters of numbers are processed one by one.
+//	buf_end - end of readable memory, chunks crossing it are copied
+//-------------------------------------------------------//
+static int parseLineSSE2(const char *p, const char *end, const char *buf_end, int32_t *row, unsigned stride)
+{
+	const __m128i zero_char = _mm_set1_epi8('0');
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i minus = _mm_set1_epi8('-');
+	ParsedNumber_t n;
+	bool in_number = false;
+	char tail[16];
+
+	beginNumber(&n);
+	n.Count = 0;
+	for (; p < end; p += 16)
+	{
+		unsigned length = (end - p < 16) ? (unsigned)(end - p) : 16;
+		unsigned valid = (1U << length) - 1;
+		const char *chunk = p;
+		__m128i v;
+
+		if (p + 16 > buf_end)
+		{
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, p, length);
+			chunk = tail;
+		}
+		v = _mm_loadu_si128((const __m128i *)chunk);
+
+		__m128i d = _mm_sub_epi8(v, zero_char);
+		unsigned digits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d)) & valid;
+		unsigned minuses = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, minus)) & valid;
+		unsigned spaces = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+			_mm_cmpeq_epi8(v, cr)), _mm_cmpeq_epi8(v, tab))) | ~valid;
+		unsigned chars = digits | minuses;
+
+		if ((chars | spaces) != 0xFFFFFFFF)
+			return -1;						// Text line
+
+		// Number continued from the previous chunk ends at its first space
+		if (in_number && (spaces & 1))
+		{
+			if (!endNumber(&n, row, stride))
+				return -1;
+			in_number = false;
+		}
+		while (chars)
+		{
+			unsigned start = ctz(chars);
+			unsigned run = ctz(~(chars >> start));
+			unsigned i;
+			if (!in_number)
+				beginNumber(&n);
+			for (i = start; i < start + run; i++)
+			{
+				if (!addNumberChar(&n, chunk[i]))
+					return -1;
+			}
+			chars &= ~(((1U << run) - 1) << start);
+			in_number = (start + run == 16);
+			if (!in_number && !endNumber(&n, row, stride))
+				return -1;
+		}
+	}
+	if (in_number && !endNumber(&n, row, stride))
+		return -1;
+	return (int)n.Count;
+}
+#endif
+
+
+//-------------------------------------------------------//
+// Passes parsed rows to the sink
+//-------------------------------------------------------//
+static void flushBlock(ParserState_t *state)
+{
+	const int32_t *columns[LOG_MAX_COLUMNS];
+	unsigned c;
+
+	if ((state->BlockRows == 0) || state->SinkError)
+		return;
+	for (c = 0; c < state->Stats->Columns; c++)
+		columns[c] = &state->Block[c * LOG_BLOCK_ROWS];
+	if (!state->Sink->Write(columns, state->Stats->Columns, state->BlockRows))
+		state->SinkError = true;
+	state->BlockRows = 0;
+}
+
+static void processLine(ParserState_t *state, const char *p, const char *end, const char *buf_end)
+{
+	int32_t *row = &state->Block[state->BlockRows];
+	unsigned c;
+	int count;
+
+#ifdef LOG_SSE2
+	if (!state->Scalar)
+		count = parseLineSSE2(p, end, buf_end, row, LOG_BLOCK_ROWS);
+	else
+#endif
+		count = parseLineScalar(p, end, row, LOG_BLOCK_ROWS);
+
+	if (count == 0)
+		return;								// Empty line
+	if (count < 0)
+	{
+		state->Stats->SkippedLines++;
+		return;
+	}
+	if ((unsigned)count != state->Stats->Columns)
+	{
+		if (state->ColumnsConfirmed)
+		{
+			state->Stats->BadRows++;
+			return;
+		}
+		// Rows before are a fragment of a line or of other log format - drop them
+		state->Stats->BadRows += state->BlockRows;
+		state->Stats->Rows -= state->BlockRows;
+		state->Stats->Columns = (unsigned)count;
+		for (c = 0; c < (unsigned)count; c++)
+			state->Block[c * LOG_BLOCK_ROWS] = row[c * LOG_BLOCK_ROWS];
+		state->BlockRows = 0;
+	}
+	state->Stats->Rows++;
+	if (state->BlockRows + 1 == LOG_CONFIRM_ROWS)
+		state->ColumnsConfirmed = true;
+	if (++state->BlockRows == LOG_BLOCK_ROWS)
+		flushBlock(state);
+}
+
+
+//-------------------------------------------------------//
+// Parses all complete lines of buffer [p : end)
+//	last - end of buffer is the end of file
+// Returns end of the last complete line - start of the data to be passed again
+//-------------------------------------------------------//
+static const char *parseBuffer(ParserState_t *state, const char *p, const char *end, bool last)
+{
+	const char *line_end;
+
+	while ((p < end) && !state->SinkError)
+	{
+		line_end = (const char *)memchr(p, '\n', end - p);
+		if (!line_end)
+		{
+			if (!last)
+				break;
+			line_end = end;
+		}
+		if (state->SkipLine)
+			state->SkipLine = false;
+		else
+			processLine(state, p, line_end, end);
+		p = (line_end == end) ? end : line_end + 1;
+	}
+	return p;
+}
+
+// Called when a buffer contains no line end
+static void skipLongLine(ParserState_t *state)
+{
+	if (!state->SkipLine)
+		state->Stats->SkippedLines++;
+	state->SkipLine = true;
+}
+
+
+//-------------------------------------------------------//
+// Reads log with fread() - for systems without mmap() and for files that cannot be mapped
+//-------------------------------------------------------//
+static bool readLogStream(ParserState_t *state, FILE *f)
+{
+	std::vector<char> buffer(LOG_READ_BUFFER);
+	size_t used = 0;
+	size_t n;
+	const char *rest;
+	bool last = false;
+
+	while (!last && !state->SinkError)
+	{
+		n = fread(&buffer[used], 1, buffer.size() - used, f);
+		if (ferror(f))
+			return false;
+		state->Stats->Bytes += n;
+		used += n;
+		last = (n == 0) || feof(f);
+		rest = parseBuffer(state, &buffer[0], &buffer[0] + used, last);
+		if ((rest == &buffer[0]) && (used == buffer.size()))
+		{
+			skipLongLine(state);
+			rest = &buffer[0] + used;
+		}
+		used -= rest - &buffer[0];
+		memmove(&buffer[0], rest, used);
+	}
+	return true;
+}
+
+#ifdef LOG_MMAP
+//-------------------------------------------------------//
+// Maps log window by window, pages done are dropped
+// Returns false if file cannot be mapped
+//-------------------------------------------------------//
+static bool mapLog(ParserState_t *state, int fd, uint64_t size)
+{
+	uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t offset = 0;
+
+	while ((offset < size) && !state->SinkError)
+	{
+		uint64_t map_offset = offset & ~(page - 1);
+		uint64_t window = (offset - map_offset) + LOG_MAP_WINDOW;
+		size_t map_length = (size_t)((size - map_offset < window) ? (size - map_offset) : window);
+		bool last = (map_offset + map_length == size);
+		void *map = mmap(NULL, map_length, PROT_READ, MAP_PRIVATE, fd, (off_t)map_offset);
+		const char *begin;
+		const char *end;
+		const char *rest;
+
+		if (map == MAP_FAILED)
+			return false;
+		madvise(map, map_length, MADV_SEQUENTIAL);
+		begin = (const char *)map + (offset - map_offset);
+		end = (const char *)map + map_length;
+		rest = parseBuffer(state, begin, end, last);
+		if (rest == begin)
+		{
+			skipLongLine(state);
+			rest = end;
+		}
+		offset += rest - begin;
+		munmap(map, map_length);
+	}
+	state->Stats->Bytes = size;
+	return true;
+}
+#endif
+
+
+//-------------------------------------------------------//
+// Parses log file
+//-------------------------------------------------------//
+bool parseLogFile(const char *fileName, LogSink *sink, LogStats_t *stats, bool scalar)
+{
+	ParserState_t state;
+	LogStats_t local_stats;
+	bool result = false;
+	FILE *f;
+
+	state.Sink = sink;
+	state.Stats = stats ? stats : &local_stats;
+	state.Block.resize(LOG_MAX_COLUMNS * LOG_BLOCK_ROWS);
+	state.BlockRows = 0;
+	state.Scalar = scalar;
+	state.ColumnsConfirmed = false;
+	state.SkipLine = false;
+	state.SinkError = false;
+	memset(state.Stats, 0, sizeof(LogStats_t));
+
+#ifdef LOG_MMAP
+	int fd = open(fileName, O_RDONLY);
+	struct stat st;
+	if (fd < 0)
+		return false;
+	if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode))
+	{
+		result = (st.st_size == 0) || mapLog(&state, fd, (uint64_t)st.st_size);
+		if (!result && (state.Stats->Rows == 0) && (state.Stats->SkippedLines == 0))
+		{
+			// Cannot be mapped at all - read it
+			if ((f = fdopen(fd, "rb")))
+			{
+				result = readLogStream(&state, f);
+				fclose(f);
+				fd = -1;
+			}
+		}
+	}
+	else if ((f = fdopen(fd, "rb")))
+	{
+		result = readLogStream(&state, f);
+		fclose(f);
+		fd = -1;
+	}
+	if (fd >= 0)
+		close(fd);
+#else
+	if (!(f = fopen(fileName, "rb")))
+		return false;
+	result = readLogStream(&state, f);
+	fclose(f);
+#endif
+
+	flushBlock(&state);
+	return result && !state.SinkError;
+}
+
+
+//-------------------------------------------------------//
+// LogTable
+//-------------------------------------------------------//
+bool LogTable::Write(const int32_t *const *columns, unsigned column_count, unsigned rows)
+{
+	unsigned c;
+	Columns.resize(column_count);
+	for (c = 0; c < column_count; c++)
+		Columns[c].insert(Columns[c].end(), columns[c], columns[c] + rows);
+	return true;
+}
@@ -0,0 +1,68 @@
+
+#ifndef LOG_PARSER_H_
+#define LOG_PARSER_H_
+
+#include <stdint.h>
+#include <vector>
+
+
+/*
+	Firmware UART log parser.
+
+	Data lines are written by logU16p() / logI32p() in main() of pid1.c: decimal integers,
+	right aligned and separated by spaces. A data line contains only digits, spaces,
+	tabs, CR and '-' in front of a number. Other lines (greeting, "Calibration data:",
+	"AC sync lost", terminal headers) are skipped.
+	All data lines of a log must have the same number of columns. The number is taken from
+	the first LOG_CONFIRM_ROWS data lines in a row with equal number of columns - terminal
+	logs often start with a fragment of a line. Other data lines are counted as bad rows.
+	Line ends may be LF, CR LF or LF CR (terminal program logs).
+
+	Logs are memory mapped window by window, so files larger than RAM are streamed.
+	Parsed rows are passed to LogSink in blocks of LOG_BLOCK_ROWS, column by column.
+*/
+
+#define LOG_MAX_COLUMNS			32
+#define LOG_BLOCK_ROWS			4096				// Same as TRACE_CHUNK_SAMPLES of RSim
+#define LOG_CONFIRM_ROWS		4
+#define LOG_MAP_WINDOW			(64UL << 20)		// Bytes mapped at once, longest line
+#define LOG_READ_BUFFER			(1UL << 20)			// Buffer for logs that cannot be mapped
+
+
+typedef struct
+{
+	unsigned Columns;					// Columns of data lines, 0 - no data lines found
+	uint64_t Rows;
+	uint64_t SkippedLines;				// Text lines
+	uint64_t BadRows;					// Data lines with wrong number of columns
+	uint64_t Bytes;
+} LogStats_t;
+
+
+// Receiver of parsed rows
+class LogSink
+{
+public:
+	virtual ~LogSink() {}
+	// columns[c][r] is column c of row r, rows > 0
+	// Returns false on error, parsing is stopped then
+	virtual bool Write(const int32_t *const *columns, unsigned column_count, unsigned rows) = 0;
+};
+
+
+// Keeps all rows in memory
+class LogTable : public LogSink
+{
+public:
+	bool Write(const int32_t *const *columns, unsigned column_count, unsigned rows);
+	std::vector<std::vector<int32_t> > Columns;
+};
+
+
+// Parses log file. stats may be NULL.
+//	scalar - do not use SIMD fast path (for comparison)
+// Returns false if file cannot be read or sink has failed
+bool parseLogFile(const char *fileName, LogSink *sink, LogStats_t *stats, bool scalar = false);
+
+
+#endif /* LOG_PARSER_H_ */
@@ -0,0 +1,196 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "log_telemetry.h"
+
+
+typedef struct
+{
+	LogSink *Sink;
+	TelemetryStats_t *Stats;
+	bool Ticks;
+	std::vector<int32_t> Block;			// Column c of row r is Block[c * LOG_BLOCK_ROWS + r]
+	unsigned BlockRows;
+	bool HasPrevious;
+	uint8_t PreviousSeq;
+	uint16_t PreviousTick;
+	int64_t Tick;						// Unwrapped loop tick
+} TelemetryState_t;
+
+
+//-------------------------------------------------------//
+// Dallas (Maxim) iButton CRC-8, same as _crc_ibutton_update() of avr-libc
+//-------------------------------------------------------//
+static uint8_t crcIbuttonUpdate(uint8_t crc, uint8_t data)
+{
+	unsigned i;
+	crc ^= data;
+	for (i = 0; i < 8; i++)
+		crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+	return crc;
+}
+
+//-------------------------------------------------------//
+// Decodes COBS frame without the delimiter
+// Returns decoded length, 0 if the frame is malformed
+//-------------------------------------------------------//
+static unsigned decodeCOBS(const uint8_t *frame, unsigned length, uint8_t *out)
+{
+	unsigned i = 0, n = 0, k;
+	uint8_t code;
+
+	while (i < length)
+	{
+		code = frame[i++];
+		if ((code == 0) || (i + code - 1 > length))
+			return 0;
+		for (k = 1; k < code; k++)
+			out[n++] = frame[i++];
+		if ((code != 0xFF) && (i < length))
+			out[n++] = 0;
+	}
+	return n;
+}
+
+static inline int32_t getU16(const uint8_t *p)
+{
+	return (int32_t)(p[0] | (p[1] << 8));
+}
+
+static inline int32_t getI16(const uint8_t *p)
+{
+	return (int32_t)(int16_t)(p[0] | (p[1] << 8));
+}
+
+static bool flushBlock(TelemetryState_t *state)
+{
+	const int32_t *columns[TELEMETRY_COLUMNS + 1];
+	unsigned c, count = TELEMETRY_COLUMNS + (state->Ticks ? 1 : 0);
+
+	if (state->BlockRows == 0)
+		return true;
+	for (c = 0; c < count; c++)
+		columns[c] = &state->Block[c * LOG_BLOCK_ROWS];
+	if (!state->Sink->Write(columns, count, state->BlockRows))
+		return false;
+	state->BlockRows = 0;
+	return true;
+}
+
+//-------------------------------------------------------//
+// Checks a frame and adds its record to the block
+//-------------------------------------------------------//
+static bool processFrame(TelemetryState_t *state, const uint8_t *frame, unsigned length)
+{
+	uint8_t record[TELEMETRY_MAX_FRAME];
+	int32_t *row = &state->Block[state->BlockRows];
+	uint8_t crc = 0;
+	uint16_t tick;
+	unsigned i;
+
+	if (length == 0)
+		return true;
+	if ((length > TELEMETRY_MAX_FRAME) || (decodeCOBS(frame, length, record) != TELEMETRY_RECORD_LENGTH))
+	{
+		state->Stats->BadFrames++;
+		return true;
+	}
+	for (i = 0; i < TELEMETRY_RECORD_LENGTH; i++)
+		crc = crcIbuttonUpdate(crc, record[i]);
+	if (crc != 0)
+	{
+		state->Stats->BadFrames++;
+		return true;
+	}
+
+	tick = (uint16_t)getU16(&record[1]);
+	if (state->HasPrevious)
+	{
+		state->Stats->LostFrames += (uint8_t)(record[0] - state->PreviousSeq - 1);
+		state->Tick += (uint16_t)(tick - state->PreviousTick);
+	}
+	else
+	{
+		state->Tick = tick;
+	}
+	state->HasPrevious = true;
+	state->PreviousSeq = record[0];
+	state->PreviousTick = tick;
+
+	// Text log order: adc_celsius, adc_normalized, adc_filtered, set point, process value, P, D, I, output
+	row[0 * LOG_BLOCK_ROWS] = getI16(&record[3]);
+	row[1 * LOG_BLOCK_ROWS] = getU16(&record[5]);
+	row[2 * LOG_BLOCK_ROWS] = getU16(&record[7]);
+	row[3 * LOG_BLOCK_ROWS] = getU16(&record[9]);
+	row[4 * LOG_BLOCK_ROWS] = getU16(&record[11]);
+	row[5 * LOG_BLOCK_ROWS] = getI16(&record[13]);
+	row[6 * LOG_BLOCK_ROWS] = getI16(&record[15]);
+	row[7 * LOG_BLOCK_ROWS] = getI16(&record[17]);
+	row[8 * LOG_BLOCK_ROWS] = getU16(&record[19]);
+	if (state->Ticks)
+		row[9 * LOG_BLOCK_ROWS] = (int32_t)state->Tick;
+	state->Stats->Frames++;
+
+	if (++state->BlockRows == LOG_BLOCK_ROWS)
+		return flushBlock(state);
+	return true;
+}
+
+
+//-------------------------------------------------------//
+// Reads telemetry file frame by frame
+//-------------------------------------------------------//
+bool parseTelemetryFile(const char *fileName, LogSink *sink, TelemetryStats_t *stats, bool ticks)
+{
+	TelemetryState_t state;
+	TelemetryStats_t local_stats;
+	std::vector<uint8_t> buffer(LOG_READ_BUFFER);
+	uint8_t frame[TELEMETRY_MAX_FRAME + 1];
+	unsigned frame_length = 0;
+	size_t count, i;
+	bool ok = true;
+	FILE *f;
+
+	if (!stats)
+		stats = &local_stats;
+	memset(stats, 0, sizeof(TelemetryStats_t));
+	if (!(f = fopen(fileName, "rb")))
+		return false;
+
+	state.Sink = sink;
+	state.Stats = stats;
+	state.Ticks = ticks;
+	state.Block.resize((TELEMETRY_COLUMNS + 1) * LOG_BLOCK_ROWS);
+	state.BlockRows = 0;
+	state.HasPrevious = false;
+	state.PreviousSeq = 0;
+	state.PreviousTick = 0;
+	state.Tick = 0;
+
+	while (ok && ((count = fread(buffer.data(), 1, buffer.size(), f)) > 0))
+	{
+		stats->Bytes += count;
+		for (i = 0; (i < count) && ok; i++)
+		{
+			if (buffer[i] == 0)
+			{
+				ok = processFrame(&state, frame, frame_length);
+				frame_length = 0;
+			}
+			else if (frame_length <= TELEMETRY_MAX_FRAME)
+			{
+				frame[frame_length++] = buffer[i];
+			}
+		}
+	}
+	if (ferror(f))
+		ok = false;
+	fclose(f);
+
+	// Unterminated last frame, e.g. power off messages
+	if (frame_length != 0)
+		stats->BadFrames++;
+	return ok && flushBlock(&state);
+}
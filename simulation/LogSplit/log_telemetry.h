@@ -0,0 +1,41 @@
+
+#ifndef LOG_TELEMETRY_H_
+#define LOG_TELEMETRY_H_
+
+#include <stdint.h>
+#include "log_parser.h"
+
+
+/*
+	Binary telemetry decoder.
+
+	Firmware built with LOG_BINARY_TELEMETRY sends every main loop run a record of
+	pid1/inc/telemetry.h: sequence number, loop tick, the 9 values of the text log
+	and CRC-8 (Dallas iButton), encoded with COBS and terminated by 0x00.
+	Records are passed to LogSink in the column order of the text log, so column files
+	are the same as for a text log. Frames with wrong length or CRC (greeting and
+	other text messages, damaged frames) are skipped and counted. Sequence number
+	gaps are counted as lost frames.
+*/
+
+#define TELEMETRY_RECORD_LENGTH		22			// Same as pid1/inc/telemetry.h, including CRC
+#define TELEMETRY_COLUMNS			9
+#define TELEMETRY_MAX_FRAME			64			// Longer frames are skipped
+
+
+typedef struct
+{
+	uint64_t Frames;					// Good records
+	uint64_t BadFrames;					// Wrong length or CRC
+	uint64_t LostFrames;				// Sequence number gaps
+	uint64_t Bytes;
+} TelemetryStats_t;
+
+
+// Decodes telemetry file. stats may be NULL.
+//	ticks - add loop tick (unwrapped) as the last column
+// Returns false if file cannot be read or sink has failed
+bool parseTelemetryFile(const char *fileName, LogSink *sink, TelemetryStats_t *stats, bool ticks = false);
+
+
+#endif /* LOG_TELEMETRY_H_ */
@@ -0,0 +1 @@
+RSim.exe -batch "RSim batch.txt"
\ No newline at end of file
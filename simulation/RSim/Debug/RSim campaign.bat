@@ -0,0 +1 @@
+RSim.exe -campaign "Test vector 1.txt,Test vector upto 120.txt,Test vector downto 120.txt,Test vector small changes.txt" -runs 1000 -out "campaign.txt"
\ No newline at end of file
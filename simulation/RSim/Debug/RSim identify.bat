@@ -0,0 +1 @@
+RSim.exe -identify "RSim identify.txt" -out "identified plant.txt"
\ No newline at end of file
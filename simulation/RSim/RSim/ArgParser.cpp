@@ -1,6 +1,7 @@
 
 #include <iostream>
 #include <stdlib.h>
+#include <string.h>
 
 #include <vector>
 #include "ArgParser.h"
@@ -54,7 +55,7 @@ int ArgParser::Parse(int argc, char* argv[])
 // Returns an option pair with specified switch
 // Returns null if not found
 
-option_pair_t* ArgParser::GetOption(char *option_switch)
+option_pair_t* ArgParser::GetOption(const char *option_switch)
 {
 	option_pair_t *option_p;
 	for (unsigned int i=0; i<option_pairs.size();i++)
@@ -67,7 +68,7 @@ option_pair_t* ArgParser::GetOption(char *option_switch)
 	return NULL;
 }
 
-char* ArgParser::GetOptionValue(char *option_switch)
+char* ArgParser::GetOptionValue(const char *option_switch)
 {
 	option_pair_t *option_p;
 	for (unsigned int i=0; i<option_pairs.size();i++)
@@ -11,8 +11,8 @@ class ArgParser
 {
 public:
 	int Parse(int argc, char* argv[]);
-	option_pair_t* GetOption(char *option_switch);
-	char* GetOptionValue(char *option_switch);
+	option_pair_t* GetOption(const char *option_switch);
+	char* GetOptionValue(const char *option_switch);
 	void PrintOptions(void);
 private:
 };
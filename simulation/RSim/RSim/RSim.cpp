@@ -1,61 +1,267 @@
 // RSim.cpp : Defines the entry point for the console application.
 //
+// Single run:
+//		RSim -input <test vector file> -outdir <directory> -mode <PLANT_STEP / NORMAL> [-nopause]
+// Batch run:
+//		RSim -batch <manifest file> [-threads <N>]
+// Log options for both:
+//		-trace <text / bin / binz>		legacy col_N.txt files (single run default),
+//										binary trace, compressed binary trace (batch default)
+//		-channels <name,name,...>		logged channels, e.g. col_0f,setting,col_8 (default all)
+//		-outstep <seconds>				time between logged samples (default every step)
+//		-jump							advance plant between events at once, log at -outstep only;
+//										used in PLANT_STEP mode with -outstep 10 or more (no gain with PID calls)
+//		-adc [<noise C>]				PID input from firmware ADC chain emulation, noise RMS of every conversion
+// Binary trace to legacy text files:
+//		RSim -convert <trace file> -outdir <directory>
+// PID gain sweep over a test vector, ranges are <min>:<max>:<step> or a single value:
+//		RSim -sweep <test vector file> [-kp <range>] [-ki <range>] [-kd <range>]
+//			[-iscale <range>] [-scale <range>] [-islope <range>]
+//			[-rank <iae / overshoot / settling / rise / duty>] [-out <file>] [-best <N>] [-threads <N>]
+// Batched closed-loop engine test and throughput:
+//		RSim -engine <instances> [-seconds <S>] [-threads <N>] [-scalar] [-verify]
+// Filter, plant jump-ahead and ADC chain microbenchmark:
+//		RSim -bench [-samples <N>]
+// ADC averaging and filter variants - delay, ISR load and resolution over sensor noise:
+//		RSim -adcmodel [<noise C>,<noise C>,...] [-positions <N>] [-updates <N>]
+// Plant model identification from temperature logs:
+//		RSim -identify <manifest file> [-out <file>] [-ambient <C>] [-tcol <N>] [-ecol <N>] [-scol <N>]
+//			[-population <N>] [-generations <N>] [-tolerance <T>] [-seed <N>] [-threads <N>]
+// Monte Carlo robustness campaign, distributions are <value>, uniform:<min>:<max> or normal:<mean>:<deviation>:
+//		RSim -campaign <test vector file>[,<test vector file>...] [-runs <N>] [-ambient <dist>]
+//			[-loss <dist>] [-gain <dist>] [-tconst <dist>] [-offset <dist>] [-noise <dist>] [-calib <dist>]
+//			[-seed <N>] [-out <file>] [-threads <N>] [-adc]
+//
 
 #include <stdio.h>
-#include <windows.h>
+#include <stdlib.h>
 #include <iostream>
 
 #include <string>
 
-#include "vector_reader.h"
 #include "ArgParser.h"
+#include "sim_runner.h"
+#include "batch_runner.h"
+#include "trace_file.h"
+#include "gain_sweep.h"
+#include "batch_engine.h"
+#include "filter_bench.h"
+#include "plant_ident.h"
+#include "mc_campaign.h"
+#include "adc_model.h"
 
-#include "stdafx.h"
 #include "stdint.h"
 #include "simulation.h"
-#include "plant.h"
-extern "C" {
-	#include "pid_controller.h"
+
+#include "stdafx.h"
+
+
+
+static void waitForUser(bool pause)
+{
+	if (pause)
+		std::cin.get();
+}
+
+// Reads -trace, -channels, -outstep, -jump and -adc options
+static bool parseTraceOptions(ArgParser *parser, SimJob_t *job)
+{
+	char *arg_str;
+	option_pair_t *option;
+
+	if ((arg_str = parser->GetOptionValue("-trace")))
+	{
+		if ((job->TraceFormat = parseTraceFormat(arg_str)) < 0)
+		{
+			std::cout << "Unknown log format (-trace <text / bin / binz>)" << std::endl;
+			return false;
+		}
+	}
+	if ((arg_str = parser->GetOptionValue("-channels")))
+	{
+		if ((job->TraceChannels = parseTraceChannels(arg_str)) == 0)
+		{
+			std::cout << "Unknown log channel (-channels col_0f,col_0,setting,col_5,col_6,col_7,col_8)" << std::endl;
+			return false;
+		}
+	}
+	if ((arg_str = parser->GetOptionValue("-outstep")))
+	{
+		job->OutputInterval = (unsigned)(atof(arg_str) * STEPS_PER_SECOND + 0.5);
+		if (job->OutputInterval == 0)
+		{
+			std::cout << "Wrong log interval (-outstep <seconds>, at least " << TIMESTEP << ")" << std::endl;
+			return false;
+		}
+	}
+	job->JumpAhead = (parser->GetOption("-jump") != 0);
+	if ((option = parser->GetOption("-adc")))
+	{
+		job->AdcEmulation = true;
+		if (option->option_value)
+			job->AdcNoise = atof(option->option_value);
+		if (job->AdcNoise < 0)
+		{
+			std::cout << "ADC noise must not be negative (-adc [<noise C>])" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Reads -sweep options
+static bool parseSweepOptions(ArgParser *parser, SweepOptions_t *options)
+{
+	const struct {const char *Switch; GainRange_t *Range;} ranges[] =
+	{
+		{"-kp",		&options->KpRange},
+		{"-ki",		&options->KiRange},
+		{"-kd",		&options->KdRange},
+		{"-iscale",	&options->IntegratorScaleRange},
+		{"-scale",	&options->ScalingFactorRange},
+		{"-islope",	&options->SoftSlopeRange},
+	};
+	char *arg_str;
+	unsigned i;
+
+	for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+	{
+		if (!(arg_str = parser->GetOptionValue(ranges[i].Switch)))
+			continue;
+		if (!parseGainRange(arg_str, ranges[i].Range))
+		{
+			std::cout << "Wrong range " << ranges[i].Switch << " " << arg_str << " (expected <min>:<max>:<step>)" << std::endl;
+			return false;
+		}
+	}
+	if ((arg_str = parser->GetOptionValue("-rank")))
+	{
+		if ((options->RankBy = parseSweepRank(arg_str)) < 0)
+		{
+			std::cout << "Unknown rank (-rank <iae / overshoot / settling / rise / duty>)" << std::endl;
+			return false;
+		}
+	}
+	if ((arg_str = parser->GetOptionValue("-out")))
+		options->OutputFile = arg_str;
+	if ((arg_str = parser->GetOptionValue("-best")))
+		options->ShowBest = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-threads")))
+		options->Threads = (unsigned)atoi(arg_str);
+	return true;
 }
 
 
-enum SimulationMode {SIM_PLANT_STEP_RESPONSE, SIM_NORMAL};
+// Reads -identify options
+static bool parseIdentOptions(ArgParser *parser, IdentOptions_t *options)
+{
+	char *arg_str;
+
+	if ((arg_str = parser->GetOptionValue("-out")))
+		options->OutputFile = arg_str;
+	if ((arg_str = parser->GetOptionValue("-ambient")))
+		options->Ambient = atof(arg_str);
+	if ((arg_str = parser->GetOptionValue("-tcol")))
+		options->TemperatureColumn = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-ecol")))
+		options->EffectColumn = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-scol")))
+		options->SetpointColumn = atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-population")))
+		options->Population = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-generations")))
+		options->Generations = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-tolerance")))
+		options->Tolerance = atof(arg_str);
+	if ((arg_str = parser->GetOptionValue("-seed")))
+		options->Seed = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-threads")))
+		options->Threads = (unsigned)atoi(arg_str);
+	if (options->Population < 4)
+	{
+		std::cout << "Population must be at least 4" << std::endl;
+		return false;
+	}
+	return true;
+}
 
+// Reads -campaign options
+static bool parseCampaignOptions(ArgParser *parser, const char *input_files, CampaignOptions_t *options)
+{
+	const struct {const char *Switch; Distribution_t *Dist;} distributions[] =
+	{
+		{"-ambient",	&options->Ambient},
+		{"-loss",		&options->AmbientLoss},
+		{"-gain",		&options->Gain},
+		{"-tconst",		&options->TimeScale},
+		{"-offset",		&options->SensorOffset},
+		{"-noise",		&options->SensorNoise},
+		{"-calib",		&options->Calibration},
+	};
+	std::string list = input_files;
+	size_t start = 0;
+	size_t end;
+	char *arg_str;
+	unsigned i;
+
+	do
+	{
+		end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+		if (end > start)
+			options->InputFiles.push_back(list.substr(start, end - start));
+		start = end + 1;
+	} while (end < list.size());
+
+	for (i = 0; i < sizeof(distributions) / sizeof(distributions[0]); i++)
+	{
+		if (!(arg_str = parser->GetOptionValue(distributions[i].Switch)))
+			continue;
+		if (!parseDistribution(arg_str, distributions[i].Dist))
+		{
+			std::cout << "Wrong distribution " << distributions[i].Switch << " " << arg_str <<
+				" (expected <value>, uniform:<min>:<max> or normal:<mean>:<deviation>)" << std::endl;
+			return false;
+		}
+	}
+	if ((arg_str = parser->GetOptionValue("-runs")))
+		options->Runs = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-seed")))
+		options->Seed = (unsigned)atoi(arg_str);
+	if ((arg_str = parser->GetOptionValue("-out")))
+		options->OutputFile = arg_str;
+	if ((arg_str = parser->GetOptionValue("-threads")))
+		options->Threads = (unsigned)atoi(arg_str);
+	options->AdcEmulation = (parser->GetOption("-adc") != 0);
+	if (options->InputFiles.empty() || (options->Runs == 0))
+	{
+		std::cout << "Expected test vector files and number of runs" << std::endl;
+		return false;
+	}
+	return true;
+}
 
 
 int _tmain(int argc, _TCHAR* argv[])
 {
-	VectorReader myVectorReader;
-	VectorRecord_t currentVector;
 	ArgParser myArgParser;
+	SimJob_t job;
+	SimResult_t result;
+	SweepOptions_t sweep_options;
+	EngineTestOptions_t engine_options;
+	IdentOptions_t ident_options;
+	CampaignOptions_t campaign_options;
+	AdcModelOptions_t adc_model_options;
+	option_pair_t *option;
 
-	unsigned long seconds_counter = 0;
-	unsigned long steps_counter = 0;
-	bool update_vector = false;
-	bool update_PID_control = false;
-	bool last_iteration = false;
-	
-	float plantState;
-	float processF;
-	uint16_t processValue;
-	float setPointF;
-	uint16_t setPoint; 
-	uint16_t setPoint_old = 0;
-	float effect = 0;
-	
-	float k_norm = 0.446f;
-	float offset_norm = 48.144f;
-
-	float tempSetting;							// Temperature setting
-	bool reg_enabled;								// Heater ON/OFF
-	uint8_t pid_mode;
-	
 	char *input_fname;
 	char *output_dir;
 	char *tmp_arg_str;
-	int simulation_mode;
-
-	char tmp_buf_char[100];
+	bool pause;
+	unsigned threads;
+	unsigned samples;
+	int failed;
 
 	//--------------------------------------------//
 	// Command line arguments parsing
@@ -65,224 +271,164 @@ int _tmain(int argc, _TCHAR* argv[])
 	 //std::cin.get();
 	 //return 0;
 
-	if (!(input_fname = myArgParser.GetOptionValue("-input")))
+	initSimJob(&job);
+
+	// Trace conversion
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-convert")))
 	{
-		std::cout << "Expected test vector file (-input <file>)" << std::endl;
-		std::cin.get();
-		return 0;
+		if (!(output_dir = myArgParser.GetOptionValue("-outdir")))
+		{
+			std::cout << "Expected output directory (-outdir <directory>)" << std::endl;
+			return 1;
+		}
+		return convertTraceToText(tmp_arg_str, output_dir) ? 0 : 1;
 	}
-	
-	if (!(output_dir = myArgParser.GetOptionValue("-outdir")))
+
+	// Gain sweep
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-sweep")))
 	{
-		std::cout << "Expected output directory (-outdir <directory>)" << std::endl;
-		std::cin.get();
-		return 0;
+		initSweepOptions(&sweep_options);
+		sweep_options.InputFile = tmp_arg_str;
+		if (!parseSweepOptions(&myArgParser, &sweep_options))
+			return 1;
+		return (runGainSweep(&sweep_options) == 0) ? 0 : 1;
 	}
 
-	if (!(tmp_arg_str = myArgParser.GetOptionValue("-mode")))
+	// Plant model identification
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-identify")))
 	{
-		std::cout << "Expected simulation mode (-mode <PLANT_STEP / NORMAL>)" << std::endl;
-		std::cin.get();
-		return 0;
+		initIdentOptions(&ident_options);
+		ident_options.ManifestFile = tmp_arg_str;
+		if (!parseIdentOptions(&myArgParser, &ident_options))
+			return 1;
+		return (runPlantIdentification(&ident_options) == 0) ? 0 : 1;
 	}
-	simulation_mode = (strcmp(tmp_arg_str, "PLANT_STEP") == 0) ? SIM_PLANT_STEP_RESPONSE : SIM_NORMAL;
 
-	//--------------------------------------------//
+	// Monte Carlo campaign
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-campaign")))
+	{
+		initCampaignOptions(&campaign_options);
+		if (!parseCampaignOptions(&myArgParser, tmp_arg_str, &campaign_options))
+			return 1;
+		return (runCampaign(&campaign_options) == 0) ? 0 : 1;
+	}
 
+	// ADC pipeline model
+	if ((option = myArgParser.GetOption("-adcmodel")))
+	{
+		initAdcModelOptions(&adc_model_options);
+		if (option->option_value && !parseNoiseList(option->option_value, &adc_model_options.Noise))
+		{
+			std::cout << "Expected sensor noise list (-adcmodel [<noise C>,<noise C>,...])" << std::endl;
+			return 1;
+		}
+		if (myArgParser.GetOptionValue("-positions"))
+			adc_model_options.Positions = (unsigned)atoi(myArgParser.GetOptionValue("-positions"));
+		if (myArgParser.GetOptionValue("-updates"))
+			adc_model_options.Updates = (unsigned)atoi(myArgParser.GetOptionValue("-updates"));
+		if ((adc_model_options.Positions == 0) || (adc_model_options.Updates == 0))
+		{
+			std::cout << "Expected non-zero -positions and -updates" << std::endl;
+			return 1;
+		}
+		return (runAdcModel(&adc_model_options) == 0) ? 0 : 1;
+	}
 
+	// Filter benchmark
+	if (myArgParser.GetOption("-bench"))
+	{
+		samples = 10000000;
+		if (myArgParser.GetOptionValue("-samples"))
+			samples = (unsigned)atoi(myArgParser.GetOptionValue("-samples"));
+		failed = runFilterBenchmark(samples);
+		failed += runPlantJumpBenchmark(samples / STEPS_PER_SECOND);
+		failed += runAdcChainBenchmark(samples / STEPS_PER_SECOND / 100);
+		return (failed == 0) ? 0 : 1;
+	}
 
-	//-----------------------------//
-	// Reading test vector file
-	if (myVectorReader.ReadVectorFile(input_fname) == false)
+	// Batched engine test
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-engine")))
 	{
-		std::cout << "Cannot read test vector file. Press any key to exit." << std::endl;
-		std::cin.get();
-		return 0;
+		engine_options.Instances = (unsigned)atoi(tmp_arg_str);
+		engine_options.Seconds = 3600;
+		if (myArgParser.GetOptionValue("-seconds"))
+			engine_options.Seconds = (unsigned)atoi(myArgParser.GetOptionValue("-seconds"));
+		engine_options.Threads = 0;
+		if (myArgParser.GetOptionValue("-threads"))
+			engine_options.Threads = (unsigned)atoi(myArgParser.GetOptionValue("-threads"));
+		engine_options.Scalar = (myArgParser.GetOption("-scalar") != 0);
+		engine_options.Verify = (myArgParser.GetOption("-verify") != 0);
+		return (runEngineTest(&engine_options) == 0) ? 0 : 1;
 	}
 
-	std::cout << "Test vector file OK. Starting simulation." << std::endl;
+	// Batch mode - no interactive prompts
+	if ((tmp_arg_str = myArgParser.GetOptionValue("-batch")))
+	{
+		job.TraceFormat = TRACE_BINARY_COMPRESSED;
+		if (!parseTraceOptions(&myArgParser, &job))
+			return 1;
+		threads = 0;
+		if (myArgParser.GetOptionValue("-threads"))
+			threads = (unsigned)atoi(myArgParser.GetOptionValue("-threads"));
+		failed = runBatch(tmp_arg_str, threads, &job);
+		return (failed == 0) ? 0 : 1;
+	}
 
+	pause = (myArgParser.GetOption("-nopause") == 0);
 
-	//-----------------------------//
-	// Initializing simulation
-	
-	if (!CreateDirectory(output_dir,NULL))
+	job.TraceFormat = TRACE_TEXT;
+	if (!parseTraceOptions(&myArgParser, &job))
 	{
-		if (GetLastError() != ERROR_ALREADY_EXISTS)
-		{
-			std::cout << "Cannot create output log directory" << std::endl;
-			std::cin.get();
-			return 0;
-		}
+		waitForUser(pause);
+		return 0;
+	}
+
+	if (!(input_fname = myArgParser.GetOptionValue("-input")))
+	{
+		std::cout << "Expected test vector file (-input <file>) or batch manifest (-batch <file>)" << std::endl;
+		waitForUser(pause);
+		return 0;
 	}
 
-	// Open LOG files
-	FILE *f_state_float;
-	FILE *f_state_int;
-	FILE *f_setting;
-	FILE *f_p_term;
-	FILE *f_d_term;
-	FILE *f_i_term;
-	FILE *f_pid_output;
-
-	// Create log data files:
-
-	// Plant state float
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_0f.txt");
-	fopen_s( &f_state_float, tmp_buf_char, "w" ); 
-	// Plant state integer
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_0.txt");
-	fopen_s( &f_state_int, tmp_buf_char, "w" ); 
-	// Set value
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "setting.txt");
-	fopen_s( &f_setting, tmp_buf_char, "w" ); 
-	// P-term of PID controller
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_5.txt");
-	fopen_s( &f_p_term, tmp_buf_char, "w" ); 
-	// D-term of PID controller
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_6.txt");
-	fopen_s( &f_d_term, tmp_buf_char, "w" ); 
-	// I-term of PID controller
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_7.txt");
-	fopen_s( &f_i_term, tmp_buf_char, "w" ); 
-	// Output of PID controller
-	sprintf_s(tmp_buf_char, 100, "%s%s", output_dir, "col_8.txt");
-	fopen_s( &f_pid_output, tmp_buf_char, "w" ); 
-	
-
-	// Set ambient temperature and plant internal state
-	if (!myVectorReader.StartConditions.AmbientValid)
-		myVectorReader.StartConditions.Ambient = 25;
-	if (!myVectorReader.StartConditions.StateValid)
-		myVectorReader.StartConditions.SystemState = 25;
-	initPlant((float)myVectorReader.StartConditions.Ambient, (float)myVectorReader.StartConditions.SystemState); 
-	processPlant(0);
-
-	// Initialize PID controller 
-	setPIDIntegratorLimit(0);
-	
-	// Initial simulator state
-	reg_enabled = false;		// heater OFF
-	tempSetting = 25.0f;		// Temperature default setting
-	myVectorReader.GetNextVector(&currentVector);
-	
-	//int32_t aaa;
-	//aaa = INT32_MAX;
-	//printf("%d",aaa);
-	//std::cin.get();
-
-	//-----------------------------//
-	// Simulate
-
-	while(true)
+	if (!(output_dir = myArgParser.GetOptionValue("-outdir")))
 	{
-		// Process time counters
-		update_vector = false;
-		update_PID_control = false;
-		if (steps_counter % STEPS_PER_SECOND == 0)
-		{
-			if (seconds_counter == currentVector.TimeStamp)
-			{
-				update_vector = true;
-			}
-			if (seconds_counter % PID_CALL_INTERVAL == 0)
-			{
-				update_PID_control = true;
-			}
-			seconds_counter++;
-		}
-		steps_counter++;
+		std::cout << "Expected output directory (-outdir <directory>)" << std::endl;
+		waitForUser(pause);
+		return 0;
+	}
 
-		// Update setting using data from test vector file
-		if (update_vector)
-		{
-			if (last_iteration)
-			{
-				printf("%10lu sec. Simulation finished.\n", currentVector.TimeStamp);
-				break;
-			}
-			
-			reg_enabled = currentVector.ProcessEnabled;
-			if (reg_enabled)
-			{
-				tempSetting = (float)currentVector.ForceValue;		
-				setPIDIntegratorLimit((int)tempSetting);
-			}
-			
-			if (reg_enabled)
-				printf("%10lu sec. New setting = %.2f\n", currentVector.TimeStamp, tempSetting);
-			else
-				printf("%10lu sec. New setting = %s\n", currentVector.TimeStamp, "OFF");
-			
-			last_iteration = !myVectorReader.GetNextVector(&currentVector);
-			//std::cin.get();
-		}
+	if (!(tmp_arg_str = myArgParser.GetOptionValue("-mode")))
+	{
+		std::cout << "Expected simulation mode (-mode <PLANT_STEP / NORMAL>)" << std::endl;
+		waitForUser(pause);
+		return 0;
+	}
 
+	if (parseSimulationMode(tmp_arg_str) < 0)
+	{
+		std::cout << "Unknown simulation mode " << tmp_arg_str << " (-mode <PLANT_STEP / NORMAL>)" << std::endl;
+		waitForUser(pause);
+		return 0;
+	}
 
-		// Process plant with TIMESTEP interval
-		processPlant(effect);	
-		
-		// Process regulator 
-		if (simulation_mode == SIM_PLANT_STEP_RESPONSE)
-		{
-				if (reg_enabled)
-					effect = 100;
-				else
-					effect = 0;
-				dbg_PID_output = (int16_t)effect;
-		}
-		else
-		{
-				if (update_PID_control)
-				{	
-					// Calculate process value
-					plantState = (float)getPlantState();					
-					processF = (plantState + offset_norm) / k_norm;	
-					processF *= 4;
-					//processF /= 2;
-					processValue = (uint16_t)processF;
-			
-					// Calculate setpoint
-					setPointF = (tempSetting + offset_norm) / k_norm;
-					setPointF *= 4;
-					//setPointF /= 2;
-					setPoint = (uint16_t)setPointF;	
-			
-					// PID
-					pid_mode = 0;
-					if (reg_enabled)
-						pid_mode |= PID_ENABLED;
-					effect = processPID(setPoint, processValue,pid_mode);
-				}
-		}
-		
+	job.InputFile = input_fname;
+	job.OutputDir = output_dir;
+	job.Mode = parseSimulationMode(tmp_arg_str);
+	job.Verbose = true;
+	if (job.JumpAhead && !isJumpAheadUsed(&job))
+		std::cout << "-jump is used in PLANT_STEP mode with -outstep " << JUMP_MIN_OUTPUT_SECONDS << " or more only, plant is stepped" << std::endl;
 
-		// LOG
-		fprintf(f_state_float, "%f\r", getPlantState());
-		fprintf(f_state_int, "%u\r", (uint16_t)getPlantState());		
-		fprintf(f_setting, "%d\r", (int)tempSetting);
-		fprintf(f_p_term, "%d\r", dbg_PID_p_term);
-		fprintf(f_d_term, "%d\r", dbg_PID_d_term);
-		fprintf(f_i_term, "%d\r", dbg_PID_i_term);
-		fprintf(f_pid_output, "%d\r", dbg_PID_output);
+	//--------------------------------------------//
 
+	if (!runSimulation(&job, &result))
+	{
+		std::cout << result.Message << (pause ? ". Press any key to exit." : ".") << std::endl;
+		waitForUser(pause);
+		return 0;
 	}
 
-	//-------------------------------//
-
-
-	
-	fclose(f_state_float);
-	fclose(f_state_int);
-	fclose(f_setting);
-	fclose(f_p_term);
-	fclose(f_d_term);
-	fclose(f_i_term);
-	fclose(f_pid_output);
-	
-	std::cout << "Done. Press enter to exit." << std::endl;
-	std::cin.get();
+	std::cout << (pause ? "Done. Press enter to exit." : "Done.") << std::endl;
+	waitForUser(pause);
 
 	return 0;
 }
-
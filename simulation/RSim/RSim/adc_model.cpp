@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "adc_model.h"
+#include "adc_chain.h"
+#include "sim_random.h"
+#include "simulation.h"
+#include "stdint.h"
+extern "C" {
+	#include "fir_filter.h"
+}
+
+
+#define ADC_MODEL_TEMPERATURE	150.0		// Celsius, sensor temperatures start here
+
+enum AdcAveraging {AVG_WINDOW, AVG_CIC2};
+
+// Measurement pipeline: averaging of conversions in the ADC ISR, FIR by every main loop update
+typedef struct
+{
+	const char *Name;
+	int Averaging;					// AdcAveraging
+	unsigned ConversionCycles;		// MCU cycles per conversion
+	unsigned Length;				// Window length or CIC decimation, conversions
+	int8_t *Coeffs;
+	uint8_t Taps;
+	uint16_t DCGain;
+} AdcPipeline_t;
+
+
+// v0.501 filter, fir_filter_rect of adc.c
+static int8_t fir20[20] = {11, 21, 33, 44, 55, 65, 73, 79, 83, 84, 83, 79, 73, 65, 55, 44, 33, 21, 11, 2};
+// Hann windows, fir8 is fir_filter_rect of adc.c
+static int8_t fir8[8] = {8, 27, 49, 64, 64, 49, 27, 8};
+static int8_t fir4[4] = {16, 48, 48, 16};
+static int8_t fir1[1] = {1};
+
+static const AdcPipeline_t pipelines[] =
+{
+	{"window 32 @1k, FIR 20",	AVG_WINDOW,	16000,	32,		fir20,	20,	1014},
+	{"CIC2 51 @1k, FIR 20",		AVG_CIC2,	16000,	51,		fir20,	20,	1014},
+	{"CIC2 51 @1k, FIR 8",		AVG_CIC2,	16000,	51,		fir8,	8,	296},
+	{"CIC2 490 @9.6k, FIR 20",	AVG_CIC2,	1664,	490,	fir20,	20,	1014},
+	{"CIC2 490 @9.6k, FIR 8",	AVG_CIC2,	1664,	490,	fir8,	8,	296},
+	{"CIC2 490 @9.6k, FIR 4",	AVG_CIC2,	1664,	490,	fir4,	4,	128},
+	{"CIC2 490 @9.6k, no FIR",	AVG_CIC2,	1664,	490,	fir1,	1,	1},
+};
+
+#define PIPELINE_COUNT	(sizeof(pipelines) / sizeof(AdcPipeline_t))
+
+
+//-------------------------------------------------------//
+// Integer pipeline as the firmware runs it.
+// Window: ring buffer summ >> 3 (4x counts). CIC2: integrators in the ISR,
+// combs every Length conversions, update takes the latest output scaled to 16x counts.
+//-------------------------------------------------------//
+class AdcPipelineModel
+{
+public:
+	AdcPipelineModel(const AdcPipeline_t *pipeline)
+	{
+		P = pipeline;
+		Core.n = P->Taps;
+		Core.dc_gain = P->DCGain;
+		Core.coeffs = P->Coeffs;
+		memset(Samples, 0, sizeof(Samples));
+		Window.assign(P->Length, 0);
+		Pointer = 0;
+		Summ = 0;
+		Integrator1 = Integrator2 = Comb1Delay = Comb2Delay = Output = 0;
+		Counter = P->Length;
+	}
+	void Convert(uint16_t sample)
+	{
+		uint32_t comb1;
+		if (P->Averaging == AVG_WINDOW)
+		{
+			Summ = Summ - Window[Pointer] + sample;
+			Window[Pointer] = sample;
+			Pointer = (Pointer + 1) % P->Length;
+			return;
+		}
+		Integrator1 += sample;
+		Integrator2 += Integrator1;
+		if (--Counter == 0)
+		{
+			Counter = P->Length;
+			comb1 = Integrator2 - Comb1Delay;
+			Comb1Delay = Integrator2;
+			Output = comb1 - Comb2Delay;
+			Comb2Delay = comb1;
+		}
+	}
+	int16_t Update(void)
+	{
+		uint32_t r2 = P->Length * P->Length;
+		if (P->Averaging == AVG_WINDOW)
+			return fir_i16_i8((int16_t)(Summ >> 3), Samples, &Core);
+		return fir_i16_i8((int16_t)((Output * 16 + r2 / 2) / r2), Samples, &Core);
+	}
+	double GetCountsPerLSB(void) const { return (P->Averaging == AVG_WINDOW) ? 4 : 16; }
+private:
+	const AdcPipeline_t *P;
+	filter8bit_core_t Core;
+	int16_t Samples[20];
+	std::vector<uint16_t> Window;
+	unsigned Pointer;
+	uint16_t Summ;
+	uint32_t Integrator1, Integrator2;
+	uint32_t Comb1Delay, Comb2Delay;
+	uint32_t Output;
+	unsigned Counter;
+};
+
+
+//-------------------------------------------------------//
+// Group delay from conversion to adc_filtered, ms:
+// centroid of the averaging weights, mean age of the averaging output
+// when the main loop takes it, centroid of the FIR
+//-------------------------------------------------------//
+static double getDelay(const AdcPipeline_t *p)
+{
+	double conversion_ms = p->ConversionCycles * 1000.0 / ADC_MODEL_CPU_CLOCK;
+	double weights = 0, moment = 0, w, readout = 0;
+	unsigned age;
+
+	if (p->Averaging == AVG_WINDOW)
+	{
+		moment = (p->Length - 1) / 2.0;
+		weights = 1;
+	}
+	else
+	{
+		for (age = 0; age < 2 * p->Length; age++)
+		{
+			w = (age < p->Length) ? (age + 1) : (2 * p->Length - 1 - age);
+			weights += w;
+			moment += w * age;
+		}
+		if (ADC_MODEL_LOOP_CYCLES % (p->Length * p->ConversionCycles) != 0)
+			readout = p->Length / 2.0;
+	}
+	double delay = (moment / weights + readout) * conversion_ms;
+
+	weights = moment = 0;
+	for (age = 0; age < p->Taps; age++)
+	{
+		weights += p->Coeffs[age];
+		moment += p->Coeffs[age] * (double)age;
+	}
+	return delay + moment / weights * ADC_MODEL_LOOP_CYCLES * 1000.0 / ADC_MODEL_CPU_CLOCK;
+}
+
+//-------------------------------------------------------//
+// ADC ISR load, percent of MCU cycles
+//-------------------------------------------------------//
+static double getIsrLoad(const AdcPipeline_t *p)
+{
+	double cycles = (p->Averaging == AVG_WINDOW) ? ADC_ISR_CYCLES_WINDOW :
+		ADC_ISR_CYCLES_CIC + (double)ADC_ISR_CYCLES_COMB / p->Length;
+	return cycles * 100.0 / p->ConversionCycles;
+}
+
+//-------------------------------------------------------//
+// Runs the pipeline at sensor temperatures spread over one ADC step.
+// Returns RMS error of adc_filtered around its overall mean, normalized ADC counts -
+// noise and the staircase of the ADC steps that noise does not dither
+//-------------------------------------------------------//
+static double getErrorRMS(const AdcPipeline_t *p, const AdcModelOptions_t *options, double noise)
+{
+	SimRandom rng(options->Seed);
+	AdcChain chain;
+	double celsius, ideal, error;
+	double summ = 0, summ2 = 0;
+	uint64_t conversion_time, update_time;
+	unsigned position, update, count = 0;
+	unsigned warmup = p->Taps + 3;
+	double noise_counts = noise / NORM_K;
+
+	for (position = 0; position < options->Positions; position++)
+	{
+		AdcPipelineModel model(p);
+		celsius = ADC_MODEL_TEMPERATURE + (position + 0.5) / options->Positions * NORM_K;
+		ideal = (celsius + NORM_OFFSET) / NORM_K;
+		conversion_time = p->ConversionCycles;
+		update_time = ADC_MODEL_LOOP_CYCLES;
+		for (update = 0; update < warmup + options->Updates; update++)
+		{
+			for (; conversion_time <= update_time; conversion_time += p->ConversionCycles)
+				model.Convert(chain.Sample(celsius, (noise_counts > 0) ? rng.Normal() * noise_counts : 0));
+			update_time += ADC_MODEL_LOOP_CYCLES;
+			error = model.Update() / model.GetCountsPerLSB() - ideal;
+			if (update < warmup)
+				continue;
+			summ += error;
+			summ2 += error * error;
+			count++;
+		}
+	}
+	summ /= count;
+	return sqrt(fmax(summ2 / count - summ * summ, 0));
+}
+
+
+void initAdcModelOptions(AdcModelOptions_t *options)
+{
+	options->Noise.clear();
+	options->Noise.push_back(0);
+	options->Noise.push_back(0.1);
+	options->Noise.push_back(0.25);
+	options->Noise.push_back(0.5);
+	options->Noise.push_back(1.0);
+	options->Positions = 32;
+	options->Updates = 200;
+	options->Seed = 1;
+}
+
+//-------------------------------------------------------//
+// Parses "<noise>,<noise>,...", Celsius
+//-------------------------------------------------------//
+bool parseNoiseList(const char *list_str, std::vector<double> *noise)
+{
+	const char *p = list_str;
+	char *end;
+	double value;
+
+	noise->clear();
+	while (*p)
+	{
+		value = strtod(p, &end);
+		if ((end == p) || (value < 0) || ((*end != ',') && (*end != '\0')))
+			return false;
+		noise->push_back(value);
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return !noise->empty();
+}
+
+//-------------------------------------------------------//
+// Compares ADC averaging and filter variants: delay, ISR load,
+// adc_filtered error and effective resolution over sensor noise levels
+//-------------------------------------------------------//
+int runAdcModel(const AdcModelOptions_t *options)
+{
+	std::vector<double> errors(PIPELINE_COUNT * options->Noise.size());
+	const AdcPipeline_t *p;
+	char column[16];
+	unsigned i, k;
+
+	for (i = 0; i < PIPELINE_COUNT; i++)
+		for (k = 0; k < options->Noise.size(); k++)
+			errors[i * options->Noise.size() + k] = getErrorRMS(&pipelines[i], options, options->Noise[k]);
+
+	printf("ADC pipeline model: %u temperatures x %u updates, main loop %lu ms, %.3f C per ADC step\n",
+		options->Positions, options->Updates, ADC_MODEL_LOOP_CYCLES * 1000 / ADC_MODEL_CPU_CLOCK, NORM_K);
+	printf("%-26s %8s %9s %9s\n", "pipeline", "conv/s", "ISR load", "delay,ms");
+	for (i = 0; i < PIPELINE_COUNT; i++)
+	{
+		p = &pipelines[i];
+		printf("%-26s %8.0f %8.1f%% %9.0f\n", p->Name, (double)ADC_MODEL_CPU_CLOCK / p->ConversionCycles,
+			getIsrLoad(p), getDelay(p));
+	}
+
+	printf("\nadc_filtered error RMS, C, at sensor noise of every conversion, C RMS:\n%-26s", "pipeline");
+	for (k = 0; k < options->Noise.size(); k++)
+	{
+		sprintf(column, "%g", options->Noise[k]);
+		printf(" %8s", column);
+	}
+	printf("\n");
+	for (i = 0; i < PIPELINE_COUNT; i++)
+	{
+		printf("%-26s", pipelines[i].Name);
+		for (k = 0; k < options->Noise.size(); k++)
+			printf(" %8.4f", errors[i * options->Noise.size() + k] * NORM_K);
+		printf("\n");
+	}
+
+	// Ideal 10-bit conversion without noise has error RMS of 1/sqrt(12) ADC steps
+	printf("\nEffective resolution, bits:\n%-26s", "pipeline");
+	for (k = 0; k < options->Noise.size(); k++)
+	{
+		sprintf(column, "%g", options->Noise[k]);
+		printf(" %8s", column);
+	}
+	printf("\n");
+	for (i = 0; i < PIPELINE_COUNT; i++)
+	{
+		printf("%-26s", pipelines[i].Name);
+		for (k = 0; k < options->Noise.size(); k++)
+			printf(" %8.1f", 10 + log2(0.2886751345948129 / fmax(errors[i * options->Noise.size() + k], 1e-6)));
+		printf("\n");
+	}
+	return 0;
+}
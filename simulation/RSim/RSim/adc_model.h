@@ -0,0 +1,33 @@
+
+#ifndef ADC_MODEL_H_
+#define ADC_MODEL_H_
+
+#include <vector>
+
+
+// MCU clock and main loop period (menuUpdateTimer), cycles
+#define ADC_MODEL_CPU_CLOCK			16000000UL
+#define ADC_MODEL_LOOP_CYCLES		(51UL * 16000)
+
+// Estimated ADC ISR cost, MCU cycles per interrupt with entry, register saves and RETI.
+// Compare with the ADC line of the STAGE_PROFILING ISR report.
+#define ADC_ISR_CYCLES_WINDOW		100			// Ring buffer and running summ (v0.501)
+#define ADC_ISR_CYCLES_CIC			130			// Two 32-bit integrators and decimation counter
+#define ADC_ISR_CYCLES_COMB			60			// Combs, added once per decimation
+
+
+typedef struct
+{
+	std::vector<double> Noise;		// Sensor noise levels, Celsius RMS of every conversion
+	unsigned Positions;				// Sensor temperatures per noise level, spread over one ADC step
+	unsigned Updates;				// Checked main loop updates per temperature
+	unsigned Seed;
+} AdcModelOptions_t;
+
+
+void initAdcModelOptions(AdcModelOptions_t *options);
+bool parseNoiseList(const char *list_str, std::vector<double> *noise);
+int runAdcModel(const AdcModelOptions_t *options);
+
+
+#endif /* ADC_MODEL_H_ */
@@ -0,0 +1,650 @@
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "batch_engine.h"
+#include "worker_pool.h"
+
+// AVX2 kernels are built for x86 GCC hosts with function target attribute and selected at runtime,
+// other compilers use them only when AVX2 code generation is enabled (/arch:AVX2)
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || defined(__AVX2__)
+#define ENGINE_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+#endif
+
+
+
+BatchEngine::BatchEngine()
+{
+	Count = 0;
+	StepCounter = 0;
+	UseAVX2 = IsAVX2Supported();
+	getPlantModel(&Model);
+}
+
+
+//-------------------------------------------------------//
+// Returns true if host CPU can run AVX2 kernels
+//-------------------------------------------------------//
+bool BatchEngine::IsAVX2Supported(void)
+{
+#if defined(ENGINE_AVX2) && defined(__GNUC__)
+	return __builtin_cpu_supports("avx2") != 0;
+#elif defined(ENGINE_AVX2)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void BatchEngine::SetAVX2(bool enable)
+{
+	UseAVX2 = enable && IsAVX2Supported();
+}
+
+
+//-------------------------------------------------------//
+// Allocates instances. All instances get default gains,
+// ambient and state of 25 Celsius, heater OFF.
+//-------------------------------------------------------//
+void BatchEngine::Init(unsigned count)
+{
+	pid_gains_t gains;
+	unsigned i;
+
+	Count = (count + 7) & ~7U;
+	StepCounter = 0;
+
+	EffZ.assign(eff_NCoef * Count, 0);
+	PlantZ.assign(plant_NCoef * Count, 0);
+	Ambient.assign(Count, 0);
+	State.assign(Count, 0);
+	StateFiltered.assign(Count, 0);
+	Effect.assign(Count, 0);
+
+	SetPoint.assign(Count, 0);
+	Enabled.assign(Count, 0);
+	LastProcessValue.assign(Count, 0);
+	IntegAcc.assign(Count, 0);
+	IntegSoftK.assign(Count, 0);
+	GainKp.assign(Count, 0);
+	GainKi.assign(Count, 0);
+	GainKd.assign(Count, 0);
+	IntegratorScale.assign(Count, 0);
+	ScalingFactor.assign(Count, 0);
+	PropMaxDiv.assign(Count, 0);
+	PropMinDiv.assign(Count, 0);
+	DiffMaxDiv.assign(Count, 0);
+	DiffMinDiv.assign(Count, 0);
+	PTerm.assign(Count, 0);
+	ITerm.assign(Count, 0);
+	DTerm.assign(Count, 0);
+	Output.assign(Count, 0);
+	Gains.resize(Count);
+
+	getDefaultPIDGains(&gains);
+	for (i = 0; i < Count; i++)
+		SetInstance(i, 25, 25, &gains);
+}
+
+
+//-------------------------------------------------------//
+// Resets single instance - same as initPlant(), processPlant(0), initPID(),
+// setPIDGains() and setPIDIntegratorLimit(0) at the start of runSimulation().
+//-------------------------------------------------------//
+void BatchEngine::SetInstance(unsigned index, double ambient, double state, const pid_gains_t *gains)
+{
+	plant_t plant;
+	pid_state_t pid;
+	unsigned k;
+
+	// Filter states are taken from a scalar plant, so the first step continues it exactly
+	initPlant(&plant, ambient, state);
+	processPlant(&plant, 0);
+	for (k = 0; k < eff_NCoef; k++)
+		EffZ[k * Count + index] = plant.eff_filter.GetState()[k];
+	for (k = 0; k < plant_NCoef; k++)
+		PlantZ[k * Count + index] = plant.plant_filter.GetState()[k];
+	Ambient[index] = ambient;
+	State[index] = plant.plantState;
+	StateFiltered[index] = plant.plantStateFiltered;
+	Effect[index] = 0;
+
+	Gains[index] = *gains;
+	GainKp[index] = gains->kp;
+	GainKi[index] = gains->ki;
+	GainKd[index] = gains->kd;
+	IntegratorScale[index] = gains->integrator_scale;
+	ScalingFactor[index] = gains->scaling_factor;
+	PropMaxDiv[index] = PROP_MAX / gains->kp;
+	PropMinDiv[index] = PROP_MIN / gains->kp;
+	DiffMaxDiv[index] = DIFF_MAX / gains->kd;
+	DiffMinDiv[index] = DIFF_MIN / gains->kd;
+
+	initPID(&pid);
+	setPIDGains(&pid, gains);
+	setPIDIntegratorLimit(&pid, 0);
+	LastProcessValue[index] = pid.lastProcessValue;
+	IntegAcc[index] = pid.integAcc;
+	IntegSoftK[index] = pid.integ_soft_k;
+	SetPoint[index] = 0;
+	Enabled[index] = 0;
+	PTerm[index] = ITerm[index] = DTerm[index] = Output[index] = 0;
+}
+
+
+//-------------------------------------------------------//
+// Changes temperature setting, Celsius, like a test vector record in runSimulation():
+// setting and integrator limit are updated only when heater is enabled
+//-------------------------------------------------------//
+void BatchEngine::SetSetting(unsigned index, int setting, bool enabled)
+{
+	pid_state_t pid;
+	float tempSetting;
+	float setPointF;
+
+	Enabled[index] = enabled ? PID_ENABLED : 0;
+	if (!enabled)
+		return;
+
+	tempSetting = (float)setting;
+	setPointF = (tempSetting + NORM_OFFSET) / NORM_K;
+	setPointF *= 4;
+	SetPoint[index] = (uint16_t)setPointF;
+
+	pid.gains = Gains[index];
+	setPIDIntegratorLimit(&pid, (int)tempSetting);
+	IntegSoftK[index] = pid.integ_soft_k;
+}
+
+
+//-------------------------------------------------------//
+// Returns PID controller state of an instance in scalar form
+//-------------------------------------------------------//
+void BatchEngine::GetPIDState(unsigned index, pid_state_t *pid)
+{
+	pid->gains = Gains[index];
+	pid->lastProcessValue = (uint16_t)LastProcessValue[index];
+	pid->integAcc = IntegAcc[index];
+	pid->integ_soft_k = (uint16_t)IntegSoftK[index];
+	pid->dbg_p_term = (int16_t)PTerm[index];
+	pid->dbg_d_term = (int16_t)DTerm[index];
+	pid->dbg_i_term = (int16_t)ITerm[index];
+	pid->dbg_output = (int16_t)Output[index];
+}
+
+
+//-------------------------------------------------------//
+// Advances all instances by a number of TIMESTEP steps
+// Blocks of instances are processed by parallel threads, every block
+// runs all steps at once to keep its data in cache.
+//	threads = 0 means all hardware threads
+//-------------------------------------------------------//
+void BatchEngine::Run(unsigned steps, unsigned threads)
+{
+	unsigned blocks = (Count + ENGINE_BLOCK_SIZE - 1) / ENGINE_BLOCK_SIZE;
+	unsigned long first_step = StepCounter;
+
+	parallelFor(blocks, threads, [&](unsigned block) {
+		unsigned begin = block * ENGINE_BLOCK_SIZE;
+		unsigned end = begin + ENGINE_BLOCK_SIZE;
+		if (end > Count)
+			end = Count;
+		RunBlock(begin, end, first_step, steps);
+	});
+	StepCounter += steps;
+}
+
+void BatchEngine::RunBlock(unsigned begin, unsigned end, unsigned long first_step, unsigned steps)
+{
+	unsigned long step;
+
+	for (step = first_step; step < first_step + steps; step++)
+	{
+		if (UseAVX2)
+			PlantStepAVX2(begin, end);
+		else
+			PlantStepScalar(begin, end);
+
+		if (step % PID_STEP_INTERVAL == 0)
+		{
+			if (UseAVX2)
+				PIDStepAVX2(begin, end);
+			else
+				PIDStepScalar(begin, end);
+		}
+	}
+}
+
+
+
+//=======================================================//
+// Scalar kernels
+//=======================================================//
+
+//-------------------------------------------------------//
+// processPlant() for instances [begin : end)
+// Filters are computed like IIRFilterTDF2::Process()
+//-------------------------------------------------------//
+void BatchEngine::PlantStepScalar(unsigned begin, unsigned end)
+{
+	const unsigned n = Count;
+	unsigned i, k;
+	double x, y, s;
+
+	for (i = begin; i < end; i++)
+	{
+		// Effect filter
+		x = Effect[i];
+		y = Model.eff_ACoef[0] * x + EffZ[i];
+		for (k = 0; k < eff_NCoef - 1; k++)
+			EffZ[k * n + i] = (Model.eff_ACoef[k + 1] * x - Model.eff_BCoef[k + 1] * y) + EffZ[(k + 1) * n + i];
+		EffZ[(eff_NCoef - 1) * n + i] = Model.eff_ACoef[eff_NCoef] * x - Model.eff_BCoef[eff_NCoef] * y;
+
+		// Simple 1st order model
+		s = State[i];
+		s += (Model.k_amb * (Ambient[i] - s) + Model.k_eff * y) * Model.timeConst;
+		State[i] = s;
+
+		// Plant output filter
+		y = Model.plant_ACoef[0] * s + PlantZ[i];
+		for (k = 0; k < plant_NCoef - 1; k++)
+			PlantZ[k * n + i] = (Model.plant_ACoef[k + 1] * s - Model.plant_BCoef[k + 1] * y) + PlantZ[(k + 1) * n + i];
+		PlantZ[(plant_NCoef - 1) * n + i] = Model.plant_ACoef[plant_NCoef] * s - Model.plant_BCoef[plant_NCoef] * y;
+		StateFiltered[i] = y;
+	}
+}
+
+
+//-------------------------------------------------------//
+// processPID() for instances [begin : end)
+// Uses the scalar controller itself, so results are exact by definition
+//-------------------------------------------------------//
+void BatchEngine::PIDStepScalar(unsigned begin, unsigned end)
+{
+	pid_state_t pid;
+	float processF;
+	unsigned i;
+
+	for (i = begin; i < end; i++)
+	{
+		processF = ((float)StateFiltered[i] + NORM_OFFSET) / NORM_K;
+		processF *= 4;
+
+		GetPIDState(i, &pid);
+		Effect[i] = processPID(&pid, (uint16_t)SetPoint[i], (uint16_t)processF, (uint8_t)Enabled[i]);
+		LastProcessValue[i] = pid.lastProcessValue;
+		IntegAcc[i] = pid.integAcc;
+		PTerm[i] = pid.dbg_p_term;
+		DTerm[i] = pid.dbg_d_term;
+		ITerm[i] = pid.dbg_i_term;
+		Output[i] = pid.dbg_output;
+	}
+}
+
+
+
+//=======================================================//
+// AVX2 kernels
+//=======================================================//
+
+#ifdef ENGINE_AVX2
+
+//-------------------------------------------------------//
+// processPlant() for instances [begin : end), 4 instances at once
+// Operations are done in the same order as scalar code, so results are the same
+//-------------------------------------------------------//
+AVX2_TARGET void BatchEngine::PlantStepAVX2(unsigned begin, unsigned end)
+{
+	const unsigned n = Count;
+	__m256d ea[eff_NCoef + 1], eb[eff_NCoef + 1];
+	__m256d pa[plant_NCoef + 1], pb[plant_NCoef + 1];
+	__m256d k_amb = _mm256_set1_pd(Model.k_amb);
+	__m256d k_eff = _mm256_set1_pd(Model.k_eff);
+	__m256d time_const = _mm256_set1_pd(Model.timeConst);
+	__m256d x, y, s;
+	unsigned i, k;
+
+	for (k = 0; k <= eff_NCoef; k++)
+	{
+		ea[k] = _mm256_set1_pd(Model.eff_ACoef[k]);
+		eb[k] = _mm256_set1_pd(Model.eff_BCoef[k]);
+	}
+	for (k = 0; k <= plant_NCoef; k++)
+	{
+		pa[k] = _mm256_set1_pd(Model.plant_ACoef[k]);
+		pb[k] = _mm256_set1_pd(Model.plant_BCoef[k]);
+	}
+
+	for (i = begin; i < end; i += 4)
+	{
+		// Effect filter
+		x = _mm256_loadu_pd(&Effect[i]);
+		y = _mm256_add_pd(_mm256_mul_pd(ea[0], x), _mm256_loadu_pd(&EffZ[i]));
+		for (k = 0; k < eff_NCoef - 1; k++)
+		{
+			_mm256_storeu_pd(&EffZ[k * n + i], _mm256_add_pd(
+				_mm256_sub_pd(_mm256_mul_pd(ea[k + 1], x), _mm256_mul_pd(eb[k + 1], y)),
+				_mm256_loadu_pd(&EffZ[(k + 1) * n + i])));
+		}
+		_mm256_storeu_pd(&EffZ[(eff_NCoef - 1) * n + i],
+			_mm256_sub_pd(_mm256_mul_pd(ea[eff_NCoef], x), _mm256_mul_pd(eb[eff_NCoef], y)));
+
+		// Simple 1st order model
+		s = _mm256_loadu_pd(&State[i]);
+		x = _mm256_add_pd(
+			_mm256_mul_pd(k_amb, _mm256_sub_pd(_mm256_loadu_pd(&Ambient[i]), s)),
+			_mm256_mul_pd(k_eff, y));
+		s = _mm256_add_pd(s, _mm256_mul_pd(x, time_const));
+		_mm256_storeu_pd(&State[i], s);
+
+		// Plant output filter
+		y = _mm256_add_pd(_mm256_mul_pd(pa[0], s), _mm256_loadu_pd(&PlantZ[i]));
+		for (k = 0; k < plant_NCoef - 1; k++)
+		{
+			_mm256_storeu_pd(&PlantZ[k * n + i], _mm256_add_pd(
+				_mm256_sub_pd(_mm256_mul_pd(pa[k + 1], s), _mm256_mul_pd(pb[k + 1], y)),
+				_mm256_loadu_pd(&PlantZ[(k + 1) * n + i])));
+		}
+		_mm256_storeu_pd(&PlantZ[(plant_NCoef - 1) * n + i],
+			_mm256_sub_pd(_mm256_mul_pd(pa[plant_NCoef], s), _mm256_mul_pd(pb[plant_NCoef], y)));
+		_mm256_storeu_pd(&StateFiltered[i], y);
+	}
+}
+
+
+// Truncates int32 lanes to int16 and sign-extends back, like assignment to int16_t
+AVX2_TARGET static inline __m256i toInt16(__m256i a)
+{
+	return _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+}
+
+// C integer division (truncation toward zero) of int32 lanes by positive int32 lanes.
+// Quotient of two 32-bit integers computed in double precision truncates to the exact result.
+AVX2_TARGET static inline __m256i divInt32(__m256i a, __m256i b)
+{
+	__m128i lo = _mm256_cvttpd_epi32(_mm256_div_pd(
+		_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(b))));
+	__m128i hi = _mm256_cvttpd_epi32(_mm256_div_pd(
+		_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1))));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+// Returns (a > limit) ? limit_value : ((a < low) ? low_value : value)
+AVX2_TARGET static inline __m256i limit2(__m256i a, __m256i high, __m256i high_value,
+	__m256i low, __m256i low_value, __m256i value)
+{
+	value = _mm256_blendv_epi8(value, low_value, _mm256_cmpgt_epi32(low, a));
+	return _mm256_blendv_epi8(value, high_value, _mm256_cmpgt_epi32(a, high));
+}
+
+
+//-------------------------------------------------------//
+// processPID() for instances [begin : end), 8 instances at once
+// 16-bit variables of scalar code are kept as sign-extended 32-bit lanes
+//-------------------------------------------------------//
+AVX2_TARGET void BatchEngine::PIDStepAVX2(unsigned begin, unsigned end)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i prop_max = _mm256_set1_epi32(PROP_MAX);
+	const __m256i prop_min = _mm256_set1_epi32(PROP_MIN);
+	const __m256i diff_max = _mm256_set1_epi32(DIFF_MAX);
+	const __m256i diff_min = _mm256_set1_epi32(DIFF_MIN);
+	const __m256i integ_max_const = _mm256_set1_epi32(INTEGRATOR_MAX);
+	const __m256i integ_min = _mm256_set1_epi32(INTEGRATOR_MIN);
+	const __m256i out_max = _mm256_set1_epi32(PID_OUTPUT_MAX);
+	const __m256i out_min = _mm256_set1_epi32(PID_OUTPUT_MIN);
+	const __m256i mask16 = _mm256_set1_epi32(0xFFFF);
+	const __m256 norm_offset = _mm256_set1_ps(NORM_OFFSET);
+	const __m256 norm_k = _mm256_set1_ps(NORM_K);
+	const __m256 four = _mm256_set1_ps(4.0f);
+	__m256 f;
+	__m256i pv, error, p_term, i_term, d_term, temp, acc, integ_max, soft_range, enabled;
+	unsigned i;
+
+	for (i = begin; i < end; i += 8)
+	{
+		// Process value
+		f = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(&StateFiltered[i]))),
+			_mm256_cvtpd_ps(_mm256_loadu_pd(&StateFiltered[i + 4])), 1);
+		f = _mm256_mul_ps(_mm256_div_ps(_mm256_add_ps(f, norm_offset), norm_k), four);
+		pv = _mm256_and_si256(_mm256_cvttps_epi32(f), mask16);
+
+		// Error
+		error = toInt16(_mm256_sub_epi32(_mm256_loadu_si256((__m256i *)&SetPoint[i]), pv));
+
+		// P term
+		p_term = toInt16(_mm256_mullo_epi32(error, _mm256_loadu_si256((__m256i *)&GainKp[i])));
+		soft_range = _mm256_loadu_si256((__m256i *)&PropMaxDiv[i]);
+		p_term = limit2(error, soft_range, prop_max,
+			_mm256_loadu_si256((__m256i *)&PropMinDiv[i]), prop_min, p_term);
+
+		// I term
+		acc = _mm256_add_epi32(_mm256_loadu_si256((__m256i *)&IntegAcc[i]),
+			_mm256_mullo_epi32(error, _mm256_loadu_si256((__m256i *)&GainKi[i])));
+		integ_max = _mm256_mullo_epi32(_mm256_sub_epi32(soft_range, error), _mm256_loadu_si256((__m256i *)&IntegSoftK[i]));
+		integ_max = limit2(error, soft_range, zero, zero, integ_max_const, integ_max);
+		acc = limit2(acc, integ_max, integ_max, integ_min, integ_min, acc);
+		_mm256_storeu_si256((__m256i *)&IntegAcc[i], acc);
+		i_term = toInt16(divInt32(acc, _mm256_loadu_si256((__m256i *)&IntegratorScale[i])));
+
+		// D term
+		d_term = toInt16(_mm256_sub_epi32(_mm256_loadu_si256((__m256i *)&LastProcessValue[i]), pv));
+		d_term = limit2(d_term, _mm256_loadu_si256((__m256i *)&DiffMaxDiv[i]), diff_max,
+			_mm256_loadu_si256((__m256i *)&DiffMinDiv[i]), diff_min,
+			toInt16(_mm256_mullo_epi32(d_term, _mm256_loadu_si256((__m256i *)&GainKd[i]))));
+		_mm256_storeu_si256((__m256i *)&LastProcessValue[i], pv);
+
+		// Sum terms
+		temp = _mm256_add_epi32(_mm256_add_epi32(p_term, i_term), d_term);
+		temp = toInt16(divInt32(temp, _mm256_loadu_si256((__m256i *)&ScalingFactor[i])));
+		enabled = _mm256_cmpgt_epi32(_mm256_loadu_si256((__m256i *)&Enabled[i]), zero);
+		temp = _mm256_and_si256(temp, enabled);
+		temp = limit2(temp, out_max, out_max, out_min, out_min, temp);
+
+		_mm256_storeu_si256((__m256i *)&PTerm[i], p_term);
+		_mm256_storeu_si256((__m256i *)&ITerm[i], i_term);
+		_mm256_storeu_si256((__m256i *)&DTerm[i], d_term);
+		_mm256_storeu_si256((__m256i *)&Output[i], temp);
+		_mm256_storeu_pd(&Effect[i], _mm256_cvtepi32_pd(_mm256_castsi256_si128(temp)));
+		_mm256_storeu_pd(&Effect[i + 4], _mm256_cvtepi32_pd(_mm256_extracti128_si256(temp, 1)));
+	}
+}
+
+#else
+
+void BatchEngine::PlantStepAVX2(unsigned begin, unsigned end)
+{
+	PlantStepScalar(begin, end);
+}
+
+void BatchEngine::PIDStepAVX2(unsigned begin, unsigned end)
+{
+	PIDStepScalar(begin, end);
+}
+
+#endif
+
+
+
+//=======================================================//
+// Engine test
+//=======================================================//
+
+#define ENGINE_TEST_SEGMENT		600			// Seconds between setting changes, the last segment may be shorter
+#define ENGINE_TEST_SAMPLES		16			// Instances checked by scalar reference
+
+// Deterministic test set: every instance has its own gains, ambient and settings
+static void getTestGains(unsigned index, pid_gains_t *gains)
+{
+	getDefaultPIDGains(gains);
+	gains->kp = (int16_t)(30 + index % 31);
+	gains->ki = (int16_t)(20 + (index / 31) % 31);
+	gains->kd = (int16_t)(200 + (index % 7) * 50);
+}
+
+static double getTestAmbient(unsigned index)
+{
+	return 20 + index % 10;
+}
+
+static void getTestSetting(unsigned index, unsigned segment, int *setting, bool *enabled)
+{
+	*setting = 60 + (int)((index * 7 + segment * 13) % 40) * 4;
+	*enabled = (segment % 4) != 3;
+}
+
+// Scalar closed loop, same sequence as runSimulation() in NORMAL mode
+typedef struct
+{
+	unsigned Index;
+	plant_t Plant;
+	pid_state_t PID;
+	float Effect;
+	float Setting;
+	bool Enabled;
+} EngineReference_t;
+
+static void initReference(EngineReference_t *ref, unsigned index)
+{
+	pid_gains_t gains;
+
+	getTestGains(index, &gains);
+	ref->Index = index;
+	initPlant(&ref->Plant, getTestAmbient(index), getTestAmbient(index));
+	processPlant(&ref->Plant, 0);
+	initPID(&ref->PID);
+	setPIDGains(&ref->PID, &gains);
+	setPIDIntegratorLimit(&ref->PID, 0);
+	ref->Effect = 0;
+	ref->Setting = 25.0f;
+	ref->Enabled = false;
+}
+
+static void runReference(EngineReference_t *ref, unsigned long first_step, unsigned steps)
+{
+	unsigned long step;
+	float processF;
+	float setPointF;
+
+	for (step = first_step; step < first_step + steps; step++)
+	{
+		processPlant(&ref->Plant, ref->Effect);
+		if (step % PID_STEP_INTERVAL == 0)
+		{
+			processF = ((float)getPlantState(&ref->Plant) + NORM_OFFSET) / NORM_K;
+			processF *= 4;
+			setPointF = (ref->Setting + NORM_OFFSET) / NORM_K;
+			setPointF *= 4;
+			ref->Effect = processPID(&ref->PID, (uint16_t)setPointF, (uint16_t)processF, ref->Enabled ? PID_ENABLED : 0);
+		}
+	}
+}
+
+
+//-------------------------------------------------------//
+// Simulates options->Instances closed loops with different gains and settings,
+// prints engine throughput in instance-steps per second
+// Returns 0 if verification passed (or was not requested)
+//-------------------------------------------------------//
+int runEngineTest(const EngineTestOptions_t *options)
+{
+	BatchEngine engine;
+	std::vector<EngineReference_t> refs;
+	pid_gains_t gains;
+	pid_state_t pid;
+	unsigned segments = (options->Seconds + ENGINE_TEST_SEGMENT - 1) / ENGINE_TEST_SEGMENT;
+	unsigned long total_steps = (unsigned long)options->Seconds * STEPS_PER_SECOND;
+	unsigned segment_steps;
+	unsigned i, s;
+	int setting;
+	bool enabled;
+	double wall_time = 0;
+	double max_deviation = 0;
+	unsigned long pid_mismatches = 0;
+
+	if (options->Instances == 0)
+	{
+		printf("Engine: number of instances must be > 0\n");
+		return -1;
+	}
+
+	engine.Init(options->Instances);
+	engine.SetAVX2(!options->Scalar);
+	for (i = 0; i < options->Instances; i++)
+	{
+		getTestGains(i, &gains);
+		engine.SetInstance(i, getTestAmbient(i), getTestAmbient(i), &gains);
+	}
+
+	if (options->Verify)
+	{
+		// plant_t holds pointers to its own filter samples, so references are initialized in place
+		refs.resize((options->Instances < ENGINE_TEST_SAMPLES) ? options->Instances : ENGINE_TEST_SAMPLES);
+		for (i = 0; i < refs.size(); i++)
+			initReference(&refs[i], (unsigned)((unsigned long long)options->Instances * i / refs.size()));
+	}
+
+	printf("Engine: %u instances, %u s, %s kernels, %u worker threads\n", options->Instances,
+		options->Seconds, engine.IsAVX2Used() ? "AVX2" : "scalar",
+		(options->Threads == 0) ? getDefaultThreadCount() : options->Threads);
+
+	for (s = 0; s < segments; s++)
+	{
+		segment_steps = ENGINE_TEST_SEGMENT * STEPS_PER_SECOND;
+		if ((unsigned long)s * segment_steps + segment_steps > total_steps)
+			segment_steps = (unsigned)(total_steps - (unsigned long)s * segment_steps);
+		for (i = 0; i < options->Instances; i++)
+		{
+			getTestSetting(i, s, &setting, &enabled);
+			engine.SetSetting(i, setting, enabled);
+		}
+
+		std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+		engine.Run(segment_steps, options->Threads);
+		wall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		for (i = 0; i < refs.size(); i++)
+		{
+			getTestSetting(refs[i].Index, s, &setting, &enabled);
+			refs[i].Enabled = enabled;
+			if (enabled)
+			{
+				refs[i].Setting = (float)setting;
+				setPIDIntegratorLimit(&refs[i].PID, (int)refs[i].Setting);
+			}
+			runReference(&refs[i], (unsigned long)s * ENGINE_TEST_SEGMENT * STEPS_PER_SECOND, segment_steps);
+
+			if (fabs(engine.GetPlantState(refs[i].Index) - getPlantState(&refs[i].Plant)) > max_deviation)
+				max_deviation = fabs(engine.GetPlantState(refs[i].Index) - getPlantState(&refs[i].Plant));
+			engine.GetPIDState(refs[i].Index, &pid);
+			if ((pid.integAcc != refs[i].PID.integAcc) || (pid.lastProcessValue != refs[i].PID.lastProcessValue) ||
+				(pid.dbg_p_term != refs[i].PID.dbg_p_term) || (pid.dbg_i_term != refs[i].PID.dbg_i_term) ||
+				(pid.dbg_d_term != refs[i].PID.dbg_d_term) || (pid.dbg_output != refs[i].PID.dbg_output))
+				pid_mismatches++;
+		}
+	}
+
+	printf("Engine done: %.3f s wall, %.1f M instance-steps/s\n", wall_time,
+		(double)options->Instances * total_steps / wall_time / 1e6);
+
+	if (options->Verify)
+	{
+		printf("Verify: %u instances, plant max deviation %g C, PID mismatches %lu\n",
+			(unsigned)refs.size(), max_deviation, pid_mismatches);
+		if ((max_deviation > ENGINE_PLANT_TOLERANCE) || (pid_mismatches != 0))
+		{
+			printf("Verify FAILED\n");
+			return 1;
+		}
+		printf("Verify OK\n");
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+
+#ifndef BATCH_ENGINE_H_
+#define BATCH_ENGINE_H_
+
+#include <vector>
+#include "stdint.h"
+#include "plant.h"
+#include "simulation.h"
+extern "C" {
+	#include "pid_controller.h"
+}
+
+
+#define ENGINE_BLOCK_SIZE		256			// Instances processed together by one thread, multiple of 8
+#define ENGINE_PLANT_TOLERANCE	1e-9		// Celsius, allowed plant deviation from processPlant()
+
+
+// Closed loop (plant + PID controller) engine for many independent instances.
+// Instance data is kept as structure of arrays, all instances advance in lockstep.
+// Plant math is the same as processPlant() and PID math is the same as processPID(),
+// including integer overflow behaviour, so every instance follows runSimulation() in NORMAL mode:
+//		every step - plant is processed with current effect,
+//		every PID_STEP_INTERVAL steps (starting with the first one) - PID computes new effect.
+// AVX2 is used when the host CPU supports it, scalar code otherwise.
+class BatchEngine
+{
+public:
+	BatchEngine();
+	void Init(unsigned count);
+	void SetInstance(unsigned index, double ambient, double state, const pid_gains_t *gains);
+	void SetSetting(unsigned index, int setting, bool enabled);
+	void Run(unsigned steps, unsigned threads);
+	unsigned GetCount(void) { return Count; }
+	unsigned long GetStepCounter(void) { return StepCounter; }
+	double GetPlantState(unsigned index) { return StateFiltered[index]; }
+	void GetPIDState(unsigned index, pid_state_t *pid);
+	void SetAVX2(bool enable);
+	bool IsAVX2Used(void) { return UseAVX2; }
+	static bool IsAVX2Supported(void);
+private:
+	void RunBlock(unsigned begin, unsigned end, unsigned long first_step, unsigned steps);
+	void PlantStepScalar(unsigned begin, unsigned end);
+	void PIDStepScalar(unsigned begin, unsigned end);
+	void PlantStepAVX2(unsigned begin, unsigned end);
+	void PIDStepAVX2(unsigned begin, unsigned end);
+	bool UseAVX2;
+	unsigned Count;					// Instances, rounded up to a multiple of 8
+	unsigned long StepCounter;
+	plant_model_t Model;
+	// Plant, transposed direct form II filter states: [k * Count + index]
+	std::vector<double> EffZ;
+	std::vector<double> PlantZ;
+	std::vector<double> Ambient;
+	std::vector<double> State;
+	std::vector<double> StateFiltered;
+	std::vector<double> Effect;
+	// PID controller
+	std::vector<int32_t> SetPoint;
+	std::vector<int32_t> Enabled;			// PID_ENABLED mode bit
+	std::vector<int32_t> LastProcessValue;
+	std::vector<int32_t> IntegAcc;
+	std::vector<int32_t> IntegSoftK;
+	std::vector<int32_t> GainKp, GainKi, GainKd, IntegratorScale, ScalingFactor;
+	std::vector<int32_t> PropMaxDiv, PropMinDiv;	// PROP_MAX / kp, PROP_MIN / kp, also INTEGRATOR_SOFT_RANGE
+	std::vector<int32_t> DiffMaxDiv, DiffMinDiv;	// DIFF_MAX / kd, DIFF_MIN / kd
+	std::vector<int32_t> PTerm, ITerm, DTerm, Output;
+	std::vector<pid_gains_t> Gains;
+};
+
+
+// Engine self-test and throughput measurement: RSim -engine <instances>
+typedef struct
+{
+	unsigned Instances;
+	unsigned Seconds;				// Simulated time
+	unsigned Threads;				// 0 - all hardware threads
+	bool Scalar;					// Do not use AVX2 kernels
+	bool Verify;					// Compare sampled instances against processPlant() / processPID()
+} EngineTestOptions_t;
+
+int runEngineTest(const EngineTestOptions_t *options);
+
+
+#endif /* BATCH_ENGINE_H_ */
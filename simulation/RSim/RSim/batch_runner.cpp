@@ -0,0 +1,178 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "batch_runner.h"
+#include "worker_pool.h"
+
+
+/*
+	Batch manifest file format - one job per line:
+
+		<test vector file>  <PLANT_STEP | NORMAL>  <output directory>
+
+	Words are separated by spaces or tabs. Words containing spaces must be quoted.
+	Empty lines and lines starting with '#' are ignored.
+	Relative paths are relative to the working directory, like with a single -input run.
+	Example:
+
+		# Nightly regression
+		"Test vector 1.txt"			NORMAL		output/tv1/
+		"Step 1.txt"				PLANT_STEP	outstep/
+*/
+
+
+//-------------------------------------------------------//
+// Splits manifest line into words
+// Double quotes group words containing spaces
+//-------------------------------------------------------//
+std::vector<std::string> splitManifestLine(const char *line)
+{
+	std::vector<std::string> words;
+	std::string word;
+	bool in_word = false;
+	bool quoted = false;
+	char c;
+
+	while ((c = *line++))
+	{
+		if (c == '"')
+		{
+			quoted = !quoted;
+			in_word = true;			// "" is an empty word
+		}
+		else if (!quoted && (c == ' ' || c == '\t' || c == '\r' || c == '\n'))
+		{
+			if (in_word)
+				words.push_back(word);
+			word.clear();
+			in_word = false;
+		}
+		else
+		{
+			word += c;
+			in_word = true;
+		}
+	}
+	if (in_word)
+		words.push_back(word);
+	return words;
+}
+
+
+//-------------------------------------------------------//
+// Reads batch manifest
+// Fields not present in manifest are copied from defaults
+// Returns false if file cannot be read or contains errors
+//-------------------------------------------------------//
+bool readBatchManifest(const char *fileName, const SimJob_t *defaults, std::vector<SimJob_t> &jobs)
+{
+	std::ifstream in_stream(fileName);
+	std::string line;
+	std::vector<std::string> words;
+	SimJob_t job = *defaults;
+	unsigned line_number = 0;
+	bool result = true;
+
+	if (!in_stream.is_open())
+	{
+		printf("Cannot open batch manifest %s\n", fileName);
+		return false;
+	}
+
+	while (std::getline(in_stream, line))
+	{
+		line_number++;
+		words = splitManifestLine(line.c_str());
+		if ((words.size() == 0) || (words[0][0] == '#'))
+			continue;
+		if (words.size() != 3)
+		{
+			printf("Manifest line %u: expected <vector file> <mode> <output dir>\n", line_number);
+			result = false;
+			continue;
+		}
+		job.InputFile = words[0];
+		job.Mode = parseSimulationMode(words[1].c_str());
+		job.OutputDir = words[2];
+		job.Verbose = false;
+		if (job.Mode < 0)
+		{
+			printf("Manifest line %u: unknown simulation mode %s\n", line_number, words[1].c_str());
+			result = false;
+			continue;
+		}
+		jobs.push_back(job);
+	}
+	return result;
+}
+
+
+//-------------------------------------------------------//
+// Runs all jobs from the manifest using a pool of worker threads
+//	threads = 0 means all hardware threads
+//	defaults - log format and channels for all jobs
+// Prints a summary line for every finished job
+// Returns number of failed jobs, or -1 if manifest is incorrect
+//-------------------------------------------------------//
+int runBatch(const char *manifestFileName, unsigned threads, const SimJob_t *defaults)
+{
+	std::vector<SimJob_t> jobs;
+	std::vector<SimResult_t> results;
+	std::mutex print_lock;
+	unsigned jobs_done = 0;
+	unsigned long simulated_total = 0;
+	int failed = 0;
+	unsigned i;
+
+	if (!readBatchManifest(manifestFileName, defaults, jobs))
+		return -1;
+	if (threads == 0)
+		threads = getDefaultThreadCount();
+	results.resize(jobs.size());
+
+	printf("Batch: %u jobs, %u worker threads\n", (unsigned)jobs.size(), threads);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	parallelFor((unsigned)jobs.size(), threads, [&](unsigned index) {
+		SimResult_t *res = &results[index];
+		runSimulation(&jobs[index], res);
+
+		std::lock_guard<std::mutex> guard(print_lock);
+		jobs_done++;
+		if (res->Success)
+		{
+			printf("[%4u/%u] OK    %-10s %8lu s simulated %9.3f s wall %12.0f sim-s/s  %s\n",
+				jobs_done, (unsigned)jobs.size(), getSimulationModeName(jobs[index].Mode),
+				res->SimulatedSeconds, res->WallSeconds,
+				(res->WallSeconds > 0) ? res->SimulatedSeconds / res->WallSeconds : 0.0,
+				jobs[index].InputFile.c_str());
+		}
+		else
+		{
+			printf("[%4u/%u] FAIL  %-10s %s: %s\n",
+				jobs_done, (unsigned)jobs.size(), getSimulationModeName(jobs[index].Mode),
+				jobs[index].InputFile.c_str(), res->Message.c_str());
+		}
+		fflush(stdout);
+	});
+
+	double wall_total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	for (i = 0; i < results.size(); i++)
+	{
+		if (results[i].Success)
+			simulated_total += results[i].SimulatedSeconds;
+		else
+			failed++;
+	}
+	printf("Batch done: %u jobs, %d failed, %lu s simulated in %.3f s wall (%.0f sim-s/s)\n",
+		(unsigned)jobs.size(), failed, simulated_total, wall_total,
+		(wall_total > 0) ? simulated_total / wall_total : 0.0);
+
+	return failed;
+}
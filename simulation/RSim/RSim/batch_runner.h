@@ -0,0 +1,15 @@
+
+#ifndef BATCH_RUNNER_H_
+#define BATCH_RUNNER_H_
+
+#include <string>
+#include <vector>
+#include "sim_runner.h"
+
+
+bool readBatchManifest(const char *fileName, const SimJob_t *defaults, std::vector<SimJob_t> &jobs);
+std::vector<std::string> splitManifestLine(const char *line);
+int runBatch(const char *manifestFileName, unsigned threads, const SimJob_t *defaults);
+
+
+#endif /* BATCH_RUNNER_H_ */
@@ -0,0 +1,387 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "filter_bench.h"
+#include "plant_filters.h"
+#include "adc_filter.h"
+#include "iir_filter.h"
+#include "plant_jump.h"
+#include "adc_chain.h"
+#include "simulation.h"
+#include "stdint.h"
+extern "C" {
+	#include "fir_filter.h"
+}
+
+
+// Deterministic pseudo-random sequence
+static uint32_t nextRandom(uint32_t *seed)
+{
+	*seed = *seed * 1664525UL + 1013904223UL;
+	return *seed >> 8;
+}
+
+static double getSeconds(std::chrono::steady_clock::time_point start_time)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+static void printResult(const char *name, unsigned samples, double old_time, double new_time, const char *check)
+{
+	printf("%-24s %10.2f %10.2f %8.2fx   %s\n", name, old_time * 1e9 / samples, new_time * 1e9 / samples,
+		old_time / new_time, check);
+}
+
+
+//-------------------------------------------------------//
+// Compares iir_double() with IIRFilterTDF2 for one coefficient set
+// Returns max absolute output difference
+//-------------------------------------------------------//
+template <class Filter, unsigned NCoef>
+static double benchIIR(const char *name, const double (&a)[NCoef + 1], const double (&b)[NCoef + 1],
+	const std::vector<double> &input, double init_value)
+{
+	double a_copy[NCoef + 1], b_copy[NCoef + 1];
+	double x[NCoef + 1], y[NCoef + 1];
+	iir_double_core_t core;
+	Filter filter;
+	std::vector<double> out_old(input.size()), out_new(input.size());
+	double max_diff = 0;
+	char check[64];
+	size_t i;
+
+	for (i = 0; i <= NCoef; i++)
+	{
+		a_copy[i] = a[i];
+		b_copy[i] = b[i];
+	}
+	core.NCoef = NCoef;
+	core.ACoef_p = a_copy;
+	core.BCoef_p = b_copy;
+	core.x_p = x;
+	core.y_p = y;
+	iir_double_init(init_value, &core);
+	filter.Init(init_value);
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < input.size(); i++)
+		out_old[i] = iir_double(input[i], &core);
+	double old_time = getSeconds(start_time);
+
+	start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < input.size(); i++)
+		out_new[i] = filter.Process(input[i]);
+	double new_time = getSeconds(start_time);
+
+	for (i = 0; i < input.size(); i++)
+	{
+		if (fabs(out_old[i] - out_new[i]) > max_diff)
+			max_diff = fabs(out_old[i] - out_new[i]);
+	}
+	sprintf(check, "max diff %.3g", max_diff);
+	printResult(name, (unsigned)input.size(), old_time, new_time, check);
+	return max_diff;
+}
+
+
+//-------------------------------------------------------//
+// Compares fir_i16_i8() with FIRFilter on the firmware ADC filter
+// Returns number of different output samples
+//-------------------------------------------------------//
+static unsigned benchFIR(const std::vector<int16_t> &input)
+{
+	int8_t coeffs[ADC_FIR_N];
+	int16_t samples[ADC_FIR_N] = {0};
+	filter8bit_core_t core;
+	AdcFilter_t filter;
+	std::vector<int16_t> out_old(input.size()), out_new(input.size());
+	unsigned mismatches = 0;
+	char name[32], check[64];
+	size_t i;
+
+	for (i = 0; i < ADC_FIR_N; i++)
+		coeffs[i] = adc_fir_coeffs[i];
+	core.n = ADC_FIR_N;
+	core.dc_gain = ADC_FIR_DC_GAIN;
+	core.coeffs = coeffs;
+	filter.Init(0);
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < input.size(); i++)
+		out_old[i] = fir_i16_i8(input[i], samples, &core);
+	double old_time = getSeconds(start_time);
+
+	start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < input.size(); i++)
+		out_new[i] = filter.Process(input[i]);
+	double new_time = getSeconds(start_time);
+
+	for (i = 0; i < input.size(); i++)
+	{
+		if (out_old[i] != out_new[i])
+			mismatches++;
+	}
+	sprintf(name, "adc FIR (%u taps)", ADC_FIR_N);
+	sprintf(check, "%u mismatches", mismatches);
+	printResult(name, (unsigned)input.size(), old_time, new_time, check);
+	return mismatches;
+}
+
+
+//-------------------------------------------------------//
+// Measures template filters against iir_double() and fir_i16_i8()
+// on coefficient sets of plant_filters.h and the firmware ADC filter
+// Returns 0 if template filters give the same results
+//-------------------------------------------------------//
+int runFilterBenchmark(unsigned samples)
+{
+	std::vector<double> plant_input(samples), effect_input(samples);
+	std::vector<int16_t> adc_input(samples);
+	uint32_t seed = 12345;
+	double plant_diff, effect_diff;
+	unsigned fir_mismatches;
+	unsigned i;
+
+	// Plant input - slow steps with noise, Celsius; effect - heater output 0 to 100;
+	// ADC - oversampled values of 20 to 250 Celsius with noise
+	for (i = 0; i < samples; i++)
+	{
+		plant_input[i] = 25 + ((i / 20000) % 8) * 25 + (nextRandom(&seed) % 1000) * 0.001;
+		effect_input[i] = (double)(((i / 400) % 5 == 0) ? 0 : nextRandom(&seed) % 101);
+		adc_input[i] = (int16_t)(3200 + ((i / 5000) % 16) * 400 + nextRandom(&seed) % 128);
+	}
+
+	printf("Filter benchmark: %u samples, time per sample in ns\n", samples);
+	printf("%-24s %10s %10s %9s\n", "filter", "old", "template", "speedup");
+	plant_diff = benchIIR<PlantFilter_t, plant_NCoef>("plant IIR (order 4)", plant_ACoef, plant_BCoef, plant_input, 25);
+	effect_diff = benchIIR<EffectFilter_t, eff_NCoef>("effect IIR (order 3)", eff_ACoef, eff_BCoef, effect_input, 0);
+	fir_mismatches = benchFIR(adc_input);
+
+	// Direct form I and transposed direct form II round differently
+	if ((plant_diff > FILTER_BENCH_TOLERANCE) || (effect_diff > FILTER_BENCH_TOLERANCE) || (fir_mismatches != 0))
+	{
+		printf("Filter check FAILED\n");
+		return 1;
+	}
+	printf("Filter check OK\n");
+	return 0;
+}
+
+
+//-------------------------------------------------------//
+// Compares PlantJump with stepwise processPlant():
+// effect changes every interval_steps, plant state is checked at every change
+// Returns max absolute plant state difference
+//-------------------------------------------------------//
+static double benchPlantJump(const char *name, unsigned events, unsigned interval_steps)
+{
+	std::vector<double> effect(events);
+	std::vector<double> out_step(events), out_jump(events);
+	plant_t plant;
+	PlantJump jump;
+	uint32_t seed = 54321;
+	double max_diff = 0;
+	char check[64];
+	unsigned i, k;
+
+	// Heater is ON for a while, then OFF to cool down
+	for (i = 0; i < events; i++)
+		effect[i] = ((i / 500) % 3 == 2) ? 0 : (double)(nextRandom(&seed) % 101);
+
+	initPlant(&plant, 25, 25);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < events; i++)
+	{
+		for (k = 0; k < interval_steps; k++)
+			processPlant(&plant, effect[i]);
+		out_step[i] = getPlantState(&plant);
+	}
+	double step_time = getSeconds(start_time);
+
+	initPlant(&plant, 25, 25);
+	start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < events; i++)
+	{
+		jump.Advance(&plant, effect[i], interval_steps);
+		out_jump[i] = getPlantState(&plant);
+	}
+	double jump_time = getSeconds(start_time);
+
+	for (i = 0; i < events; i++)
+	{
+		if (fabs(out_step[i] - out_jump[i]) > max_diff)
+			max_diff = fabs(out_step[i] - out_jump[i]);
+	}
+	sprintf(check, "max diff %.3g C", max_diff);
+	printResult(name, events, step_time, jump_time, check);
+	return max_diff;
+}
+
+
+//-------------------------------------------------------//
+// Measures PlantJump against stepwise processPlant()
+// for PID call interval and for long open-loop intervals
+// Returns 0 if trajectories match
+//-------------------------------------------------------//
+int runPlantJumpBenchmark(unsigned seconds)
+{
+	double pid_diff, long_diff;
+
+	printf("\nPlant jump-ahead: %u s, time per interval in ns\n", seconds);
+	printf("%-24s %10s %10s %9s\n", "interval", "stepwise", "jump", "speedup");
+	pid_diff = benchPlantJump("PID call (4 s)", seconds / PID_CALL_INTERVAL, PID_STEP_INTERVAL);
+	long_diff = benchPlantJump("open loop (60 s)", seconds / 60, 60 * STEPS_PER_SECOND);
+
+	// Both ways round differently, difference accumulates over the run
+	if ((pid_diff > PLANT_JUMP_TOLERANCE) || (long_diff > PLANT_JUMP_TOLERANCE))
+	{
+		printf("Plant jump check FAILED\n");
+		return 1;
+	}
+	printf("Plant jump check OK\n");
+	return 0;
+}
+
+
+//-------------------------------------------------------//
+// Firmware ADC chain as it runs on the device: every conversion goes to
+// the ISR CIC decimator, every main loop update scales its output and runs fir_i16_i8().
+// Noise and quantization are taken from the AdcChain model.
+//-------------------------------------------------------//
+class AdcChainReference
+{
+public:
+	AdcChainReference(const AdcChain *model, double celsius)
+	{
+		unsigned i;
+		Model = model;
+		for (i = 0; i < ADC_FIR_N; i++)
+			Coeffs[i] = adc_fir_coeffs[i];
+		Core.n = ADC_FIR_N;
+		Core.dc_gain = ADC_FIR_DC_GAIN;
+		Core.coeffs = Coeffs;
+		memset(Samples, 0, sizeof(Samples));
+		Integrator1 = Integrator2 = Comb1Delay = Comb2Delay = Output = 0;
+		Counter = ADC_DECIMATION;
+		Conversion = 0;
+		for (i = 0; i < ADC_CHAIN_STEPS; i++)
+			Step(celsius);
+	}
+	void Step(double celsius)
+	{
+		uint32_t comb1, gain = (uint32_t)ADC_DECIMATION * ADC_DECIMATION;
+		uint16_t oversampled;
+		unsigned i, k;
+		for (k = 0; k < ADC_UPDATES_PER_STEP; k++)
+		{
+			// ADC ISR
+			for (i = 0; i < ADC_DECIMATION; i++)
+			{
+				Integrator1 += Model->Sample(celsius, Model->GetNoise(Conversion++));
+				Integrator2 += Integrator1;
+				if (--Counter == 0)
+				{
+					Counter = ADC_DECIMATION;
+					comb1 = Integrator2 - Comb1Delay;
+					Comb1Delay = Integrator2;
+					Output = comb1 - Comb2Delay;
+					Comb2Delay = comb1;
+				}
+			}
+			// update_normalized_adc()
+			oversampled = (uint16_t)(((Output << 4) + (gain >> 1)) / gain);
+			Normalized = oversampled >> 4;
+			Filtered = fir_i16_i8(oversampled, Samples, &Core);
+			Status = 0;
+			if (Normalized < ADC_LOW_CORRECT)
+				Status |= ADC_SENSOR_NO_PRESENT;
+			else if (Normalized > ADC_HIGH_CORRECT)
+				Status |= ADC_SENSOR_SHORTED;
+		}
+	}
+	uint16_t Filtered;
+	uint16_t Normalized;
+	uint8_t Status;
+private:
+	const AdcChain *Model;
+	int8_t Coeffs[ADC_FIR_N];
+	filter8bit_core_t Core;
+	int16_t Samples[ADC_FIR_N];
+	uint32_t Integrator1, Integrator2;
+	uint32_t Comb1Delay, Comb2Delay;
+	uint32_t Output;
+	unsigned Counter;
+	uint64_t Conversion;
+};
+
+
+//-------------------------------------------------------//
+// Compares AdcChain with per-conversion firmware emulation.
+// Sensor temperature covers the working range, sensor faults and ADC limits.
+// Values are checked at every step, timing is for reads at PID calls only.
+// Returns 0 if all values are the same
+//-------------------------------------------------------//
+int runAdcChainBenchmark(unsigned seconds)
+{
+	unsigned steps = seconds * STEPS_PER_SECOND;
+	std::vector<double> celsius(steps);
+	std::vector<uint16_t> out_filtered(steps);
+	AdcChain chain;
+	uint32_t seed = 777;
+	unsigned mismatches = 0;
+	char check[64];
+	unsigned i;
+
+	for (i = 0; i < steps; i++)
+		celsius[i] = -60.0 + (double)((i / 600) % 12) * 45.0 + (nextRandom(&seed) % 1000) * 0.01;
+	chain.Init(celsius[0], 0.5, 2024);
+
+	// Check - every step
+	AdcChainReference check_ref(&chain, celsius[0]);
+	for (i = 0; i < steps; i++)
+	{
+		check_ref.Step(celsius[i]);
+		chain.Step(celsius[i]);
+		if ((chain.GetFiltered() != check_ref.Filtered) || (chain.GetNormalized() != check_ref.Normalized) ||
+			(chain.GetStatus() != check_ref.Status))
+			mismatches++;
+	}
+
+	// Timing - both ways are read at PID calls
+	AdcChainReference ref(&chain, celsius[0]);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < steps; i++)
+	{
+		ref.Step(celsius[i]);
+		if (i % PID_STEP_INTERVAL == 0)
+			out_filtered[i] = ref.Filtered;
+	}
+	double ref_time = getSeconds(start_time);
+
+	chain.Init(celsius[0], 0.5, 2024);
+	start_time = std::chrono::steady_clock::now();
+	for (i = 0; i < steps; i++)
+	{
+		chain.Step(celsius[i]);
+		if ((i % PID_STEP_INTERVAL == 0) && (chain.GetFiltered() != out_filtered[i]))
+			mismatches++;
+	}
+	double chain_time = getSeconds(start_time);
+
+	printf("\nADC chain emulation: %u s, time per step in ns\n", seconds);
+	printf("%-24s %10s %10s %9s\n", "chain", "firmware", "lazy", "speedup");
+	sprintf(check, "%u mismatches", mismatches);
+	printResult("ADC chain, noise 0.5 C", steps, ref_time, chain_time, check);
+
+	if (mismatches != 0)
+	{
+		printf("ADC chain check FAILED\n");
+		return 1;
+	}
+	printf("ADC chain check OK\n");
+	return 0;
+}
@@ -0,0 +1,13 @@
+
+#ifndef FILTER_BENCH_H_
+#define FILTER_BENCH_H_
+
+#define FILTER_BENCH_TOLERANCE	1e-4		// Allowed IIR output difference, filter output units
+#define PLANT_JUMP_TOLERANCE	1e-4		// Allowed plant state difference, Celsius
+
+int runFilterBenchmark(unsigned samples);
+int runPlantJumpBenchmark(unsigned seconds);
+int runAdcChainBenchmark(unsigned seconds);
+
+
+#endif /* FILTER_BENCH_H_ */
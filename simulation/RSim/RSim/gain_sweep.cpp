@@ -0,0 +1,257 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "gain_sweep.h"
+#include "sim_runner.h"
+#include "trace_file.h"
+#include "worker_pool.h"
+
+
+typedef struct
+{
+	pid_gains_t Gains;
+	SimResult_t Result;
+} SweepPoint_t;
+
+
+//-------------------------------------------------------//
+// Sets every range to the compile-time gain
+//-------------------------------------------------------//
+void initSweepOptions(SweepOptions_t *options)
+{
+	pid_gains_t gains;
+	getDefaultPIDGains(&gains);
+
+	options->InputFile.clear();
+	options->OutputFile.clear();
+	options->KpRange.Min = options->KpRange.Max = gains.kp;
+	options->KiRange.Min = options->KiRange.Max = gains.ki;
+	options->KdRange.Min = options->KdRange.Max = gains.kd;
+	options->IntegratorScaleRange.Min = options->IntegratorScaleRange.Max = gains.integrator_scale;
+	options->ScalingFactorRange.Min = options->ScalingFactorRange.Max = gains.scaling_factor;
+	options->SoftSlopeRange.Min = options->SoftSlopeRange.Max = gains.integ_soft_slope;
+	options->KpRange.Step = options->KiRange.Step = options->KdRange.Step = 1;
+	options->IntegratorScaleRange.Step = options->ScalingFactorRange.Step = options->SoftSlopeRange.Step = 1;
+	options->RankBy = RANK_IAE;
+	options->Threads = 0;
+	options->ShowBest = 10;
+}
+
+
+//-------------------------------------------------------//
+// Parses gain range: "<min>:<max>:<step>", "<min>:<max>" (step 1) or "<value>"
+//-------------------------------------------------------//
+bool parseGainRange(const char *range_str, GainRange_t *range)
+{
+	int n = sscanf(range_str, "%d:%d:%d", &range->Min, &range->Max, &range->Step);
+	if (n < 1)
+		return false;
+	if (n < 2)
+		range->Max = range->Min;
+	if (n < 3)
+		range->Step = 1;
+	return (range->Step > 0) && (range->Max >= range->Min);
+}
+
+//-------------------------------------------------------//
+// Converts rank name to SweepRank
+// Returns -1 if name is unknown
+//-------------------------------------------------------//
+int parseSweepRank(const char *rank_str)
+{
+	if (strcmp(rank_str, "iae") == 0)
+		return RANK_IAE;
+	if (strcmp(rank_str, "overshoot") == 0)
+		return RANK_OVERSHOOT;
+	if (strcmp(rank_str, "settling") == 0)
+		return RANK_SETTLING;
+	if (strcmp(rank_str, "rise") == 0)
+		return RANK_RISE;
+	if (strcmp(rank_str, "duty") == 0)
+		return RANK_DUTY;
+	return -1;
+}
+
+
+//-------------------------------------------------------//
+// Helpers
+//-------------------------------------------------------//
+
+static void addRangeValues(const GainRange_t *range, std::vector<int> &values)
+{
+	int value;
+	for (value = range->Min; value <= range->Max; value += range->Step)
+		values.push_back(value);
+}
+
+static bool checkRange(const GainRange_t *range, int min, int max, const char *name)
+{
+	if ((range->Min < min) || (range->Max > max))
+	{
+		printf("Sweep: %s must be in range [%d : %d]\n", name, min, max);
+		return false;
+	}
+	return true;
+}
+
+// Returns rank value of a point, smaller is better
+// Time metrics that have not been reached are worse than any number
+static double getRankValue(const SweepPoint_t *point, int rank_by)
+{
+	const ResponseMetrics_t *m = &point->Result.Metrics;
+	if (!point->Result.Success)
+		return 1e300;
+	switch (rank_by)
+	{
+		case RANK_OVERSHOOT:	return m->Overshoot;
+		case RANK_SETTLING:		return (m->SettlingTime < 0) ? 1e299 : m->SettlingTime;
+		case RANK_RISE:			return (m->RiseTime < 0) ? 1e299 : m->RiseTime;
+		case RANK_DUTY:			return m->Duty;
+		default:				return m->IAE;
+	}
+}
+
+static void printTimeMetric(FILE *f, double value)
+{
+	if (value < 0)
+		fprintf(f, "%10s", "-");
+	else
+		fprintf(f, "%10.1f", value);
+}
+
+static void printTableHeader(FILE *f)
+{
+	fprintf(f, "#%5s %5s %5s %5s %6s %6s %6s %10s %10s %10s %12s %7s\n",
+		"rank", "Kp", "Ki", "Kd", "iscale", "scale", "islope",
+		"rise,s", "overs.,C", "settl.,s", "IAE,C*s", "duty,%");
+}
+
+static void printTableLine(FILE *f, unsigned rank, const SweepPoint_t *point)
+{
+	const pid_gains_t *g = &point->Gains;
+	const ResponseMetrics_t *m = &point->Result.Metrics;
+
+	fprintf(f, "%6u %5d %5d %5d %6d %6d %6d ", rank, g->kp, g->ki, g->kd,
+		g->integrator_scale, g->scaling_factor, g->integ_soft_slope);
+	if (!point->Result.Success)
+	{
+		fprintf(f, " %s\n", point->Result.Message.c_str());
+		return;
+	}
+	printTimeMetric(f, m->RiseTime);
+	fprintf(f, " %10.2f ", m->Overshoot);
+	printTimeMetric(f, m->SettlingTime);
+	fprintf(f, " %12.1f %7.1f\n", m->IAE, m->Duty);
+}
+
+
+//-------------------------------------------------------//
+// Simulates closed loop for every combination of gains using all cores
+// and prints points ranked by options->RankBy
+// Returns 0 if all points have been simulated
+//-------------------------------------------------------//
+int runGainSweep(const SweepOptions_t *options)
+{
+	std::vector<int> kp, ki, kd, iscale, scale, islope;
+	std::vector<SweepPoint_t> points;
+	std::vector<unsigned> order;
+	SweepPoint_t point;
+	SimJob_t job;
+	unsigned threads;
+	unsigned i;
+	int failed = 0;
+	size_t a, b, c, d, e, f;
+	FILE *out;
+
+	if (!checkRange(&options->KpRange, 1, INT16_MAX, "Kp") ||
+		!checkRange(&options->KiRange, 0, INT16_MAX, "Ki") ||
+		!checkRange(&options->KdRange, 1, INT16_MAX, "Kd") ||
+		!checkRange(&options->IntegratorScaleRange, 1, INT16_MAX, "integrator scale") ||
+		!checkRange(&options->ScalingFactorRange, 1, INT16_MAX, "scaling factor") ||
+		!checkRange(&options->SoftSlopeRange, 0, UINT8_MAX, "soft limit slope"))
+		return -1;
+
+	addRangeValues(&options->KpRange, kp);
+	addRangeValues(&options->KiRange, ki);
+	addRangeValues(&options->KdRange, kd);
+	addRangeValues(&options->IntegratorScaleRange, iscale);
+	addRangeValues(&options->ScalingFactorRange, scale);
+	addRangeValues(&options->SoftSlopeRange, islope);
+
+	for (a = 0; a < kp.size(); a++)
+	for (b = 0; b < ki.size(); b++)
+	for (c = 0; c < kd.size(); c++)
+	for (d = 0; d < iscale.size(); d++)
+	for (e = 0; e < scale.size(); e++)
+	for (f = 0; f < islope.size(); f++)
+	{
+		point.Gains.kp = (int16_t)kp[a];
+		point.Gains.ki = (int16_t)ki[b];
+		point.Gains.kd = (int16_t)kd[c];
+		point.Gains.integrator_scale = (int16_t)iscale[d];
+		point.Gains.scaling_factor = (int16_t)scale[e];
+		point.Gains.integ_soft_slope = (uint8_t)islope[f];
+		points.push_back(point);
+	}
+
+	threads = (options->Threads == 0) ? getDefaultThreadCount() : options->Threads;
+	printf("Sweep: %u points, %u worker threads, test vector %s\n",
+		(unsigned)points.size(), threads, options->InputFile.c_str());
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	// Closed loop only, no logs
+	initSimJob(&job);
+	job.InputFile = options->InputFile;
+	job.Mode = SIM_NORMAL;
+	job.TraceFormat = TRACE_NONE;
+
+	parallelFor((unsigned)points.size(), threads, [&](unsigned index) {
+		SimJob_t point_job = job;
+		point_job.Gains = &points[index].Gains;
+		runSimulation(&point_job, &points[index].Result);
+	});
+
+	double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	// Rank
+	for (i = 0; i < points.size(); i++)
+	{
+		order.push_back(i);
+		if (!points[i].Result.Success)
+			failed++;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned x, unsigned y) {
+		double vx = getRankValue(&points[x], options->RankBy);
+		double vy = getRankValue(&points[y], options->RankBy);
+		if (vx != vy)
+			return vx < vy;
+		return getRankValue(&points[x], RANK_IAE) < getRankValue(&points[y], RANK_IAE);
+	});
+
+	if (options->OutputFile.size() != 0)
+	{
+		if (!(out = fopen(options->OutputFile.c_str(), "w")))
+		{
+			printf("Cannot create %s\n", options->OutputFile.c_str());
+			return -1;
+		}
+		fprintf(out, "# Gain sweep, test vector %s, %u points\n", options->InputFile.c_str(), (unsigned)points.size());
+		printTableHeader(out);
+		for (i = 0; i < order.size(); i++)
+			printTableLine(out, i + 1, &points[order[i]]);
+		fclose(out);
+	}
+
+	printTableHeader(stdout);
+	for (i = 0; (i < order.size()) && (i < options->ShowBest); i++)
+		printTableLine(stdout, i + 1, &points[order[i]]);
+	printf("Sweep done: %u points, %d failed, %.3f s wall\n", (unsigned)points.size(), failed, wall_time);
+
+	return failed;
+}
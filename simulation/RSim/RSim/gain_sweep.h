@@ -0,0 +1,40 @@
+
+#ifndef GAIN_SWEEP_H_
+#define GAIN_SWEEP_H_
+
+#include <string>
+
+
+enum SweepRank {RANK_IAE, RANK_OVERSHOOT, RANK_SETTLING, RANK_RISE, RANK_DUTY};
+
+// Values of a single gain: Min, Min + Step, ... <= Max
+typedef struct
+{
+	int Min;
+	int Max;
+	int Step;
+} GainRange_t;
+
+typedef struct
+{
+	std::string InputFile;			// Test vector file, simulated in NORMAL mode
+	std::string OutputFile;			// Ranked table of all points, empty - console only
+	GainRange_t KpRange;
+	GainRange_t KiRange;
+	GainRange_t KdRange;
+	GainRange_t IntegratorScaleRange;
+	GainRange_t ScalingFactorRange;
+	GainRange_t SoftSlopeRange;		// integ_soft_slope of setPIDIntegratorLimit()
+	int RankBy;						// SweepRank
+	unsigned Threads;				// 0 - all hardware threads
+	unsigned ShowBest;				// Number of best points printed to console
+} SweepOptions_t;
+
+
+void initSweepOptions(SweepOptions_t *options);
+bool parseGainRange(const char *range_str, GainRange_t *range);
+int parseSweepRank(const char *rank_str);
+int runGainSweep(const SweepOptions_t *options);
+
+
+#endif /* GAIN_SWEEP_H_ */
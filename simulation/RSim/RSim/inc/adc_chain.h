@@ -0,0 +1,75 @@
+
+#ifndef ADC_CHAIN_H_
+#define ADC_CHAIN_H_
+
+#include "stdint.h"
+#include "simulation.h"
+#include "adc_filter.h"
+
+
+// Firmware ADC parameters, same as pid1/inc/adc.h
+#define ADC_DECIMATION			490			// Free-running conversions per CIC output
+#define ADC_EXTRA_BITS			2
+#define ADC_COEFF_SCALE			(10000L << ADC_EXTRA_BITS)		// COEFF_SCALE
+#define ADC_LOW_CORRECT			50
+#define ADC_HIGH_CORRECT		1000
+#define ADC_SENSOR_NO_PRESENT	(1<<0)		// adc_status bits
+#define ADC_SENSOR_SHORTED		(1<<1)
+#define ADC_UPDATE_INTERVAL		0.05		// s, update_normalized_adc() is called by every main loop run
+
+// ADC_TO_PID_COUNTS() of adc.h - adc_filtered in calibration and PID counts (4x adc_normalized)
+#define ADC_TO_PID_COUNTS(x)	((uint16_t)(((x) + (1 << (ADC_EXTRA_BITS - 1))) >> ADC_EXTRA_BITS))
+
+// Calibration points, Celsius. ADC values are taken from the sensor model like update_CalibrationPoint() does.
+#define ADC_CALIBRATION_POINT1	24
+#define ADC_CALIBRATION_POINT2	130
+
+#define ADC_UPDATES_PER_STEP	((unsigned)(TIMESTEP / ADC_UPDATE_INTERVAL + 0.5))
+#define ADC_CHAIN_STEPS			((ADC_FIR_N + ADC_UPDATES_PER_STEP) / ADC_UPDATES_PER_STEP)	// Steps that affect adc_filtered
+
+
+// Host model of the firmware temperature measurement: sensor, 10-bit ADC and the integer
+// pipeline of adc.c - ADC ISR (CIC decimator of 1024 - ADC), update_normalized_adc()
+// (CIC output scaling, fir_filter_rect) and conv_Celsius_to_ADC().
+// Sensor gives normalized ADC value (T + NORM_OFFSET) / NORM_K plus white noise, the ADC rounds it.
+// Plant state is constant during a simulation step, every step is ADC_UPDATES_PER_STEP
+// runs of the main loop, every update takes the CIC output of ADC_DECIMATION new conversions
+// (the model keeps CIC and main loop in step). CIC output depends on the conversions of
+// the last two updates, adc_filtered - on the last ADC_FIR_N + 1 updates, so the pipeline
+// is evaluated when a value is read, from sensor values of the last ADC_CHAIN_STEPS steps.
+// Results are the same as for processing every conversion.
+// Noise of conversion n is a function of the seed and n (triangular, sum of 2 uniform numbers).
+class AdcChain
+{
+public:
+	AdcChain();
+	void Init(double celsius, double noise, uint64_t seed);
+	void Step(double celsius);
+	void Skip(uint64_t steps);			// Steps that are not read, see getNextEventStep()
+	uint16_t GetFiltered(void);			// adc_filtered, PID process value is ADC_TO_PID_COUNTS() of it
+	uint16_t GetNormalized(void);		// adc_normalized
+	uint8_t GetStatus(void);			// adc_status
+	uint16_t CelsiusToADC(int16_t celsius) const;		// conv_Celsius_to_ADC()
+	int16_t ADCToCelsius(uint16_t adc) const;			// conv_ADC_to_Celsius()
+	// Single conversion as stored by the ADC ISR (1024 - ADC)
+	// Update u of step s = u / ADC_UPDATES_PER_STEP uses conversions [(u - 1) * ADC_DECIMATION : (u + 1) * ADC_DECIMATION)
+	uint16_t Sample(double celsius, double noise) const;
+	double GetNoise(uint64_t conversion) const;
+	uint64_t GetStepCount(void) const { return Steps; }
+private:
+	void Evaluate(void);
+	double History[ADC_CHAIN_STEPS];	// Sensor temperature of the last steps, [Steps % ADC_CHAIN_STEPS] is the next one
+	uint64_t Steps;						// Starts with ADC_CHAIN_STEPS steps of Init() temperature
+	double NoiseCounts;					// RMS, normalized ADC counts
+	double NoiseScale;					// GetNoise() counts per hash unit
+	uint64_t Seed;
+	int32_t KNorm;						// calculateCoeffs() results
+	int32_t OffsetNorm;
+	bool Valid;
+	uint16_t Filtered;
+	uint16_t Normalized;
+	uint8_t Status;
+};
+
+
+#endif /* ADC_CHAIN_H_ */
@@ -0,0 +1,28 @@
+
+#ifndef ADC_FILTER_H_
+#define ADC_FILTER_H_
+
+#include "filter_templates.h"
+
+
+// Firmware ADC filter, same as fir_filter_rect in pid1/src/adc.c
+// Input is the oversampled ADC value (16x adc_normalized)
+#define ADC_FIR_N			8
+#define ADC_FIR_DC_GAIN		296
+
+constexpr int8_t adc_fir_coeffs[ADC_FIR_N] = {
+            8,
+           27,
+           49,
+           64,
+           64,
+           49,
+           27,
+            8
+	};
+
+
+typedef FIRFilter<int16_t, int8_t, ADC_FIR_N, adc_fir_coeffs, ADC_FIR_DC_GAIN> AdcFilter_t;
+
+
+#endif /* ADC_FILTER_H_ */
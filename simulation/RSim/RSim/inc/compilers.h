@@ -30,7 +30,7 @@
 #endif
 
 //________________________________________
-#ifdef  __GNUC__
+#if defined(__GNUC__) && defined(__AVR__)
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/interrupt.h>
@@ -65,7 +65,7 @@
 
 
 //________________________________________
-#ifdef WIN32
+#if defined(WIN32) || defined(__unix__)
 #include "stdint.h"
 #include "taps.h"
 #endif
@@ -0,0 +1,101 @@
+
+#ifndef FILTER_TEMPLATES_H_
+#define FILTER_TEMPLATES_H_
+
+#include "stdint.h"
+
+
+// Compile-time specialized filters.
+// Order and coefficients are template parameters, so loops have constant trip counts
+// and coefficients are known to the compiler. Coefficient tables are constexpr arrays
+// at namespace scope, e.g.
+//		constexpr double my_ACoef[3] = {...};
+//		constexpr double my_BCoef[3] = {...};
+//		IIRFilterTDF2<double, 2, my_ACoef, my_BCoef> my_filter;
+
+
+//-------------------------------------------------------//
+// IIR filter, transposed direct form II
+//	ACoef - numerator (input) coefficients
+//	BCoef - denominator (output) coefficients, BCoef[0] must be 1
+// Same transfer function as iir_double(), but only NCoef state
+// variables are kept and nothing is shifted.
+//-------------------------------------------------------//
+template <typename T, unsigned NCoef, const T (&ACoef)[NCoef + 1], const T (&BCoef)[NCoef + 1]>
+class IIRFilterTDF2
+{
+public:
+	// Sets state so that the filter continues as if input and output had been equal to value,
+	// same as iir_double_init()
+	void Init(T value)
+	{
+		T acc = 0;
+		unsigned k;
+		for (k = NCoef; k > 0; k--)
+		{
+			acc = (ACoef[k] * value - BCoef[k] * value) + acc;
+			State[k - 1] = acc;
+		}
+	}
+
+	T Process(T x)
+	{
+		T y = ACoef[0] * x + State[0];
+		unsigned k;
+		for (k = 0; k < NCoef - 1; k++)
+			State[k] = (ACoef[k + 1] * x - BCoef[k + 1] * y) + State[k + 1];
+		State[NCoef - 1] = ACoef[NCoef] * x - BCoef[NCoef] * y;
+		return y;
+	}
+
+	// Direct access for engines that keep the state elsewhere
+	const T *GetState(void) const { return State; }
+	void SetState(const T *state)
+	{
+		unsigned k;
+		for (k = 0; k < NCoef; k++)
+			State[k] = state[k];
+	}
+private:
+	T State[NCoef];
+};
+
+
+//-------------------------------------------------------//
+// FIR filter, circular buffer
+//	TSample - sample type, TCoef - coefficient type
+//	Output is summ(Coeffs[i] * sample[i]) / DCGain, where sample[0] is the newest sample
+// Same result as fir_i16_i8() for int16_t samples and int8_t coefficients.
+// Every sample is stored twice, so the window is always contiguous.
+//-------------------------------------------------------//
+template <typename TSample, typename TCoef, unsigned N, const TCoef (&Coeffs)[N], int32_t DCGain>
+class FIRFilter
+{
+public:
+	void Init(TSample value)
+	{
+		unsigned i;
+		for (i = 0; i < 2 * N; i++)
+			Samples[i] = value;
+		Position = 0;
+	}
+
+	TSample Process(TSample new_sample)
+	{
+		int32_t summ = 0;
+		unsigned i;
+
+		Position = (Position == 0) ? (N - 1) : (Position - 1);
+		Samples[Position] = new_sample;
+		Samples[Position + N] = new_sample;
+		for (i = 0; i < N; i++)
+			summ += (int32_t)Samples[Position + i] * Coeffs[i];
+		return (TSample)(summ / DCGain);
+	}
+private:
+	TSample Samples[2 * N];
+	unsigned Position;
+};
+
+
+#endif /* FILTER_TEMPLATES_H_ */
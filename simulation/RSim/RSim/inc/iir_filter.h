@@ -1,4 +1,6 @@
 
+#ifndef IIR_FILTER_H_
+#define IIR_FILTER_H_
 
  typedef struct {
 	int NCoef;
@@ -9,5 +11,9 @@
 } iir_double_core_t;
 
 
+ // Direct form I with shifted histories. Plant model uses IIRFilterTDF2 (filter_templates.h),
+ // these functions are kept as reference for RSim -bench
  void iir_double_init(double value,  iir_double_core_t *fcore);
  double iir_double(double NewSample, iir_double_core_t *fcore);
+
+#endif /* IIR_FILTER_H_ */
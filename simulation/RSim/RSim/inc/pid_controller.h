@@ -5,6 +5,9 @@
  *  Author: Avega
  */ 
 
+#ifndef PID_CONTROLLER_H_
+#define PID_CONTROLLER_H_
+
 
 //------------------------------------------//
 // PID controller settings
@@ -36,6 +39,7 @@
 // Intergrator limit function parameters
 #define INTEGRATOR_SOFT_LIMIT
 #define INTEGRATOR_SOFT_RANGE	(PROP_MAX / Kp)		// Start integrating when error becomes such that p_term is less than PROP_MAX
+#define INTEGRATOR_SOFT_SLOPE	12					// See setPIDIntegratorLimit()
 //#define INTEGRATOR_SOFT_MAX		(30 * 10000L)		// Intergator maximum when error = 0		
 //#define INTEGRATOR_SOFT_K	(INTEGRATOR_SOFT_MAX / INTEGRATOR_SOFT_RANGE)
 
@@ -55,15 +59,37 @@
 
 
 
-extern int16_t dbg_PID_p_term;
-extern int16_t dbg_PID_d_term;
-extern int16_t dbg_PID_i_term;
-extern int16_t dbg_PID_output;
-
-void setPIDIntegratorLimit(uint8_t set_temp);
-uint8_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode);
-
-
-
-
-
+// PID controller gains
+// Defaults are Kp, Ki, Kd, INTEGRATOR_SCALE, SCALING_FACTOR and INTEGRATOR_SOFT_SLOPE,
+// simulator may change them at runtime to search for better tuning
+typedef struct {
+	int16_t kp;
+	int16_t ki;
+	int16_t kd;
+	int16_t integrator_scale;
+	int16_t scaling_factor;
+	uint8_t integ_soft_slope;		// integ_soft_k = (set_temp - 15) * integ_soft_slope
+} pid_gains_t;
+
+// PID controller instance state
+// Every simulation owns its controller, so several simulations may run in parallel
+typedef struct {
+	pid_gains_t gains;
+	uint16_t lastProcessValue;
+	int32_t integAcc;
+	uint16_t integ_soft_k;
+	// Debug
+	int16_t dbg_p_term;
+	int16_t dbg_d_term;
+	int16_t dbg_i_term;
+	int16_t dbg_output;
+} pid_state_t;
+
+
+void getDefaultPIDGains(pid_gains_t *gains);
+void initPID(pid_state_t *pid);
+void setPIDGains(pid_state_t *pid, const pid_gains_t *gains);
+void setPIDIntegratorLimit(pid_state_t *pid, uint8_t set_temp);
+uint8_t processPID(pid_state_t *pid, uint16_t setPoint, uint16_t processValue, uint8_t mode);
+
+#endif /* PID_CONTROLLER_H_ */
@@ -1,7 +1,41 @@
 
+#ifndef PLANT_H_
+#define PLANT_H_
 
+#include "plant_filters.h"
 
-void initPlant(double ambient, double state);
-void processPlant(double effect);
-double getPlantState(void);
 
+// Plant model instance.
+// All model state lives here, so every simulation can own its plant
+// and several simulations may run in parallel threads.
+typedef struct {
+	PlantFilter_t plant_filter;			// plant output filter, see plant_filters.h
+	EffectFilter_t eff_filter;			// effect (heater) filter
+	double plantAmbient;
+	double plantState;
+	double plantStateFiltered;
+	double k_amb;						// model parameters, defaults unless setPlantVariation() is called
+	double k_eff;
+	double timeConst;
+} plant_t;
+
+
+// Plant model parameters - for engines that process many plants at once
+typedef struct {
+	const double *plant_ACoef;
+	const double *plant_BCoef;
+	const double *eff_ACoef;
+	const double *eff_BCoef;
+	double k_amb;
+	double k_eff;
+	double timeConst;
+} plant_model_t;
+
+
+void initPlant(plant_t *plant, double ambient, double state);
+void setPlantVariation(plant_t *plant, double k_amb_scale, double k_eff_scale, double time_scale);
+void processPlant(plant_t *plant, double effect);
+double getPlantState(plant_t *plant);
+void getPlantModel(plant_model_t *model);
+
+#endif /* PLANT_H_ */
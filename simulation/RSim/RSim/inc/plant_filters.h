@@ -0,0 +1,114 @@
+
+#ifndef PLANT_FILTERS_H_
+#define PLANT_FILTERS_H_
+
+#include "filter_templates.h"
+
+#define plant_NCoef 4			// Order of plant output filter
+#define eff_NCoef 3				// Order of effect (heater) filter
+
+
+/**************************************************************
+WinFilter version 0.8
+http://www.winfilter.20m.com
+akundert@hotmail.com
+
+Filter type: Low Pass
+Filter model: Butterworth
+Filter order: 5
+Sampling Frequency: 500 Hz
+Cut Frequency: 1.000000 Hz
+Coefficents Quantization: float
+
+Z domain Zeros
+z = -1.000000 + j 0.000000
+z = -1.000000 + j 0.000000
+z = -1.000000 + j 0.000000
+z = -1.000000 + j 0.000000
+z = -1.000000 + j 0.000000
+
+Z domain Poles
+z = 0.985283 + j -0.004173
+z = 0.985283 + j 0.004173
+z = 0.994441 + j -0.015128
+z = 0.994441 + j 0.015128
+z = 0.999887 + j -0.000000
+***************************************************************/
+constexpr double plant_ACoef[plant_NCoef+1] = {
+        0.00000000067117469390,
+        0.00000000268469877561,
+        0.00000000402704816342,
+        0.00000000268469877561,
+        0.00000000067117469390
+    };
+
+    constexpr double plant_BCoef[plant_NCoef+1] = {
+        1.00000000000000000000,
+        -3.97263546992882950000,
+        5.91828019705741950000,
+        -3.91865100043767800000,
+        0.97300628517191312000
+    };
+
+
+
+
+//----------------------------//
+/*  good
+#define eff_NCoef 4
+static double eff_y[eff_NCoef+1]; //output samples
+static double eff_x[eff_NCoef+1]; //input samples
+
+double eff_ACoef[eff_NCoef+1] = {
+        0.00000000005929847418,
+        0.00000000023719389671,
+        0.00000000035579084507,
+        0.00000000023719389671,
+        0.00000000005929847418
+    };
+
+    double eff_BCoef[eff_NCoef+1] = {
+        1.00000000000000000000,
+        -3.99397387738456230000,
+        5.98197913518426280000,
+        -3.98203645370192310000,
+        0.99403119633051884000
+    };
+*/
+
+/* too big delay
+double eff_ACoef[eff_NCoef+1] = {
+        0.00000000931329148875,
+        0.00000002793987446626,
+        0.00000002793987446626,
+        0.00000000931329148875
+    };
+
+    double eff_BCoef[eff_NCoef+1] = {
+        1.00000000000000000000,
+        -2.99688763931455470000,
+        2.99378750508951930000,
+        -0.99689985056499619000
+    };
+*/
+
+constexpr double eff_ACoef[eff_NCoef+1] = {
+        0.00000001159228067557,
+        0.00000003477684202670,
+        0.00000003477684202670,
+        0.00000001159228067557
+    };
+
+    constexpr double eff_BCoef[eff_NCoef+1] = {
+        1.00000000000000000000,
+        -2.99584690314718530000,
+        2.99171554448822490000,
+        -0.99586860530641597000
+    };
+
+
+typedef IIRFilterTDF2<double, plant_NCoef, plant_ACoef, plant_BCoef> PlantFilter_t;
+typedef IIRFilterTDF2<double, eff_NCoef, eff_ACoef, eff_BCoef> EffectFilter_t;
+
+
+#endif /* PLANT_FILTERS_H_ */
@@ -0,0 +1,56 @@
+
+#ifndef PLANT_JUMP_H_
+#define PLANT_JUMP_H_
+
+#include <map>
+#include <vector>
+#include "plant.h"
+
+
+// Augmented plant state: effect filter, plantState, plant filter, plantStateFiltered, effect, ambient
+#define PLANT_JUMP_DIM			(eff_NCoef + 1 + plant_NCoef + 3)
+#define PLANT_JUMP_CACHE_SIZE	64			// Max number of cached A^k matrices
+
+
+typedef struct {
+	double hi[PLANT_JUMP_DIM][PLANT_JUMP_DIM];
+	double lo[PLANT_JUMP_DIM][PLANT_JUMP_DIM];
+} jump_matrix_t;
+
+// Double-double number, value is hi + lo
+typedef struct {
+	double hi;
+	double lo;
+} double2_t;
+
+typedef struct {
+	double2_t a[PLANT_JUMP_DIM][PLANT_JUMP_DIM];
+} jump_matrix2_t;
+
+
+// Exact jump-ahead of the plant over steps with constant effect and ambient.
+// processPlant() is linear in the augmented state, so one step is x' = A * x.
+// A is assembled by processing basis vectors, A^k is built from binary powers A^(2^j)
+// and cached for the step counts in use. A is assembled again when model parameters
+// of the plant differ from the previous Advance() call (see setPlantVariation()).
+// Plant filters have poles close to 1, so products of their matrices lose many digits.
+// Powers are multiplied in double-double arithmetic and rounded to double only in the end.
+class PlantJump
+{
+public:
+	PlantJump();
+	void Advance(plant_t *plant, double effect, unsigned long steps);
+private:
+	void Build(const plant_t *model);
+	void Pack(const plant_t *plant, double effect, double *x);
+	void Unpack(const double *x, plant_t *plant);
+	const jump_matrix_t *GetMatrix(unsigned long steps);
+	double KAmb, KEff, TimeConst;							// Model parameters of A
+	double EffSteady[eff_NCoef];							// Filter states for constant input of 1
+	double PlantSteady[plant_NCoef];
+	std::vector<jump_matrix2_t> Powers;						// A^(2^j)
+	std::map<unsigned long, jump_matrix_t> Cache;			// A^k
+};
+
+
+#endif /* PLANT_JUMP_H_ */
@@ -6,5 +6,10 @@
  #define TIMESTEP			0.1			// in seconds
  #define STEPS_PER_SECOND	10			// must be integer
  #define PID_CALL_INTERVAL	4			// in seconds	
+ #define PID_STEP_INTERVAL	(STEPS_PER_SECOND * PID_CALL_INTERVAL)	// in steps
+
+// Plant state (Celsius) to PID input conversion, see runSimulation()
+ #define NORM_K				0.446f
+ #define NORM_OFFSET		48.144f
  
 
@@ -5,6 +5,13 @@
 /*                (c) 2010, Phyton                                   */
 /*********************************************************************/
 
+#if defined(__GNUC__)
+// GCC hosts (Linux build) provide their own complete stdint.h
+// No include guard here: #include_next must reach the system header
+// even if this file has been found twice through the include path.
+#include_next <stdint.h>
+#else
+
 #ifndef __STDINT_H
 #define __STDINT_H
 
@@ -101,6 +108,8 @@
 
 #endif /* __STDINT_H */
 
+#endif /* __GNUC__ */
+
 /* end of stdint.h */
 
 
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mc_campaign.h"
+#include "sim_runner.h"
+#include "sim_random.h"
+#include "trace_file.h"
+#include "worker_pool.h"
+
+
+#define CAMPAIGN_SEED_MIX		0xD1B54A32D192ED03ULL	// Spreads run numbers over seed space
+
+enum CampaignMetric {METRIC_RISE, METRIC_OVERSHOOT, METRIC_SETTLING, METRIC_STEADY, METRIC_IAE, METRIC_COUNT};
+
+static const char *metricNames[METRIC_COUNT] = {"rise,s", "overshoot,C", "settling,s", "steady err,C", "IAE,C*s"};
+static const double percentiles[] = {5, 25, 50, 75, 95};
+
+
+static void setDistribution(Distribution_t *dist, int type, double a, double b)
+{
+	dist->Type = type;
+	dist->A = a;
+	dist->B = b;
+}
+
+//-------------------------------------------------------//
+// Sets default spread of a workshop fleet
+//-------------------------------------------------------//
+void initCampaignOptions(CampaignOptions_t *options)
+{
+	options->InputFiles.clear();
+	options->OutputFile.clear();
+	options->Runs = 1000;
+	setDistribution(&options->Ambient, DIST_UNIFORM, 10, 35);
+	setDistribution(&options->AmbientLoss, DIST_NORMAL, 1, 0.1);
+	setDistribution(&options->Gain, DIST_NORMAL, 1, 0.1);
+	setDistribution(&options->TimeScale, DIST_NORMAL, 1, 0.1);
+	setDistribution(&options->SensorOffset, DIST_NORMAL, 0, 1);
+	setDistribution(&options->SensorNoise, DIST_UNIFORM, 0, 0.5);
+	setDistribution(&options->Calibration, DIST_NORMAL, 0, 0.01);
+	options->Seed = 1;
+	options->Threads = 0;
+	options->AdcEmulation = false;
+}
+
+
+//-------------------------------------------------------//
+// Parses distribution: "<value>", "uniform:<min>:<max>" or "normal:<mean>:<deviation>"
+//-------------------------------------------------------//
+bool parseDistribution(const char *dist_str, Distribution_t *dist)
+{
+	char *end;
+
+	if (strncmp(dist_str, "uniform:", 8) == 0)
+	{
+		dist->Type = DIST_UNIFORM;
+		if ((sscanf(dist_str + 8, "%lf:%lf", &dist->A, &dist->B) != 2) || (dist->B < dist->A))
+			return false;
+		return true;
+	}
+	if (strncmp(dist_str, "normal:", 7) == 0)
+	{
+		dist->Type = DIST_NORMAL;
+		if ((sscanf(dist_str + 7, "%lf:%lf", &dist->A, &dist->B) != 2) || (dist->B < 0))
+			return false;
+		return true;
+	}
+	dist->Type = DIST_CONSTANT;
+	dist->A = strtod(dist_str, &end);
+	dist->B = 0;
+	return (end != dist_str) && (*end == '\0');
+}
+
+
+//-------------------------------------------------------//
+// Helpers
+//-------------------------------------------------------//
+
+static double getDistributionMin(const Distribution_t *dist)
+{
+	return (dist->Type == DIST_NORMAL) ? (dist->A - 3 * dist->B) : dist->A;
+}
+
+static bool checkDistribution(const Distribution_t *dist, double min, const char *name)
+{
+	if (getDistributionMin(dist) <= min)
+	{
+		printf("Campaign: %s must be greater than %g\n", name, min);
+		return false;
+	}
+	return true;
+}
+
+static double drawValue(SimRandom *rng, const Distribution_t *dist)
+{
+	double x;
+	switch (dist->Type)
+	{
+		case DIST_UNIFORM:
+			return dist->A + (dist->B - dist->A) * rng->Uniform();
+		case DIST_NORMAL:
+			do
+			{
+				x = rng->Normal();
+			} while (fabs(x) > 3.0);
+			return dist->A + dist->B * x;
+		default:
+			return dist->A;
+	}
+}
+
+static void printDistribution(const char *name, const Distribution_t *dist)
+{
+	switch (dist->Type)
+	{
+		case DIST_UNIFORM:	printf("    %-22s uniform %g : %g\n", name, dist->A, dist->B);	break;
+		case DIST_NORMAL:	printf("    %-22s normal %g, deviation %g\n", name, dist->A, dist->B);	break;
+		default:			printf("    %-22s %g\n", name, dist->A);	break;
+	}
+}
+
+// Machine of the fleet. Runs are drawn from their own seeds, so the fleet
+// does not depend on thread count and is the same for every test vector.
+static void drawMachine(const CampaignOptions_t *options, unsigned run, SimVariation_t *v)
+{
+	SimRandom rng(((uint64_t)options->Seed << 32) ^ ((uint64_t)run * CAMPAIGN_SEED_MIX));
+
+	v->Ambient = drawValue(&rng, &options->Ambient);
+	v->AmbientLossScale = drawValue(&rng, &options->AmbientLoss);
+	v->GainScale = drawValue(&rng, &options->Gain);
+	v->TimeScale = drawValue(&rng, &options->TimeScale);
+	v->SensorOffset = drawValue(&rng, &options->SensorOffset);
+	v->SensorNoise = drawValue(&rng, &options->SensorNoise);
+	v->CalibrationError = drawValue(&rng, &options->Calibration);
+	v->NoiseSeed = rng.Next();
+}
+
+// Returns metric value, time metrics that have not been reached are +infinity
+static double getMetric(const ResponseMetrics_t *m, int metric)
+{
+	switch (metric)
+	{
+		case METRIC_RISE:		return (m->RiseTime < 0) ? HUGE_VAL : m->RiseTime;
+		case METRIC_OVERSHOOT:	return m->Overshoot;
+		case METRIC_SETTLING:	return (m->SettlingTime < 0) ? HUGE_VAL : m->SettlingTime;
+		case METRIC_STEADY:		return m->SteadyError;
+		default:				return m->IAE;
+	}
+}
+
+static void printValue(FILE *f, double value)
+{
+	if (value == HUGE_VAL)
+		fprintf(f, " %10s", "-");
+	else
+		fprintf(f, " %10.2f", value);
+}
+
+// Percentile of sorted values, nearest rank
+static double getPercentile(const std::vector<double> &sorted, double p)
+{
+	size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+	return sorted[(rank == 0) ? 0 : rank - 1];
+}
+
+
+//-------------------------------------------------------//
+// Prints percentile bands of metrics of all successful runs of a test vector
+//-------------------------------------------------------//
+static void printBands(const char *input_file, const std::vector<SimResult_t> &results)
+{
+	std::vector<double> values;
+	unsigned failed = 0;
+	unsigned not_reached;
+	unsigned metric, i;
+
+	for (i = 0; i < results.size(); i++)
+	{
+		if (!results[i].Success)
+			failed++;
+	}
+	printf("\n%s: %u runs, %u failed\n", input_file, (unsigned)results.size(), failed);
+	if (failed == results.size())
+	{
+		printf("    %s\n", results[0].Message.c_str());
+		return;
+	}
+
+	printf("    %-14s %10s", "metric", "min");
+	for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+		printf("        P%-2.0f", percentiles[i]);
+	printf(" %10s  %s\n", "max", "not reached");
+
+	for (metric = 0; metric < METRIC_COUNT; metric++)
+	{
+		values.clear();
+		not_reached = 0;
+		for (i = 0; i < results.size(); i++)
+		{
+			if (!results[i].Success)
+				continue;
+			values.push_back(getMetric(&results[i].Metrics, metric));
+			if (values.back() == HUGE_VAL)
+				not_reached++;
+		}
+		std::sort(values.begin(), values.end());
+		printf("    %-14s", metricNames[metric]);
+		printValue(stdout, values.front());
+		for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+			printValue(stdout, getPercentile(values, percentiles[i]));
+		printValue(stdout, values.back());
+		if ((metric == METRIC_RISE) || (metric == METRIC_SETTLING))
+			printf("  %u", not_reached);
+		printf("\n");
+	}
+}
+
+
+//-------------------------------------------------------//
+// Simulates every test vector with options->Runs randomized machines using all cores
+// and prints percentile bands of closed loop metrics
+// Returns number of failed runs
+//-------------------------------------------------------//
+int runCampaign(const CampaignOptions_t *options)
+{
+	std::vector<SimVariation_t> machines(options->Runs);
+	std::vector<std::vector<SimResult_t> > results(options->InputFiles.size());
+	unsigned long simulated = 0;
+	unsigned threads;
+	unsigned count;
+	unsigned i, j, metric;
+	int failed = 0;
+	SimJob_t job;
+	FILE *out;
+
+	if (options->InputFiles.empty() || (options->Runs == 0))
+		return -1;
+	if (!checkDistribution(&options->AmbientLoss, 0, "ambient loss scale") ||
+		!checkDistribution(&options->Gain, 0, "gain scale") ||
+		!checkDistribution(&options->TimeScale, 0, "time constant scale") ||
+		!checkDistribution(&options->Calibration, -1, "calibration error"))
+		return -1;
+	if (getDistributionMin(&options->SensorNoise) < 0)
+	{
+		printf("Campaign: sensor noise must not be negative\n");
+		return -1;
+	}
+
+	for (i = 0; i < options->Runs; i++)
+		drawMachine(options, i, &machines[i]);
+	for (i = 0; i < results.size(); i++)
+		results[i].resize(options->Runs);
+
+	threads = (options->Threads == 0) ? getDefaultThreadCount() : options->Threads;
+	count = (unsigned)options->InputFiles.size() * options->Runs;
+	printf("Campaign: %u test vectors x %u machines, seed %u, %u worker threads\n",
+		(unsigned)options->InputFiles.size(), options->Runs, options->Seed, threads);
+	printDistribution("ambient, C", &options->Ambient);
+	printDistribution("ambient loss scale", &options->AmbientLoss);
+	printDistribution("gain scale", &options->Gain);
+	printDistribution("time constant scale", &options->TimeScale);
+	printDistribution("sensor offset, C", &options->SensorOffset);
+	printDistribution("sensor noise, C RMS", &options->SensorNoise);
+	printDistribution("calibration error", &options->Calibration);
+	if (options->AdcEmulation)
+		printf("    PID input from ADC chain emulation\n");
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	// Closed loop only, no logs
+	initSimJob(&job);
+	job.Mode = SIM_NORMAL;
+	job.TraceFormat = TRACE_NONE;
+	job.AdcEmulation = options->AdcEmulation;
+
+	parallelFor(count, threads, [&](unsigned index) {
+		SimJob_t run_job = job;
+		unsigned vector = index / options->Runs;
+		unsigned run = index % options->Runs;
+		run_job.InputFile = options->InputFiles[vector];
+		run_job.Variation = &machines[run];
+		runSimulation(&run_job, &results[vector][run]);
+	});
+
+	double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	for (i = 0; i < results.size(); i++)
+	{
+		for (j = 0; j < options->Runs; j++)
+		{
+			if (!results[i][j].Success)
+				failed++;
+			else
+				simulated += results[i][j].SimulatedSeconds;
+		}
+		printBands(options->InputFiles[i].c_str(), results[i]);
+	}
+
+	if (options->OutputFile.size() != 0)
+	{
+		if (!(out = fopen(options->OutputFile.c_str(), "w")))
+		{
+			printf("Cannot create %s\n", options->OutputFile.c_str());
+			return -1;
+		}
+		fprintf(out, "# Monte Carlo campaign, seed %u, %u machines\n", options->Seed, options->Runs);
+		for (i = 0; i < options->InputFiles.size(); i++)
+			fprintf(out, "# vector %u: %s\n", i, options->InputFiles[i].c_str());
+		fprintf(out, "#%6s %6s %8s %7s %7s %7s %8s %7s %8s", "vector", "run", "ambient", "loss", "gain", "tconst",
+			"offset", "noise", "calib");
+		for (i = 0; i < METRIC_COUNT; i++)
+			fprintf(out, " %10s", metricNames[i]);
+		fprintf(out, "\n");
+		for (i = 0; i < results.size(); i++)
+		{
+			for (j = 0; j < options->Runs; j++)
+			{
+				const SimVariation_t *v = &machines[j];
+				fprintf(out, "%7u %6u %8.2f %7.3f %7.3f %7.3f %8.3f %7.3f %8.4f", i, j, v->Ambient,
+					v->AmbientLossScale, v->GainScale, v->TimeScale, v->SensorOffset, v->SensorNoise, v->CalibrationError);
+				if (!results[i][j].Success)
+				{
+					fprintf(out, " %s\n", results[i][j].Message.c_str());
+					continue;
+				}
+				for (metric = 0; metric < METRIC_COUNT; metric++)
+					printValue(out, getMetric(&results[i][j].Metrics, metric));
+				fprintf(out, "\n");
+			}
+		}
+		fclose(out);
+	}
+
+	printf("\nCampaign done: %u runs, %d failed, %lu s simulated in %.3f s wall (%.0f sim-s/s)\n",
+		count, failed, simulated, wall_time, (wall_time > 0) ? simulated / wall_time : 0.0);
+	return failed;
+}
@@ -0,0 +1,43 @@
+
+#ifndef MC_CAMPAIGN_H_
+#define MC_CAMPAIGN_H_
+
+#include <string>
+#include <vector>
+
+
+enum DistributionType {DIST_CONSTANT, DIST_UNIFORM, DIST_NORMAL};
+
+// Random parameter: constant A, uniform in [A : B] or normal with mean A and deviation B.
+// Normal values are limited to A +- 3B.
+typedef struct
+{
+	int Type;						// DistributionType
+	double A;
+	double B;
+} Distribution_t;
+
+typedef struct
+{
+	std::vector<std::string> InputFiles;	// Test vector files, simulated in NORMAL mode
+	std::string OutputFile;			// Table of all runs, empty - console only
+	unsigned Runs;					// Machines per test vector
+	Distribution_t Ambient;			// Celsius
+	Distribution_t AmbientLoss;		// Plant k_amb multiplier
+	Distribution_t Gain;			// Plant k_eff multiplier
+	Distribution_t TimeScale;		// Plant time constant multiplier
+	Distribution_t SensorOffset;	// Celsius
+	Distribution_t SensorNoise;		// Celsius RMS, of every ADC conversion with AdcEmulation
+	Distribution_t Calibration;		// Relative sensor gain error
+	unsigned Seed;
+	unsigned Threads;				// 0 - all hardware threads
+	bool AdcEmulation;				// PID input from firmware ADC chain emulation
+} CampaignOptions_t;
+
+
+void initCampaignOptions(CampaignOptions_t *options);
+bool parseDistribution(const char *dist_str, Distribution_t *dist);
+int runCampaign(const CampaignOptions_t *options);
+
+
+#endif /* MC_CAMPAIGN_H_ */
@@ -0,0 +1,594 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "plant_ident.h"
+#include "batch_runner.h"
+#include "worker_pool.h"
+#include "plant.h"
+#include "simulation.h"
+
+
+/*
+	Identification manifest - one temperature log per line:
+
+		<log file>  [<ambient temperature>]
+
+	Logs are firmware UART logs, one line per TIMESTEP, with measured temperature (Celsius),
+	heater output (0 - 100%) and PID set point in the columns given by -tcol, -ecol and -scol.
+	Firmware does not call PID while regulation is off, so the logged output is stale
+	and heater output is taken as 0 when the set point is 0.
+	Lines that are not all integer numbers (greeting, calibration dump) and lines
+	with heater output outside [0 : 100] are skipped.
+	Words containing spaces must be quoted. Empty lines and lines starting with '#' are ignored.
+	Relative paths are relative to the working directory.
+	Example:
+
+		"../../../temperature log/experiment#15/experiment#15_1.log"		22
+*/
+
+
+// Differential evolution, DE/rand/1/bin
+#define DE_WEIGHT			0.6			// Difference vector weight
+#define DE_CROSSOVER		0.9			// Probability to take a parameter from the mutant
+#define IDENT_REPORT_EVERY	10			// generations
+
+#define IDENT_MAX_ORDER		8
+#define IDENT_PI			3.14159265358979323846
+
+
+// Fitted parameters
+enum {IDENT_K_AMB, IDENT_K_EFF, IDENT_EFF_CUTOFF, IDENT_PLANT_CUTOFF, IDENT_PARAMS};
+
+// Search range, candidates are kept as logarithms of parameter values
+static const struct {const char *Name; double Min; double Max;} paramRange[IDENT_PARAMS] =
+{
+	{"k_amb",						0.005,	2.0},
+	{"k_eff",						0.01,	5.0},
+	{"effect filter cutoff, Hz",	0.0005,	0.5},
+	{"plant filter cutoff, Hz",		0.0005,	2.0},
+};
+
+typedef struct
+{
+	std::string FileName;
+	double Ambient;
+	std::vector<float> Temperature;
+	std::vector<float> Effect;
+	unsigned Skipped;					// Lines that are not log samples
+} IdentLog_t;
+
+// Plant model with runtime coefficients, see processPlant()
+typedef struct
+{
+	double eff_a[eff_NCoef + 1];
+	double eff_b[eff_NCoef + 1];
+	double plant_a[plant_NCoef + 1];
+	double plant_b[plant_NCoef + 1];
+	double k_amb;
+	double k_eff;
+	double time_const;
+} ident_model_t;
+
+typedef struct
+{
+	double x[IDENT_PARAMS];				// Logarithms of parameter values
+	double Cost;						// Mean of squared errors of all logs
+} Candidate_t;
+
+
+//-------------------------------------------------------//
+// Deterministic pseudo-random numbers in [0 : 1)
+//-------------------------------------------------------//
+static double nextUniform(uint32_t *seed)
+{
+	*seed = *seed * 1664525UL + 1013904223UL;
+	return (*seed >> 8) / 16777216.0;
+}
+
+
+//-------------------------------------------------------//
+// Reads log samples, log->FileName and log->Ambient must be set
+// Returns false if file cannot be read or has no samples
+//-------------------------------------------------------//
+static bool readLog(IdentLog_t *log, const IdentOptions_t *options)
+{
+	std::ifstream in_stream(log->FileName.c_str());
+	std::string line;
+	std::vector<long> values;
+	unsigned t_column = options->TemperatureColumn;
+	unsigned e_column = options->EffectColumn;
+	unsigned columns = std::max(t_column, e_column) + 1;
+
+	if (options->SetpointColumn >= 0)
+		columns = std::max(columns, (unsigned)options->SetpointColumn + 1);
+
+	if (!in_stream.is_open())
+	{
+		printf("Cannot open log %s\n", log->FileName.c_str());
+		return false;
+	}
+	log->Skipped = 0;
+	while (std::getline(in_stream, line))
+	{
+		const char *p = line.c_str();
+		char *end;
+		bool valid = true;
+
+		values.clear();
+		while (1)
+		{
+			while (isspace((unsigned char)*p))
+				p++;
+			if (*p == 0)
+				break;
+			values.push_back(strtol(p, &end, 10));
+			if ((end == p) || (*end && !isspace((unsigned char)*end)))
+			{
+				valid = false;
+				break;
+			}
+			p = end;
+		}
+		if (valid && (values.size() == 0))
+			continue;
+		if (!valid || (values.size() < columns) || (values[e_column] < 0) || (values[e_column] > 100))
+		{
+			log->Skipped++;
+			continue;
+		}
+		log->Temperature.push_back((float)values[t_column]);
+		if ((options->SetpointColumn >= 0) && (values[options->SetpointColumn] == 0))
+			log->Effect.push_back(0);
+		else
+			log->Effect.push_back((float)values[e_column]);
+	}
+	if (log->Temperature.size() < 2)
+	{
+		printf("Log %s has no samples\n", log->FileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+//-------------------------------------------------------//
+// Reads manifest and all logs listed in it
+// Returns false if any file cannot be read or contains errors
+//-------------------------------------------------------//
+static bool readIdentManifest(const IdentOptions_t *options, std::vector<IdentLog_t> &logs)
+{
+	std::ifstream in_stream(options->ManifestFile.c_str());
+	std::string line;
+	std::vector<std::string> words;
+	IdentLog_t log;
+	unsigned line_number = 0;
+	bool result = true;
+
+	if (!in_stream.is_open())
+	{
+		printf("Cannot open identification manifest %s\n", options->ManifestFile.c_str());
+		return false;
+	}
+	while (std::getline(in_stream, line))
+	{
+		line_number++;
+		words = splitManifestLine(line.c_str());
+		if ((words.size() == 0) || (words[0][0] == '#'))
+			continue;
+		if (words.size() > 2)
+		{
+			printf("Manifest line %u: expected <log file> [<ambient temperature>]\n", line_number);
+			result = false;
+			continue;
+		}
+		log.FileName = words[0];
+		log.Ambient = (words.size() > 1) ? atof(words[1].c_str()) : options->Ambient;
+		log.Temperature.clear();
+		log.Effect.clear();
+		if (!readLog(&log, options))
+		{
+			result = false;
+			continue;
+		}
+		logs.push_back(log);
+	}
+	if (logs.size() == 0)
+	{
+		printf("No logs in %s\n", options->ManifestFile.c_str());
+		result = false;
+	}
+	return result;
+}
+
+
+//-------------------------------------------------------//
+// Low pass filter design - bilinear transform of the analog prototype with prewarped cutoff
+//	ripple = 0 - Butterworth, otherwise Chebyshev type I with ripple in dB
+//	cutoff - fraction of sampling frequency
+// Results: a - numerator, b - denominator (b[0] = 1), DC gain is 1
+//-------------------------------------------------------//
+static void designLowPass(unsigned order, double ripple, double cutoff, double *a, double *b)
+{
+	std::complex<double> poly[IDENT_MAX_ORDER + 1];
+	double wc = 2.0 * tan(IDENT_PI * cutoff);
+	double v = (ripple > 0) ? asinh(1.0 / sqrt(pow(10.0, ripple / 10) - 1)) / order : 0;
+	double a_summ = 0;
+	double b_summ = 0;
+	double binomial = 1;
+	unsigned i, k;
+
+	// Denominator - product of (1 - z[k] * q^-1) for all poles
+	poly[0] = 1;
+	for (k = 0; k < order; k++)
+	{
+		double theta = IDENT_PI * (2 * k + 1) / (2 * order);
+		std::complex<double> s = (ripple > 0) ?
+			std::complex<double>(-sinh(v) * sin(theta), cosh(v) * cos(theta)) :
+			std::complex<double>(-sin(theta), cos(theta));
+		std::complex<double> z = (2.0 + wc * s) / (2.0 - wc * s);
+		poly[k + 1] = -z * poly[k];
+		for (i = k; i > 0; i--)
+			poly[i] -= z * poly[i - 1];
+	}
+
+	// Numerator - all zeros at -1
+	for (i = 0; i <= order; i++)
+	{
+		b[i] = poly[i].real();
+		a[i] = binomial;
+		b_summ += b[i];
+		a_summ += a[i];
+		binomial = binomial * (order - i) / (i + 1);
+	}
+	for (i = 0; i <= order; i++)
+		a[i] *= b_summ / a_summ;
+}
+
+static double getDCGain(const double *a, const double *b, unsigned order)
+{
+	double a_summ = 0;
+	double b_summ = 0;
+	unsigned i;
+	for (i = 0; i <= order; i++)
+	{
+		a_summ += a[i];
+		b_summ += b[i];
+	}
+	return a_summ / b_summ;
+}
+
+// Model of plant.cpp and plant_filters.h
+static void getCurrentModel(ident_model_t *m)
+{
+	plant_model_t model;
+	getPlantModel(&model);
+	std::copy(model.eff_ACoef, model.eff_ACoef + eff_NCoef + 1, m->eff_a);
+	std::copy(model.eff_BCoef, model.eff_BCoef + eff_NCoef + 1, m->eff_b);
+	std::copy(model.plant_ACoef, model.plant_ACoef + plant_NCoef + 1, m->plant_a);
+	std::copy(model.plant_BCoef, model.plant_BCoef + plant_NCoef + 1, m->plant_b);
+	m->k_amb = model.k_amb;
+	m->k_eff = model.k_eff;
+	m->time_const = model.timeConst;
+}
+
+static void buildModel(const double *x, ident_model_t *m)
+{
+	plant_model_t model;
+	getPlantModel(&model);
+	designLowPass(eff_NCoef, IDENT_EFF_FILTER_RIPPLE, exp(x[IDENT_EFF_CUTOFF]) * TIMESTEP, m->eff_a, m->eff_b);
+	designLowPass(plant_NCoef, 0, exp(x[IDENT_PLANT_CUTOFF]) * TIMESTEP, m->plant_a, m->plant_b);
+	m->k_amb = exp(x[IDENT_K_AMB]);
+	m->k_eff = exp(x[IDENT_K_EFF]);
+	m->time_const = model.timeConst;
+}
+
+
+//-------------------------------------------------------//
+// Transposed direct form II, same as IIRFilterTDF2
+//-------------------------------------------------------//
+static inline void initTDF2(const double *a, const double *b, double *z, unsigned order, double value)
+{
+	double acc = 0;
+	unsigned k;
+	for (k = order; k > 0; k--)
+	{
+		acc = (a[k] * value - b[k] * value) + acc;
+		z[k - 1] = acc;
+	}
+}
+
+static inline double processTDF2(const double *a, const double *b, double *z, unsigned order, double x)
+{
+	double y = a[0] * x + z[0];
+	unsigned k;
+	for (k = 0; k < order - 1; k++)
+		z[k] = (a[k + 1] * x - b[k + 1] * y) + z[k + 1];
+	z[order - 1] = a[order] * x - b[order] * y;
+	return y;
+}
+
+//-------------------------------------------------------//
+// Simulates plant with the logged heater output, same as processPlant()
+// Plant starts at the first logged temperature, heater filter starts at 0.
+// Returns summ of squared errors of the following samples
+//-------------------------------------------------------//
+static double simulateLog(const ident_model_t *m, const IdentLog_t *log, double *max_error)
+{
+	double eff_z[eff_NCoef];
+	double plant_z[plant_NCoef];
+	double state = log->Temperature[0];
+	double summ = 0;
+	double error;
+	size_t i;
+
+	initTDF2(m->eff_a, m->eff_b, eff_z, eff_NCoef, 0);
+	initTDF2(m->plant_a, m->plant_b, plant_z, plant_NCoef, state);
+	if (max_error)
+		*max_error = 0;
+	for (i = 1; i < log->Temperature.size(); i++)
+	{
+		double effect_filtered = processTDF2(m->eff_a, m->eff_b, eff_z, eff_NCoef, log->Effect[i - 1]);
+		state += (m->k_amb * (log->Ambient - state) + m->k_eff * effect_filtered) * m->time_const;
+		error = processTDF2(m->plant_a, m->plant_b, plant_z, plant_NCoef, state) - log->Temperature[i];
+		summ += error * error;
+		if (max_error && (fabs(error) > *max_error))
+			*max_error = fabs(error);
+	}
+	return summ;
+}
+
+static inline double getMeanSquare(double summ, const IdentLog_t *log)
+{
+	return summ / (log->Temperature.size() - 1);
+}
+
+
+//-------------------------------------------------------//
+// Computes costs of candidates, every candidate and log pair is a separate task
+// Every log has the same weight, whatever its length
+//-------------------------------------------------------//
+static void evaluateCandidates(std::vector<Candidate_t> &candidates, const std::vector<IdentLog_t> &logs, unsigned threads)
+{
+	unsigned n_logs = (unsigned)logs.size();
+	std::vector<double> mse(candidates.size() * n_logs);
+	unsigned i, k;
+
+	parallelFor((unsigned)mse.size(), threads, [&](unsigned index) {
+		ident_model_t model;
+		const IdentLog_t *log = &logs[index % n_logs];
+		buildModel(candidates[index / n_logs].x, &model);
+		mse[index] = getMeanSquare(simulateLog(&model, log, 0), log);
+	});
+
+	for (i = 0; i < candidates.size(); i++)
+	{
+		candidates[i].Cost = 0;
+		for (k = 0; k < n_logs; k++)
+			candidates[i].Cost += mse[i * n_logs + k];
+		candidates[i].Cost /= n_logs;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Output
+//-------------------------------------------------------//
+
+static void printCoefficients(FILE *f, const char *name, const double *coef, unsigned order)
+{
+	unsigned i;
+	fprintf(f, "constexpr double %s[%s+1] = {\n", name, (order == eff_NCoef) ? "eff_NCoef" : "plant_NCoef");
+	for (i = 0; i <= order; i++)
+		fprintf(f, "        %.17e%s\n", coef[i], (i < order) ? "," : "");
+	fprintf(f, "    };\n\n");
+}
+
+static void printLogTable(FILE *f, const char *prefix, const std::vector<IdentLog_t> &logs,
+	const std::vector<double> &current_mse, const std::vector<double> &fitted_mse, const std::vector<double> &fitted_max)
+{
+	unsigned i;
+	fprintf(f, "%s%8s %8s %11s %11s %9s  %s\n", prefix, "samples", "ambient", "current,C", "fitted,C", "max,C", "log");
+	for (i = 0; i < logs.size(); i++)
+	{
+		fprintf(f, "%s%8u %8.1f %11.3f %11.3f %9.2f  %s\n", prefix, (unsigned)logs[i].Temperature.size(), logs[i].Ambient,
+			sqrt(current_mse[i]), sqrt(fitted_mse[i]), fitted_max[i], logs[i].FileName.c_str());
+	}
+}
+
+// Parameter set in the form of plant.cpp and plant_filters.h
+static bool writeParameterSet(const IdentOptions_t *options, const ident_model_t *m, const double *x,
+	const std::vector<IdentLog_t> &logs, double current_cost, double fitted_cost,
+	const std::vector<double> &current_mse, const std::vector<double> &fitted_mse, const std::vector<double> &fitted_max)
+{
+	FILE *f = fopen(options->OutputFile.c_str(), "w");
+	if (!f)
+	{
+		printf("Cannot create %s\n", options->OutputFile.c_str());
+		return false;
+	}
+	fprintf(f, "// Plant model identified by RSim -identify %s\n", options->ManifestFile.c_str());
+	fprintf(f, "// %u logs, RMS error %.3f C (current model %.3f C)\n//\n",
+		(unsigned)logs.size(), sqrt(fitted_cost), sqrt(current_cost));
+	printLogTable(f, "// ", logs, current_mse, fitted_mse, fitted_max);
+
+	fprintf(f, "\n\n// plant.cpp\n");
+	fprintf(f, "static double k_amb = %.6g;\n", m->k_amb);
+	fprintf(f, "static double k_eff = %.6g;\n", m->k_eff);
+	fprintf(f, "static double timeConst = %.6g * TIMESTEP;\t\t// unchanged\n", m->time_const / TIMESTEP);
+
+	fprintf(f, "\n\n// plant_filters.h\n");
+	fprintf(f, "// Effect filter: Chebyshev type I, order %u, ripple %.1f dB, cutoff %.6g Hz at %g Hz, DC gain 1\n",
+		(unsigned)eff_NCoef, IDENT_EFF_FILTER_RIPPLE, exp(x[IDENT_EFF_CUTOFF]), 1.0 / TIMESTEP);
+	printCoefficients(f, "eff_ACoef", m->eff_a, eff_NCoef);
+	printCoefficients(f, "eff_BCoef", m->eff_b, eff_NCoef);
+	fprintf(f, "// Plant output filter: Butterworth, order %u, cutoff %.6g Hz at %g Hz, DC gain 1\n",
+		(unsigned)plant_NCoef, exp(x[IDENT_PLANT_CUTOFF]), 1.0 / TIMESTEP);
+	printCoefficients(f, "plant_ACoef", m->plant_a, plant_NCoef);
+	printCoefficients(f, "plant_BCoef", m->plant_b, plant_NCoef);
+	fclose(f);
+	return true;
+}
+
+
+//-------------------------------------------------------//
+// Defaults for current firmware logs: temperature in the first column,
+// PID set point in the 4th one and PID output in the last (9th) one
+//-------------------------------------------------------//
+void initIdentOptions(IdentOptions_t *options)
+{
+	options->ManifestFile.clear();
+	options->OutputFile.clear();
+	options->Ambient = 25;
+	options->TemperatureColumn = 0;
+	options->EffectColumn = 8;
+	options->SetpointColumn = 3;
+	options->Population = 40;
+	options->Generations = 300;
+	options->Tolerance = 1e-5;
+	options->Seed = 1;
+	options->Threads = 0;
+}
+
+
+//-------------------------------------------------------//
+// Fits k_amb, k_eff and filter cutoffs to the logs by differential evolution.
+// Starts from the current model poles, prints the parameter set and
+// the fit error of every log, writes the set to options->OutputFile.
+// Returns 0 on success
+//-------------------------------------------------------//
+int runPlantIdentification(const IdentOptions_t *options)
+{
+	std::vector<IdentLog_t> logs;
+	std::vector<Candidate_t> population;
+	std::vector<Candidate_t> trials;
+	std::vector<double> current_mse, fitted_mse, fitted_max;
+	ident_model_t current, fitted;
+	Candidate_t candidate;
+	uint32_t seed = options->Seed;
+	unsigned long samples = 0;
+	unsigned long evaluations = 0;
+	unsigned skipped = 0;
+	unsigned threads;
+	unsigned generation = 0;
+	unsigned i, j, best, worst;
+	double current_cost = 0;
+	double error;
+	bool converged = false;
+
+	if (!readIdentManifest(options, logs))
+		return -1;
+	for (i = 0; i < logs.size(); i++)
+	{
+		samples += (unsigned long)logs[i].Temperature.size();
+		skipped += logs[i].Skipped;
+	}
+
+	threads = (options->Threads == 0) ? getDefaultThreadCount() : options->Threads;
+	printf("Identify: %u logs, %lu samples (%u lines skipped), population %u, %u worker threads\n",
+		(unsigned)logs.size(), samples, skipped, options->Population, threads);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	// Current model as is
+	getCurrentModel(&current);
+	for (i = 0; i < logs.size(); i++)
+	{
+		current_mse.push_back(getMeanSquare(simulateLog(&current, &logs[i], 0), &logs[i]));
+		current_cost += current_mse.back() / logs.size();
+	}
+	printf("Current model: RMS error %.3f C\n", sqrt(current_cost));
+
+	// Initial population: current model poles with DC gain 1 and random points
+	candidate.x[IDENT_K_AMB] = log(current.k_amb);
+	candidate.x[IDENT_K_EFF] = log(current.k_eff * getDCGain(current.eff_a, current.eff_b, eff_NCoef));
+	candidate.x[IDENT_EFF_CUTOFF] = log(IDENT_EFF_FILTER_CUTOFF);
+	candidate.x[IDENT_PLANT_CUTOFF] = log(IDENT_PLANT_FILTER_CUTOFF);
+	population.push_back(candidate);
+	while (population.size() < options->Population)
+	{
+		for (j = 0; j < IDENT_PARAMS; j++)
+			candidate.x[j] = log(paramRange[j].Min) + nextUniform(&seed) * (log(paramRange[j].Max) - log(paramRange[j].Min));
+		population.push_back(candidate);
+	}
+	evaluateCandidates(population, logs, threads);
+	evaluations += population.size();
+
+	while ((generation < options->Generations) && !converged)
+	{
+		generation++;
+
+		// Mutant from 3 other random candidates, crossover with the current one
+		trials = population;
+		for (i = 0; i < population.size(); i++)
+		{
+			unsigned r1, r2, r3, forced;
+			do r1 = (unsigned)(nextUniform(&seed) * population.size()); while (r1 == i);
+			do r2 = (unsigned)(nextUniform(&seed) * population.size()); while ((r2 == i) || (r2 == r1));
+			do r3 = (unsigned)(nextUniform(&seed) * population.size()); while ((r3 == i) || (r3 == r1) || (r3 == r2));
+			forced = (unsigned)(nextUniform(&seed) * IDENT_PARAMS);
+			for (j = 0; j < IDENT_PARAMS; j++)
+			{
+				if ((j != forced) && (nextUniform(&seed) >= DE_CROSSOVER))
+					continue;
+				trials[i].x[j] = population[r1].x[j] + DE_WEIGHT * (population[r2].x[j] - population[r3].x[j]);
+				trials[i].x[j] = std::max(trials[i].x[j], log(paramRange[j].Min));
+				trials[i].x[j] = std::min(trials[i].x[j], log(paramRange[j].Max));
+			}
+		}
+		evaluateCandidates(trials, logs, threads);
+		evaluations += trials.size();
+
+		// Selection
+		best = worst = 0;
+		for (i = 0; i < population.size(); i++)
+		{
+			if (trials[i].Cost <= population[i].Cost)
+				population[i] = trials[i];
+			if (population[i].Cost < population[best].Cost)
+				best = i;
+			if (population[i].Cost > population[worst].Cost)
+				worst = i;
+		}
+		converged = (population[worst].Cost - population[best].Cost <= options->Tolerance * population[best].Cost);
+		if ((generation % IDENT_REPORT_EVERY == 0) || converged || (generation == options->Generations))
+			printf("Generation %4u: RMS error %.4f C, worst candidate %.4f C\n", generation,
+				sqrt(population[best].Cost), sqrt(population[worst].Cost));
+	}
+
+	best = 0;
+	for (i = 0; i < population.size(); i++)
+	{
+		if (population[i].Cost < population[best].Cost)
+			best = i;
+	}
+	buildModel(population[best].x, &fitted);
+	for (i = 0; i < logs.size(); i++)
+	{
+		fitted_mse.push_back(getMeanSquare(simulateLog(&fitted, &logs[i], &error), &logs[i]));
+		fitted_max.push_back(error);
+	}
+	double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	printLogTable(stdout, "", logs, current_mse, fitted_mse, fitted_max);
+	printf("Parameters:\n");
+	for (j = 0; j < IDENT_PARAMS; j++)
+		printf("    %-26s %.6g\n", paramRange[j].Name, exp(population[best].x[j]));
+	printf("Identification %s: %u generations, %lu simulations, RMS error %.3f C (current model %.3f C), %.1f s wall\n",
+		converged ? "converged" : "stopped", generation, evaluations * logs.size(),
+		sqrt(population[best].Cost), sqrt(current_cost), wall_time);
+
+	if (options->OutputFile.size() != 0)
+	{
+		if (!writeParameterSet(options, &fitted, population[best].x, logs, current_cost, population[best].Cost,
+			current_mse, fitted_mse, fitted_max))
+			return -1;
+		printf("Parameter set written to %s\n", options->OutputFile.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+
+#ifndef PLANT_IDENT_H_
+#define PLANT_IDENT_H_
+
+#include <string>
+
+
+// Filters of plant_filters.h as filter designs. Poles of the coefficient tables are
+// exactly these designs, but table DC gains are 2.574 (effect) and 0.905 (plant) instead of 1.
+// Identification designs both filters with DC gain 1 and fits the cutoff frequencies.
+#define IDENT_EFF_FILTER_RIPPLE		1.0				// dB, Chebyshev type I of order eff_NCoef
+#define IDENT_EFF_FILTER_CUTOFF		(1.0 / 150)		// Hz
+#define IDENT_PLANT_FILTER_CUTOFF	(1.0 / 60)		// Hz, Butterworth of order plant_NCoef
+
+
+typedef struct
+{
+	std::string ManifestFile;		// List of temperature logs
+	std::string OutputFile;			// Parameter set for plant.cpp and plant_filters.h, empty - console only
+	double Ambient;					// For logs without ambient temperature in the manifest
+	unsigned TemperatureColumn;		// Log columns, counted from 0
+	unsigned EffectColumn;
+	int SetpointColumn;				// Heater is off when set point is 0, -1 - not logged
+	unsigned Population;			// Candidates per generation
+	unsigned Generations;			// Max number of generations
+	double Tolerance;				// Stop when costs of all candidates are within this relative range
+	unsigned Seed;
+	unsigned Threads;				// 0 - all hardware threads
+} IdentOptions_t;
+
+
+void initIdentOptions(IdentOptions_t *options);
+int runPlantIdentification(const IdentOptions_t *options);
+
+
+#endif /* PLANT_IDENT_H_ */
@@ -0,0 +1,142 @@
+
+#include <math.h>
+
+#include "response_metrics.h"
+#include "simulation.h"
+#include "stdint.h"
+extern "C" {
+	#include "pid_controller.h"
+}
+
+
+
+ResponseAnalyzer::ResponseAnalyzer()
+{
+	SampleInterval = TIMESTEP;
+	InSegment = false;
+	SegmentStart = 0;
+	SegmentStartState = 0;
+	SegmentSetting = 0;
+	Time10 = -1;
+	Time90 = -1;
+	LastOutsideBand = 0;
+	LastInsideBand = false;
+	SegmentOvershoot = 0;
+	SegmentLastTime = 0;
+	SteadyAverage = 0;
+	Result.RiseTime = 0;
+	Result.Overshoot = 0;
+	Result.SettlingTime = 0;
+	Result.IAE = 0;
+	Result.SteadyError = 0;
+	Result.Duty = 0;
+	NotReached = false;
+	NotSettled = false;
+	OutputSum = 0;
+	EnabledSteps = 0;
+}
+
+
+//-------------------------------------------------------//
+// Adds results of current segment to totals
+//-------------------------------------------------------//
+void ResponseAnalyzer::CloseSegment(void)
+{
+	if (!InSegment)
+		return;
+	InSegment = false;
+
+	if (SegmentOvershoot > Result.Overshoot)
+		Result.Overshoot = SegmentOvershoot;
+
+	if ((SegmentLastTime - SegmentStart >= STEADY_MIN_TIME) && (fabs(SteadyAverage) > fabs(Result.SteadyError)))
+		Result.SteadyError = SteadyAverage;
+
+	if (fabs(SegmentSetting - SegmentStartState) < MIN_STEP_SIZE)
+		return;
+
+	if ((Time10 < 0) || (Time90 < 0))
+		NotReached = true;
+	else if (Time90 - Time10 > Result.RiseTime)
+		Result.RiseTime = Time90 - Time10;
+
+	if (!LastInsideBand)
+		NotSettled = true;
+	else if (LastOutsideBand - SegmentStart > Result.SettlingTime)
+		Result.SettlingTime = LastOutsideBand - SegmentStart;
+}
+
+
+//-------------------------------------------------------//
+// Processes one simulation step (or one sample, see SetSampleInterval())
+//	time - simulation time, s
+//	state - plant state, Celsius
+//	setting - temperature setting, Celsius
+//	enabled - heater is controlled
+//	output - controller output, 0 to PID_OUTPUT_MAX
+//-------------------------------------------------------//
+void ResponseAnalyzer::Update(double time, double state, double setting, bool enabled, int output)
+{
+	double progress;
+	double direction;
+	double deviation;
+
+	if (!enabled)
+	{
+		CloseSegment();
+		return;
+	}
+
+	if (!InSegment || (setting != SegmentSetting))
+	{
+		CloseSegment();
+		InSegment = true;
+		SegmentStart = time;
+		SegmentStartState = state;
+		SegmentSetting = setting;
+		Time10 = -1;
+		Time90 = -1;
+		LastOutsideBand = time;
+		SegmentOvershoot = 0;
+		SteadyAverage = state - setting;
+	}
+	SegmentLastTime = time;
+	SteadyAverage += (state - SegmentSetting - SteadyAverage) * (SampleInterval / STEADY_AVERAGE_TIME);
+
+	direction = (SegmentSetting >= SegmentStartState) ? 1.0 : -1.0;
+	if (SegmentSetting != SegmentStartState)
+	{
+		progress = (state - SegmentStartState) / (SegmentSetting - SegmentStartState);
+		if ((Time10 < 0) && (progress >= 0.1))
+			Time10 = time;
+		if ((Time90 < 0) && (progress >= 0.9))
+			Time90 = time;
+	}
+
+	deviation = (state - SegmentSetting) * direction;
+	if (deviation > SegmentOvershoot)
+		SegmentOvershoot = deviation;
+
+	LastInsideBand = (fabs(state - SegmentSetting) <= SETTLING_BAND);
+	if (!LastInsideBand)
+		LastOutsideBand = time;
+
+	Result.IAE += fabs(SegmentSetting - state) * SampleInterval;
+	OutputSum += output;
+	EnabledSteps++;
+}
+
+
+//-------------------------------------------------------//
+// Returns accumulated metrics
+//-------------------------------------------------------//
+void ResponseAnalyzer::Finish(ResponseMetrics_t *metrics)
+{
+	CloseSegment();
+	*metrics = Result;
+	if (NotReached)
+		metrics->RiseTime = -1;
+	if (NotSettled)
+		metrics->SettlingTime = -1;
+	metrics->Duty = (EnabledSteps != 0) ? (OutputSum * 100.0 / PID_OUTPUT_MAX / EnabledSteps) : 0;
+}
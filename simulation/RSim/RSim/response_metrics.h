@@ -0,0 +1,57 @@
+
+#ifndef RESPONSE_METRICS_H_
+#define RESPONSE_METRICS_H_
+
+
+#define SETTLING_BAND		1.0			// Celsius, plant state is settled when |setting - state| <= SETTLING_BAND
+#define MIN_STEP_SIZE		5.0			// Celsius, smaller setting changes are not used for rise and settling time
+#define STEADY_AVERAGE_TIME	60.0		// s, time constant of plant state averaging for steady state error
+#define STEADY_MIN_TIME		600.0		// s, shorter setting segments are not used for steady state error
+
+
+// Closed loop quality of a single simulation
+// Rise time, overshoot and settling time are the worst values among all setting steps
+typedef struct
+{
+	double RiseTime;				// s, 10% -> 90% of setting step, < 0 if setting has not been reached
+	double Overshoot;				// Celsius, past the setting in the direction of step
+	double SettlingTime;			// s, from setting step to staying within SETTLING_BAND, < 0 if not settled
+	double IAE;						// Celsius * s, integral of |setting - state| while heater is enabled
+	double SteadyError;				// Celsius, state - setting averaged at the end of a segment, largest by magnitude
+	double Duty;					// %, mean controller output while heater is enabled
+} ResponseMetrics_t;
+
+
+// Accumulates ResponseMetrics_t from simulation steps
+class ResponseAnalyzer
+{
+public:
+	ResponseAnalyzer();
+	void SetSampleInterval(double interval) { SampleInterval = interval; }
+	void Update(double time, double state, double setting, bool enabled, int output);
+	void Finish(ResponseMetrics_t *metrics);
+private:
+	void CloseSegment(void);
+	// Current segment - constant setting
+	bool InSegment;
+	double SegmentStart;
+	double SegmentStartState;
+	double SegmentSetting;
+	double Time10;
+	double Time90;
+	double LastOutsideBand;
+	bool LastInsideBand;
+	double SegmentOvershoot;
+	double SegmentLastTime;
+	double SteadyAverage;
+	// Totals
+	double SampleInterval;			// s, time between Update() calls
+	ResponseMetrics_t Result;
+	bool NotReached;
+	bool NotSettled;
+	double OutputSum;
+	unsigned long EnabledSteps;
+};
+
+
+#endif /* RESPONSE_METRICS_H_ */
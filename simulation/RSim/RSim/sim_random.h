@@ -0,0 +1,48 @@
+
+#ifndef SIM_RANDOM_H_
+#define SIM_RANDOM_H_
+
+#include <math.h>
+#include "stdint.h"
+
+
+// Deterministic random number generator (SplitMix64).
+// Same seed gives the same sequence with every compiler and library,
+// unlike std:: distributions.
+class SimRandom
+{
+public:
+	SimRandom(uint64_t seed = 0) { Seed(seed); }
+	void Seed(uint64_t seed) { State = seed; Spare = 0; HasSpare = false; }
+	uint64_t Next(void)
+	{
+		uint64_t z = (State += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+	// [0, 1)
+	double Uniform(void) { return (Next() >> 11) * (1.0 / 9007199254740992.0); }
+	// Standard normal, Box-Muller
+	double Normal(void)
+	{
+		double u, v;
+		if (HasSpare)
+		{
+			HasSpare = false;
+			return Spare;
+		}
+		u = 1.0 - Uniform();
+		v = Uniform();
+		Spare = sqrt(-2.0 * log(u)) * sin(6.283185307179586 * v);
+		HasSpare = true;
+		return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+	}
+private:
+	uint64_t State;
+	double Spare;
+	bool HasSpare;
+};
+
+
+#endif /* SIM_RANDOM_H_ */
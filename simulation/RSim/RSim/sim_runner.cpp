@@ -0,0 +1,399 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <string>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "vector_reader.h"
+#include "sim_runner.h"
+#include "trace_file.h"
+
+#include "stdint.h"
+#include "simulation.h"
+#include "plant.h"
+#include "plant_jump.h"
+#include "adc_chain.h"
+#include "sim_random.h"
+
+
+
+//-------------------------------------------------------//
+// Sets default job options: NORMAL mode, text log of all channels, default PID gains
+//-------------------------------------------------------//
+void initSimJob(SimJob_t *job)
+{
+	job->InputFile.clear();
+	job->OutputDir.clear();
+	job->Mode = SIM_NORMAL;
+	job->Verbose = false;
+	job->TraceFormat = TRACE_TEXT;
+	job->TraceChannels = TRACE_ALL_CHANNELS;
+	job->Gains = NULL;
+	job->OutputInterval = 1;
+	job->JumpAhead = false;
+	job->Variation = NULL;
+	job->AdcEmulation = false;
+	job->AdcNoise = 0;
+}
+
+//-------------------------------------------------------//
+// Converts simulation mode name to SimulationMode
+// Returns -1 if name is unknown
+//-------------------------------------------------------//
+int parseSimulationMode(const char *mode_str)
+{
+	if (strcmp(mode_str, "PLANT_STEP") == 0)
+		return SIM_PLANT_STEP_RESPONSE;
+	if (strcmp(mode_str, "NORMAL") == 0)
+		return SIM_NORMAL;
+	return -1;
+}
+
+const char *getSimulationModeName(int mode)
+{
+	return (mode == SIM_PLANT_STEP_RESPONSE) ? "PLANT_STEP" : "NORMAL";
+}
+
+//-------------------------------------------------------//
+// Creates output directory together with missing parent directories
+// Returns true if directory has been created or already exists
+//-------------------------------------------------------//
+static bool makeDirectory(const std::string &path)
+{
+	int result;
+#ifdef _WIN32
+	result = _mkdir(path.c_str());
+#else
+	result = mkdir(path.c_str(), 0777);
+#endif
+	return (result == 0) || (errno == EEXIST);
+}
+
+bool createOutputDirectory(const char *path)
+{
+	std::string dir = path;
+	size_t i;
+
+	for (i = 1; i < dir.size(); i++)
+	{
+		if (((dir[i] == '/') || (dir[i] == '\\')) && (dir[i - 1] != ':') && (dir[i - 1] != '.'))
+		{
+			if (!makeDirectory(dir.substr(0, i)))
+				return false;
+		}
+	}
+	return makeDirectory(dir);
+}
+
+//-------------------------------------------------------//
+// Jump-ahead pays off only when events are sparse: PLANT_STEP mode (no PID calls) with
+// logged samples JUMP_MIN_OUTPUT_SECONDS or more apart - about 2.5x faster than stepping
+// at 10 s, 12x at 60 s. PID calls every 4 s of NORMAL mode leave about 1.3x, and logging
+// every second is slower than stepping. Other jobs step through with the same results.
+//-------------------------------------------------------//
+bool isJumpAheadUsed(const SimJob_t *job)
+{
+	return job->JumpAhead && (job->Mode == SIM_PLANT_STEP_RESPONSE) &&
+		(job->OutputInterval >= JUMP_MIN_OUTPUT_SECONDS * STEPS_PER_SECOND);
+}
+
+//-------------------------------------------------------//
+// Returns the first step >= step that is not a plain plant step:
+// test vector record, PID call or logged sample.
+// ADC chain needs every one of the last ADC_CHAIN_STEPS steps before PID call.
+//-------------------------------------------------------//
+static unsigned long getNextEventStep(unsigned long step, unsigned long vector_time, bool pid_control, bool adc_chain, unsigned output_interval)
+{
+	unsigned long next = ((step + output_interval - 1) / output_interval) * output_interval;
+	unsigned long vector_step = vector_time * STEPS_PER_SECOND;
+	unsigned long pid_step = ((step + PID_STEP_INTERVAL - 1) / PID_STEP_INTERVAL) * PID_STEP_INTERVAL;
+
+	if ((vector_step >= step) && (vector_step < next))
+		next = vector_step;
+	if (adc_chain)
+		pid_step = (pid_step - step < ADC_CHAIN_STEPS) ? step : pid_step - (ADC_CHAIN_STEPS - 1);
+	if (pid_control && (pid_step < next))
+		next = pid_step;
+	return next;
+}
+
+//-------------------------------------------------------//
+// Runs simulation of single test vector file
+// Function uses only its own plant and PID instances, so several
+// simulations may run in parallel threads.
+//-------------------------------------------------------//
+bool runSimulation(const SimJob_t *job, SimResult_t *result)
+{
+	VectorReader myVectorReader;
+	VectorRecord_t currentVector;
+	plant_t plant;
+	PlantJump jump;
+	pid_state_t pid;
+	TraceWriter trace;
+	TraceSample_t sample;
+	ResponseAnalyzer analyzer;
+	SimRandom noise;
+	AdcChain adc;
+
+	unsigned long seconds_counter = 0;
+	unsigned long steps_counter = 0;
+	unsigned long next_step;
+	unsigned output_interval = (job->OutputInterval == 0) ? 1 : job->OutputInterval;
+	bool update_vector = false;
+	bool update_PID_control = false;
+	bool last_iteration = false;
+	bool jump_ahead = isJumpAheadUsed(job);
+	bool log_sample;
+	double sensor_state;
+
+	float plantState;
+	float processF;
+	uint16_t processValue;
+	float setPointF;
+	uint16_t setPoint;
+	float effect = 0;
+
+	float k_norm = NORM_K;
+	float offset_norm = NORM_OFFSET;
+
+	float tempSetting;							// Temperature setting
+	bool reg_enabled;								// Heater ON/OFF
+	uint8_t pid_mode;
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	result->Success = false;
+	result->SimulatedSeconds = 0;
+	result->WallSeconds = 0;
+
+	//-----------------------------//
+	// Reading test vector file
+	myVectorReader.Verbose = job->Verbose;
+	if (myVectorReader.ReadVectorFile(job->InputFile.c_str()) == false)
+	{
+		result->Message = "Cannot read test vector file";
+		return false;
+	}
+
+	if (job->Verbose)
+		printf("Test vector file OK. Starting simulation.\n");
+
+
+	//-----------------------------//
+	// Initializing simulation
+
+	if ((job->TraceFormat != TRACE_NONE) && !createOutputDirectory(job->OutputDir.c_str()))
+	{
+		result->Message = "Cannot create output log directory";
+		return false;
+	}
+
+	// Create log data files
+	if (!trace.Open(job->OutputDir, job->TraceFormat, job->TraceChannels, TIMESTEP * output_interval))
+	{
+		result->Message = "Cannot create log data files";
+		return false;
+	}
+
+	// Set ambient temperature and plant internal state
+	if (!myVectorReader.StartConditions.AmbientValid)
+		myVectorReader.StartConditions.Ambient = 25;
+	if (!myVectorReader.StartConditions.StateValid)
+		myVectorReader.StartConditions.SystemState = 25;
+	if (job->Variation)
+	{
+		// Machine standing in the workshop has ambient temperature
+		initPlant(&plant, job->Variation->Ambient, myVectorReader.StartConditions.StateValid ?
+			(float)myVectorReader.StartConditions.SystemState : job->Variation->Ambient);
+		setPlantVariation(&plant, job->Variation->AmbientLossScale, job->Variation->GainScale, job->Variation->TimeScale);
+		noise.Seed(job->Variation->NoiseSeed);
+	}
+	else
+	{
+		initPlant(&plant, (float)myVectorReader.StartConditions.Ambient, (float)myVectorReader.StartConditions.SystemState);
+	}
+	processPlant(&plant, 0);
+	if (job->AdcEmulation)
+	{
+		adc.Init(getPlantState(&plant), job->Variation ? job->Variation->SensorNoise : job->AdcNoise,
+			job->Variation ? job->Variation->NoiseSeed : 0);
+	}
+
+	// Initialize PID controller
+	initPID(&pid);
+	if (job->Gains)
+		setPIDGains(&pid, job->Gains);
+	setPIDIntegratorLimit(&pid, 0);
+
+	// Initial simulator state
+	reg_enabled = false;		// heater OFF
+	tempSetting = 25.0f;		// Temperature default setting
+	myVectorReader.GetNextVector(&currentVector);
+
+	//-----------------------------//
+	// Simulate
+
+	if (jump_ahead)
+		analyzer.SetSampleInterval(TIMESTEP * output_interval);
+
+	while(true)
+	{
+		// Skip plain plant steps - effect and ambient are constant until the next event
+		if (jump_ahead)
+		{
+			next_step = getNextEventStep(steps_counter, currentVector.TimeStamp, (job->Mode != SIM_PLANT_STEP_RESPONSE),
+				job->AdcEmulation, output_interval);
+			jump.Advance(&plant, effect, next_step - steps_counter);
+			if (job->AdcEmulation)
+				adc.Skip(next_step - steps_counter);
+			steps_counter = next_step;
+			seconds_counter = (steps_counter + STEPS_PER_SECOND - 1) / STEPS_PER_SECOND;
+		}
+
+		// Process time counters
+		update_vector = false;
+		update_PID_control = false;
+		if (steps_counter % STEPS_PER_SECOND == 0)
+		{
+			if (seconds_counter == currentVector.TimeStamp)
+			{
+				update_vector = true;
+			}
+			if (seconds_counter % PID_CALL_INTERVAL == 0)
+			{
+				update_PID_control = true;
+			}
+			seconds_counter++;
+		}
+		steps_counter++;
+
+		// Update setting using data from test vector file
+		if (update_vector)
+		{
+			if (last_iteration)
+			{
+				if (job->Verbose)
+					printf("%10lu sec. Simulation finished.\n", currentVector.TimeStamp);
+				break;
+			}
+
+			reg_enabled = currentVector.ProcessEnabled;
+			if (reg_enabled)
+			{
+				tempSetting = (float)currentVector.ForceValue;
+				setPIDIntegratorLimit(&pid, (int)tempSetting);
+			}
+
+			if (job->Verbose)
+			{
+				if (reg_enabled)
+					printf("%10lu sec. New setting = %.2f\n", currentVector.TimeStamp, tempSetting);
+				else
+					printf("%10lu sec. New setting = %s\n", currentVector.TimeStamp, "OFF");
+			}
+
+			last_iteration = !myVectorReader.GetNextVector(&currentVector);
+		}
+
+
+		// Process plant with TIMESTEP interval
+		processPlant(&plant, effect);
+		if (job->AdcEmulation)
+		{
+			sensor_state = getPlantState(&plant);
+			if (job->Variation)
+				sensor_state = sensor_state * (1.0 + job->Variation->CalibrationError) + job->Variation->SensorOffset;
+			adc.Step(sensor_state);
+		}
+
+		// Process regulator
+		if (job->Mode == SIM_PLANT_STEP_RESPONSE)
+		{
+				if (reg_enabled)
+					effect = 100;
+				else
+					effect = 0;
+				pid.dbg_output = (int16_t)effect;
+		}
+		else
+		{
+				if (update_PID_control && job->AdcEmulation)
+				{
+					// Same as control.c: PID input is adc_filtered in PID counts, sensor error turns the heater off
+					processValue = ADC_TO_PID_COUNTS(adc.GetFiltered());
+					setPoint = ADC_TO_PID_COUNTS(adc.CelsiusToADC((int16_t)tempSetting));
+					pid_mode = 0;
+					if (reg_enabled && !(adc.GetStatus() & (ADC_SENSOR_NO_PRESENT | ADC_SENSOR_SHORTED)))
+						pid_mode |= PID_ENABLED;
+					effect = processPID(&pid, setPoint, processValue, pid_mode);
+				}
+				else if (update_PID_control)
+				{
+					// Calculate process value
+					plantState = (float)getPlantState(&plant);
+					if (job->Variation)
+					{
+						plantState = (float)(plantState * (1.0 + job->Variation->CalibrationError) +
+							job->Variation->SensorOffset + job->Variation->SensorNoise * noise.Normal());
+					}
+					processF = (plantState + offset_norm) / k_norm;
+					processF *= 4;
+					//processF /= 2;
+					processValue = (uint16_t)processF;
+
+					// Calculate setpoint
+					setPointF = (tempSetting + offset_norm) / k_norm;
+					setPointF *= 4;
+					//setPointF /= 2;
+					setPoint = (uint16_t)setPointF;
+
+					// PID
+					pid_mode = 0;
+					if (reg_enabled)
+						pid_mode |= PID_ENABLED;
+					effect = processPID(&pid, setPoint, processValue, pid_mode);
+				}
+		}
+
+
+		// Response is analyzed every step, or at logged samples only when plant steps are skipped
+		log_sample = ((steps_counter - 1) % output_interval == 0);
+		if (!jump_ahead || log_sample)
+			analyzer.Update((steps_counter - 1) * TIMESTEP, getPlantState(&plant), tempSetting, reg_enabled, pid.dbg_output);
+
+		// LOG
+		if (!log_sample)
+			continue;
+		sample.PlantState = getPlantState(&plant);
+		sample.PlantStateInt = (uint16_t)sample.PlantState;
+		sample.Setting = (int32_t)tempSetting;
+		sample.PTerm = pid.dbg_p_term;
+		sample.DTerm = pid.dbg_d_term;
+		sample.ITerm = pid.dbg_i_term;
+		sample.Output = pid.dbg_output;
+		trace.Write(&sample);
+
+	}
+
+	//-------------------------------//
+
+	if (!trace.Close())
+	{
+		result->Message = "Cannot write log data files";
+		return false;
+	}
+
+	analyzer.Finish(&result->Metrics);
+	result->Success = true;
+	result->SimulatedSeconds = currentVector.TimeStamp;
+	result->WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	return true;
+}
@@ -0,0 +1,68 @@
+
+#ifndef SIM_RUNNER_H_
+#define SIM_RUNNER_H_
+
+#include <string>
+#include "stdint.h"
+#include "response_metrics.h"
+extern "C" {
+	#include "pid_controller.h"
+}
+
+
+enum SimulationMode {SIM_PLANT_STEP_RESPONSE, SIM_NORMAL};
+
+#define JUMP_MIN_OUTPUT_SECONDS		10		// Shortest log interval of jump-ahead, see isJumpAheadUsed()
+
+
+// Machine to machine differences: plant parameters, ambient, temperature sensor
+typedef struct
+{
+	double Ambient;					// Celsius, ambient and initial plant state (unless test vector sets .state)
+	double AmbientLossScale;		// Plant k_amb multiplier
+	double GainScale;				// Plant k_eff multiplier
+	double TimeScale;				// Plant time constant multiplier
+	double SensorOffset;			// Celsius, added to measured temperature
+	double SensorNoise;				// Celsius RMS, white noise of measured temperature (of every ADC conversion with AdcChain)
+	double CalibrationError;		// Relative sensor gain error, measured = state * (1 + error) + offset
+	uint64_t NoiseSeed;
+} SimVariation_t;
+
+
+// Single simulation job - one test vector file
+typedef struct
+{
+	std::string InputFile;			// Test vector file
+	std::string OutputDir;			// Directory for log data files
+	int Mode;						// SimulationMode
+	bool Verbose;					// Print simulation progress to console
+	int TraceFormat;				// TraceFormat - log data format
+	unsigned TraceChannels;			// Mask of logged TraceChannel items
+	const pid_gains_t *Gains;		// PID controller gains, NULL - default
+	unsigned OutputInterval;		// Steps between logged samples, 1 - every step
+	bool JumpAhead;					// Advance plant from event to event at once, see PlantJump and isJumpAheadUsed()
+	const SimVariation_t *Variation;	// NULL - nominal plant and ideal sensor, ambient from test vector
+	bool AdcEmulation;				// PID input from firmware ADC chain emulation, see AdcChain
+	double AdcNoise;				// Celsius RMS of every ADC conversion if there is no Variation
+} SimJob_t;
+
+// Result of a single simulation job
+typedef struct
+{
+	bool Success;
+	std::string Message;			// Error description if Success is false
+	unsigned long SimulatedSeconds;	// Simulated time, seconds
+	double WallSeconds;				// Host time spent, seconds
+	ResponseMetrics_t Metrics;		// Closed loop quality
+} SimResult_t;
+
+
+void initSimJob(SimJob_t *job);
+int parseSimulationMode(const char *mode_str);
+const char *getSimulationModeName(int mode);
+bool createOutputDirectory(const char *path);
+bool isJumpAheadUsed(const SimJob_t *job);
+bool runSimulation(const SimJob_t *job, SimResult_t *result);
+
+
+#endif /* SIM_RUNNER_H_ */
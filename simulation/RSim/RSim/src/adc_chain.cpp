@@ -0,0 +1,189 @@
+
+#include "adc_chain.h"
+
+
+static_assert(ADC_CHAIN_STEPS * ADC_UPDATES_PER_STEP > ADC_FIR_N, "Chain steps must hold FIR updates and the CIC window before them");
+static_assert(ADC_DECIMATION % 2 == 0, "Conversion pairs must not cross CIC outputs");
+
+#define ADC_CIC_GAIN	((uint32_t)ADC_DECIMATION * ADC_DECIMATION)
+
+AdcChain::AdcChain()
+{
+	Init(25, 0, 0);
+}
+
+//-------------------------------------------------------//
+// Sets sensor temperature history, noise (Celsius RMS per conversion)
+// and calibration. Calibration points are measured without noise,
+// the same way as update_CalibrationPoint() takes adc_filtered of a settled sensor
+// (16x sample) in PID counts.
+//-------------------------------------------------------//
+void AdcChain::Init(double celsius, double noise, uint64_t seed)
+{
+	unsigned i;
+	uint16_t cp1_adc = (uint16_t)(Sample(ADC_CALIBRATION_POINT1, 0) * 4);
+	uint16_t cp2_adc = (uint16_t)(Sample(ADC_CALIBRATION_POINT2, 0) * 4);
+	int16_t temp = (int16_t)((cp2_adc - cp1_adc) << ADC_EXTRA_BITS);
+
+	// calculateCoeffs()
+	KNorm = ((int32_t)(ADC_CALIBRATION_POINT2 - ADC_CALIBRATION_POINT1) * ADC_COEFF_SCALE + (int32_t)(temp >> 1)) / ((int32_t)temp);
+	OffsetNorm = (int32_t)ADC_CALIBRATION_POINT1 * ADC_COEFF_SCALE - ((int32_t)cp1_adc << ADC_EXTRA_BITS) * KNorm;
+
+	for (i = 0; i < ADC_CHAIN_STEPS; i++)
+		History[i] = celsius;
+	Steps = ADC_CHAIN_STEPS;
+	NoiseCounts = noise / NORM_K;
+	NoiseScale = NoiseCounts * 2.449489742783178 / 65536.0;
+	Seed = seed;
+	Valid = false;
+}
+
+void AdcChain::Step(double celsius)
+{
+	History[Steps % ADC_CHAIN_STEPS] = celsius;
+	Steps++;
+	Valid = false;
+}
+
+void AdcChain::Skip(uint64_t steps)
+{
+	Steps += steps;
+	Valid = false;
+}
+
+//-------------------------------------------------------//
+// 10-bit conversion of the sensor output (normalized ADC counts with noise), rounded to nearest
+//-------------------------------------------------------//
+static inline uint16_t quantize(double normalized)
+{
+	double adc = 1024.5 - normalized;
+	if (adc < 0)
+		return 1024;
+	if (adc >= 1024)
+		return 1;
+	return (uint16_t)(1024 - (int)adc);
+}
+
+uint16_t AdcChain::Sample(double celsius, double noise) const
+{
+	return quantize((celsius + NORM_OFFSET) / NORM_K + noise);
+}
+
+//-------------------------------------------------------//
+// Noise of a single conversion, normalized ADC counts.
+// Sum of two 16-bit uniform numbers (triangular distribution) scaled to NoiseCounts RMS.
+// One SplitMix64 output serves two successive conversions.
+//-------------------------------------------------------//
+static inline uint64_t hashConversions(uint64_t seed, uint64_t pair)
+{
+	uint64_t z = seed + (pair + 1) * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline double getTriangular(uint32_t bits, double scale)
+{
+	return (double)((int32_t)((bits & 0xFFFF) + (bits >> 16)) - 65536) * scale;
+}
+
+double AdcChain::GetNoise(uint64_t conversion) const
+{
+	uint64_t z = hashConversions(Seed, conversion >> 1);
+	return getTriangular((uint32_t)((conversion & 1) ? (z >> 32) : z), NoiseScale);
+}
+
+//-------------------------------------------------------//
+// Runs update_normalized_adc() for the last ADC_FIR_N main loop updates.
+// Every update is a block of ADC_DECIMATION conversions. CIC output of an update
+// weights its block with ADC_DECIMATION to 1 and the block before with ADC_DECIMATION - 1 to 0,
+// so it is computed from the plain and index-weighted summs of both blocks.
+// FIR sum is the same as fir_i16_i8() with a filled filter buffer.
+//-------------------------------------------------------//
+void AdcChain::Evaluate(void)
+{
+	uint32_t block_summ[ADC_FIR_N + 1];		// [0] is the oldest block
+	uint32_t block_moment[ADC_FIR_N + 1];	// Summ of conversions multiplied by their index in the block
+	int16_t oversampled[ADC_FIR_N];			// [0] is the newest
+	uint64_t first = Steps * ADC_UPDATES_PER_STEP - ADC_FIR_N - 1;
+	uint64_t update, conversion, hash;
+	unsigned i, b;
+	uint32_t sample, cic;
+	double normalized;
+	int32_t summ;
+
+	for (b = 0; b <= ADC_FIR_N; b++)
+	{
+		update = first + b;
+		normalized = (History[(update / ADC_UPDATES_PER_STEP) % ADC_CHAIN_STEPS] + NORM_OFFSET) / NORM_K;
+		if (NoiseCounts == 0)
+		{
+			sample = quantize(normalized);
+			block_summ[b] = sample * ADC_DECIMATION;
+			block_moment[b] = sample * (ADC_DECIMATION * (ADC_DECIMATION - 1) / 2);
+			continue;
+		}
+		block_summ[b] = 0;
+		block_moment[b] = 0;
+		conversion = update * ADC_DECIMATION;
+		for (i = 0; i < ADC_DECIMATION; i += 2)
+		{
+			hash = hashConversions(Seed, (conversion + i) >> 1);
+			sample = quantize(normalized + getTriangular((uint32_t)hash, NoiseScale));
+			block_summ[b] += sample;
+			block_moment[b] += sample * i;
+			sample = quantize(normalized + getTriangular((uint32_t)(hash >> 32), NoiseScale));
+			block_summ[b] += sample;
+			block_moment[b] += sample * (i + 1);
+		}
+	}
+
+	for (b = 1; b <= ADC_FIR_N; b++)
+	{
+		cic = block_summ[b] * ADC_DECIMATION - block_moment[b] + block_moment[b - 1];
+		oversampled[ADC_FIR_N - b] = (int16_t)(((cic << 4) + (ADC_CIC_GAIN >> 1)) / ADC_CIC_GAIN);
+	}
+
+	summ = 0;
+	for (i = 0; i < ADC_FIR_N; i++)
+		summ += (int32_t)oversampled[i] * adc_fir_coeffs[i];
+	Filtered = (uint16_t)(int16_t)(summ / ADC_FIR_DC_GAIN);
+	Normalized = (uint16_t)oversampled[0] >> 4;
+	Status = 0;
+	if (Normalized < ADC_LOW_CORRECT)
+		Status |= ADC_SENSOR_NO_PRESENT;
+	else if (Normalized > ADC_HIGH_CORRECT)
+		Status |= ADC_SENSOR_SHORTED;
+	Valid = true;
+}
+
+uint16_t AdcChain::GetFiltered(void)
+{
+	if (!Valid)
+		Evaluate();
+	return Filtered;
+}
+
+uint16_t AdcChain::GetNormalized(void)
+{
+	if (!Valid)
+		Evaluate();
+	return Normalized;
+}
+
+uint8_t AdcChain::GetStatus(void)
+{
+	if (!Valid)
+		Evaluate();
+	return Status;
+}
+
+uint16_t AdcChain::CelsiusToADC(int16_t celsius) const
+{
+	return (uint16_t)(((int32_t)celsius * ADC_COEFF_SCALE - OffsetNorm + (KNorm >> 1)) / KNorm);
+}
+
+int16_t AdcChain::ADCToCelsius(uint16_t adc) const
+{
+	return (int16_t)(((int32_t)adc * KNorm + OffsetNorm + (ADC_COEFF_SCALE >> 1)) / ADC_COEFF_SCALE);
+}
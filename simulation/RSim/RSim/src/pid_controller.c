@@ -15,38 +15,57 @@
 
 
 
- 
-int16_t dbg_PID_p_term;
-int16_t dbg_PID_d_term;
-int16_t dbg_PID_i_term;
-int16_t dbg_PID_output;
 
 
 // Nice new model
 
 //TODO: increase resolution of PID output
-//TODO: check code size with integAcc declared as static local or global
 //TODO: pack debug info into structure
 //TODO: optimize log - use pointers, etc
 
 
-static uint16_t integ_soft_k;
+// Returns compile-time gains
+void getDefaultPIDGains(pid_gains_t *gains)
+{
+	gains->kp = Kp;
+	gains->ki = Ki;
+	gains->kd = Kd;
+	gains->integrator_scale = INTEGRATOR_SCALE;
+	gains->scaling_factor = SCALING_FACTOR;
+	gains->integ_soft_slope = INTEGRATOR_SOFT_SLOPE;
+}
+
+// Resets controller state and sets default gains
+// Call this function once before the first processPID() call
+void initPID(pid_state_t *pid)
+{
+	memset(pid, 0, sizeof(pid_state_t));
+	getDefaultPIDGains(&pid->gains);
+}
+
+// Sets controller gains. kp, kd, integrator_scale and scaling_factor must not be 0
+// Call setPIDIntegratorLimit() after this function
+void setPIDGains(pid_state_t *pid, const pid_gains_t *gains)
+{
+	pid->gains = *gains;
+}
 
 // Sets maximum integrator value for particular temperature setting point in order to reduce wind-up
 // Argument is Celsius degree
 // Call this function every time when the set point is changed and once during initialization
-void setPIDIntegratorLimit(uint8_t set_temp)
+void setPIDIntegratorLimit(pid_state_t *pid, uint8_t set_temp)
 {
 	// Integrator maximum is computed as integ_soft_k * (INTEGRATOR_SOFT_RANGE - error), see the processPID()
 	// When error = 0, maximum is simply integ_soft_k * INTEGRATOR_SOFT_RANGE
 	// integ_soft_k is chosen for desired maximum
 	// For example, we want integrator maximum of about 30% at 90C. Then integ_soft_k = 300_000 / INTEGRATOR_SOFT_RANGE = 862
 	// The "magic" coefficient in the integ_soft_k expression should be 862 / (90 - 15) = 11.49 => 12
+	// (INTEGRATOR_SOFT_SLOPE, gains.integ_soft_slope)
 	
 	if (set_temp < 50)
 		set_temp = 50;
 	set_temp -= 15;
-	integ_soft_k = (uint16_t)set_temp * 12;
+	pid->integ_soft_k = (uint16_t)set_temp * pid->gains.integ_soft_slope;
 }
 
 
@@ -58,40 +77,39 @@ void setPIDIntegratorLimit(uint8_t set_temp)
 //	processValue - actual process value
 //	mode - enable/disable controller - 
 //	  terms are calculated anyway, but output is set to 0 when disabled
-uint8_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode)
+uint8_t processPID(pid_state_t *pid, uint16_t setPoint, uint16_t processValue, uint8_t mode)
 {
-	static uint16_t lastProcessValue;
-	static int32_t integAcc;
 	int16_t error, p_term, i_term, d_term, temp;
 	int32_t integ_max;
+	int16_t soft_range = PROP_MAX / pid->gains.kp;		// INTEGRATOR_SOFT_RANGE
 
 	// Get the error
 	error = setPoint - processValue;
 	
 	//------ Calculate P term --------//
-	if (error > (PROP_MAX / Kp))			// Compare before multiplication to avoid overflow
+	if (error > (PROP_MAX / pid->gains.kp))			// Compare before multiplication to avoid overflow
 	{
 		p_term = PROP_MAX;	
 	}
-	else if (error < (PROP_MIN / Kp))
+	else if (error < (PROP_MIN / pid->gains.kp))
 	{
 		p_term = PROP_MIN;	
 	}
 	else
 	{
-		p_term = error * Kp;
+		p_term = error * pid->gains.kp;
 	}
 	
 	//------ Calculate I term --------//
 	if (!(mode & PID_RESET_INTEGRATOR))
-		integAcc += error * Ki;
+		pid->integAcc += error * pid->gains.ki;
 	else
-		integAcc = 0;		// May be useful for debug
+		pid->integAcc = 0;		// May be useful for debug
 
 	#ifdef INTEGRATOR_SOFT_LIMIT
 	// Soft limit is a monotone linear function f(error), f(error) = 0 when error = INTEGRATOR_SOFT_RANGE
 	// growing up to f(error) = INTEGRATOR_SOFT_MAX when error = 0
-	if (error > INTEGRATOR_SOFT_RANGE)
+	if (error > soft_range)
 		integ_max = 0;
 	else if (error < 0)
 		integ_max = INTEGRATOR_MAX;
@@ -99,50 +117,50 @@ uint8_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode)
 	{
 		//integ_max = (INTEGRATOR_SOFT_RANGE - (int32_t)error) * INTEGRATOR_SOFT_K;
 		//integ_max = (INTEGRATOR_SOFT_RANGE - (int32_t)error) * integ_soft_k;
-		integ_max = (int32_t)(INTEGRATOR_SOFT_RANGE - error) * integ_soft_k;	// <- optimized
+		integ_max = (int32_t)(soft_range - error) * pid->integ_soft_k;	// <- optimized
 	}
 
-	if (integAcc > integ_max )
+	if (pid->integAcc > integ_max )
 	{
-		integAcc = integ_max;
+		pid->integAcc = integ_max;
 	}
-	else if (integAcc < INTEGRATOR_MIN)
+	else if (pid->integAcc < INTEGRATOR_MIN)
 	{
-		integAcc = INTEGRATOR_MIN;
+		pid->integAcc = INTEGRATOR_MIN;
 	}
 	#else
 	// Simple limit
-	if (integAcc > INTEGRATOR_MAX )
+	if (pid->integAcc > INTEGRATOR_MAX )
 	{
-		integAcc = INTEGRATOR_MAX;
+		pid->integAcc = INTEGRATOR_MAX;
 	}
-	else if (integAcc < INTEGRATOR_MIN)
+	else if (pid->integAcc < INTEGRATOR_MIN)
 	{
-		integAcc = INTEGRATOR_MIN;
+		pid->integAcc = INTEGRATOR_MIN;
 	}
 	#endif
 	
-	i_term = (int16_t)(integAcc / INTEGRATOR_SCALE);	// Should not exceed MAXINT16
+	i_term = (int16_t)(pid->integAcc / pid->gains.integrator_scale);	// Should not exceed MAXINT16
 
 	//------ Calculate D term --------//
-	d_term = lastProcessValue - processValue;	
-	if (d_term > DIFF_MAX / Kd)
+	d_term = pid->lastProcessValue - processValue;	
+	if (d_term > DIFF_MAX / pid->gains.kd)
 	{
 		d_term = DIFF_MAX;
 	}
-	else if (d_term < DIFF_MIN / Kd)
+	else if (d_term < DIFF_MIN / pid->gains.kd)
 	{
 		d_term = DIFF_MIN;
 	}
 	else
 	{
-		d_term = Kd * d_term;
+		d_term = pid->gains.kd * d_term;
 	}
-	lastProcessValue = processValue;
+	pid->lastProcessValue = processValue;
 	
 	//--------- Summ terms -----------//
 	if (mode & PID_ENABLED)
-		temp = (int16_t)( ((int32_t)p_term + (int32_t)i_term + (int32_t)d_term) / SCALING_FACTOR );
+		temp = (int16_t)( ((int32_t)p_term + (int32_t)i_term + (int32_t)d_term) / pid->gains.scaling_factor );
 	else
 		temp = 0;
 	
@@ -156,10 +174,10 @@ uint8_t processPID(uint16_t setPoint, uint16_t processValue, uint8_t mode)
 	}
 	
 	//------- Debug --------//
-	dbg_PID_p_term = p_term;
-	dbg_PID_d_term = d_term;
-	dbg_PID_i_term = i_term;
-	dbg_PID_output = temp;
+	pid->dbg_p_term = p_term;
+	pid->dbg_d_term = d_term;
+	pid->dbg_i_term = i_term;
+	pid->dbg_output = temp;
 	
 	
 	return (uint8_t)temp;	
@@ -0,0 +1,244 @@
+
+#include <string.h>
+
+#include "plant_jump.h"
+
+
+// Augmented state vector layout
+#define JUMP_EFF_Z			0
+#define JUMP_STATE			(JUMP_EFF_Z + eff_NCoef)
+#define JUMP_PLANT_Z		(JUMP_STATE + 1)
+#define JUMP_FILTERED		(JUMP_PLANT_Z + plant_NCoef)
+#define JUMP_EFFECT			(JUMP_FILTERED + 1)
+#define JUMP_AMBIENT		(JUMP_EFFECT + 1)
+
+
+//-------------------------------------------------------//
+// Filter states are kept as deviations from the steady state for the current filter input.
+// TDF-II states of plant filters are large numbers that almost cancel each other,
+// deviations are small, so products with A^k do not lose precision.
+//-------------------------------------------------------//
+void PlantJump::Pack(const plant_t *plant, double effect, double *x)
+{
+	unsigned k;
+	for (k = 0; k < eff_NCoef; k++)
+		x[JUMP_EFF_Z + k] = plant->eff_filter.GetState()[k] - EffSteady[k] * effect;
+	x[JUMP_STATE] = plant->plantState;
+	for (k = 0; k < plant_NCoef; k++)
+		x[JUMP_PLANT_Z + k] = plant->plant_filter.GetState()[k] - PlantSteady[k] * plant->plantState;
+	x[JUMP_FILTERED] = plant->plantStateFiltered;
+	x[JUMP_EFFECT] = effect;
+	x[JUMP_AMBIENT] = plant->plantAmbient;
+}
+
+void PlantJump::Unpack(const double *x, plant_t *plant)
+{
+	double z[plant_NCoef];
+	unsigned k;
+	for (k = 0; k < eff_NCoef; k++)
+		z[k] = x[JUMP_EFF_Z + k] + EffSteady[k] * x[JUMP_EFFECT];
+	plant->eff_filter.SetState(z);
+	plant->plantState = x[JUMP_STATE];
+	for (k = 0; k < plant_NCoef; k++)
+		z[k] = x[JUMP_PLANT_Z + k] + PlantSteady[k] * x[JUMP_STATE];
+	plant->plant_filter.SetState(z);
+	plant->plantStateFiltered = x[JUMP_FILTERED];
+	plant->plantAmbient = x[JUMP_AMBIENT];
+}
+
+
+//-------------------------------------------------------//
+// Double-double arithmetic, error-free transformations
+// without FMA (Dekker, Knuth)
+//-------------------------------------------------------//
+
+static inline double2_t twoSum(double a, double b)
+{
+	double2_t r;
+	double v;
+	r.hi = a + b;
+	v = r.hi - a;
+	r.lo = (a - (r.hi - v)) + (b - v);
+	return r;
+}
+
+static inline void split(double a, double *hi, double *lo)
+{
+	double t = 134217729.0 * a;			// 2^27 + 1
+	*hi = t - (t - a);
+	*lo = a - *hi;
+}
+
+static inline double2_t twoProduct(double a, double b)
+{
+	double2_t r;
+	double ah, al, bh, bl;
+	r.hi = a * b;
+	split(a, &ah, &al);
+	split(b, &bh, &bl);
+	r.lo = ((ah * bh - r.hi) + ah * bl + al * bh) + al * bl;
+	return r;
+}
+
+static inline double2_t add2(double2_t a, double2_t b)
+{
+	double2_t s = twoSum(a.hi, b.hi);
+	double2_t t = twoSum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = twoSum(s.hi, s.lo);
+	s.lo += t.lo;
+	return twoSum(s.hi, s.lo);
+}
+
+static inline double2_t mul2(double2_t a, double2_t b)
+{
+	double2_t p = twoProduct(a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return twoSum(p.hi, p.lo);
+}
+
+static void multiply(const jump_matrix2_t *a, const jump_matrix2_t *b, jump_matrix2_t *result)
+{
+	unsigned i, j, k;
+	for (i = 0; i < PLANT_JUMP_DIM; i++)
+	{
+		for (j = 0; j < PLANT_JUMP_DIM; j++)
+		{
+			double2_t summ = {0, 0};
+			for (k = 0; k < PLANT_JUMP_DIM; k++)
+				summ = add2(summ, mul2(a->a[i][k], b->a[k][j]));
+			result->a[i][j] = summ;
+		}
+	}
+}
+
+
+PlantJump::PlantJump()
+{
+	KAmb = KEff = TimeConst = 0;
+}
+
+
+//-------------------------------------------------------//
+// Assembles single step matrix A: column j is processPlant() applied to basis vector j
+//-------------------------------------------------------//
+void PlantJump::Build(const plant_t *model)
+{
+	jump_matrix2_t step;
+	double x[PLANT_JUMP_DIM];
+	double y[PLANT_JUMP_DIM];
+	plant_t plant;
+	unsigned i, j;
+
+	KAmb = model->k_amb;
+	KEff = model->k_eff;
+	TimeConst = model->timeConst;
+	Powers.clear();
+	Cache.clear();
+
+	// Filter states for constant input of 1
+	initPlant(&plant, 0, 1);
+	plant.k_amb = KAmb;
+	plant.k_eff = KEff;
+	plant.timeConst = TimeConst;
+	plant.eff_filter.Init(1);
+	memcpy(EffSteady, plant.eff_filter.GetState(), sizeof(EffSteady));
+	memcpy(PlantSteady, plant.plant_filter.GetState(), sizeof(PlantSteady));
+
+	for (j = 0; j < PLANT_JUMP_DIM; j++)
+	{
+		for (i = 0; i < PLANT_JUMP_DIM; i++)
+			x[i] = (i == j) ? 1.0 : 0.0;
+		Unpack(x, &plant);
+		processPlant(&plant, x[JUMP_EFFECT]);
+		Pack(&plant, x[JUMP_EFFECT], y);
+		for (i = 0; i < PLANT_JUMP_DIM; i++)
+		{
+			step.a[i][j].hi = y[i];
+			step.a[i][j].lo = 0;
+		}
+	}
+	Powers.push_back(step);
+}
+
+
+//-------------------------------------------------------//
+// Returns A^steps, steps > 0
+//-------------------------------------------------------//
+const jump_matrix_t *PlantJump::GetMatrix(unsigned long steps)
+{
+	std::map<unsigned long, jump_matrix_t>::iterator it = Cache.find(steps);
+	jump_matrix2_t result;
+	jump_matrix2_t temp;
+	jump_matrix_t *m;
+	bool empty = true;
+	unsigned i, j;
+
+	if (it != Cache.end())
+		return &it->second;
+
+	for (j = 0; (steps >> j) != 0; j++)
+	{
+		if (j == Powers.size())
+		{
+			multiply(&Powers[j - 1], &Powers[j - 1], &temp);
+			Powers.push_back(temp);
+		}
+		if (!((steps >> j) & 1))
+			continue;
+		if (empty)
+			result = Powers[j];
+		else
+		{
+			multiply(&Powers[j], &result, &temp);
+			result = temp;
+		}
+		empty = false;
+	}
+
+	if (Cache.size() >= PLANT_JUMP_CACHE_SIZE)
+		Cache.erase(Cache.begin());
+	m = &Cache[steps];
+	for (i = 0; i < PLANT_JUMP_DIM; i++)
+	{
+		for (j = 0; j < PLANT_JUMP_DIM; j++)
+		{
+			m->hi[i][j] = result.a[i][j].hi;
+			m->lo[i][j] = result.a[i][j].lo;
+		}
+	}
+	return m;
+}
+
+
+//-------------------------------------------------------//
+// Same as calling processPlant(plant, effect) steps times,
+// up to rounding of matrix products
+//-------------------------------------------------------//
+void PlantJump::Advance(plant_t *plant, double effect, unsigned long steps)
+{
+	const jump_matrix_t *m;
+	double x[PLANT_JUMP_DIM];
+	double y[PLANT_JUMP_DIM];
+	unsigned i, k;
+
+	if (steps == 0)
+		return;
+	if (Powers.empty() || (plant->k_amb != KAmb) || (plant->k_eff != KEff) || (plant->timeConst != TimeConst))
+		Build(plant);
+	m = GetMatrix(steps);
+	Pack(plant, effect, x);
+	for (i = 0; i < PLANT_JUMP_DIM; i++)
+	{
+		double2_t summ = {0, 0};
+		double error = 0;
+		for (k = 0; k < PLANT_JUMP_DIM; k++)
+		{
+			double2_t p = twoProduct(m->hi[i][k], x[k]);
+			summ = twoSum(summ.hi, p.hi);
+			error += summ.lo + p.lo + m->lo[i][k] * x[k];
+		}
+		y[i] = summ.hi + error;
+	}
+	Unpack(y, plant);
+}
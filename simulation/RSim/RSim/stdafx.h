@@ -5,10 +5,17 @@
 
 #pragma once
 
+#ifdef _WIN32
 #include "targetver.h"
 
 #include <stdio.h>
 #include <tchar.h>
+#else
+// Non-Windows hosts: plain char command line
+#include <stdio.h>
+#define _tmain main
+typedef char _TCHAR;
+#endif
 
 
 
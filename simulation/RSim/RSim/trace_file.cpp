@@ -0,0 +1,657 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "trace_file.h"
+#include "sim_runner.h"
+
+
+typedef struct
+{
+	const char *Name;
+	int Type;
+} TraceChannelInfo_t;
+
+// Must match TraceChannel
+static const TraceChannelInfo_t channelInfo[TRACE_CHANNEL_COUNT] =
+{
+	{"col_0f",	TRACE_TYPE_F64},
+	{"col_0",	TRACE_TYPE_U16},
+	{"setting",	TRACE_TYPE_I32},
+	{"col_5",	TRACE_TYPE_I16},
+	{"col_6",	TRACE_TYPE_I16},
+	{"col_7",	TRACE_TYPE_I16},
+	{"col_8",	TRACE_TYPE_I16},
+};
+
+static const char traceMagic[8] = {'R','S','I','M','T','R','C','\0'};
+
+#define TEXT_FILE_BUFFER_SIZE	65536
+
+
+
+//-------------------------------------------------------//
+// Helpers
+//-------------------------------------------------------//
+
+static std::string makeOutputPath(const std::string &output_dir, const char *name)
+{
+	std::string path = output_dir;
+	if ((path.size() != 0) && (path[path.size() - 1] != '/') && (path[path.size() - 1] != '\\'))
+		path += '/';
+	path += name;
+	return path;
+}
+
+static void putLE(std::vector<uint8_t> &dst, uint64_t value, unsigned size)
+{
+	while (size--)
+	{
+		dst.push_back((uint8_t)value);
+		value >>= 8;
+	}
+}
+
+static uint64_t getLE(const uint8_t *src, unsigned size)
+{
+	uint64_t value = 0;
+	while (size--)
+		value = (value << 8) | src[size];
+	return value;
+}
+
+static void putVarint(std::vector<uint8_t> &dst, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		dst.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	dst.push_back((uint8_t)value);
+}
+
+// Returns number of bytes used, 0 if data is broken
+static unsigned getVarint(const uint8_t *src, const uint8_t *end, uint64_t *value)
+{
+	unsigned count = 0;
+	unsigned shift = 0;
+	*value = 0;
+	while ((src < end) && (shift < 64))
+	{
+		*value |= (uint64_t)(*src & 0x7F) << shift;
+		count++;
+		if ((*src++ & 0x80) == 0)
+			return count;
+		shift += 7;
+	}
+	return 0;
+}
+
+static uint64_t zigzagEncode(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzagDecode(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static unsigned getTypeSize(int type)
+{
+	switch (type)
+	{
+		case TRACE_TYPE_F64:	return 8;
+		case TRACE_TYPE_I32:	return 4;
+		default:				return 2;
+	}
+}
+
+// Converts raw little-endian sample to signed value
+static int64_t signExtend(uint64_t raw, int type)
+{
+	switch (type)
+	{
+		case TRACE_TYPE_I16:	return (int16_t)raw;
+		case TRACE_TYPE_U16:	return (uint16_t)raw;
+		case TRACE_TYPE_I32:	return (int32_t)raw;
+		default:				return (int64_t)raw;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Converts comma-separated list of channel names to channel mask
+//	"all" selects all channels
+// Returns 0 if list contains unknown names
+//-------------------------------------------------------//
+unsigned parseTraceChannels(const char *list)
+{
+	std::string names = list;
+	std::string name;
+	unsigned mask = 0;
+	size_t start = 0;
+	size_t end;
+	int i;
+
+	if (names == "all")
+		return TRACE_ALL_CHANNELS;
+
+	while (start <= names.size())
+	{
+		end = names.find(',', start);
+		if (end == std::string::npos)
+			end = names.size();
+		name = names.substr(start, end - start);
+		for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+		{
+			if (name == channelInfo[i].Name)
+				break;
+		}
+		if (i == TRACE_CHANNEL_COUNT)
+			return 0;
+		mask |= (1 << i);
+		start = end + 1;
+	}
+	return mask;
+}
+
+//-------------------------------------------------------//
+// Converts trace format name to TraceFormat
+// Returns -1 if name is unknown
+//-------------------------------------------------------//
+int parseTraceFormat(const char *format_str)
+{
+	if (strcmp(format_str, "text") == 0)
+		return TRACE_TEXT;
+	if (strcmp(format_str, "bin") == 0)
+		return TRACE_BINARY;
+	if (strcmp(format_str, "binz") == 0)
+		return TRACE_BINARY_COMPRESSED;
+	if (strcmp(format_str, "none") == 0)
+		return TRACE_NONE;
+	return -1;
+}
+
+const char *getTraceChannelName(int channel)
+{
+	return channelInfo[channel].Name;
+}
+
+
+
+//=======================================================//
+// TraceWriter
+//=======================================================//
+
+TraceWriter::TraceWriter()
+{
+	int i;
+	for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+		TextFiles[i] = NULL;
+	TraceFile = NULL;
+	Format = TRACE_TEXT;
+	Channels = 0;
+	BufferedSamples = 0;
+	WriteError = false;
+}
+
+TraceWriter::~TraceWriter()
+{
+	Close();
+}
+
+
+//-------------------------------------------------------//
+// Creates log files in output directory
+//	format - TraceFormat, nothing is written with TRACE_NONE
+//	channels - mask of TraceChannel bits
+//-------------------------------------------------------//
+bool TraceWriter::Open(const std::string &outputDir, int format, unsigned channels, double timestep)
+{
+	std::vector<uint8_t> header;
+	std::string path;
+	int i;
+
+	Format = format;
+	Channels = channels;
+	BufferedSamples = 0;
+	WriteError = false;
+
+	if (Format == TRACE_NONE)
+		return true;
+
+	if (Format == TRACE_TEXT)
+	{
+		for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+		{
+			if (!(Channels & (1 << i)))
+				continue;
+			path = makeOutputPath(outputDir, (std::string(channelInfo[i].Name) + ".txt").c_str());
+			if (!(TextFiles[i] = fopen(path.c_str(), "w")))
+			{
+				Close();
+				return false;
+			}
+			setvbuf(TextFiles[i], NULL, _IOFBF, TEXT_FILE_BUFFER_SIZE);
+		}
+		return true;
+	}
+
+	path = makeOutputPath(outputDir, TRACE_FILE_NAME);
+	if (!(TraceFile = fopen(path.c_str(), "wb")))
+		return false;
+
+	uint64_t timestep_bits;
+	memcpy(&timestep_bits, &timestep, sizeof(timestep_bits));
+	header.insert(header.end(), traceMagic, traceMagic + sizeof(traceMagic));
+	putLE(header, TRACE_FILE_VERSION, 2);
+	putLE(header, (Format == TRACE_BINARY_COMPRESSED) ? TRACE_FLAG_COMPRESSED : 0, 2);
+	putLE(header, 0, 2);				// channel count, filled below
+	putLE(header, 0, 2);
+	putLE(header, timestep_bits, 8);
+	unsigned channel_count = 0;
+	for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+	{
+		if (!(Channels & (1 << i)))
+			continue;
+		char name[TRACE_NAME_LENGTH] = {0};
+		strncpy(name, channelInfo[i].Name, TRACE_NAME_LENGTH - 1);
+		header.insert(header.end(), name, name + TRACE_NAME_LENGTH);
+		putLE(header, channelInfo[i].Type, 1);
+		putLE(header, 0, 3);
+		Buffer[i].reserve(TRACE_CHUNK_SAMPLES);
+		channel_count++;
+	}
+	header[12] = (uint8_t)channel_count;
+	header[13] = (uint8_t)(channel_count >> 8);
+
+	if (fwrite(&header[0], 1, header.size(), TraceFile) != header.size())
+		WriteError = true;
+	return !WriteError;
+}
+
+
+//-------------------------------------------------------//
+// Returns sample value of a channel
+// F64 values are returned as bit pattern
+//-------------------------------------------------------//
+int64_t TraceWriter::GetChannelValue(int channel, const TraceSample_t *sample)
+{
+	int64_t bits;
+	switch (channel)
+	{
+		case TRACE_STATE_FLOAT:
+			memcpy(&bits, &sample->PlantState, sizeof(bits));
+			return bits;
+		case TRACE_STATE_INT:	return sample->PlantStateInt;
+		case TRACE_SETTING:		return sample->Setting;
+		case TRACE_P_TERM:		return sample->PTerm;
+		case TRACE_D_TERM:		return sample->DTerm;
+		case TRACE_I_TERM:		return sample->ITerm;
+		default:				return sample->Output;
+	}
+}
+
+
+//-------------------------------------------------------//
+// Logs one simulation step
+//-------------------------------------------------------//
+void TraceWriter::Write(const TraceSample_t *sample)
+{
+	int i;
+
+	if (Format == TRACE_TEXT)
+	{
+		// Same output as original per-step fprintf calls
+		if (TextFiles[TRACE_STATE_FLOAT])	fprintf(TextFiles[TRACE_STATE_FLOAT], "%f\r", sample->PlantState);
+		if (TextFiles[TRACE_STATE_INT])		fprintf(TextFiles[TRACE_STATE_INT], "%u\r", sample->PlantStateInt);
+		if (TextFiles[TRACE_SETTING])		fprintf(TextFiles[TRACE_SETTING], "%d\r", (int)sample->Setting);
+		if (TextFiles[TRACE_P_TERM])		fprintf(TextFiles[TRACE_P_TERM], "%d\r", sample->PTerm);
+		if (TextFiles[TRACE_D_TERM])		fprintf(TextFiles[TRACE_D_TERM], "%d\r", sample->DTerm);
+		if (TextFiles[TRACE_I_TERM])		fprintf(TextFiles[TRACE_I_TERM], "%d\r", sample->ITerm);
+		if (TextFiles[TRACE_PID_OUTPUT])	fprintf(TextFiles[TRACE_PID_OUTPUT], "%d\r", sample->Output);
+		return;
+	}
+
+	if (!TraceFile)
+		return;
+	for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+	{
+		if (Channels & (1 << i))
+			Buffer[i].push_back(GetChannelValue(i, sample));
+	}
+	if (++BufferedSamples == TRACE_CHUNK_SAMPLES)
+		FlushChunk();
+}
+
+
+//-------------------------------------------------------//
+// Encodes buffered samples as a chunk and writes it to file
+//-------------------------------------------------------//
+bool TraceWriter::FlushChunk(void)
+{
+	std::vector<uint8_t> column;
+	unsigned size_pos;
+	unsigned i, n;
+	int64_t prev;
+	int64_t prev_delta;
+	int64_t delta;
+
+	if (BufferedSamples == 0)
+		return true;
+
+	ChunkData.clear();
+	putLE(ChunkData, BufferedSamples, 4);
+	for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+	{
+		if (!(Channels & (1 << i)))
+			continue;
+		size_pos = (unsigned)ChunkData.size();
+		putLE(ChunkData, 0, 4);
+		if (Format == TRACE_BINARY_COMPRESSED)
+		{
+			prev = 0;
+			prev_delta = 0;
+			for (n = 0; n < BufferedSamples; n++)
+			{
+				delta = Buffer[i][n] - prev;
+				if (channelInfo[i].Type == TRACE_TYPE_F64)
+				{
+					// Plant state is smooth - second difference of double bits is small
+					putVarint(ChunkData, zigzagEncode(delta - prev_delta));
+					prev_delta = delta;
+				}
+				else
+				{
+					putVarint(ChunkData, zigzagEncode(delta));
+				}
+				prev = Buffer[i][n];
+			}
+		}
+		else
+		{
+			for (n = 0; n < BufferedSamples; n++)
+				putLE(ChunkData, (uint64_t)Buffer[i][n], getTypeSize(channelInfo[i].Type));
+		}
+		n = (unsigned)ChunkData.size() - size_pos - 4;
+		ChunkData[size_pos] = (uint8_t)n;
+		ChunkData[size_pos + 1] = (uint8_t)(n >> 8);
+		ChunkData[size_pos + 2] = (uint8_t)(n >> 16);
+		ChunkData[size_pos + 3] = (uint8_t)(n >> 24);
+		Buffer[i].clear();
+	}
+	BufferedSamples = 0;
+
+	if (fwrite(&ChunkData[0], 1, ChunkData.size(), TraceFile) != ChunkData.size())
+		WriteError = true;
+	return !WriteError;
+}
+
+
+//-------------------------------------------------------//
+// Flushes buffered data and closes all files
+// Returns false if any write has failed
+//-------------------------------------------------------//
+bool TraceWriter::Close(void)
+{
+	int i;
+
+	for (i = 0; i < TRACE_CHANNEL_COUNT; i++)
+	{
+		if (TextFiles[i])
+		{
+			if (fclose(TextFiles[i]) != 0)
+				WriteError = true;
+			TextFiles[i] = NULL;
+		}
+	}
+	if (TraceFile)
+	{
+		FlushChunk();
+		if (fclose(TraceFile) != 0)
+			WriteError = true;
+		TraceFile = NULL;
+	}
+	return !WriteError;
+}
+
+
+
+//=======================================================//
+// TraceReader
+//=======================================================//
+
+TraceReader::TraceReader()
+{
+	TraceFile = NULL;
+	Timestep = 0;
+	Flags = 0;
+}
+
+TraceReader::~TraceReader()
+{
+	Close();
+}
+
+void TraceReader::Close(void)
+{
+	if (TraceFile)
+		fclose(TraceFile);
+	TraceFile = NULL;
+}
+
+
+//-------------------------------------------------------//
+// Opens trace file and reads header
+//-------------------------------------------------------//
+bool TraceReader::Open(const char *fileName)
+{
+	uint8_t header[24];
+	uint8_t descriptor[TRACE_NAME_LENGTH + 4];
+	char name[TRACE_NAME_LENGTH + 1];
+	unsigned channel_count;
+	unsigned i;
+	uint64_t bits;
+	TraceColumn_t column;
+
+	Close();
+	Header.clear();
+	if (!(TraceFile = fopen(fileName, "rb")))
+		return false;
+
+	if ((fread(header, 1, sizeof(header), TraceFile) != sizeof(header)) ||
+		(memcmp(header, traceMagic, sizeof(traceMagic)) != 0) ||
+		(getLE(&header[8], 2) != TRACE_FILE_VERSION))
+	{
+		Close();
+		return false;
+	}
+	Flags = (unsigned)getLE(&header[10], 2);
+	channel_count = (unsigned)getLE(&header[12], 2);
+	bits = getLE(&header[16], 8);
+	memcpy(&Timestep, &bits, sizeof(Timestep));
+
+	for (i = 0; i < channel_count; i++)
+	{
+		if (fread(descriptor, 1, sizeof(descriptor), TraceFile) != sizeof(descriptor))
+		{
+			Close();
+			return false;
+		}
+		memcpy(name, descriptor, TRACE_NAME_LENGTH);
+		name[TRACE_NAME_LENGTH] = '\0';
+		column.Name = name;
+		column.Type = descriptor[TRACE_NAME_LENGTH];
+		if (column.Type > TRACE_TYPE_I32)
+		{
+			Close();
+			return false;
+		}
+		Header.push_back(column);
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------//
+// Reads and decodes next chunk, appending samples to columns
+// Sets done to true at the end of file
+//-------------------------------------------------------//
+bool TraceReader::ReadChunk(std::vector<TraceColumn_t> &columns, bool *done)
+{
+	uint8_t buf[4];
+	std::vector<uint8_t> data;
+	unsigned sample_count;
+	unsigned size;
+	unsigned i, n, used;
+	const uint8_t *p;
+	const uint8_t *end;
+	int64_t prev;
+	int64_t prev_delta;
+	int64_t delta;
+	int64_t value;
+	uint64_t raw;
+	double f;
+	int type;
+
+	*done = false;
+	n = (unsigned)fread(buf, 1, 4, TraceFile);
+	if (n == 0)
+	{
+		*done = true;
+		return true;
+	}
+	if (n != 4)
+		return false;
+	sample_count = (unsigned)getLE(buf, 4);
+
+	for (i = 0; i < columns.size(); i++)
+	{
+		if (fread(buf, 1, 4, TraceFile) != 4)
+			return false;
+		size = (unsigned)getLE(buf, 4);
+		data.resize(size + 1);
+		if (fread(&data[0], 1, size, TraceFile) != size)
+			return false;
+		p = &data[0];
+		end = p + size;
+		type = columns[i].Type;
+		prev = 0;
+		prev_delta = 0;
+
+		for (n = 0; n < sample_count; n++)
+		{
+			if (Flags & TRACE_FLAG_COMPRESSED)
+			{
+				if (!(used = getVarint(p, end, &raw)))
+					return false;
+				p += used;
+				delta = zigzagDecode(raw);
+				if (type == TRACE_TYPE_F64)
+				{
+					delta += prev_delta;
+					prev_delta = delta;
+				}
+				value = prev + delta;
+				prev = value;
+			}
+			else
+			{
+				if (p + getTypeSize(type) > end)
+					return false;
+				value = signExtend(getLE(p, getTypeSize(type)), type);
+				p += getTypeSize(type);
+			}
+
+			if (type == TRACE_TYPE_F64)
+			{
+				memcpy(&f, &value, sizeof(f));
+				columns[i].FloatData.push_back(f);
+			}
+			else
+			{
+				columns[i].IntData.push_back((int32_t)value);
+			}
+		}
+	}
+	return true;
+}
+
+
+//-------------------------------------------------------//
+// Reads all samples of all channels
+//-------------------------------------------------------//
+bool TraceReader::ReadAll(std::vector<TraceColumn_t> &columns)
+{
+	bool done = false;
+
+	if (!TraceFile)
+		return false;
+	columns = Header;
+	while (!done)
+	{
+		if (!ReadChunk(columns, &done))
+			return false;
+	}
+	return true;
+}
+
+
+
+//-------------------------------------------------------//
+// Converts binary trace to legacy text log files
+// (col_0f.txt, col_0.txt, setting.txt, col_5.txt ... col_8.txt)
+//-------------------------------------------------------//
+bool convertTraceToText(const char *traceFileName, const char *outputDir)
+{
+	TraceReader reader;
+	std::vector<TraceColumn_t> columns;
+	std::string path;
+	FILE *f;
+	unsigned i, n;
+	bool result = true;
+
+	if (!reader.Open(traceFileName) || !reader.ReadAll(columns))
+	{
+		printf("Cannot read trace file %s\n", traceFileName);
+		return false;
+	}
+	if (!createOutputDirectory(outputDir))
+	{
+		printf("Cannot create output directory %s\n", outputDir);
+		return false;
+	}
+
+	for (i = 0; i < columns.size(); i++)
+	{
+		path = makeOutputPath(outputDir, (columns[i].Name + ".txt").c_str());
+		if (!(f = fopen(path.c_str(), "w")))
+		{
+			printf("Cannot create %s\n", path.c_str());
+			result = false;
+			continue;
+		}
+		setvbuf(f, NULL, _IOFBF, TEXT_FILE_BUFFER_SIZE);
+		if (columns[i].Type == TRACE_TYPE_F64)
+		{
+			for (n = 0; n < columns[i].FloatData.size(); n++)
+				fprintf(f, "%f\r", columns[i].FloatData[n]);
+		}
+		else if (columns[i].Type == TRACE_TYPE_U16)
+		{
+			for (n = 0; n < columns[i].IntData.size(); n++)
+				fprintf(f, "%u\r", (unsigned)columns[i].IntData[n]);
+		}
+		else
+		{
+			for (n = 0; n < columns[i].IntData.size(); n++)
+				fprintf(f, "%d\r", columns[i].IntData[n]);
+		}
+		if (fclose(f) != 0)
+			result = false;
+	}
+	return result;
+}
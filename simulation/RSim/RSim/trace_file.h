@@ -0,0 +1,137 @@
+
+#ifndef TRACE_FILE_H_
+#define TRACE_FILE_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "stdint.h"
+
+
+/*
+	Binary trace file (.rtr) - all numbers are little-endian
+
+	Header:
+		char		magic[8]			"RSIMTRC"
+		uint16		version				TRACE_FILE_VERSION
+		uint16		flags				TRACE_FLAG_xxx
+		uint16		channel count
+		uint16		reserved
+		double		timestep, seconds
+		channel descriptors:
+			char	name[16]			legacy log file name without ".txt"
+			uint8	type				TraceType
+			uint8	reserved[3]
+
+	Chunks, until end of file:
+		uint32		sample count
+		for every channel:
+			uint32	data size, bytes
+			data:
+				raw					- samples as is (double, int16, uint16 or int32)
+				TRACE_FLAG_COMPRESSED	- integers: difference from previous sample,
+									  doubles: second difference of sample bits (as int64),
+									  both zigzag encoded and stored as 7-bit varints.
+									  Previous sample and difference are 0 at the beginning of every chunk.
+*/
+
+#define TRACE_FILE_VERSION			1
+#define TRACE_FLAG_COMPRESSED		0x0001
+#define TRACE_CHUNK_SAMPLES			4096
+#define TRACE_NAME_LENGTH			16
+#define TRACE_FILE_NAME				"trace.rtr"
+
+
+enum TraceType {TRACE_TYPE_F64, TRACE_TYPE_I16, TRACE_TYPE_U16, TRACE_TYPE_I32};
+
+// Simulator channels. Order is the same as legacy log files
+enum TraceChannel
+{
+	TRACE_STATE_FLOAT,				// col_0f.txt	Plant state float
+	TRACE_STATE_INT,				// col_0.txt	Plant state integer
+	TRACE_SETTING,					// setting.txt	Set value
+	TRACE_P_TERM,					// col_5.txt	P-term of PID controller
+	TRACE_D_TERM,					// col_6.txt	D-term of PID controller
+	TRACE_I_TERM,					// col_7.txt	I-term of PID controller
+	TRACE_PID_OUTPUT,				// col_8.txt	Output of PID controller
+	TRACE_CHANNEL_COUNT
+};
+
+#define TRACE_ALL_CHANNELS			((1 << TRACE_CHANNEL_COUNT) - 1)
+
+enum TraceFormat {TRACE_TEXT, TRACE_BINARY, TRACE_BINARY_COMPRESSED, TRACE_NONE};
+
+
+// One simulation step
+typedef struct
+{
+	double PlantState;
+	uint16_t PlantStateInt;
+	int32_t Setting;
+	int16_t PTerm;
+	int16_t DTerm;
+	int16_t ITerm;
+	int16_t Output;
+} TraceSample_t;
+
+
+typedef struct
+{
+	std::string Name;
+	int Type;						// TraceType
+	std::vector<double> FloatData;	// TRACE_TYPE_F64 samples
+	std::vector<int32_t> IntData;	// Integer samples
+} TraceColumn_t;
+
+
+
+unsigned parseTraceChannels(const char *list);
+int parseTraceFormat(const char *format_str);
+const char *getTraceChannelName(int channel);
+
+
+// Writes simulation log either as legacy text files or as a binary trace
+class TraceWriter
+{
+public:
+	TraceWriter();
+	~TraceWriter();
+	bool Open(const std::string &outputDir, int format, unsigned channels, double timestep);
+	void Write(const TraceSample_t *sample);
+	bool Close(void);
+private:
+	int64_t GetChannelValue(int channel, const TraceSample_t *sample);
+	bool FlushChunk(void);
+	int Format;
+	unsigned Channels;
+	FILE *TextFiles[TRACE_CHANNEL_COUNT];
+	FILE *TraceFile;
+	std::vector<int64_t> Buffer[TRACE_CHANNEL_COUNT];
+	std::vector<uint8_t> ChunkData;
+	unsigned BufferedSamples;
+	bool WriteError;
+};
+
+
+// Reads binary trace file
+class TraceReader
+{
+public:
+	TraceReader();
+	~TraceReader();
+	bool Open(const char *fileName);
+	bool ReadAll(std::vector<TraceColumn_t> &columns);
+	void Close(void);
+	double Timestep;
+	unsigned Flags;
+private:
+	bool ReadChunk(std::vector<TraceColumn_t> &columns, bool *done);
+	FILE *TraceFile;
+	std::vector<TraceColumn_t> Header;
+};
+
+
+bool convertTraceToText(const char *traceFileName, const char *outputDir);
+
+
+#endif /* TRACE_FILE_H_ */
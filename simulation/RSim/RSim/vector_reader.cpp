@@ -1,10 +1,10 @@
 
 #include <stdio.h>
-#include <windows.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <stdlib.h>
+#include <string.h>
 using namespace std;
 
 
@@ -12,8 +12,13 @@ using namespace std;
 
 #include "vector_reader.h"
 
-vector<VectorRecord_t> formedForceVector;
-unsigned int VectorPtr;
+VectorReader::VectorReader()
+{
+	VectorPtr = 0;
+	Verbose = true;
+	StartConditions.AmbientValid = false;
+	StartConditions.StateValid = false;
+}
 
 
 bool VectorReader::GetNextVector(VectorRecord_t *rec)
@@ -26,11 +31,11 @@ bool VectorReader::GetNextVector(VectorRecord_t *rec)
 }
 
 
-bool VectorReader::ReadVectorFile(char *fileName)
+bool VectorReader::ReadVectorFile(const char *fileName)
 {
 	ifstream in_stream;
 	char line[256];
-	char delims[] = " \t";
+	char delims[] = " \t\r";
 	vector<char*> words;
 	VectorRecord_t newRecord;
 	bool result = true;
@@ -42,7 +47,8 @@ bool VectorReader::ReadVectorFile(char *fileName)
 
 	try 
 	{
-		cout << "Reading file: " << fileName << endl;
+		if (Verbose)
+			cout << "Reading file: " << fileName << endl;
 
 		in_stream.open(fileName);
 		if (in_stream.is_open()) 
@@ -58,7 +64,8 @@ bool VectorReader::ReadVectorFile(char *fileName)
 				//	cout << words[i] << "\n";
 				if (words.size() < 2)
 				{
-					cout << "Test vector file record error. Scipping this record." << endl;
+					if (Verbose)
+						cout << "Test vector file record error. Scipping this record." << endl;
 					continue;
 				}
 
@@ -90,7 +97,8 @@ bool VectorReader::ReadVectorFile(char *fileName)
 					formedForceVector.push_back(newRecord); 
 				}
 			}
-			cout << "Total read: " << formedForceVector.size() << " records" << endl;
+			if (Verbose)
+				cout << "Total read: " << formedForceVector.size() << " records" << endl;
 		}
 		else 
 		{
@@ -27,12 +27,15 @@ typedef struct
 class VectorReader
 {
 public:
-	bool ReadVectorFile(char *fileName);	
+	VectorReader();
+	bool ReadVectorFile(const char *fileName);	
 	bool GetNextVector(VectorRecord_t *rec);
 	StartCondition_t StartConditions;
+	bool Verbose;							// Print file reading messages to console
 private:
 	vector<char*> SplitByDelims(char source[], char delims[] );
-	
+	vector<VectorRecord_t> formedForceVector;
+	unsigned int VectorPtr;
 };
 
 
@@ -0,0 +1,50 @@
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.h"
+
+
+
+//-------------------------------------------------------//
+// Returns number of hardware threads, at least 1
+//-------------------------------------------------------//
+unsigned getDefaultThreadCount(void)
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return (n == 0) ? 1 : n;
+}
+
+
+//-------------------------------------------------------//
+// Runs task(i) for every i in [0 : count-1] using a bounded pool of worker threads.
+// Workers take the next index from a shared counter, so long and short
+// tasks are balanced automatically. Returns when all tasks are done.
+//	threads = 0 means all hardware threads
+//-------------------------------------------------------//
+void parallelFor(unsigned count, unsigned threads, const std::function<void(unsigned)> &task)
+{
+	std::atomic<unsigned> next_index(0);
+	std::vector<std::thread> workers;
+	unsigned i;
+
+	if (threads == 0)
+		threads = getDefaultThreadCount();
+	if (threads > count)
+		threads = count;
+
+	auto worker = [&]() {
+		unsigned index;
+		while ((index = next_index++) < count)
+			task(index);
+	};
+
+	// Calling thread works too
+	for (i = 1; i < threads; i++)
+		workers.push_back(std::thread(worker));
+	if (count != 0)
+		worker();
+	for (i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
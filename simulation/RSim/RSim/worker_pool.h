@@ -0,0 +1,12 @@
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <functional>
+
+
+unsigned getDefaultThreadCount(void);
+void parallelFor(unsigned count, unsigned threads, const std::function<void(unsigned)> &task);
+
+
+#endif /* WORKER_POOL_H_ */